@@ -0,0 +1,221 @@
+// =====================================================================================
+// Benchmark for the sparse products of one EM step: A*p and A^T*r
+// Compares the serial COO scatter, the "smart" thread-local scatter merged
+// under a critical section, and the CSR/CSC row gathers used by the estimators
+// Copyright 2025, NGSFeatures Project
+// =====================================================================================
+
+#include "EmEngine.hh"
+#include "SparseMatrixBuilder.hh"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <cmath>
+#include <cstdint>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Same threshold as benchmark_smart_optimized_em.cc
+const size_t PARALLEL_THRESHOLD = 5000;
+
+// ============================================================================
+// COO scatter variants (as in benchmark_smart_optimized_em.cc)
+// ============================================================================
+
+std::vector<double> sparseM_vec_prod_original(const std::vector<double>& p,
+                                              const std::vector<int>& rowId,
+                                              const std::vector<int>& colId,
+                                              const std::vector<double>& realVal) {
+    std::vector<double> Result(p.size(), 0.0);
+    for (unsigned i = 0; i < rowId.size(); i++) {
+        Result[rowId[i]] += realVal[i] * p[colId[i]];
+    }
+    return Result;
+}
+
+std::vector<double> sparseM_vec_prod_smart(const std::vector<double>& p,
+                                           const std::vector<int>& rowId,
+                                           const std::vector<int>& colId,
+                                           const std::vector<double>& realVal) {
+    std::vector<double> Result(p.size(), 0.0);
+
+    if (rowId.size() >= PARALLEL_THRESHOLD) {
+#pragma omp parallel
+        {
+            std::vector<double> local_result(p.size(), 0.0);
+
+#pragma omp for nowait schedule(static)
+            for (size_t i = 0; i < rowId.size(); i++) {
+                local_result[rowId[i]] += realVal[i] * p[colId[i]];
+            }
+
+#pragma omp critical
+            {
+                for (size_t i = 0; i < p.size(); i++) {
+                    Result[i] += local_result[i];
+                }
+            }
+        }
+    } else {
+        for (size_t i = 0; i < rowId.size(); i++) {
+            Result[rowId[i]] += realVal[i] * p[colId[i]];
+        }
+    }
+
+    return Result;
+}
+
+// ============================================================================
+// Timer utility
+// ============================================================================
+
+class Timer {
+   public:
+    void start() { start_time = std::chrono::high_resolution_clock::now(); }
+
+    double elapsed_ms() {
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+        return duration.count() / 1000.0;
+    }
+
+   private:
+    std::chrono::time_point<std::chrono::high_resolution_clock> start_time;
+};
+
+// ============================================================================
+// Benchmark functions
+// ============================================================================
+
+// Read-error matrix shaped like the real one: a diagonal entry per tag plus a
+// varying number of neighbors, so the rows are deliberately unbalanced
+CsrMatrix make_error_matrix(size_t num_sequences, std::mt19937& gen) {
+    std::uniform_int_distribution<size_t> col_dist(0, num_sequences - 1);
+    std::uniform_int_distribution<int> degree_dist(0, 12);
+    std::uniform_real_distribution<> prop_dist(0.001, 0.05);
+
+    SparseMatrixBuilder builder(num_sequences, num_sequences * 7);
+    for (size_t i = 0; i < num_sequences; ++i) {
+        builder.addEntry(static_cast<std::uint32_t>(i), 0.9);
+        int degree = (i % 64 == 0) ? 3 * degree_dist(gen) : degree_dist(gen);
+        for (int k = 0; k < degree; ++k) {
+            builder.addEntry(static_cast<std::uint32_t>(col_dist(gen)), prop_dist(gen));
+        }
+        builder.endRow();
+    }
+    return builder.finish();
+}
+
+void benchmark_spmv(size_t num_sequences, size_t num_iterations) {
+    std::mt19937 gen(42);
+    CsrMatrix A = make_error_matrix(num_sequences, gen);
+    CsrMatrix At = TransposeCsr(A);
+
+    // COO arrays of the same matrix for the scatter variants
+    std::vector<int> IA, JA;
+    std::vector<double> RA = A.values;
+    IA.reserve(A.nnz());
+    for (size_t i = 0; i < A.numRows; ++i) {
+        for (std::uint64_t k = A.rowPtr[i]; k < A.rowPtr[i + 1]; ++k) {
+            IA.push_back(static_cast<int>(i));
+        }
+    }
+    JA.assign(A.colIdx.begin(), A.colIdx.end());
+
+    std::uniform_real_distribution<> count_dist(1.0, 100.0);
+    std::vector<double> rawCount(num_sequences);
+    for (size_t i = 0; i < num_sequences; ++i) {
+        rawCount[i] = count_dist(gen);
+    }
+    std::vector<double> p(num_sequences, 1.0 / num_sequences);
+
+    std::cout << "  nnz = " << A.nnz() << std::endl;
+
+    double checksum[3] = {0.0, 0.0, 0.0};
+    double elapsed[4];
+    const char* labels[4] = {"Serial COO scatter ", "Smart COO scatter  ",
+                             "CSR/CSC gather     ", "Fused EmEngine step"};
+
+    for (int version = 0; version < 3; ++version) {
+        Timer timer;
+        timer.start();
+        for (size_t iter = 0; iter < num_iterations; ++iter) {
+            std::vector<double> q, s;
+            if (version == 0) {
+                q = sparseM_vec_prod_original(p, IA, JA, RA);
+                s = sparseM_vec_prod_original(q, JA, IA, RA);
+            } else if (version == 1) {
+                q = sparseM_vec_prod_smart(p, IA, JA, RA);
+                s = sparseM_vec_prod_smart(q, JA, IA, RA);
+            } else {
+                q = MultiplyCsr(A, p);
+                s = MultiplyCsr(At, q);
+            }
+            checksum[version] += s[iter % num_sequences];
+        }
+        elapsed[version] = timer.elapsed_ms();
+    }
+
+    EmEngine em(A, At, rawCount);
+    std::vector<double> theM = rawCount;
+    Timer timer;
+    timer.start();
+    for (size_t iter = 0; iter < num_iterations; ++iter) {
+        em.step(theM, static_cast<double>(num_sequences));
+    }
+    elapsed[3] = timer.elapsed_ms();
+
+    for (int version = 0; version < 4; ++version) {
+        std::cout << "  " << labels[version] << ": " << elapsed[version] << " ms"
+                  << " [Speedup: " << elapsed[0] / elapsed[version] << "x]" << std::endl;
+    }
+
+    if (std::fabs(checksum[1] - checksum[0]) > 1e-9 * std::fabs(checksum[0]) ||
+        std::fabs(checksum[2] - checksum[0]) > 1e-9 * std::fabs(checksum[0])) {
+        std::cout << "  WARNING: variants disagree" << std::endl;
+    }
+}
+
+int main() {
+    std::cout << "========================================" << std::endl;
+#ifdef _OPENMP
+    std::cout << "OpenMP enabled with " << omp_get_max_threads() << " threads" << std::endl;
+#else
+    std::cout << "WARNING: OpenMP not enabled!" << std::endl;
+#endif
+    std::cout << "========================================" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "Sparse Matrix-Vector Product Benchmark" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << std::endl;
+
+    const size_t num_iterations = 50;
+
+    struct TestCase {
+        size_t sequences;
+        const char* name;
+    };
+
+    TestCase test_cases[] = {{1000, "Medium dataset (1,000 sequences)"},
+                             {100000, "Large dataset (100,000 sequences)"},
+                             {1000000, "Very large dataset (1,000,000 sequences)"}};
+
+    for (const auto& test : test_cases) {
+        std::cout << test.name << " - 50 iterations of A*p and A^T*r:" << std::endl;
+        benchmark_spmv(test.sequences, num_iterations);
+        std::cout << std::endl;
+    }
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Benchmark complete!" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return 0;
+}
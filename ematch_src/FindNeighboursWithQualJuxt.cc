@@ -3,11 +3,14 @@
 // Copyright 2009, Edward Wijaya
 // =====================================================================================
 
+#include "QualityModel.hh"
+
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <cmath>
@@ -60,12 +63,6 @@ std::string GetPathNameFromFilename(const std::string& filename) {
     return foundPath;
 }
 
-double Solexa2Phred(double sQ) {
-    // Convert Solexa into Phred Quality
-    double pQ = 10.00 * log(1.00 + pow(10.00, (sQ / 10.0))) / log(10.00);
-    return pQ;
-}
-
 string ConvertInt2String(int IntVal) {
     std::string S;
     std::stringstream out;
@@ -91,51 +88,37 @@ vector<int> MismatchPos(std::vector<int> STag, string Nb) {
     return MMPos;
 }
 
-double MultiplyError(std::vector<double>& Qual, std::vector<int>& Pos) {
-    double Result = 1;
-
-    for (unsigned i = 0; i < Pos.size(); i++) {
-        double err = (pow(10, -(Solexa2Phred(Qual[Pos[i]]) / 10.00))) / 3;
-        // cout << "QUAL: " << Qual[i] << " , ERR " << err << endl;
-        Result *= err;
+// Probability of reading a given wrong base at every position of a read;
+// a neighbor's error is the product over its mismatched positions
+void PositionErrors(const QualityModel& Model, std::vector<double>& Qual,
+                    std::vector<double>& Err) {
+    for (unsigned i = 0; i < Err.size(); i++) {
+        Err[i] = Model.baseErrProb(Qual[i]);
     }
-
-
-    return Result;
 }
 
-vector<int> MismatchPosByVec(std::vector<int> STag, vector<int> Nb) {
-    vector<int> MMPos;
-
-    for (unsigned i = 0; i < STag.size(); i++) {
-        int Base = Nb[i];
-        int STagBase = STag[i];
-
-        if (Base != STagBase) {
-            // cout << "\t -- " << Base << " " << STag[i] << endl;
-            MMPos.push_back(i);
+// Keys of the neighbors of a tag within 1 Hamming distance, each followed by
+// a tab: for each position substitutions 1, 2 and 3, with 0 in place of the
+// tag's own base. They depend on the tag only.
+string HammingOneNeighbors(const string& TagKey) {
+    string Keys;
+    Keys.reserve(3 * TagKey.size() * (TagKey.size() + 1));
+
+    string NbKey = TagKey;
+    for (unsigned p = 0; p < TagKey.size(); p++) {
+        for (int b = 1; b <= 3; b++) {
+            int bval = b;
+            if (TagKey[p] - '0' == b) {
+                bval = 0;
+            }
+            NbKey[p] = '0' + bval;
+            Keys += NbKey;
+            Keys += '\t';
         }
+        NbKey[p] = TagKey[p];
     }
 
-    return MMPos;
-}
-
-double normalizeQualByMismatches1Tag(std::vector<int>& SeedTag, std::vector<int> NbTags,
-                                     std::vector<double>& qual) {
-    vector<int> mmPos = MismatchPosByVec(SeedTag, NbTags);
-    double ErrorProb = MultiplyError(qual, mmPos);
-    return ErrorProb;
-}
-
-
-vector<int> neighbors(vector<int>& arg, int posNo, int baseNo) {
-    // pass base position and return neighbors
-
-    vector<int> transfVec;
-    transfVec = arg;
-    transfVec[posNo] = baseNo;
-
-    return transfVec;
+    return Keys;
 }
 
 
@@ -178,6 +161,14 @@ int main(int arg_count, char* arg_vec[]) {
 
     vector<string> DNAStrings;
 
+    // Neighbor keys of recently seen tags, so that a tag read many times is
+    // enumerated once and only its error probabilities are recomputed.
+    // Emptied when full to bound its memory.
+    const size_t MaxCachedTags = 4096;
+    unordered_map<string, string> NeighborCache;
+
+    vector<double> posErr;
+    const QualityModel Solexa(QualityScale::Solexa, QualityFormula::LogRatio);
 
     if (myfile.is_open()) {
         while (getline(myfile, line)) {
@@ -218,10 +209,12 @@ int main(int arg_count, char* arg_vec[]) {
             lookup['T'] = 3;
 
             vector<int> numTag;
+            string TagKey;
 
             for (unsigned j = 0; j < DNA.size(); j++) {
                 int cb = lookup[DNA[j]];  // converted base
                 numTag.push_back(cb);
+                TagKey += '0' + cb;
             }
 
             prn_vec_binos<int>(numTag, rawFile);
@@ -232,32 +225,28 @@ int main(int arg_count, char* arg_vec[]) {
             nbqFile << "\t";
 
             if (hd == 1) {
-                for (unsigned p = 0; p < numTag.size(); p++) {
-                    for (int b = 1; b <= 3; b++) {
-                        // cerr << " Pos: " << p << ", base= " << b << endl;
-
-                        int bval = b;
-                        if (numTag[p] == b) {
-                            bval = 0;
-                        }
-
-                        vector<int> nbnumTag = neighbors(numTag, p, bval);
-                        double nrmQual = normalizeQualByMismatches1Tag(numTag, nbnumTag, qualBase);
-
+                auto cached = NeighborCache.find(TagKey);
+                if (cached == NeighborCache.end()) {
+                    if (NeighborCache.size() >= MaxCachedTags) {
+                        NeighborCache.clear();
+                    }
+                    cached = NeighborCache.emplace(TagKey, HammingOneNeighbors(TagKey)).first;
+                }
+                const string& NbKeys = cached->second;
 
-                        // prn_vec <int>(nbnumTag);
-                        // cout << "\t";
-                        // cout << nrmQual << "\t";
+                posErr.resize(numTag.size());
+                PositionErrors(Solexa, qualBase, posErr);
 
-                        prn_vec_binos<int>(nbnumTag, nbqFile);
-                        nbqFile << "\t";
-                        nbqFile << nrmQual << "\t";
-                    }
+                // Each neighbor differs from the tag at one position only
+                const size_t KeyLength = TagKey.size() + 1;
+                for (unsigned n = 0; n < 3 * numTag.size(); n++) {
+                    nbqFile.write(&NbKeys[n * KeyLength], KeyLength);
+                    nbqFile << posErr[n / 3] << "\t";
                 }
 
                 // cout << endl;
-                rawFile << endl;
-                nbqFile << endl;
+                rawFile << "\n";
+                nbqFile << "\n";
             } else {
                 cerr << "Only HD <= 1 is accepted" << endl;
                 return EXIT_FAILURE;
@@ -0,0 +1,204 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.9
+ *  Last Modified: $Date$
+ *  Description: See header file.
+ */
+#include <cmath>
+#include <limits>
+#include "RecountAndersonTagCorrector.hh"
+
+namespace cbrc{
+
+
+/* --------------- CONSTRUCTORS --------------- */
+
+RecountAndersonTagCorrector::RecountAndersonTagCorrector
+(  const RecountExpectationComputer&     expectationComputer,
+   const RecountTagCounts&               observedCounts,
+   const size_t                          numRoundsToWaitForBetter,
+   const tagCountT                       tolerance,
+   const size_t                          historySize
+   )
+  : expectationComputer        (  expectationComputer       ),
+    observedCounts             (  observedCounts            ),
+    _numRoundsToWaitForBetter  (  numRoundsToWaitForBetter  ),
+    _tolerance                 (  tolerance                 ),
+    _historySize               (  historySize               )
+{
+  const size_t  numTags  =  observedCounts.size();
+
+  expectedCounts.setSize( numTags );
+  estTrue       .setSize( numTags );
+  prevEstTrue   .setSize( numTags );
+  residual      .setSize( numTags );
+  prevResidual  .setSize( numTags );
+
+
+  /* ---------- Initialize Current Best Solution Info ---------- */
+  _bestEstError  =  std::numeric_limits<tagCountT>::max();
+  _bestEstCounts.setSize( numTags );
+  _bestEstCounts.zero();
+  _bestEstCountsIteration  =  0;
+  _numIterations           =  0;
+}
+
+
+
+void RecountAndersonTagCorrector::inferTrueTagCounts(){
+
+  const size_t  numTags  =  observedCounts.size();
+
+  estTrue.assign( observedCounts );
+  clearHistory();
+
+  std::vector<double>  gamma;
+
+  // ITERATIVE_SEARCH:
+  for(  size_t curIteration = 0;  ;  ++curIteration  ){
+
+    expectationComputer.meanCountsFromTrue( expectedCounts, estTrue );
+    ++_numIterations;
+
+    tagCountT  maxResidual  =  0.0;
+    for(  size_t i = 0;  i < numTags;  ++i  ){
+      residual[i]  =  observedCounts(i) - expectedCounts(i);
+      maxResidual  =  std::max(  maxResidual,  (tagCountT) fabs( residual(i) )  );
+    }
+
+    if(  maxResidual < bestEstError()  ){
+      _bestEstError  =  maxResidual;
+      _bestEstCountsIteration  =  curIteration;
+      _bestEstCounts.assign( estTrue );
+    }
+
+    if(  maxResidual <= tolerance()  )  break;   // CONVERGED
+
+    if(  curIteration - bestEstCountsIteration()  >=  numRoundsToWaitForBetter()  )  break;
+
+
+    if(  curIteration > 0  )  pushHistory();
+
+    prevEstTrue .assign( estTrue  );
+    prevResidual.assign( residual );
+
+    // fall back to a plain step when the history cannot be solved for
+    gamma.clear();
+    if(  !dResidual.empty()  &&  !solveMixingCoefficients( gamma )  ){
+      clearHistory();
+      gamma.clear();
+    }
+
+    for(  size_t i = 0;  i < numTags;  ++i  ){
+      tagCountT  next  =  estTrue(i) + residual(i);
+      for(  size_t j = 0;  j < gamma.size();  ++j  ){
+	next  -=  gamma[j] * ( dEstTrue[j][i] + dResidual[j][i] );
+      }
+      estTrue[i]  =  next;
+    }
+  }
+
+} // end inferTrueTagCounts
+
+
+
+void RecountAndersonTagCorrector::pushHistory(){
+
+  if(  !historySize()  )  return;
+
+  const size_t  numTags  =  observedCounts.size();
+
+  if(  dResidual.size() == historySize()  ){
+    dEstTrue .erase( dEstTrue .begin() );
+    dResidual.erase( dResidual.begin() );
+    dResidualDots.erase( dResidualDots.begin() );
+    for(  size_t j = 0;  j < dResidualDots.size();  ++j  ){
+      dResidualDots[j].erase( dResidualDots[j].begin() );
+    }
+  }
+
+  dEstTrue .push_back(  std::vector<tagCountT>( numTags )  );
+  dResidual.push_back(  std::vector<tagCountT>( numTags )  );
+
+  std::vector<tagCountT>&  dX  =  dEstTrue .back();
+  std::vector<tagCountT>&  dR  =  dResidual.back();
+
+  for(  size_t i = 0;  i < numTags;  ++i  ){
+    dX[i]  =  estTrue (i) - prevEstTrue (i);
+    dR[i]  =  residual(i) - prevResidual(i);
+  }
+
+  // inner products of the new residual difference with all of them
+  const size_t  newIdx  =  dResidual.size() - 1;
+
+  dResidualDots.push_back(  std::vector<double>( newIdx + 1 )  );
+
+  for(  size_t j = 0;  j <= newIdx;  ++j  ){
+    double  dot  =  0.0;
+    for(  size_t i = 0;  i < numTags;  ++i  )  dot  +=  dResidual[j][i] * dR[i];
+    dResidualDots[newIdx][j]  =  dot;
+    if( j < newIdx )  dResidualDots[j].push_back( dot );
+  }
+}
+
+
+
+void RecountAndersonTagCorrector::clearHistory(){
+  dEstTrue     .clear();
+  dResidual    .clear();
+  dResidualDots.clear();
+}
+
+
+
+bool RecountAndersonTagCorrector::solveMixingCoefficients(  std::vector<double>&  gamma  ) const{
+
+  const size_t  m        =  dResidual.size();
+  const size_t  numTags  =  observedCounts.size();
+
+  // normal equations  (dR' dR) gamma = dR' residual,  as an augmented matrix
+  std::vector< std::vector<double> >  a( m, std::vector<double>( m+1 ) );
+
+  double  maxDiag  =  0.0;
+  for(  size_t j = 0;  j < m;  ++j  ){
+    for(  size_t k = 0;  k < m;  ++k  )  a[j][k]  =  dResidualDots[j][k];
+    double  dot  =  0.0;
+    for(  size_t i = 0;  i < numTags;  ++i  )  dot  +=  dResidual[j][i] * residual(i);
+    a[j][m]  =  dot;
+    maxDiag  =  std::max( maxDiag, a[j][j] );
+  }
+
+  if(  maxDiag <= 0.0  )  return false;
+
+  // Gaussian elimination with partial pivoting
+  for(  size_t col = 0;  col < m;  ++col  ){
+
+    size_t  pivot  =  col;
+    for(  size_t row = col+1;  row < m;  ++row  ){
+      if(  fabs( a[row][col] ) > fabs( a[pivot][col] )  )  pivot  =  row;
+    }
+
+    if(  fabs( a[pivot][col] )  <  1e-12 * maxDiag  )  return false;
+
+    a[col].swap( a[pivot] );
+
+    for(  size_t row = col+1;  row < m;  ++row  ){
+      const double  factor  =  a[row][col] / a[col][col];
+      for(  size_t k = col;  k <= m;  ++k  )  a[row][k]  -=  factor * a[col][k];
+    }
+  }
+
+  gamma.assign( m, 0.0 );
+  for(  size_t j = m;  j-- > 0;  ){
+    double  sum  =  a[j][m];
+    for(  size_t k = j+1;  k < m;  ++k  )  sum  -=  a[j][k] * gamma[k];
+    gamma[j]  =  sum / a[j][j];
+  }
+
+  return true;
+}
+
+
+} // end namespace cbrc
@@ -0,0 +1,122 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.9
+ *  Last Modified: $Date$
+ *
+ *  Description: Same search as RecountExpectationMatchingTagCorrector,
+ *               for true counts x whose expected counts E(x) match the
+ *               observed counts, but accelerated with Anderson mixing.
+ *
+ *               The plain corrector iterates the fixed point map
+ *               x <- x + r(x), with residual r(x) = observed - E(x).
+ *               Here each step instead combines the last historySize()
+ *               iterates: with dX, dR the differences of successive
+ *               iterates and residuals, gamma minimizes |r - dR gamma|
+ *               and
+ *
+ *                   x  <-  x + r - (dX + dR) gamma
+ *
+ *               Each step still costs one pass over the neighbor graph,
+ *               but far fewer steps are needed.  A historySize() of 0
+ *               gives the plain fixed point iteration.
+ *
+ *               The search stops when max_i |r_i| is at most the
+ *               tolerance, or after numRoundsToWaitForBetter steps
+ *               without a smaller residual.
+ *
+ *  Purpose: Created for the RECOUNT project.
+ *
+ */
+#ifndef RECOUNTANDERSONTAGCORRECTOR_HH_
+#define RECOUNTANDERSONTAGCORRECTOR_HH_
+#include <iostream>
+#include <vector>
+#include "RecountExpectationComputer.hh"
+
+namespace cbrc{
+
+class RecountAndersonTagCorrector{
+public:
+
+  /* --------------- CONSTRUCTORS --------------- */
+  RecountAndersonTagCorrector
+  (  const RecountExpectationComputer&     expectationComputer,
+     const RecountTagCounts&               observedCounts,
+     const size_t                          numRoundsToWaitForBetter  =  10,
+     const tagCountT                       tolerance                 =  0.0,
+     const size_t                          historySize               =  5
+     );
+
+
+  /* --------------- ACCESSORS --------------- */
+  const size_t&  numRoundsToWaitForBetter() const{
+    return _numRoundsToWaitForBetter;
+  }
+
+  const tagCountT&  tolerance() const{  return _tolerance;  }
+
+  const size_t&  historySize() const{  return _historySize;  }
+
+  // max_i |observed(i) - expected(i)| of bestEstCounts()
+  const tagCountT&  bestEstError() const{
+    return _bestEstError;
+  }
+
+  const RecountTagCounts&  bestEstCounts() const{
+    return _bestEstCounts;
+  }
+
+  const size_t&  bestEstCountsIteration() const{
+    return _bestEstCountsIteration;
+  }
+
+  // number of expected count computations (passes over the graph)
+  const size_t&  numIterations() const{
+    return _numIterations;
+  }
+
+
+  void inferTrueTagCounts();
+
+private:
+  // set gamma to minimize |residual - sum_j gamma[j] dR[j]|;
+  // false if the history is too ill conditioned to solve
+  bool  solveMixingCoefficients(  /***/ std::vector<double>&  gamma  ) const;
+
+  // append the differences of the last two iterates to the history,
+  // dropping the oldest differences beyond historySize()
+  void  pushHistory();
+
+  void  clearHistory();
+
+  /* --------------- OBJECT DATA --------------- */
+  const RecountExpectationComputer&     expectationComputer;
+  const RecountTagCounts&               observedCounts;
+
+  /* ---------- Optimization Search Parameters ---------- */
+  const size_t     _numRoundsToWaitForBetter;
+  const tagCountT  _tolerance;
+  const size_t     _historySize;
+
+
+  RecountTagCounts  expectedCounts;
+
+  // current and previous iterate and their residuals
+  RecountTagCounts  estTrue,  prevEstTrue;
+  RecountTagCounts  residual, prevResidual;
+
+  // differences of successive iterates and residuals, oldest first,
+  // and the inner products of the residual differences
+  std::vector< std::vector<tagCountT> >  dEstTrue, dResidual;
+  std::vector< std::vector<double> >     dResidualDots;
+
+  tagCountT         _bestEstError;
+  RecountTagCounts  _bestEstCounts;
+  size_t            _bestEstCountsIteration;
+  size_t            _numIterations;
+};
+
+} // end namespace cbrc
+#endif // RECOUNTANDERSONTAGCORRECTOR_HH_
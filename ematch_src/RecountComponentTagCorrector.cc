@@ -0,0 +1,256 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.10
+ *  Last Modified: $Date$
+ *  Description: See header file.
+ */
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "utils/gdb/gdbUtils.hh"
+#include "RecountComponentTagCorrector.hh"
+
+namespace cbrc{
+
+
+namespace{
+
+  // components are batched until a batch holds at least this many tags
+  const size_t  minBatchSize  =  1024;
+
+} // end anonymous namespace
+
+
+
+/* --------------- CONSTRUCTORS --------------- */
+
+RecountComponentTagCorrector::RecountComponentTagCorrector
+(  const RecountNeighborProbGraphInMemory&  neighborProbGraph,
+   const RecountTagCounts&                  observedCounts,
+   const size_t                             numRoundsToWaitForBetter,
+   const tagCountT                          tolerance,
+   const size_t                             numThreads
+   )
+  : neighborProbGraph          (  neighborProbGraph         ),
+    observedCounts             (  observedCounts            ),
+    _numRoundsToWaitForBetter  (  numRoundsToWaitForBetter  ),
+    _tolerance                 (  tolerance                 ),
+    _numThreads                (  std::max<size_t>( numThreads, 1 )  )
+{
+  init(  RecountGraphComponents( neighborProbGraph, observedCounts.size(), numThreads )  );
+}
+
+
+
+RecountComponentTagCorrector::RecountComponentTagCorrector
+(  const RecountNeighborProbGraphInMemory&  neighborProbGraph,
+   const RecountGraphComponents&            graphComponents,
+   const RecountTagCounts&                  observedCounts,
+   const size_t                             numRoundsToWaitForBetter,
+   const tagCountT                          tolerance,
+   const size_t                             numThreads
+   )
+  : neighborProbGraph          (  neighborProbGraph         ),
+    observedCounts             (  observedCounts            ),
+    _numRoundsToWaitForBetter  (  numRoundsToWaitForBetter  ),
+    _tolerance                 (  tolerance                 ),
+    _numThreads                (  std::max<size_t>( numThreads, 1 )  )
+{
+  init( graphComponents );
+}
+
+
+
+void RecountComponentTagCorrector::init(  const RecountGraphComponents&  graphComponents  ){
+
+  const RecountNeighborProbGraphInMemory&  graph  =  neighborProbGraph;
+
+  const size_t   numTags      =  observedCounts.size();
+  const tagIdT*  neighborIds  =  graph.neighborIds();
+  const size_t   numEntries   =  graph.numNeighborEntries();
+
+  DO_OR_DIEF(  graphComponents.size() == numTags,
+	       "Graph components are of %zu tags, but there are %zu counts",
+	       graphComponents.size(), numTags  );
+
+  for(  size_t k = 0;  k < numEntries;  ++k  ){
+    GDB_ASSERTF(  neighborIds[k] < numTags,
+		  "Graph has neighbor id %zu but only %zu counts",
+		  size_t( neighborIds[k] ), numTags  );
+  }
+
+  const size_t  numComponents  =  graphComponents.numComponents();
+
+
+  /* ---------- Order The Components, Largest First ---------- */
+  std::vector<size_t>  componentOrder( numComponents );
+  for(  size_t c = 0;  c < numComponents;  ++c  )  componentOrder[c]  =  c;
+
+  std::stable_sort(  componentOrder.begin(),  componentOrder.end(),
+		     [&graphComponents]( const size_t& c0, const size_t& c1 ){
+		       return  graphComponents.componentSize(c0) > graphComponents.componentSize(c1);
+		     }  );
+
+  // first position of each component, then of each tag
+  std::vector<size_t>  componentBegin( numComponents );
+  _componentOffsets.assign( numComponents + 1, 0 );
+  for(  size_t i = 0;  i < numComponents;  ++i  ){
+    componentBegin[ componentOrder[i] ]  =  _componentOffsets[i];
+    _componentOffsets[i + 1]  =  _componentOffsets[i] + graphComponents.componentSize( componentOrder[i] );
+  }
+
+  _tagOrder.resize( numTags );
+  std::vector<size_t>  tagPosition( numTags );
+  for(  size_t tag = 0;  tag < numTags;  ++tag  ){
+    const size_t  pos  =  componentBegin[ graphComponents.componentId( tag ) ]++;
+    _tagOrder  [pos]  =  tag;
+    tagPosition[tag]  =  pos;
+  }
+
+  // the large components go alone, the small ones in batches
+  _batchOffsets.assign( 1, 0 );
+  for(  size_t i = 1;  i <= numComponents;  ++i  ){
+    if(  i == numComponents
+	 ||  _componentOffsets[i] - _batchOffsets.back() >= minBatchSize  ){
+      _batchOffsets.push_back( _componentOffsets[i] );
+    }
+  }
+
+
+  /* ---------- Transposed Graph By Position ---------- */
+  // count the in-edges of every position, then place the edges node by
+  // node so that each position lists its sources in file order
+  _inOffsets.assign( numTags + 1, 0 );
+  for(  size_t k = 0;  k < numEntries;  ++k  ){
+    ++_inOffsets[ tagPosition[ neighborIds[k] ] + 1 ];
+  }
+  for(  size_t p = 0;  p < numTags;  ++p  ){
+    _inOffsets[p + 1]  +=  _inOffsets[p];
+  }
+
+  _inSources.resize( numEntries );
+  _inProbs  .resize( numEntries );
+
+  std::vector<size_t>  next( _inOffsets.begin(), _inOffsets.end() - 1 );
+
+  for(  size_t node = 0;  node < graph.size();  ++node  ){
+    for(  size_t k = graph.offset( node );  k < graph.offset( node + 1 );  ++k  ){
+      const size_t  in  =  next[ tagPosition[ neighborIds[k] ] ]++;
+      _inSources[in]  =  tagPosition[ graph.nodeId( node ) ];
+      _inProbs  [in]  =  graph.hasFloatProbs()
+	?  probT( graph.neighborProbsFloat()[k] )
+	:  graph.neighborProbs()[k];
+    }
+  }
+
+
+  _observed.resize( numTags );
+  for(  size_t p = 0;  p < numTags;  ++p  )  _observed[p]  =  observedCounts( _tagOrder[p] );
+
+  _estTrue[0].resize( numTags );
+  _estTrue[1].resize( numTags );
+
+
+  /* ---------- Initialize Current Best Solution Info ---------- */
+  _bestEstError  =  std::numeric_limits<tagCountT>::max();
+  _bestEstCounts.setSize( observedCounts.size() );
+  _bestEstCounts.zero();
+  _bestEstCountsIteration  =  0;
+  _numIterations           =  0;
+  _maxComponentIterations  =  0;
+}
+
+
+
+void RecountComponentTagCorrector::inferTrueTagCounts(){
+
+  const long  numBatches  =  _batchOffsets.size() - 1;
+
+  std::vector<componentResultT>  results( numComponents() );
+
+  // components in a batch are corrected one after the other by one thread
+#pragma omp parallel for num_threads( numThreads() ) schedule( dynamic, 1 )
+  for(  long batch = 0;  batch < numBatches;  ++batch  ){
+
+    size_t  c  =  std::lower_bound(  _componentOffsets.begin(),  _componentOffsets.end(),
+				     _batchOffsets[batch]  )  -  _componentOffsets.begin();
+
+    for(  ;  _componentOffsets[c] < _batchOffsets[batch + 1];  ++c  ){
+      results[c]  =  inferComponent(  _componentOffsets[c],  _componentOffsets[c + 1]  );
+    }
+  }
+
+
+  /* ---------- Combine The Component Results ---------- */
+  _bestEstError  =  0.0;
+  double  numEdgeVisits  =  0.0;
+
+  for(  size_t c = 0;  c < numComponents();  ++c  ){
+    _bestEstError            =  std::max(  _bestEstError,            results[c].bestEstError            );
+    _bestEstCountsIteration  =  std::max(  _bestEstCountsIteration,  results[c].bestEstCountsIteration  );
+    _maxComponentIterations  =  std::max(  _maxComponentIterations,  results[c].numIterations           );
+
+    // a component of only isolated tags still costs a visit per tag
+    const size_t  numEdges  =  std::max(  _inOffsets[ _componentOffsets[c + 1] ] - _inOffsets[ _componentOffsets[c] ],
+					  _componentOffsets[c + 1] - _componentOffsets[c]  );
+    numEdgeVisits  +=  double( numEdges ) * results[c].numIterations;
+  }
+
+  const double  numEdgesTotal  =  std::max<double>(  _inSources.size(),  _tagOrder.size()  );
+  _numIterations  =  numEdgesTotal > 0  ?  size_t( ceil( numEdgeVisits / numEdgesTotal ) )  :  0;
+
+} // end inferTrueTagCounts
+
+
+
+RecountComponentTagCorrector::componentResultT
+RecountComponentTagCorrector::inferComponent(  const size_t& begin,  const size_t& end  ){
+
+  componentResultT  result;
+  result.bestEstError            =  std::numeric_limits<tagCountT>::max();
+  result.bestEstCountsIteration  =  0;
+  result.numIterations           =  0;
+
+  std::vector<tagCountT>*  prev  =  &_estTrue[0];
+  std::vector<tagCountT>*  cur   =  &_estTrue[1];
+
+  for(  size_t p = begin;  p < end;  ++p  )  (*prev)[p]  =  _observed[p];
+
+  // ITERATIVE_SEARCH, as in RecountExpectationMatchingTagCorrector
+  for(  size_t curIteration = 0;
+	curIteration - result.bestEstCountsIteration  <=  numRoundsToWaitForBetter();
+	std::swap( prev, cur ), ++curIteration
+	){
+
+    ++result.numIterations;
+
+    tagCountT  curMaxCountDiff  =  0.0;
+
+    for(  size_t p = begin;  p < end;  ++p  ){
+
+      tagCountT  expected  =  0;
+      for(  size_t k = _inOffsets[p];  k < _inOffsets[p + 1];  ++k  ){
+	expected  +=  (*prev)[ _inSources[k] ] * _inProbs[k];
+      }
+
+      (*cur)[p]  =  (*prev)[p] + _observed[p] - expected;
+
+      curMaxCountDiff  =  std::max(  curMaxCountDiff,  (tagCountT) fabs( (*cur)[p] - (*prev)[p] )  );
+    }
+
+    if(  curMaxCountDiff < result.bestEstError  ){
+      result.bestEstError            =  curMaxCountDiff;
+      result.bestEstCountsIteration  =  curIteration;
+      for(  size_t p = begin;  p < end;  ++p  )  _bestEstCounts[ _tagOrder[p] ]  =  (*cur)[p];
+    }
+
+    if(  curMaxCountDiff <= tolerance()  )  break;   // CONVERGED
+  }
+
+  return result;
+}
+
+
+} // end namespace cbrc
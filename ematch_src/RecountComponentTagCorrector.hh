@@ -0,0 +1,156 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.10
+ *  Last Modified: $Date$
+ *
+ *  Description: Same search as RecountExpectationMatchingTagCorrector,
+ *               but done separately for each connected component of the
+ *               neighbor graph.
+ *
+ *               The expected count of a tag depends only on the true
+ *               counts of tags in its own component, so the components
+ *               can be corrected independently.  Each one iterates until
+ *               its own estimates stop improving (or change by at most
+ *               the tolerance), instead of until those of the slowest
+ *               component in the graph do, and most components are
+ *               singletons or pairs which settle in a few rounds.
+ *
+ *               The components are found by RecountGraphComponents, or
+ *               given precomputed (as written by
+ *               dumpRecountNeighborProbGraphOnDisk_ConnectedComponentSize).
+ *               The tags are renumbered so that each component is
+ *               contiguous, and each component keeps its own transposed
+ *               graph, listing the sources of every tag in file order so
+ *               that each round gives the same estimates as
+ *               RecountComputerForGraphInMemory.  Components are handed
+ *               to the threads largest first; small ones are batched.
+ *
+ *  Purpose: Created for the RECOUNT project.
+ *
+ */
+#ifndef RECOUNTCOMPONENTTAGCORRECTOR_HH_
+#define RECOUNTCOMPONENTTAGCORRECTOR_HH_
+#include <iostream>
+#include <vector>
+#include "RecountGraphComponents.hh"
+#include "RecountNeighborProbGraphInMemory.hh"
+#include "RecountTagCounts.hh"
+
+namespace cbrc{
+
+class RecountComponentTagCorrector{
+public:
+
+  /* --------------- CONSTRUCTORS --------------- */
+  RecountComponentTagCorrector
+  (  const RecountNeighborProbGraphInMemory&  neighborProbGraph,
+     const RecountTagCounts&                  observedCounts,
+     const size_t                             numRoundsToWaitForBetter  =  10,
+     const tagCountT                          tolerance                 =  0.0,
+     const size_t                             numThreads                =  0
+     );
+
+  // same, with the components of the graph already computed
+  RecountComponentTagCorrector
+  (  const RecountNeighborProbGraphInMemory&  neighborProbGraph,
+     const RecountGraphComponents&            graphComponents,
+     const RecountTagCounts&                  observedCounts,
+     const size_t                             numRoundsToWaitForBetter  =  10,
+     const tagCountT                          tolerance                 =  0.0,
+     const size_t                             numThreads                =  0
+     );
+
+
+  /* --------------- ACCESSORS --------------- */
+  const size_t&  numRoundsToWaitForBetter() const{
+    return _numRoundsToWaitForBetter;
+  }
+
+  const tagCountT&  tolerance() const{  return _tolerance;  }
+
+  const size_t&  numThreads() const{  return _numThreads;  }
+
+  size_t  numComponents() const{  return  _componentOffsets.size() - 1;  }
+
+  // largest over the components of their best estimate's error
+  const tagCountT&  bestEstError() const{
+    return _bestEstError;
+  }
+
+  const RecountTagCounts&  bestEstCounts() const{
+    return _bestEstCounts;
+  }
+
+  // largest over the components of the round of their best estimate
+  const size_t&  bestEstCountsIteration() const{
+    return _bestEstCountsIteration;
+  }
+
+  // work done, in passes over the whole graph: the rounds of each
+  // component weighted by its share of the neighbor entries, rounded up
+  const size_t&  numIterations() const{
+    return _numIterations;
+  }
+
+  // most rounds done by any component
+  const size_t&  maxComponentIterations() const{
+    return _maxComponentIterations;
+  }
+
+
+  void inferTrueTagCounts();
+
+private:
+  // result of correcting one component
+  struct componentResultT{
+    tagCountT  bestEstError;
+    size_t     bestEstCountsIteration;
+    size_t     numIterations;
+  };
+
+  // fill the component and transposed graph arrays below,
+  // and initialize the best solution info
+  void  init(  const RecountGraphComponents&  graphComponents  );
+
+  // correct the tags at positions [begin, end), one whole component or more
+  componentResultT  inferComponent(  const size_t& begin,  const size_t& end  );
+
+  /* --------------- OBJECT DATA --------------- */
+  const RecountNeighborProbGraphInMemory&  neighborProbGraph;
+  const RecountTagCounts&                  observedCounts;
+
+  /* ---------- Optimization Search Parameters ---------- */
+  const size_t     _numRoundsToWaitForBetter;
+  const tagCountT  _tolerance;
+  const size_t     _numThreads;
+
+  // tag ids grouped by component, largest component first, and the
+  // position of each component's first tag in it
+  tagIdVecT            _tagOrder;
+  std::vector<size_t>  _componentOffsets;
+
+  // positions at which each batch of components starts
+  std::vector<size_t>  _batchOffsets;
+
+  // transposed graph by position: the tag at position p is a neighbor of
+  // the tags at positions _inSources[k] with probability _inProbs[k],
+  // for k in [_inOffsets[p], _inOffsets[p+1])
+  std::vector<size_t>  _inOffsets;
+  std::vector<size_t>  _inSources;
+  probVecT             _inProbs;
+
+  // observed counts and two rounds of estimates, by position
+  std::vector<tagCountT>  _observed;
+  std::vector<tagCountT>  _estTrue[2];
+
+  tagCountT         _bestEstError;
+  RecountTagCounts  _bestEstCounts;
+  size_t            _bestEstCountsIteration;
+  size_t            _numIterations;
+  size_t            _maxComponentIterations;
+};
+
+} // end namespace cbrc
+#endif // RECOUNTCOMPONENTTAGCORRECTOR_HH_
@@ -0,0 +1,198 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.5.13
+ *  Last Modified: $Date$
+ *  Description: See header file.
+ */
+#include <algorithm>
+#include "RecountComputerForGraphInMemory.hh"
+
+
+namespace cbrc{
+
+
+namespace{
+
+  // observedCounts[j] += trueCount(i) * prob(i,j) over all edges i -> j;
+  // templated on the stored probability type
+  template <typename storedProbT>
+  void addMeanCounts(  /***/ RecountTagCounts&                 observedCounts,
+		       const RecountTagCounts&                 trueCounts,
+		       const RecountNeighborProbGraphInMemory&  graph,
+		       const storedProbT*                      neighborProbs  ){
+
+    const tagIdT*  neighborIds  =  graph.neighborIds();
+
+    for(  size_t node = 0;  node < graph.size();  ++node  ){
+
+      const tagCountT&  trueTagCount  =  trueCounts(  graph.nodeId( node )  );
+
+      const size_t  end  =  graph.offset( node + 1 );
+
+      for(  size_t k = graph.offset( node );  k < end;  ++k  ){
+	observedCounts[ neighborIds[k] ]  +=  trueTagCount * probT( neighborProbs[k] );
+      }
+    }
+  }
+
+
+  // variances[j] += trueCount(i) * (1 - prob(i,j)) * prob(i,j) over all edges i -> j
+  template <typename storedProbT>
+  void addVarianceCounts(  /***/ RecountTagCounts&                 variances,
+			   const RecountTagCounts&                 trueCounts,
+			   const RecountNeighborProbGraphInMemory&  graph,
+			   const storedProbT*                      neighborProbs  ){
+
+    const tagIdT*  neighborIds  =  graph.neighborIds();
+
+    for(  size_t node = 0;  node < graph.size();  ++node  ){
+
+      const tagCountT&  trueTagCount  =  trueCounts(  graph.nodeId( node )  );
+
+      const size_t  end  =  graph.offset( node + 1 );
+
+      for(  size_t k = graph.offset( node );  k < end;  ++k  ){
+	const probT  prob  =  neighborProbs[k];
+	variances[ neighborIds[k] ]  +=  trueTagCount *  (1 - prob) * prob;
+      }
+    }
+  }
+
+
+  // observedCounts[j] = sum_k f( trueCount(inSourceIds[k]), inProbs[k] ),
+  // tags divided between numThreads threads
+  template <typename termFunctionT>
+  void gatherCounts(  /***/ RecountTagCounts&     observedCounts,
+		      const RecountTagCounts&     trueCounts,
+		      const std::vector<size_t>&  inOffsets,
+		      const tagIdVecT&            inSourceIds,
+		      const probVecT&             inProbs,
+		      const size_t&               numThreads,
+		      termFunctionT               f  ){
+
+    const long  numTargets  =  inOffsets.size() - 1;
+
+    GDB_ASSERTF(  size_t( numTargets ) <= observedCounts.size(),
+		  "Graph has neighbor ids up to %ld but only %zu counts",
+		  numTargets, observedCounts.size()  );
+
+#pragma omp parallel for num_threads( numThreads ) schedule( dynamic, 1024 )
+    for(  long j = 0;  j < numTargets;  ++j  ){
+
+      tagCountT  sum  =  0;
+
+      for(  size_t k = inOffsets[j];  k < inOffsets[j + 1];  ++k  ){
+	sum  +=  f(  trueCounts( inSourceIds[k] ),  inProbs[k]  );
+      }
+
+      observedCounts[j]  =  sum;
+    }
+  }
+
+} // end anonymous namespace
+
+
+
+void RecountComputerForGraphInMemory::buildTransposed(){
+
+  const RecountNeighborProbGraphInMemory&  graph  =  neighborProbGraph();
+
+  const tagIdT*  neighborIds  =  graph.neighborIds();
+  const size_t   numEntries   =  graph.numNeighborEntries();
+
+  size_t  numTargets  =  graph.tagID_to_seq().size();
+  for(  size_t k = 0;  k < numEntries;  ++k  ){
+    numTargets  =  std::max<size_t>( numTargets, neighborIds[k] + 1 );
+  }
+
+  // count the in-edges of every tag, then place the edges node by node so
+  // that each tag lists its sources in file order
+  _inOffsets.assign( numTargets + 1, 0 );
+  for(  size_t k = 0;  k < numEntries;  ++k  ){
+    ++_inOffsets[ neighborIds[k] + 1 ];
+  }
+  for(  size_t j = 0;  j < numTargets;  ++j  ){
+    _inOffsets[j + 1]  +=  _inOffsets[j];
+  }
+
+  _inSourceIds.resize( numEntries );
+  _inProbs    .resize( numEntries );
+
+  std::vector<size_t>  next( _inOffsets.begin(), _inOffsets.end() - 1 );
+
+  for(  size_t node = 0;  node < graph.size();  ++node  ){
+    for(  size_t k = graph.offset( node );  k < graph.offset( node + 1 );  ++k  ){
+      const size_t  pos  =  next[ neighborIds[k] ]++;
+      _inSourceIds[pos]  =  graph.nodeId( node );
+      _inProbs    [pos]  =  graph.hasFloatProbs()
+	?  probT( graph.neighborProbsFloat()[k] )
+	:  graph.neighborProbs()[k];
+    }
+  }
+}
+
+
+
+void
+RecountComputerForGraphInMemory::
+meanCountsFromTrue(  /***/ RecountTagCounts& observedCounts,
+		     const RecountTagCounts& trueCounts  ) const{
+
+  GDB_ASSERTF(  observedCounts.size() == trueCounts.size(),
+	        "Expected equal sizes but got observedCounts:%zu, trueCounts:%zu",
+	        observedCounts.size(), trueCounts.size()  );
+
+  observedCounts.zero();
+
+  if(  !_inOffsets.empty()  ){
+    gatherCounts(  observedCounts, trueCounts, _inOffsets, _inSourceIds, _inProbs, numThreads(),
+		   []( const tagCountT& trueTagCount, const probT& prob ){
+		     return  trueTagCount * prob;
+		   }  );
+  }
+  else if(  neighborProbGraph().hasFloatProbs()  ){
+    addMeanCounts(  observedCounts, trueCounts, neighborProbGraph(),
+		    neighborProbGraph().neighborProbsFloat()  );
+  }
+  else{
+    addMeanCounts(  observedCounts, trueCounts, neighborProbGraph(),
+		    neighborProbGraph().neighborProbs()  );
+  }
+
+}
+
+
+
+void
+RecountComputerForGraphInMemory::
+varianceCountsFromTrue(  /***/ RecountTagCounts& variances,
+			 const RecountTagCounts& trueCounts  ) const{
+
+  GDB_ASSERTF(  variances.size() == trueCounts.size(),
+	        "Expected equal sizes but got variances:%zu, trueCounts:%zu",
+	        variances.size(), trueCounts.size()  );
+
+  variances.zero();
+
+  if(  !_inOffsets.empty()  ){
+    gatherCounts(  variances, trueCounts, _inOffsets, _inSourceIds, _inProbs, numThreads(),
+		   []( const tagCountT& trueTagCount, const probT& prob ){
+		     return  trueTagCount *  (1 - prob) * prob;
+		   }  );
+  }
+  else if(  neighborProbGraph().hasFloatProbs()  ){
+    addVarianceCounts(  variances, trueCounts, neighborProbGraph(),
+			neighborProbGraph().neighborProbsFloat()  );
+  }
+  else{
+    addVarianceCounts(  variances, trueCounts, neighborProbGraph(),
+			neighborProbGraph().neighborProbs()  );
+  }
+
+}
+
+
+
+} // end namespace cbrc
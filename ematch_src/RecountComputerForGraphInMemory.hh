@@ -0,0 +1,85 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.5.13
+ *  Last Modified: $Date$
+ *
+ *  Description: Class to compute various quantaties using
+ *               RecountNeighborProbGraphInMemory as representation
+ *               of neighbor graph.  Gives the same results as
+ *               RecountComputerForGraphOnDisk, which visits the
+ *               nodes and neighbors in the same order.
+ *
+ *               Given a number of threads, the computer builds the
+ *               transposed graph, listing for each tag the nodes which
+ *               have it as a neighbor in file order, and each thread
+ *               gathers the counts of its own tags.  Every count is
+ *               summed by a single thread in a fixed order, so the
+ *               results are the same for any number of threads.
+ *               Without it, counts are scattered along the graph
+ *               by one thread and no transposed copy is kept.
+ *
+ *  Purpose: Created for RECOUNT project.
+ *
+ */
+#ifndef RECOUNTCOMPUTERFORGRAPHINMEMORY_HH_
+#define RECOUNTCOMPUTERFORGRAPHINMEMORY_HH_
+#include <iostream>
+#include <vector>
+#include "RecountExpectationComputer.hh"
+#include "RecountNeighborProbGraphInMemory.hh"
+#include "RecountTagCounts.hh"
+
+namespace cbrc{
+
+class RecountComputerForGraphInMemory : public RecountExpectationComputer{
+public:
+  /* ********** CONSTRUCTORS ********** */
+  RecountComputerForGraphInMemory( const RecountNeighborProbGraphInMemory& neighborProbGraph,
+				   const size_t&                           numThreads  =  0 )
+    : _neighborProbGraph( neighborProbGraph ),
+      _numThreads( numThreads )
+  {
+    if( numThreads > 0 )  buildTransposed();
+  }
+
+  /* ********** ACCESSORS ********** */
+  const RecountNeighborProbGraphInMemory&  neighborProbGraph() const
+  {
+    return _neighborProbGraph;
+  }
+
+  // 0 for the serial scatter
+  const size_t&  numThreads() const{  return _numThreads;  }
+
+  /* ********** METHODS ********** */
+  // set observedCounts(i) to the mean number of counts of tag i
+  void meanCountsFromTrue(  /***/ RecountTagCounts& observedCounts,
+			    const RecountTagCounts& trueCounts  ) const override;
+
+
+  // set observedCounts(i) to the variance of the number of counts of tag i
+  void varianceCountsFromTrue(  /***/ RecountTagCounts& variances,
+				const RecountTagCounts& trueCounts  ) const override;
+
+
+
+private:
+  // fill the _in* arrays from the graph
+  void buildTransposed();
+
+  // object data
+  const RecountNeighborProbGraphInMemory&  _neighborProbGraph;
+
+  const size_t  _numThreads;
+
+  // transposed graph: tag j is a neighbor of tags _inSourceIds[k] with
+  // probability _inProbs[k], for k in [_inOffsets[j], _inOffsets[j+1])
+  std::vector<size_t>  _inOffsets;
+  tagIdVecT            _inSourceIds;
+  probVecT             _inProbs;
+};
+
+} // end namespace cbrc
+#endif // RECOUNTCOMPUTERFORGRAPHINMEMORY_HH_
@@ -15,12 +15,13 @@
 #ifndef RECOUNTCOMPUTERFORGRAPHONDISK_HH_
 #define RECOUNTCOMPUTERFORGRAPHONDISK_HH_
 #include <iostream>
+#include "RecountExpectationComputer.hh"
 #include "RecountNeighborProbGraphOnDisk.hh"
 #include "RecountTagCounts.hh"
 
 namespace cbrc{
 
-class RecountComputerForGraphOnDisk{
+class RecountComputerForGraphOnDisk : public RecountExpectationComputer{
 public:
   /* ********** CONSTRUCTORS ********** */
   RecountComputerForGraphOnDisk( RecountNeighborProbGraphOnDisk& neighborProbGraph )
@@ -36,12 +37,12 @@ public:
   /* ********** METHODS ********** */
   // set observedCounts(i) to the mean number of counts of tag i
   void meanCountsFromTrue(  /***/ RecountTagCounts& observedCounts,
-			    const RecountTagCounts& trueCounts  ) const;
+			    const RecountTagCounts& trueCounts  ) const override;
 
 
   // set observedCounts(i) to the variance of the number of counts of tag i
   void varianceCountsFromTrue(  /***/ RecountTagCounts& variances,
-				const RecountTagCounts& trueCounts  ) const;
+				const RecountTagCounts& trueCounts  ) const override;
 
 
 
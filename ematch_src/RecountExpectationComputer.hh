@@ -0,0 +1,37 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.5.13
+ *  Last Modified: $Date$
+ *
+ *  Description: Abstract interface for computing the observed counts
+ *               expected from a set of true counts, independent of how
+ *               the neighbor graph is stored.
+ *
+ *  Purpose: Created for RECOUNT project.
+ *
+ */
+#ifndef RECOUNTEXPECTATIONCOMPUTER_HH_
+#define RECOUNTEXPECTATIONCOMPUTER_HH_
+#include <iostream>
+#include "RecountTagCounts.hh"
+
+namespace cbrc{
+
+class RecountExpectationComputer{
+public:
+  /* ********** METHODS ********** */
+  // set observedCounts(i) to the mean number of counts of tag i
+  virtual void meanCountsFromTrue(  /***/ RecountTagCounts& observedCounts,
+				    const RecountTagCounts& trueCounts  ) const = 0;
+
+  // set observedCounts(i) to the variance of the number of counts of tag i
+  virtual void varianceCountsFromTrue(  /***/ RecountTagCounts& variances,
+					const RecountTagCounts& trueCounts  ) const = 0;
+
+  virtual ~RecountExpectationComputer(){}
+};
+
+} // end namespace cbrc
+#endif // RECOUNTEXPECTATIONCOMPUTER_HH_
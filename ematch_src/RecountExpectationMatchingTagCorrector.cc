@@ -15,13 +15,15 @@ namespace cbrc{
 /* --------------- CONSTRUCTORS --------------- */
 
 RecountExpectationMatchingTagCorrector::RecountExpectationMatchingTagCorrector
-(  const RecountComputerForGraphOnDisk&  expectationComputer,
+(  const RecountExpectationComputer&     expectationComputer,
    const RecountTagCounts&               observedCounts,
-   const size_t                          numRoundsToWaitForBetter
+   const size_t                          numRoundsToWaitForBetter,
+   const tagCountT                       tolerance
    )
   : expectationComputer        (  expectationComputer       ),
     observedCounts             (  observedCounts            ),
-    _numRoundsToWaitForBetter  (  numRoundsToWaitForBetter  )
+    _numRoundsToWaitForBetter  (  numRoundsToWaitForBetter  ),
+    _tolerance                 (  tolerance                 )
 {
   _curIdx = 0;
 
@@ -36,6 +38,7 @@ RecountExpectationMatchingTagCorrector::RecountExpectationMatchingTagCorrector
   _bestEstCounts.setSize( observedCounts.size() );
   _bestEstCounts.zero();
   _bestEstCountsIteration  =  0;
+  _numIterations           =  0;
 }
 
 
@@ -51,6 +54,7 @@ void RecountExpectationMatchingTagCorrector::inferTrueTagCounts(){
 
     expectationComputer.meanCountsFromTrue(  expectedCounts,
 					     estTrueCounts[ prevIdx() ]  );
+    ++_numIterations;
 
     computeCountCorrections();
 
@@ -64,6 +68,8 @@ void RecountExpectationMatchingTagCorrector::inferTrueTagCounts(){
       _bestEstCountsIteration  =  curIteration;
       _bestEstCounts.assign(  estTrueCounts[  curIdx() ]  );
     }
+
+    if(  curMaxCountDiff <= tolerance()  )  break;   // CONVERGED
   }
 
 
@@ -16,7 +16,7 @@
 #ifndef RECOUNTEXPECTATIONMATCHINGTAGCORRECTOR_HH_
 #define RECOUNTEXPECTATIONMATCHINGTAGCORRECTOR_HH_
 #include <iostream>
-#include "RecountComputerForGraphOnDisk.hh"
+#include "RecountExpectationComputer.hh"
 
 namespace cbrc{
 
@@ -27,9 +27,10 @@ public:
 
   /* --------------- CONSTRUCTORS --------------- */
   RecountExpectationMatchingTagCorrector
-  (  const RecountComputerForGraphOnDisk&  expectationComputer,
+  (  const RecountExpectationComputer&     expectationComputer,
      const RecountTagCounts&               observedCounts,
-     const size_t                          numRoundsToWaitForBetter  =  10
+     const size_t                          numRoundsToWaitForBetter  =  10,
+     const tagCountT                       tolerance                 =  0.0
      );
 
 
@@ -42,6 +43,10 @@ public:
     return  estTrueCounts[ curIdx() ];
   }
 
+  // stop once successive estimates differ by at most this much, 0 to
+  // stop only after numRoundsToWaitForBetter() rounds without improvement
+  const tagCountT&  tolerance() const{  return _tolerance;  }
+
   const tagCountT&  bestEstError() const{
     return _bestEstError;
   }
@@ -54,6 +59,11 @@ public:
     return _bestEstCountsIteration;
   }
 
+  // number of expected count computations (passes over the graph)
+  const size_t&            numIterations() const{
+    return _numIterations;
+  }
+
 
   /* --------------- Current/Previous Index Methods --------------- */
 
@@ -79,11 +89,12 @@ public:
 private:
 
   /* --------------- OBJECT DATA --------------- */
-  const RecountComputerForGraphOnDisk&  expectationComputer;
+  const RecountExpectationComputer&     expectationComputer;
   const RecountTagCounts&               observedCounts;
 
   /* ---------- Optimization Search Parameters ---------- */
-  const size_t  _numRoundsToWaitForBetter;
+  const size_t     _numRoundsToWaitForBetter;
+  const tagCountT  _tolerance;
 
 
   RecountTagCounts  expectedCounts;
@@ -94,6 +105,7 @@ private:
   tagCountT         _bestEstError;
   RecountTagCounts  _bestEstCounts;
   size_t            _bestEstCountsIteration;
+  size_t            _numIterations;
 
   int  _curIdx;
 };
@@ -0,0 +1,188 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.12
+ *  Last Modified: $Date$
+ *  Description: See header file.
+ */
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include "utils/gdb/gdbUtils.hh"
+#include "RecountGraphComponents.hh"
+
+namespace cbrc{
+
+
+namespace{
+
+  typedef  RecountGraphComponents::componentIdT  componentIdT;
+
+  typedef  std::atomic<componentIdT>  parentT;
+
+
+  // root of the tree holding x, pointing nodes on the way at their
+  // grandparents.  Every parent has a smaller index than its child, so a
+  // failed or stale update only leaves a node pointing a little higher.
+  componentIdT  findRoot(  parentT* parent,  componentIdT x  ){
+
+    for(;;){
+      componentIdT  p  =  parent[x].load( std::memory_order_relaxed );
+      if(  p == x  )  return x;
+
+      const componentIdT  grandparent  =  parent[p].load( std::memory_order_relaxed );
+      if(  grandparent != p  ){
+	parent[x].compare_exchange_weak( p, grandparent, std::memory_order_relaxed );
+      }
+      x  =  grandparent;
+    }
+  }
+
+
+  // join the trees of x and y, linking the root of larger index under the other
+  void  unite(  parentT* parent,  componentIdT x,  componentIdT y  ){
+
+    for(;;){
+      x  =  findRoot( parent, x );
+      y  =  findRoot( parent, y );
+
+      if(  x == y  )  return;
+
+      if(  x < y  )  std::swap( x, y );
+
+      // fails if another thread linked x meanwhile; then look again
+      componentIdT  expected  =  x;
+      if(  parent[x].compare_exchange_strong( expected, y, std::memory_order_relaxed )  )  return;
+    }
+  }
+
+} // end anonymous namespace
+
+
+
+/* ********** CONSTRUCTORS ********** */
+
+RecountGraphComponents::RecountGraphComponents(  const RecountNeighborProbGraphInMemory&  graph,
+						 const size_t&                            numTags,
+						 const size_t&                            numThreads  ){
+
+  DO_OR_DIEF(  numTags < size_t( componentIdT(-1) ),
+	       "Too many tags (%zu) for 32 bit component ids", numTags  );
+
+  const tagIdT*  neighborIds  =  graph.neighborIds();
+
+  const std::unique_ptr<parentT[]>  parent(  new parentT[numTags]  );
+  for(  size_t i = 0;  i < numTags;  ++i  )  parent[i].store( i, std::memory_order_relaxed );
+
+
+  /* ***** Add the edges of the graph's nodes, divided between threads ***** */
+  const long  numNodes  =  graph.size();
+
+#pragma omp parallel for num_threads( std::max<size_t>( numThreads, 1 ) ) schedule( dynamic, 1024 )
+  for(  long node = 0;  node < numNodes;  ++node  ){
+
+    const componentIdT  nodeId  =  graph.nodeId( node );
+
+    GDB_ASSERTF(  nodeId < numTags,
+		  "Graph has node id %zu but only %zu tags", size_t( nodeId ), numTags  );
+
+    for(  size_t k = graph.offset( node );  k < graph.offset( node + 1 );  ++k  ){
+
+      GDB_ASSERTF(  neighborIds[k] < numTags,
+		    "Graph has neighbor id %zu but only %zu tags", size_t( neighborIds[k] ), numTags  );
+
+      if(  neighborIds[k] != nodeId  )  unite( parent.get(), nodeId, neighborIds[k] );
+    }
+  }
+
+
+  /* ***** Number the components in the order of their lowest tag ***** */
+  // roots have the lowest index in their tree, so are numbered before
+  // any other tag of their component is reached
+  _componentIds.resize( numTags );
+
+  componentIdT  numComponents  =  0;
+
+  for(  size_t i = 0;  i < numTags;  ++i  ){
+    const componentIdT  root  =  findRoot( parent.get(), i );
+    _componentIds[i]  =  ( root == i )  ?  numComponents++  :  _componentIds[root];
+  }
+
+  countSizes( numComponents );
+}
+
+
+
+RecountGraphComponents::RecountGraphComponents(  std::istream&  iStream  ){
+
+  std::string  signature( binarySignature().size(), '\0' );
+  iStream.read(  &signature[0], signature.size()  );
+
+  DO_OR_DIEF(  !iStream.fail() && signature == binarySignature(),
+	       "Input error. Binary graph components signature not found"  );
+
+  binaryHeaderT  header;
+  iStream.read(  (char*) &header, sizeof(header)  );
+
+  DO_OR_DIEF(  !iStream.fail() && header.byteOrderMark == binaryByteOrderMark(),
+	       "Input error. Binary graph components header unreadable or of other byte order"  );
+
+  _componentIds.resize( header.numTags );
+  iStream.read(  (char*) _componentIds.data(),  header.numTags * sizeof(componentIdT)  );
+
+  std::vector<sizeCountT>  sizeHistogram( header.numHistogramEntries );
+  iStream.read(  (char*) sizeHistogram.data(),  header.numHistogramEntries * sizeof(sizeCountT)  );
+
+  DO_OR_DIEF(  !iStream.fail(),
+	       "Input error. Binary graph components file truncated"  );
+
+  for(  size_t i = 0;  i < size();  ++i  ){
+    DO_OR_DIEF(  _componentIds[i] < header.numComponents,
+		 "Input error. Tag %zu has component id %u, but there are only %zu components",
+		 i, _componentIds[i], size_t( header.numComponents )  );
+  }
+
+  countSizes( header.numComponents );
+
+  DO_OR_DIEF(  sizeHistogram == _sizeHistogram,
+	       "Input error. Component size histogram does not match the component ids"  );
+}
+
+
+
+/* ********** METHODS ********** */
+
+void  RecountGraphComponents::countSizes(  const size_t& numComponents  ){
+
+  _componentSizes.assign( numComponents, 0 );
+  for(  size_t i = 0;  i < size();  ++i  )  ++_componentSizes[ _componentIds[i] ];
+
+  std::map<uint64_t, uint64_t>  sizeCounts;
+  for(  size_t c = 0;  c < numComponents;  ++c  )  ++sizeCounts[ _componentSizes[c] ];
+
+  _sizeHistogram.assign( sizeCounts.begin(), sizeCounts.end() );
+}
+
+
+
+void  RecountGraphComponents::write(  std::ostream& oStream  ) const{
+
+  binaryHeaderT  header;
+  header.byteOrderMark        =  binaryByteOrderMark();
+  header.reserved             =  0;
+  header.numTags              =  size();
+  header.numComponents        =  numComponents();
+  header.numHistogramEntries  =  _sizeHistogram.size();
+
+  oStream.write(  binarySignature().data(),  binarySignature().size()  );
+  oStream.write(  (const char*) &header,  sizeof(header)  );
+  oStream.write(  (const char*) _componentIds.data(),  size() * sizeof(componentIdT)  );
+  oStream.write(  (const char*) _sizeHistogram.data(),  _sizeHistogram.size() * sizeof(sizeCountT)  );
+
+  DO_OR_DIEF(  !oStream.fail(),  "Output error while writing binary graph components"  );
+}
+
+
+} // end namespace cbrc
@@ -0,0 +1,115 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.12
+ *  Last Modified: $Date$
+ *
+ *  Description: Connected components of the tags of a neighbor graph,
+ *               with the histogram of their sizes.
+ *
+ *               Computed with a lock free union-find forest over the
+ *               tags: the graph's nodes are divided between numThreads
+ *               threads, each adding the edges of its nodes.  A root is
+ *               only ever linked under a root of smaller index, with a
+ *               compare and swap, and finds halve the paths they follow
+ *               the same way, so concurrent unions never form a cycle.
+ *
+ *               Components are numbered 0, 1, 2, ... in the order of
+ *               their lowest tag id, as ConnectedComponentOnlineComputer
+ *               numbers them, so the numbering does not depend on the
+ *               number of threads.
+ *
+ *               write() saves the component ids and size histogram in
+ *               a binary file, which the istream constructor reads back
+ *               for the component-sharded stages downstream.
+ *
+ *  Purpose: Created for the RECOUNT project.
+ *
+ */
+#ifndef RECOUNTGRAPHCOMPONENTS_HH_
+#define RECOUNTGRAPHCOMPONENTS_HH_
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include "RecountNeighborProbGraphInMemory.hh"
+
+namespace cbrc{
+
+class RecountGraphComponents{
+public:
+
+  /* ********** TYPEDEFS ********** */
+  typedef  uint32_t  componentIdT;
+
+  // (component size, number of components of that size)
+  typedef  std::pair<uint64_t, uint64_t>  sizeCountT;
+
+
+  /* ********** CONSTRUCTORS ********** */
+
+  // components of tags 0..numTags-1 joined by the edges of neighborProbGraph
+  RecountGraphComponents(  const RecountNeighborProbGraphInMemory&  neighborProbGraph,
+			   const size_t&                            numTags,
+			   const size_t&                            numThreads  =  0  );
+
+  // read the binary format written by write()
+  RecountGraphComponents(  std::istream&  iStream  );
+
+
+  /* ********** ACCESSORS ********** */
+
+  // number of tags
+  size_t  size() const{  return _componentIds.size();  }
+
+  size_t  numComponents() const{  return _componentSizes.size();  }
+
+  const componentIdT&  componentId(  const size_t& tagId  ) const{
+    return _componentIds[tagId];
+  }
+
+  const std::vector<componentIdT>&  componentIds() const{  return _componentIds;  }
+
+  const uint64_t&  componentSize(  const size_t& componentId  ) const{
+    return _componentSizes[componentId];
+  }
+
+  // by increasing component size
+  const std::vector<sizeCountT>&  sizeHistogram() const{  return _sizeHistogram;  }
+
+
+  /* ********** METHODS ********** */
+
+  // binarySignature(), binaryHeaderT, the component id of every tag as
+  // componentIdT, then the size histogram as uint64_t pairs
+  void  write(  std::ostream& oStream  ) const;
+
+  static const std::string&  binarySignature(){
+    static const std::string  _signature( "recountComponents001\n" );
+    return _signature;
+  }
+
+private:
+  struct binaryHeaderT{
+    uint32_t  byteOrderMark;
+    uint32_t  reserved;
+    uint64_t  numTags;
+    uint64_t  numComponents;
+    uint64_t  numHistogramEntries;
+  };
+
+  static uint32_t  binaryByteOrderMark(){  return 0x01020304;  }
+
+  // fill _componentSizes and _sizeHistogram from _componentIds
+  void  countSizes(  const size_t& numComponents  );
+
+  /* ***** Object Data ***** */
+  std::vector<componentIdT>  _componentIds;
+  std::vector<uint64_t>      _componentSizes;
+  std::vector<sizeCountT>    _sizeHistogram;
+};
+
+} // end namespace cbrc
+#endif // RECOUNTGRAPHCOMPONENTS_HH_
@@ -0,0 +1,192 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.8
+ *  Last Modified: $Date$
+ *  Description: See header file.
+ */
+#include "utils/gdb/gdbUtils.hh"
+#include "QualityModel.hh"
+#include "RecountNeighborProbGraphFormat.hh"
+#include "RecountNeighborProbGraphBuilder.hh"
+
+namespace cbrc{
+
+
+/* ********** CONSTRUCTORS ********** */
+
+RecountNeighborProbGraphBuilder::RecountNeighborProbGraphBuilder
+(  const TagSet&       tagId_to_seq,
+   const size_t&       memoryBudget,
+   const std::string&  spillFilename  )
+  : _tagId_to_seq ( tagId_to_seq  ),
+    _memoryBudget ( memoryBudget  ),
+    _spillFilename( spillFilename ),
+    _size         ( 0             ),
+    _offsets      ( 1, 0          )
+{}
+
+
+
+/* ********** ACCESSORS ********** */
+
+size_t  RecountNeighborProbGraphBuilder::memoryUsed() const{
+  return(   _nodeIds      .capacity() * sizeof(tagIdT)
+	  + _offsets      .capacity() * sizeof(size_t)
+	  + _neighborIds  .capacity() * sizeof(tagIdT)
+	  + _neighborProbs.capacity() * sizeof(probT)   );
+}
+
+
+
+/* ********** CLASS METHODS ********** */
+
+probT  RecountNeighborProbGraphBuilder::substitutionProb(  const double&  solexaQual  ){
+
+  // Solexa to Phred quality, then Phred to error probability,
+  // shared equally by the three other bases; looked up for integer scores
+  static const QualityModel  solexa( QualityScale::Solexa, QualityFormula::LogRatio );
+
+  return  solexa.baseErrProb( solexaQual );
+}
+
+
+
+/* ********** METHODS ********** */
+
+void  RecountNeighborProbGraphBuilder::addTag(  const std::string&          tagSeq,
+						const std::vector<double>&  solexaQuals  ){
+
+  const size_t  tagId  =  _tagId_to_seq.getSerialNumberOrDie( tagSeq );
+
+  _residues  =  _tagId_to_seq.toUnpackedSeq( tagSeq );
+
+  DO_OR_DIEF(  solexaQuals.size() >= _residues.size(),
+	       "Tag \"%s\" has %zu quality scores for its %zu bases",
+	       tagSeq.c_str(), solexaQuals.size(), _residues.size()  );
+
+  _curNeighborIds  .clear();
+  _curNeighborProbs.clear();
+
+  probT  sumOtherProbs  =  0.0;
+
+  for(  size_t pos = 0;  pos < _residues.size();  ++pos  ){
+
+    const probT  prob      =  substitutionProb( solexaQuals[pos] );
+    const byte   original  =  _residues[pos];
+
+    GDB_ASSERTF(  ( (prob >= 0) && (prob < 0.5) ),
+		  "invalid probability value: %f", prob  );
+
+    // the other bases in the order FindNeighboursWithQualJuxt lists them
+    for(  byte base = 1;  base < 4;  ++base  ){
+
+      _residues[pos]  =  ( base == original )  ?  0  :  base;
+
+      const size_t  neighborId  =  _tagId_to_seq.find( _residues );
+
+      // skip neighbor whose tag is not in the tag list
+      if(  neighborId == _tagId_to_seq.size()  )  continue;
+
+      _curNeighborIds  .push_back( neighborId );
+      _curNeighborProbs.push_back( prob );
+      sumOtherProbs  +=  prob;
+    }
+
+    _residues[pos]  =  original;
+  }
+
+  if(  sumOtherProbs <= 1  ){
+    _curNeighborIds  .push_back( tagId );
+    _curNeighborProbs.push_back( 1.0 - sumOtherProbs );
+  }
+
+  addNode( tagId, _curNeighborIds, _curNeighborProbs );
+}
+
+
+
+void  RecountNeighborProbGraphBuilder::addNode(  const tagIdT&     tagId,
+						 const tagIdVecT&  neighborIds,
+						 const probVecT&   neighborProbs  ){
+  ++_size;
+
+  if(  spilled()  ){
+    _neighborList.set( tagId, neighborIds, neighborProbs );
+    _neighborList.write( _spillFile );
+    return;
+  }
+
+  _nodeIds.push_back( tagId );
+  _neighborIds  .insert(  _neighborIds  .end(),  neighborIds  .begin(),  neighborIds  .end()  );
+  _neighborProbs.insert(  _neighborProbs.end(),  neighborProbs.begin(),  neighborProbs.end()  );
+  _offsets.push_back( _neighborIds.size() );
+
+  if(  _memoryBudget  &&  memoryUsed() > _memoryBudget  )  spill();
+}
+
+
+
+void  RecountNeighborProbGraphBuilder::spill(){
+
+  _spillFile.open( _spillFilename.c_str(), std::ios::binary );
+
+  DO_OR_DIEF(  _spillFile.good(),
+	       "Could not open graph spill file \"%s\"", _spillFilename.c_str()  );
+
+  // version 000 file, whose node count is filled in by finish()
+  const size_t  nodeCount  =  0;
+  _spillFile.write(  RecountNeighborProbGraphFormat::signature().data(),
+		     RecountNeighborProbGraphFormat::signature().size()  );
+  _spillFile.write(  (char*) &nodeCount,  sizeof(nodeCount)  );
+
+  for(  size_t node = 0;  node < _nodeIds.size();  ++node  ){
+
+    const tagIdVecT  neighborIds(  _neighborIds.begin() + _offsets[node],
+				   _neighborIds.begin() + _offsets[node+1]  );
+    const probVecT   neighborProbs(  _neighborProbs.begin() + _offsets[node],
+				     _neighborProbs.begin() + _offsets[node+1]  );
+
+    _neighborList.set( _nodeIds[node], neighborIds, neighborProbs );
+    _neighborList.write( _spillFile );
+  }
+
+  // free the arrays
+  std::vector<tagIdT>().swap( _nodeIds       );
+  std::vector<size_t>().swap( _offsets       );
+  tagIdVecT          ().swap( _neighborIds   );
+  probVecT           ().swap( _neighborProbs );
+}
+
+
+
+void  RecountNeighborProbGraphBuilder::finish(){
+
+  if(  !spilled()  )  return;
+
+  _spillFile.seekp( RecountNeighborProbGraphFormat::signature().size() );
+  _spillFile.write(  (char*) &_size,  sizeof(_size)  );
+  _spillFile.close();
+
+  DO_OR_DIEF(  !_spillFile.fail(),
+	       "Output error while writing graph spill file \"%s\"", _spillFilename.c_str()  );
+}
+
+
+
+void  RecountNeighborProbGraphBuilder::releaseArrays(  /***/ std::vector<tagIdT>&  nodeIds,
+						       /***/ std::vector<size_t>&  offsets,
+						       /***/ tagIdVecT&            neighborIds,
+						       /***/ probVecT&             neighborProbs  ){
+
+  GDB_ASSERTF(  !spilled(),  "Graph was spilled to \"%s\"", _spillFilename.c_str()  );
+
+  nodeIds      .swap( _nodeIds       );
+  offsets      .swap( _offsets       );
+  neighborIds  .swap( _neighborIds   );
+  neighborProbs.swap( _neighborProbs );
+}
+
+
+} // end namespace cbrc
@@ -0,0 +1,121 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.8
+ *  Last Modified: $Date$
+ *
+ *  Description: Builds the neighbor graph of a tag set directly from the
+ *               per position Solexa quality scores of each tag, without
+ *               the text neighbor list (.nbq) file and
+ *               RecountNeighborProbGraphWriter.
+ *
+ *               As in FindNeighboursWithQualJuxt, the neighbors of a tag
+ *               are the tags one substitution away, with probability
+ *               10^(-phred/10)/3 for the quality of the substituted
+ *               position.  As in RecountNeighborProbGraphWriter,
+ *               neighbors not in the tag set are dropped and the tag
+ *               itself is added last with the remaining probability.
+ *
+ *               The graph is kept in the flat arrays of
+ *               RecountNeighborProbGraphInMemory until they would use
+ *               more than the memory budget.  From then on the nodes are
+ *               written to a version 000 graph file instead, to be read
+ *               with RecountNeighborProbGraphOnDisk.
+ *
+ *  Purpose: Created for RECOUNT project
+ *
+ */
+#ifndef RECOUNTNEIGHBORPROBGRAPHBUILDER_HH_
+#define RECOUNTNEIGHBORPROBGRAPHBUILDER_HH_
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "TagSet.hh"
+#include "recountTypes.hh"
+#include "RecountNeighborList.hh"
+
+namespace cbrc{
+
+class RecountNeighborProbGraphBuilder{
+public:
+
+  /* ********** CONSTRUCTORS ********** */
+
+  // memoryBudget is in bytes, 0 for no limit.
+  // spillFilename is only created if the budget is exceeded.
+  RecountNeighborProbGraphBuilder(  const TagSet&       tagId_to_seq,
+				    const size_t&       memoryBudget,
+				    const std::string&  spillFilename  );
+
+
+  /* ********** ACCESSORS ********** */
+
+  // number of nodes added
+  const size_t&  size() const{  return _size;  }
+
+  // true once the nodes are being written to spillFilename()
+  bool  spilled() const{  return _spillFile.is_open();  }
+
+  const std::string&  spillFilename() const{  return _spillFilename;  }
+
+  // bytes held by the graph arrays
+  size_t  memoryUsed() const;
+
+
+  /* ********** METHODS ********** */
+
+  // add the node of tag tagSeq, whose Solexa quality score at each
+  // position is solexaQuals[position]
+  void  addTag(  const std::string&          tagSeq,
+		 const std::vector<double>&  solexaQuals  );
+
+  // call after the last addTag; completes the spill file if there is one
+  void  finish();
+
+  // give the graph arrays to the caller, leaving the builder empty.
+  // Only when not spilled()
+  void  releaseArrays(  /***/ std::vector<tagIdT>&  nodeIds,
+			/***/ std::vector<size_t>&  offsets,
+			/***/ tagIdVecT&            neighborIds,
+			/***/ probVecT&             neighborProbs  );
+
+
+  /* ********** CLASS METHODS ********** */
+
+  // probability that a base with Solexa quality score solexaQual is read
+  // as one particular other base
+  static probT  substitutionProb(  const double&  solexaQual  );
+
+private:
+  // add the node tagId to the arrays or the spill file
+  void  addNode(  const tagIdT&     tagId,
+		  const tagIdVecT&  neighborIds,
+		  const probVecT&   neighborProbs  );
+
+  // move the nodes in the arrays to a newly opened spill file
+  void  spill();
+
+  // object data
+  const TagSet&  _tagId_to_seq;
+  const size_t   _memoryBudget;
+  std::string    _spillFilename;
+  std::ofstream  _spillFile;
+
+  size_t  _size;
+
+  std::vector<tagIdT>  _nodeIds;
+  std::vector<size_t>  _offsets;
+  tagIdVecT            _neighborIds;
+  probVecT             _neighborProbs;
+
+  // reused for each tag
+  TagSet::unpackedSeqT  _residues;
+  tagIdVecT             _curNeighborIds;
+  probVecT              _curNeighborProbs;
+  RecountNeighborList   _neighborList;
+};
+
+} // end namespace cbrc
+#endif // RECOUNTNEIGHBORPROBGRAPHBUILDER_HH_
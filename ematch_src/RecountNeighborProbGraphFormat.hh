@@ -1,4 +1,4 @@
-/*  
+/*
  *  Author: Paul Horton
  *  Organization: Computational Biology Research Center, AIST, Japan
  *  Copyright (C) 2009, Paul Horton, All rights reserved.
@@ -8,12 +8,38 @@
  *  Description: Some constants for the binary format of
  *               the RecountNeighborProbGraph
  *
+ *  Version 000 ("recountGraph000\n"):
+ *      signature, node count, then one record per node:
+ *      tagIdT id, size_t listSize, listSize RecountTagIdProbPair structs
+ *      (including their padding).
+ *
+ *  Version 001 ("recountGraph001\n"):
+ *      signature, Header001, then four arrays, each starting on a
+ *      multiple of alignment() bytes from the beginning of the file:
+ *
+ *        nodeIds        numNodes              tagIdT
+ *        offsets        numNodes+1            size_t, neighbors of node n
+ *                                             are [offsets[n], offsets[n+1])
+ *        neighborIds    numNeighborEntries    tagIdT
+ *        neighborProbs  numNeighborEntries    double, or float when
+ *                                             probBytes is 4
+ *
+ *      so any node can be looked up directly and the whole file can be
+ *      mapped into memory and used in place.  The header records the byte
+ *      order and field widths of the machine which wrote the file.
+ *
  *  Purpose: Created for the RECOUNT project
  *
  */
 #ifndef RECOUNTNEIGHBORPROBGRAPHFORMAT_HH_
 #define RECOUNTNEIGHBORPROBGRAPHFORMAT_HH_
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "utils/gdb/gdbUtils.hh"
+#include "recountTypes.hh"
 
 namespace cbrc{
 
@@ -32,6 +58,162 @@ namespace RecountNeighborProbGraphFormat{
     return(  signature().size() + sizeof(size_t)  );
   }
 
+
+  inline const std::string&  signature001(){
+    static const std::string  _signature( "recountGraph001\n" );
+    return _signature;
+  }
+
+  // arrays of version 001 start at multiples of this many bytes
+  inline size_t  alignment(){  return 64;  }
+
+  // written as a native integer; reads back differently on the other byte order
+  inline uint32_t  byteOrderMark(){  return 0x01020304;  }
+
+
+  /* ********** VERSION 001 HEADER ********** */
+  struct Header001{
+    uint32_t  byteOrderMark;
+    uint8_t   tagIdBytes;
+    uint8_t   offsetBytes;
+    uint8_t   probBytes;
+    uint8_t   reserved;
+    uint64_t  numNodes;
+    uint64_t  numNeighborEntries;
+
+    // positions of the arrays from the beginning of the file
+    uint64_t  nodeIdsPos;
+    uint64_t  offsetsPos;
+    uint64_t  neighborIdsPos;
+    uint64_t  neighborProbsPos;
+    uint64_t  fileSize;
+  };
+
+
+  inline uint64_t  alignUp( const uint64_t& pos ){
+    return  (pos + alignment() - 1) / alignment() * alignment();
+  }
+
+
+  // header of a graph with the given sizes, array positions filled in
+  inline Header001  makeHeader001(  const uint64_t&  numNodes,
+				    const uint64_t&  numNeighborEntries,
+				    const bool&      floatProbs  ){
+    Header001  header;
+    header.byteOrderMark       =  byteOrderMark();
+    header.tagIdBytes          =  sizeof(tagIdT);
+    header.offsetBytes         =  sizeof(size_t);
+    header.probBytes           =  floatProbs ? sizeof(float) : sizeof(probT);
+    header.reserved            =  0;
+    header.numNodes            =  numNodes;
+    header.numNeighborEntries  =  numNeighborEntries;
+
+    header.nodeIdsPos        =  alignUp( signature001().size() + sizeof(Header001) );
+    header.offsetsPos        =  alignUp( header.nodeIdsPos     + numNodes * sizeof(tagIdT) );
+    header.neighborIdsPos    =  alignUp( header.offsetsPos     + (numNodes + 1) * sizeof(size_t) );
+    header.neighborProbsPos  =  alignUp( header.neighborIdsPos + numNeighborEntries * sizeof(tagIdT) );
+    header.fileSize          =  header.neighborProbsPos + numNeighborEntries * header.probBytes;
+    return header;
+  }
+
+
+  // return 0 or 1, the version of the graph file whose signature is at the
+  // current position of iStream.  Leaves iStream just after the signature.
+  inline int  readVersion( std::istream& iStream ){
+
+    std::string  fileSignature( signature().size(), '\0' );
+    iStream.read(  &fileSignature[0], fileSignature.size()  );
+
+    DO_OR_DIEF(  !iStream.fail(),  "Input error, could not read graph file signature"  );
+
+    if(  fileSignature == signature()     )  return 0;
+    if(  fileSignature == signature001()  )  return 1;
+
+    DO_OR_DIEF(  false,  "Input error, unknown graph file signature \"%s\"",
+		 fileSignature.c_str()  );
+    return -1;
+  }
+
+
+  // read the version 001 header following the signature; die unless the
+  // file was written with the byte order and field widths of this program
+  inline Header001  readHeader001( std::istream& iStream ){
+
+    Header001  header;
+    iStream.read(  (char*) &header, sizeof(header)  );
+
+    DO_OR_DIEF(  !iStream.fail(),  "Input error, could not read graph file header"  );
+
+    DO_OR_DIEF(  header.byteOrderMark == byteOrderMark(),
+		 "Graph file was written on a machine with the other byte order"  );
+
+    DO_OR_DIEF(  header.tagIdBytes == sizeof(tagIdT) && header.offsetBytes == sizeof(size_t),
+		 "Graph file has %u byte tag ids and %u byte offsets, expected %zu and %zu",
+		 (unsigned) header.tagIdBytes, (unsigned) header.offsetBytes,
+		 sizeof(tagIdT), sizeof(size_t)  );
+
+    DO_OR_DIEF(  header.probBytes == sizeof(float) || header.probBytes == sizeof(probT),
+		 "Graph file has %u byte probabilities", (unsigned) header.probBytes  );
+
+    const Header001  expected
+      =  makeHeader001(  header.numNodes,  header.numNeighborEntries,
+			 header.probBytes == sizeof(float)  );
+
+    DO_OR_DIEF(  header.nodeIdsPos       == expected.nodeIdsPos
+		 && header.offsetsPos       == expected.offsetsPos
+		 && header.neighborIdsPos   == expected.neighborIdsPos
+		 && header.neighborProbsPos == expected.neighborProbsPos
+		 && header.fileSize         == expected.fileSize,
+		 "Graph file header array positions are inconsistent"  );
+
+    return header;
+  }
+
+
+  // write a version 001 graph file holding the given arrays
+  inline void  write001(  /***/ std::ostream&        oStream,
+			  const std::vector<tagIdT>&  nodeIds,
+			  const std::vector<size_t>&  offsets,
+			  const tagIdVecT&            neighborIds,
+			  const probVecT&             neighborProbs,
+			  const bool&                 floatProbs  ){
+
+    GDB_ASSERTF(  offsets.size() == nodeIds.size() + 1
+		  && neighborIds.size() == neighborProbs.size()
+		  && offsets.back() == neighborIds.size(),
+		  "Inconsistent graph arrays"  );
+
+    const Header001  header
+      =  makeHeader001( nodeIds.size(), neighborIds.size(), floatProbs );
+
+    const std::string  padding( alignment(), '\0' );
+    uint64_t  pos  =  0;
+
+    // write n bytes of data after padding up to position start
+    auto  writeAt  =  [&]( const uint64_t& start, const void* data, const uint64_t& n ){
+      oStream.write(  padding.data(),  start - pos  );
+      oStream.write(  (const char*) data,  n  );
+      pos  =  start + n;
+    };
+
+    writeAt(  0,  signature001().data(),  signature001().size()  );
+    writeAt(  pos,  &header,  sizeof(header)  );
+    writeAt(  header.nodeIdsPos,      nodeIds.data(),      nodeIds.size()     * sizeof(tagIdT)  );
+    writeAt(  header.offsetsPos,      offsets.data(),      offsets.size()     * sizeof(size_t)  );
+    writeAt(  header.neighborIdsPos,  neighborIds.data(),  neighborIds.size() * sizeof(tagIdT)  );
+
+    if( floatProbs ){
+      const std::vector<float>  probs32( neighborProbs.begin(), neighborProbs.end() );
+      writeAt(  header.neighborProbsPos,  probs32.data(),  probs32.size() * sizeof(float)  );
+    }
+    else{
+      writeAt(  header.neighborProbsPos,  neighborProbs.data(),
+		neighborProbs.size() * sizeof(probT)  );
+    }
+
+    DO_OR_DIEF(  !oStream.fail(),  "Output error while writing graph file"  );
+  }
+
 }
 
 
@@ -0,0 +1,296 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.5.11
+ *  Last Modified: $Date$
+ *  Description: See header file.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "utils/gdb/gdbUtils.hh"
+#include "RecountTagIdProbPair.hh"
+#include "RecountNeighborProbGraphInMemory.hh"
+
+
+namespace cbrc{
+
+
+/* *************** CONSTRUCTORS *************** */
+
+RecountNeighborProbGraphInMemory::RecountNeighborProbGraphInMemory
+(  const TagSet&       tagID_to_seq,
+   const std::string&  graphFilename  )
+  : _tagID_to_seq( tagID_to_seq )
+{
+  init();
+
+  std::ifstream  graphFile( graphFilename.c_str(), std::ios::binary );
+
+  DO_OR_DIEF(  graphFile.good(),  "Could not open graph file \"%s\"", graphFilename.c_str()  );
+
+  if(  RecountNeighborProbGraphFormat::readVersion( graphFile ) == 1  ){
+
+    const RecountNeighborProbGraphFormat::Header001  header
+      =  RecountNeighborProbGraphFormat::readHeader001( graphFile );
+
+    if(  map001( graphFilename, header )  )  return;
+
+    read001( graphFile, header );
+    return;
+  }
+
+  read000( graphFile );
+}
+
+
+
+RecountNeighborProbGraphInMemory::RecountNeighborProbGraphInMemory
+(  const TagSet&                tagID_to_seq,
+   /***/ std::vector<tagIdT>&  nodeIds,
+   /***/ std::vector<size_t>&  offsets,
+   /***/ tagIdVecT&            neighborIds,
+   /***/ probVecT&             neighborProbs  )
+  : _tagID_to_seq( tagID_to_seq )
+{
+  init();
+
+  GDB_ASSERTF(  offsets.size() == nodeIds.size() + 1
+		&& neighborIds.size() == neighborProbs.size()
+		&& offsets.back() == neighborIds.size(),
+		"Inconsistent graph arrays"  );
+
+  _ownedNodeIds      .swap( nodeIds       );
+  _ownedOffsets      .swap( offsets       );
+  _ownedNeighborIds  .swap( neighborIds   );
+  _ownedNeighborProbs.swap( neighborProbs );
+
+  _size  =  _ownedNodeIds.size();
+
+  useOwnedArrays();
+}
+
+
+
+RecountNeighborProbGraphInMemory::~RecountNeighborProbGraphInMemory(){
+  if( _map )  munmap( _map, _mapSize );
+}
+
+
+
+void RecountNeighborProbGraphInMemory::init(){
+  _size                =  0;
+  _nodeIds             =  NULL;
+  _offsets             =  NULL;
+  _neighborIds         =  NULL;
+  _neighborProbs       =  NULL;
+  _neighborProbsFloat  =  NULL;
+  _map                 =  NULL;
+  _mapSize             =  0;
+  _curNode             =  0;
+}
+
+
+
+void RecountNeighborProbGraphInMemory::read( std::ifstream& graphFile ){
+
+  if(  RecountNeighborProbGraphFormat::readVersion( graphFile ) == 1  ){
+    read001(  graphFile,  RecountNeighborProbGraphFormat::readHeader001( graphFile )  );
+    return;
+  }
+
+  read000( graphFile );
+}
+
+
+
+void RecountNeighborProbGraphInMemory::read000( std::ifstream& graphFile ){
+
+  graphFile.read( (char*) &_size, sizeof(_size) );
+
+  GDB_ASSERTF( size() > 0,  "Expected graph size to be > 0" );
+
+  _ownedNodeIds.reserve( size() );
+  _ownedOffsets.reserve( size() + 1 );
+  _ownedOffsets.push_back( 0 );
+
+  // records are stored as (id, listSize, listSize tagId/prob pairs),
+  // split the pairs into the id and probability arrays as they are read
+  std::vector<RecountTagIdProbPair>  record;
+
+  while(  graphFile.peek() != std::ifstream::traits_type::eof()  ){
+
+    tagIdT  id;
+    graphFile.read(  (char*) &id, sizeof(id)  );
+
+    size_t  listSize;
+    graphFile.read(  (char*) &listSize, sizeof(listSize)  );
+
+    DO_OR_DIEF(  !graphFile.fail(),
+		 "Binary input failed in middle of record %zu", _ownedNodeIds.size()  );
+
+    record.resize( listSize );
+    graphFile.read(  (char*) record.data(), listSize * sizeof( record[0] )  );
+
+    DO_OR_DIEF(  !graphFile.fail(),
+		 "Binary input failed in neighbor list of record %zu", _ownedNodeIds.size()  );
+
+    _ownedNodeIds.push_back( id );
+
+    for(  size_t i = 0;  i < listSize;  ++i  ){
+      _ownedNeighborIds  .push_back( record[i].id()   );
+      _ownedNeighborProbs.push_back( record[i].prob() );
+    }
+
+    _ownedOffsets.push_back( _ownedNeighborIds.size() );
+  }
+
+  DO_OR_DIEF(  !_ownedNodeIds.empty(),  "Binary input file error. Could not read first record"  );
+
+  // the header count is not checked by the on disk reader either; iterate over
+  // the records actually present
+  _size = _ownedNodeIds.size();
+
+  _ownedNeighborIds  .shrink_to_fit();
+  _ownedNeighborProbs.shrink_to_fit();
+
+  useOwnedArrays();
+}
+
+
+
+void RecountNeighborProbGraphInMemory::read001
+(  std::ifstream& graphFile,
+   const RecountNeighborProbGraphFormat::Header001& header  ){
+
+  _size  =  header.numNodes;
+
+  GDB_ASSERTF( size() > 0,  "Expected graph size to be > 0" );
+
+  _ownedNodeIds    .resize( header.numNodes );
+  _ownedOffsets    .resize( header.numNodes + 1 );
+  _ownedNeighborIds.resize( header.numNeighborEntries );
+
+  graphFile.seekg( header.nodeIdsPos );
+  graphFile.read(  (char*) _ownedNodeIds.data(),  _ownedNodeIds.size() * sizeof(tagIdT)  );
+
+  graphFile.seekg( header.offsetsPos );
+  graphFile.read(  (char*) _ownedOffsets.data(),  _ownedOffsets.size() * sizeof(size_t)  );
+
+  graphFile.seekg( header.neighborIdsPos );
+  graphFile.read(  (char*) _ownedNeighborIds.data(),
+		   _ownedNeighborIds.size() * sizeof(tagIdT)  );
+
+  graphFile.seekg( header.neighborProbsPos );
+  if(  header.probBytes == sizeof(float)  ){
+    _ownedNeighborProbsFloat.resize( header.numNeighborEntries );
+    graphFile.read(  (char*) _ownedNeighborProbsFloat.data(),
+		     _ownedNeighborProbsFloat.size() * sizeof(float)  );
+  }
+  else{
+    _ownedNeighborProbs.resize( header.numNeighborEntries );
+    graphFile.read(  (char*) _ownedNeighborProbs.data(),
+		     _ownedNeighborProbs.size() * sizeof(probT)  );
+  }
+
+  DO_OR_DIEF(  !graphFile.fail(),  "Binary input file error. Graph file is truncated"  );
+
+  useOwnedArrays();
+  checkArrays001( header );
+}
+
+
+
+void RecountNeighborProbGraphInMemory::useOwnedArrays(){
+  _nodeIds      =  _ownedNodeIds.data();
+  _offsets      =  _ownedOffsets.data();
+  _neighborIds  =  _ownedNeighborIds.data();
+
+  if(  _ownedNeighborProbsFloat.empty()  ){
+    _neighborProbs  =  _ownedNeighborProbs.data();
+  }
+  else{
+    _neighborProbsFloat  =  _ownedNeighborProbsFloat.data();
+  }
+}
+
+
+
+bool RecountNeighborProbGraphInMemory::map001
+(  const std::string& graphFilename,
+   const RecountNeighborProbGraphFormat::Header001& header  ){
+
+  const int  fd  =  open( graphFilename.c_str(), O_RDONLY );
+  if( fd < 0 )  return false;
+
+  struct stat  fileStat;
+  if(   fstat( fd, &fileStat ) != 0
+	|| static_cast<uint64_t>( fileStat.st_size ) < header.fileSize   ){
+    close( fd );
+    return false;
+  }
+
+  void*  map  =  mmap( NULL, header.fileSize, PROT_READ, MAP_SHARED, fd, 0 );
+  close( fd );
+
+  if( map == MAP_FAILED )  return false;
+
+  _map      =  map;
+  _mapSize  =  header.fileSize;
+  _size     =  header.numNodes;
+
+  GDB_ASSERTF( size() > 0,  "Expected graph size to be > 0" );
+
+  const char*  base  =  static_cast<const char*>( map );
+
+  _nodeIds      =  reinterpret_cast<const tagIdT*>( base + header.nodeIdsPos     );
+  _offsets      =  reinterpret_cast<const size_t*>( base + header.offsetsPos     );
+  _neighborIds  =  reinterpret_cast<const tagIdT*>( base + header.neighborIdsPos );
+
+  if(  header.probBytes == sizeof(float)  ){
+    _neighborProbsFloat  =  reinterpret_cast<const float*>( base + header.neighborProbsPos );
+  }
+  else{
+    _neighborProbs  =  reinterpret_cast<const probT*>( base + header.neighborProbsPos );
+  }
+
+  checkArrays001( header );
+
+  return true;
+}
+
+
+
+// The computers index through these arrays without checks, so a corrupt
+// file is caught here, in one pass over it
+void RecountNeighborProbGraphInMemory::checkArrays001
+(  const RecountNeighborProbGraphFormat::Header001& header  ) const{
+
+  const size_t  numTags  =  tagID_to_seq().size();
+
+  DO_OR_DIEF(  _offsets[0] == 0,
+	       "Graph file offset table does not start at 0"  );
+
+  DO_OR_DIEF(  _offsets[ size() ] == header.numNeighborEntries,
+	       "Graph file offset table does not end at the number of neighbors"  );
+
+  for(  size_t node = 0;  node < size();  ++node  ){
+    DO_OR_DIEF(  _offsets[node] <= _offsets[node+1],
+		 "Graph file offsets decrease at node %zu", node  );
+
+    DO_OR_DIEF(  _nodeIds[node] < numTags,
+		 "Graph file node %zu has id %zu, but there are only %zu tags",
+		 node, size_t( _nodeIds[node] ), numTags  );
+  }
+
+  for(  size_t k = 0;  k < header.numNeighborEntries;  ++k  ){
+    DO_OR_DIEF(  _neighborIds[k] < numTags,
+		 "Graph file neighbor entry %zu has id %zu, but there are only %zu tags",
+		 k, size_t( _neighborIds[k] ), numTags  );
+  }
+}
+
+
+} // end namespace cbrc
@@ -0,0 +1,165 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.5.11
+ *  Last Modified: $Date$
+ *
+ *  Description:
+ *      Same graph as RecountNeighborProbGraphOnDisk, but loaded
+ *      once from the binary graph file into flat arrays:
+ *
+ *        nodeId(n)                      id of the n-th node in file order
+ *        offset(n) .. offset(n+1)-1     range of its neighbors in
+ *        neighborIds(), neighborProbs() their ids and probabilities
+ *
+ *      so that repeated passes over the graph are plain loops over
+ *      memory instead of re-reading the file.  Use the on disk class
+ *      for graphs which do not fit in memory.
+ *
+ *      Version 001 files (see RecountNeighborProbGraphFormat) already
+ *      hold these arrays; when constructed from a file name they are
+ *      mapped into memory and used in place.  Their probabilities may
+ *      be floats, in which case neighborProbs() is NULL and
+ *      neighborProbsFloat() holds them.
+ *
+ *  Purpose: Created for RECOUNT project
+ *
+ */
+#ifndef RECOUNTNEIGHBORPROBGRAPHINMEMORY_HH_
+#define RECOUNTNEIGHBORPROBGRAPHINMEMORY_HH_
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "TagSet.hh"
+#include "recountTypes.hh"
+#include "RecountNeighborProbGraphFormat.hh"
+
+namespace cbrc{
+
+class RecountNeighborProbGraphInMemory{
+public:
+
+  /* ********** CONSTRUCTORS ********** */
+  RecountNeighborProbGraphInMemory(  const TagSet&         tagID_to_seq,
+				     /***/ std::ifstream&  graphFile  )
+    : _tagID_to_seq( tagID_to_seq )
+  {
+    init();
+    read( graphFile );
+  }
+
+  // map version 001 files, read version 000 files
+  RecountNeighborProbGraphInMemory(  const TagSet&       tagID_to_seq,
+				     const std::string&  graphFilename  );
+
+  // graph built in memory, as by RecountNeighborProbGraphBuilder.
+  // Takes the contents of the arrays, leaving them empty.
+  RecountNeighborProbGraphInMemory(  const TagSet&                tagID_to_seq,
+				     /***/ std::vector<tagIdT>&  nodeIds,
+				     /***/ std::vector<size_t>&  offsets,
+				     /***/ tagIdVecT&            neighborIds,
+				     /***/ probVecT&             neighborProbs  );
+
+  ~RecountNeighborProbGraphInMemory();
+
+
+  /* ********** ACCESSORS ********** */
+
+  // number of nodes with neighbors
+  const size_t& size() const{  return _size;  }
+
+  const TagSet&  tagID_to_seq() const{
+    return _tagID_to_seq;
+  }
+
+  const tagIdT&  nodeId( const size_t& node ) const{  return _nodeIds[node];  }
+
+  // neighbors of node are at indices [offset(node), offset(node+1))
+  const size_t&  offset( const size_t& node ) const{  return _offsets[node];  }
+
+  const tagIdT*  neighborIds()        const{  return _neighborIds;       }
+  const probT*   neighborProbs()      const{  return _neighborProbs;     }
+  const float*   neighborProbsFloat() const{  return _neighborProbsFloat;  }
+
+  bool hasFloatProbs() const{  return _neighborProbsFloat != NULL;  }
+
+  // total number of (node, neighbor) pairs
+  size_t numNeighborEntries() const{  return offset( size() );  }
+
+  // true when the arrays point into a mapped version 001 file
+  bool isMapped() const{  return _map != NULL;  }
+
+
+  /* ***** Iterator-like methods, as in RecountNeighborProbGraphOnDisk ***** */
+  void readFirstNode(){
+    _curNode = 0;
+  }
+
+  bool readNextNode(){
+    return  ++_curNode < size();
+  }
+
+  const size_t&  curNode() const{  return _curNode;  }
+
+  const tagIdT&  curId() const{  return nodeId( curNode() );  }
+
+  const size_t&  curBegin() const{  return offset( curNode()     );  }
+  const size_t&  curEnd  () const{  return offset( curNode() + 1 );  }
+
+
+private:
+  // not copyable; the arrays may point into a mapping owned by this object
+  RecountNeighborProbGraphInMemory( const RecountNeighborProbGraphInMemory& );
+  RecountNeighborProbGraphInMemory& operator=( const RecountNeighborProbGraphInMemory& );
+
+  void init();
+
+  void read( std::ifstream& graphFile );
+
+  // read the record list of a version 000 file
+  void read000( std::ifstream& graphFile );
+
+  // read the arrays of a version 001 file
+  void read001(  std::ifstream& graphFile,
+		 const RecountNeighborProbGraphFormat::Header001& header  );
+
+  // point the arrays at the owned vectors
+  void useOwnedArrays();
+
+  // die unless the offsets of a version 001 file never decrease and stay
+  // within its neighbor entries, and all of its ids are ids of tagID_to_seq()
+  void checkArrays001(  const RecountNeighborProbGraphFormat::Header001& header  ) const;
+
+  // point the arrays into mapped version 001 file graphFilename;
+  // false if it could not be mapped
+  bool map001(  const std::string& graphFilename,
+		const RecountNeighborProbGraphFormat::Header001& header  );
+
+  /* ***** Object Data ***** */
+  const TagSet&  _tagID_to_seq;
+
+  size_t  _size;
+
+  const tagIdT*  _nodeIds;
+  const size_t*  _offsets;
+  const tagIdT*  _neighborIds;
+  const probT*   _neighborProbs;
+  const float*   _neighborProbsFloat;
+
+  // storage of the arrays when they are not mapped
+  std::vector<tagIdT>  _ownedNodeIds;
+  std::vector<size_t>  _ownedOffsets;
+  tagIdVecT            _ownedNeighborIds;
+  probVecT             _ownedNeighborProbs;
+  std::vector<float>   _ownedNeighborProbsFloat;
+
+  void*   _map;
+  size_t  _mapSize;
+
+  size_t  _curNode;
+};
+
+} // end namespace cbrc
+#endif // RECOUNTNEIGHBORPROBGRAPHINMEMORY_HH_
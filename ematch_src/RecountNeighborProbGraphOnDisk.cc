@@ -6,6 +6,7 @@
  *  Last Modified: $Date: 2009/05/15 04:12:55 $
  *  Description: See header file.
  */
+#include <algorithm>
 #include "utils/stl/binaryIO.hh"
 #include "RecountNeighborProbGraphFormat.hh"
 #include "RecountNeighborProbGraphOnDisk.hh"
@@ -18,12 +19,81 @@ namespace cbrc{
 
 void RecountNeighborProbGraphOnDisk::init(){
 
-  binaryIO::traceOrDie(  RecountNeighborProbGraphFormat::signature(), graphFile  );
+  _version  =  RecountNeighborProbGraphFormat::readVersion( graphFile );
 
-  graphFile.read( (char*) &_size, sizeof(_size) );
+  if( _version == 0 ){
+    graphFile.read( (char*) &_size, sizeof(_size) );
+
+    GDB_ASSERTF( size() > 0,  "Expected graph size to be > 0" );
+    return;
+  }
+
+  _header  =  RecountNeighborProbGraphFormat::readHeader001( graphFile );
+  _size    =  _header.numNodes;
 
   GDB_ASSERTF( size() > 0,  "Expected graph size to be > 0" );
 
+  _nodeIds.resize( size() );
+  graphFile.seekg( _header.nodeIdsPos );
+  graphFile.read(  (char*) _nodeIds.data(),  _nodeIds.size() * sizeof(tagIdT)  );
+
+  _offsets.resize( size() + 1 );
+  graphFile.seekg( _header.offsetsPos );
+  graphFile.read(  (char*) _offsets.data(),  _offsets.size() * sizeof(size_t)  );
+
+  DO_OR_DIEF(  !graphFile.fail(),  "Binary input file error. Could not read node index"  );
+}
+
+
+
+/* *************** METHODS *************** */
+
+void RecountNeighborProbGraphOnDisk::readNode001(){
+
+  const size_t  begin  =  _offsets[_curNode];
+  const size_t  end    =  _offsets[_curNode + 1];
+
+  if(  begin < _blockBegin || end > _blockEnd  )  readBlock001( begin, end );
+
+  _curIds  .assign(  _blockIds  .begin() + (begin - _blockBegin),
+		     _blockIds  .begin() + (end   - _blockBegin)  );
+  _curProbs.assign(  _blockProbs.begin() + (begin - _blockBegin),
+		     _blockProbs.begin() + (end   - _blockBegin)  );
+
+  _curNeighborList.set(  _nodeIds[_curNode], _curIds, _curProbs  );
+}
+
+
+
+void RecountNeighborProbGraphOnDisk::readBlock001(  const size_t& begin, const size_t& end  ){
+
+  // entries read per block, unless a single neighbor list is longer
+  const size_t  blockEntries  =  1 << 16;
+
+  _blockBegin  =  begin;
+  _blockEnd    =  std::min<size_t>(  _header.numNeighborEntries,
+				     std::max( end, begin + blockEntries )  );
+
+  const size_t  numEntries  =  _blockEnd - _blockBegin;
+
+  _blockIds.resize( numEntries );
+  graphFile.seekg( _header.neighborIdsPos + begin * sizeof(tagIdT) );
+  graphFile.read(  (char*) _blockIds.data(),  numEntries * sizeof(tagIdT)  );
+
+  _blockProbs.resize( numEntries );
+  graphFile.seekg( _header.neighborProbsPos + begin * _header.probBytes );
+
+  if(  _header.probBytes == sizeof(float)  ){
+    _blockProbs32.resize( numEntries );
+    graphFile.read(  (char*) _blockProbs32.data(),  numEntries * sizeof(float)  );
+    _blockProbs.assign( _blockProbs32.begin(), _blockProbs32.end() );
+  }
+  else{
+    graphFile.read(  (char*) _blockProbs.data(),  numEntries * sizeof(probT)  );
+  }
+
+  DO_OR_DIEF(  !graphFile.fail(),
+	       "Binary input failed in neighbor list of node %zu", _curNode  );
 }
 
 
@@ -13,12 +13,17 @@
  *      only the neighbors of a single tag need to be held
  *      in memory at any given time.
  *
+ *      Reads both versions of RecountNeighborProbGraphFormat.
+ *      For version 001 the node ids and offset table are held in
+ *      memory and the neighbor arrays are read a block at a time.
+ *
  *  Purpose: Created for RECOUNT project
  *
  */
 #ifndef RECOUNTNEIGHBORPROBGRAPHONDISK_HH_
 #define RECOUNTNEIGHBORPROBGRAPHONDISK_HH_
 #include <iostream>
+#include <vector>
 #include "TagSet.hh"
 #include "RecountNeighborList.hh"
 #include "RecountNeighborProbGraphFormat.hh"
@@ -32,7 +37,10 @@ public:
   RecountNeighborProbGraphOnDisk(  const TagSet&         tagID_to_seq,
 				   /***/ std::ifstream&  graphFile  )
     : _tagID_to_seq( tagID_to_seq ),
-      graphFile   ( graphFile    )
+      graphFile   ( graphFile    ),
+      _curNode    ( 0            ),
+      _blockBegin ( 0            ),
+      _blockEnd   ( 0            )
   {
     init();
   }
@@ -54,12 +62,22 @@ public:
   
   /* ***** Iterator-like methods ***** */
   void readFirstNode(){
+    if( _version == 1 ){
+      _curNode = 0;
+      readNode001();
+      return;
+    }
     rewind();
     DO_OR_DIEF(  _curNeighborList.read( graphFile ),
 		 "Binary input file error. Could not read first record"  );
   }
 
   bool readNextNode(){
+    if( _version == 1 ){
+      if(  ++_curNode >= size()  )  return false;
+      readNode001();
+      return true;
+    }
     return  _curNeighborList.read( graphFile );
   }
 
@@ -67,6 +85,13 @@ public:
 private:
   void init();
 
+  // set _curNeighborList to node _curNode of a version 001 file
+  void readNode001();
+
+  // fill the block buffers with neighbor entries from begin on,
+  // at least up to end
+  void readBlock001( const size_t& begin, const size_t& end );
+
   void rewind(){
     graphFile.clear();
     graphFile.seekg( RecountNeighborProbGraphFormat::headerSize() );
@@ -81,6 +106,26 @@ private:
 
   size_t _size;
 
+  int  _version;
+
+  /* ***** Version 001 Only ***** */
+  RecountNeighborProbGraphFormat::Header001  _header;
+
+  std::vector<tagIdT>  _nodeIds;
+  std::vector<size_t>  _offsets;
+
+  size_t  _curNode;
+
+  // neighbor entries [_blockBegin, _blockEnd) read from the file
+  size_t              _blockBegin;
+  size_t              _blockEnd;
+  tagIdVecT           _blockIds;
+  probVecT            _blockProbs;
+  std::vector<float>  _blockProbs32;
+
+  // neighbor list of the current node
+  tagIdVecT           _curIds;
+  probVecT            _curProbs;
 };
 
 } // end namespace cbrc
@@ -6,8 +6,10 @@
  *  Last Modified: $Date: 2009/09/24 01:44:06 $
  *  Description: See header file.
  */
-#include <boost/lexical_cast.hpp>
-#include "utils/perlish/perlish.hh"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <boost/foreach.hpp>
 #include "utils/stl/binaryIO.hh"
 #include "utils/stl/stlUtils.hh"
 #include "utils/gdb/gdbUtils.hh"
@@ -17,90 +19,184 @@
 
 namespace cbrc{
 
-  size_t RecountNeighborProbGraphWriter::write(  std::ofstream& ofStream,
-						 std::istream& tagNeighborlistIstream  ){
+  namespace{
 
-    
-    // declare vectors to hold neighbor data
-    std::vector<tagIdT>  neighborIds;
-    std::vector<probT>   neighborProbs;
-    RecountNeighborList  neighborList;
+    // bytes of the neighbor list file read at a time
+    const size_t  blockSize  =  size_t(1) << 22;
 
-    size_t nodeCount  =  0; // number of neighborhood's written.
+    // lines parsed by one thread at a time
+    const long    parseChunkSize  =  256;
 
-    // write signature
-    binaryIO::writeContentsOnly( RecountNeighborProbGraphFormat::signature(), ofStream );
+  } // end anonymous namespace
 
-    // save ofstream pointer so we can go back and write it later
-    const std::ofstream::pos_type posBeforeNodeCount = ofStream.tellp();
 
-    // make room for writing nodeCount afterwards.
-    ofStream.seekp( sizeof(nodeCount), std::ios_base::cur );
 
+  bool RecountNeighborProbGraphWriter::readLines(  std::istream&  tagNeighborlistIstream  ){
 
-    for( ; ; ++nodeCount ){
-    
-      const std::string line = perlish::slurpLine( tagNeighborlistIstream );
+    // move the partial line left from the previous block to the front
+    _blockFill  -=  _blockUsed;
+    if(  _blockFill  )  memmove(  &_block[0],  &_block[_blockUsed],  _blockFill  );
+    _blockUsed  =  0;
 
-      if( !line.size() )  break;  /** LOOP EXIT! **/
+    _lines.clear();
 
+    bool  atEnd  =  false;
 
-       GDB_ASSERTF(  !boost::regex_search( line, boost::regex("\t\t") ),
-		     "Input error. Fields should be separted by exactly one tab character."\
-		     " line:\n%s\n", line.c_str()  );
+    // read until the block holds a whole line, growing it for long lines
+    while(  !atEnd  ){
 
+      if(  _block.size() < _blockFill + blockSize  )  _block.resize( _blockFill + blockSize );
 
-      const stringVecT  fields  =  perlish::split( "\t", line );
+      tagNeighborlistIstream.read(  &_block[_blockFill],  blockSize  );
 
+      const size_t  numRead  =  tagNeighborlistIstream.gcount();
 
-      GDB_ASSERTF(  fields.size() > 3,
-		    "Expected at least 3 fields, but got %zu", fields.size()  );
+      atEnd  =  ( numRead < blockSize );
 
-      GDB_ASSERTF(  (fields.size() % 2),
-		    "Expected an odd number of fields, but got %zu", fields.size()  );
+      const bool  hasNewline  =  memchr( &_block[_blockFill], '\n', numRead ) != NULL;
 
-      /* ***  Pop off tag sequence and count  *** */
-      const std::string  tagSeq  =  fields[0];
+      _blockFill  +=  numRead;
 
+      if(  hasNewline  )  break;
+    }
 
-      { // ***** Build vector of neighborIds and neighborProbs
+    if(  !_blockFill  )  return false;
 
-	const neighborhoodSizeT  listBegIdx  =  1;   // neighbor list start index
+    const char*  const  blockBeg  =  &_block[0];
+    const char*  const  blockEnd  =  blockBeg + _blockFill;
 
-	neighborIds  .resize ( 0 );
-	neighborProbs.resize ( 0 );
+    const char*  lineBeg  =  blockBeg;
 
-	/* ***** Parse FIELDS into id and probability lists ***** */
-	for(  size_t i = listBegIdx;  i < fields.size();
-	      i++  /* also incremented in loop body */
-	      ){
+    while(  lineBeg < blockEnd  ){
 
-	  
-	  const std::string  neighborSeq  =  fields[i];
+      const char*  lineEnd  =  (const char*) memchr( lineBeg, '\n', blockEnd - lineBeg );
 
-	  GDB_ASSERTF(  ( neighborSeq != tagSeq ),
-			"tagId:%s found in its own neighbor list", tagSeq.c_str()  );
+      if(  !lineEnd  ){
+	if(  !atEnd  )  break;   // partial line, finished in the next block
+	lineEnd  =  blockEnd;
+      }
 
-	  const TagSet::unpackedSeqT  neighborUnpackedSeq
-	    =   tagId_to_seq.toUnpackedSeq( fields[i] );
-	  
+      // skip empty and comment lines, as perlish::slurpLine does
+      if(  lineEnd > lineBeg  &&  *lineBeg != '#'  ){
+	_lines.push_back(  std::make_pair( lineBeg, lineEnd )  );
+      }
 
-	  // When tag present, this implementation does 2 binary searches.
-	  // Could be optimized to 1.
-	  if(  tagId_to_seq.has( neighborUnpackedSeq )  ){
-	    const size_t neighborId  =  tagId_to_seq( neighborUnpackedSeq );
-	    neighborIds  .push_back(  neighborId  );
-	    neighborProbs.push_back(  boost::lexical_cast<probT> ( fields[++i] )  );
-	  }
-	  else{ // skip neighbor whose tag is not in the tag list
-	    //	    std::cerr  <<  "skipping tag: "  <<  neighborSeq  <<  std::endl;
-	    ++i;  // skip over unused probability field. 
-	  }
-	}
-      } // END: Build vector of neighborIds and neighborProbs block.
+      lineBeg  =  lineEnd + 1;
+    }
+
+    _blockUsed  =  std::min<size_t>(  lineBeg - blockBeg,  _blockFill  );
+
+    return  true;
+  }
+
+
+
+  size_t RecountNeighborProbGraphWriter::readNeighborLists(  std::istream&  tagNeighborlistIstream  ){
+
+    // a block may hold only empty or comment lines
+    do{
+      if(  !readLines( tagNeighborlistIstream )  )  return 0;
+    } while(  _lines.empty()  );
+
+    const long  numLines  =  _lines.size();
+
+    if(  _neighborLists.size() < _lines.size()  )  _neighborLists.resize( _lines.size() );
+
+#pragma omp parallel num_threads( std::max<size_t>( numThreads(), 1 ) )
+    {
+      std::string  seq;
+
+#pragma omp for schedule( dynamic, parseChunkSize )
+      for(  long i = 0;  i < numLines;  ++i  ){
+	parseNeighborList(  _lines[i].first,  _lines[i].second,  _neighborLists[i],  seq  );
+      }
+    }
+
+    return  numLines;
+  }
+
+
+
+  void RecountNeighborProbGraphWriter::parseNeighborList(  const char*           lineBeg,
+							    const char*           lineEnd,
+							    /***/ neighborListT&  neighborList,
+							    /***/ std::string&    seq  ) const{
+
+    const char*  fieldBeg  =  lineBeg;
+    const char*  fieldEnd;
+    size_t       numFields  =  0;
+
+    // point [fieldBeg, fieldEnd) at the next tab separated field;
+    // a trailing tab does not start another field
+    auto  nextField  =  [&](){
+      if(  fieldBeg >= lineEnd  )  return false;
+      fieldEnd  =  (const char*) memchr( fieldBeg, '\t', lineEnd - fieldBeg );
+      if(  !fieldEnd  )  fieldEnd  =  lineEnd;
+      ++numFields;
+      GDB_ASSERTF(  fieldEnd > fieldBeg,
+		    "Input error. Fields should be separted by exactly one tab character."\
+		    " line:\n%s\n", std::string( lineBeg, lineEnd ).c_str()  );
+      return true;
+    };
+
+    // advance past the current field
+    auto  skipField  =  [&](){  fieldBeg  =  fieldEnd + 1;  };
+
+
+    /* ***  Pop off tag sequence  *** */
+    nextField();
+    const char*  const  tagSeqBeg  =  fieldBeg;
+    const char*  const  tagSeqEnd  =  fieldEnd;
+    seq.assign( tagSeqBeg, tagSeqEnd );
+    skipField();
+
+    neighborList.tagId  =  tagId_to_seq.getSerialNumberOrDie( seq );
+
+    tagIdVecT&  neighborIds    =  neighborList.neighborIds;
+    probVecT&   neighborProbs  =  neighborList.neighborProbs;
+
+    neighborIds  .clear();
+    neighborProbs.clear();
+
+
+    /* ***** Parse fields into id and probability lists ***** */
+    while(  nextField()  ){
+
+      GDB_ASSERTF(  !(  fieldEnd - fieldBeg == tagSeqEnd - tagSeqBeg
+			&& !memcmp( fieldBeg, tagSeqBeg, tagSeqEnd - tagSeqBeg )  ),
+		    "tagId:%s found in its own neighbor list",
+		    std::string( tagSeqBeg, tagSeqEnd ).c_str()  );
+
+      seq.assign( fieldBeg, fieldEnd );
+      skipField();
+
+      DO_OR_DIEF(  nextField(),
+		   "Expected an odd number of fields, but got %zu", numFields  );
+
+      const size_t  neighborId  =  tagId_to_seq.find( seq );
 
+      // skip neighbor whose tag is not in the tag list, and its probability
+      if(  neighborId != tagId_to_seq.size()  ){
+	probT  prob;
+	const std::from_chars_result  parsed  =  std::from_chars( fieldBeg, fieldEnd, prob );
 
-      { // ***** Check validity of probs and add self to neighbor list
+	DO_OR_DIEF(  parsed.ec == std::errc()  &&  parsed.ptr == fieldEnd,
+		     "Could not parse probability \"%s\" of tag %s",
+		     std::string( fieldBeg, fieldEnd ).c_str(),
+		     std::string( tagSeqBeg, tagSeqEnd ).c_str()  );
+
+	neighborIds  .push_back(  neighborId  );
+	neighborProbs.push_back(  prob  );
+      }
+
+      skipField();
+    }
+
+    GDB_ASSERTF(  numFields > 3,
+		  "Expected at least 3 fields, but got %zu", numFields  );
+
+
+    { // ***** Check validity of probs and add self to neighbor list
 
 	probT sumOtherProbs = 0.0;
 	BOOST_FOREACH(  const probT& prob,  neighborProbs  ){
@@ -115,24 +211,47 @@ namespace cbrc{
 	* 	      tagSeq.c_str(), sumOtherProbs  );
 	*--------------------------------------------------*/
 
-         if ( sumOtherProbs <= 1)  {
-            // push self onto neighbor list
-            neighborIds  .push_back(  tagId_to_seq.getSerialNumberOrDie( tagSeq )  );
-            neighborProbs.push_back(  1.0 - sumOtherProbs  );
-          }
-      }
-      
+	if ( sumOtherProbs <= 1)  {
+	  // push self onto neighbor list
+	  neighborIds  .push_back(  neighborList.tagId  );
+	  neighborProbs.push_back(  1.0 - sumOtherProbs  );
+	}
+    }
+  }
 
-      /* ********** WRITE OUTPUT ********** */
 
-      neighborList.set(  tagId_to_seq.getSerialNumberOrDie( tagSeq ),
-			 neighborIds, neighborProbs  );
 
+  size_t RecountNeighborProbGraphWriter::write(  std::ofstream& ofStream,
+						 std::istream& tagNeighborlistIstream  ){
 
-      neighborList.write( ofStream );
-      
+    
+    RecountNeighborList  neighborList;
+
+    size_t nodeCount  =  0; // number of neighborhood's written.
+
+    // write signature
+    binaryIO::writeContentsOnly( RecountNeighborProbGraphFormat::signature(), ofStream );
 
-    } // end for slurpLine( tagNeighborlistIstream )
+    // save ofstream pointer so we can go back and write it later
+    const std::ofstream::pos_type posBeforeNodeCount = ofStream.tellp();
+
+    // make room for writing nodeCount afterwards.
+    ofStream.seekp( sizeof(nodeCount), std::ios_base::cur );
+
+
+    for(  size_t numRead;  ( numRead = readNeighborLists( tagNeighborlistIstream ) );  ){
+
+      /* ********** WRITE OUTPUT, IN INPUT ORDER ********** */
+      for(  size_t i = 0;  i < numRead;  ++i, ++nodeCount  ){
+
+	const neighborListT&  parsed  =  _neighborLists[i];
+
+	neighborList.set(  parsed.tagId, parsed.neighborIds, parsed.neighborProbs  );
+
+	neighborList.write( ofStream );
+      }
+
+    } // end for readNeighborLists( tagNeighborlistIstream )
 
     // overwrite nodeCount at beginning of ofStream
     ofStream.seekp( posBeforeNodeCount, std::ios_base::beg );
@@ -141,5 +260,39 @@ namespace cbrc{
     return nodeCount;
   }
 
+
+
+  size_t RecountNeighborProbGraphWriter::write001(  std::ofstream& ofStream,
+						    std::istream&  tagNeighborlistIstream,
+						    const bool&    floatProbs  ){
+
+    // the array positions in the header depend on the total number of
+    // neighbors, so the whole graph is collected before anything is written
+    std::vector<tagIdT>  nodeIds;
+    std::vector<size_t>  offsets( 1, 0 );
+    tagIdVecT            allNeighborIds;
+    probVecT             allNeighborProbs;
+
+    for(  size_t numRead;  ( numRead = readNeighborLists( tagNeighborlistIstream ) );  ){
+
+      for(  size_t i = 0;  i < numRead;  ++i  ){
+
+	const neighborListT&  parsed  =  _neighborLists[i];
+
+	nodeIds.push_back( parsed.tagId );
+
+	allNeighborIds  .insert(  allNeighborIds  .end(),  parsed.neighborIds  .begin(),  parsed.neighborIds  .end()  );
+	allNeighborProbs.insert(  allNeighborProbs.end(),  parsed.neighborProbs.begin(),  parsed.neighborProbs.end()  );
+
+	offsets.push_back( allNeighborIds.size() );
+      }
+    }
+
+    RecountNeighborProbGraphFormat::write001(  ofStream, nodeIds, offsets,
+					       allNeighborIds, allNeighborProbs, floatProbs  );
+
+    return nodeIds.size();
+  }
+
 } // end namespace cbrc
 
@@ -7,10 +7,17 @@
  *
  *  Description: Class to write binary format neighbor graph from text files
  *
+ *               The neighbor list file is read in blocks of whole lines.
+ *               The lines of a block are parsed, and their tags and
+ *               neighbors looked up in the tag set, by numThreads threads;
+ *               then the neighbor lists are written out in input order.
+ *
  */
 #ifndef RECOUNTNEIGHBORPROBGRAPHWRITER_HH_
 #define RECOUNTNEIGHBORPROBGRAPHWRITER_HH_
 #include <iostream>
+#include <string>
+#include <vector>
 #include "TagSet.hh"
 #include "RecountNeighborList.hh"
 
@@ -23,19 +30,68 @@ public:
 
   /* ********** CONSTRUCTORS ********** */
 
-  RecountNeighborProbGraphWriter(  std::istream& tagSeqsIstream  )
-    : tagId_to_seq( tagSeqsIstream )
+  RecountNeighborProbGraphWriter(  std::istream&  tagSeqsIstream,
+				   const size_t&  numThreads  =  0  )
+    : tagId_to_seq( tagSeqsIstream ),
+      _numThreads ( numThreads     ),
+      _blockFill  ( 0              ),
+      _blockUsed  ( 0              )
   {}
 
   // returns number of neighbor lists written.
   size_t write( std::ofstream& ofStream,
                 std::istream&  tagNeighborlistIstream  );
 
+  // same, but in version 001 of RecountNeighborProbGraphFormat;
+  // probabilities are stored as float when floatProbs is true.
+  size_t write001( std::ofstream& ofStream,
+                   std::istream&  tagNeighborlistIstream,
+                   const bool&    floatProbs  =  false  );
+
   /* ********** ACCESSORS ********** */
+
+  // threads used to parse the neighbor lists, 0 for one
+  const size_t&  numThreads() const{  return _numThreads;  }
+
 private:
 
+  // tag id and neighbors, including the tag itself, of one neighbor list
+  struct neighborListT{
+    tagIdT     tagId;
+    tagIdVecT  neighborIds;
+    probVecT   neighborProbs;
+  };
+
+  // read the next block of whole lines from tagNeighborlistIstream and
+  // parse them into the first n elements of _neighborLists.
+  // returns n, 0 at end of input.
+  size_t readNeighborLists(  std::istream&  tagNeighborlistIstream  );
+
+  // read the next block of whole lines into _block, pointing _lines at
+  // the lines which are not comments or empty.
+  // returns false at end of input.
+  bool readLines(  std::istream&  tagNeighborlistIstream  );
+
+  // parse the line [lineBeg, lineEnd) into neighborList.
+  // seq is scratch space for looking up tag sequences
+  void parseNeighborList(  const char*           lineBeg,
+			   const char*           lineEnd,
+			   /***/ neighborListT&  neighborList,
+			   /***/ std::string&    seq  ) const;
+
   // object data
   const TagSet  tagId_to_seq;
+  const size_t  _numThreads;
+
+  // current block of input; the lines in [0, _blockUsed) have been split
+  // into _lines, the rest of the _blockFill bytes read is a partial line
+  std::vector<char>  _block;
+  size_t             _blockFill;
+  size_t             _blockUsed;
+  std::vector< std::pair<const char*, const char*> >  _lines;
+
+  // parsed lines of the current block, kept to reuse their vectors
+  std::vector<neighborListT>  _neighborLists;
 };
 
 } // end namespace cbrc
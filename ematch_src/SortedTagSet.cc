@@ -67,6 +67,65 @@ void SortedTagSet::readFromTextStream( std::istream& iStream ){
 
 
 
+void SortedTagSet::readFromBinaryStream( std::istream& iStream ){
+
+  std::string  signature( binarySignature().size(), '\0' );
+  iStream.read(  &signature[0], signature.size()  );
+
+  DO_OR_DIEF(  !iStream.fail() && signature == binarySignature(),
+	       "Input error. Binary sorted tag set signature not found"  );
+
+  binaryHeaderT  header;
+  iStream.read(  (char*) &header, sizeof(header)  );
+
+  DO_OR_DIEF(  !iStream.fail(),  "Input error. Could not read binary sorted tag set header"  );
+
+  DO_OR_DIEF(  header.byteOrderMark == binaryByteOrderMark(),
+	       "Binary sorted tag set was written on a machine with the other byte order"  );
+
+  DO_OR_DIEF(  header.tagLengthBytes == sizeof(tagSeqT::size_type),
+	       "Binary sorted tag set has %u byte tag lengths, expected %zu",
+	       (unsigned) header.tagLengthBytes, sizeof(tagSeqT::size_type)  );
+
+  const uint64_t  numTags  =  header.numTags;
+
+  v.resize( numTags );
+
+  for(  size_t tagCount = 0;  tagCount < numTags;  ++tagCount  ){
+
+    v[tagCount].read( iStream );
+
+    DO_OR_DIEF(  !iStream.fail(),
+		 "End of file after only %zu out of %zu total tags read",
+		 tagCount, (size_t) numTags  );
+  }
+
+  // written from a tag set which was checked when its text was read
+} // end method readFromBinaryStream
+
+
+
+void SortedTagSet::writeToBinaryStream( std::ostream& oStream ) const{
+
+  binaryHeaderT  header;
+  header.byteOrderMark   =  binaryByteOrderMark();
+  header.tagLengthBytes  =  sizeof(tagSeqT::size_type);
+  header.reserved8       =  0;
+  header.reserved        =  0;
+  header.numTags         =  size();
+
+  oStream.write(  binarySignature().data(),  binarySignature().size()  );
+  oStream.write(  (const char*) &header,  sizeof(header)  );
+
+  BOOST_FOREACH( const tagSeqT& curTag, v ){
+    curTag.write( oStream );
+  }
+
+  DO_OR_DIEF(  !oStream.fail(),  "Output error while writing binary sorted tag set"  );
+}
+
+
+
 void SortedTagSet::assertIsSorted() const{
   for(  size_t i = 0;  i < v.size()-1;  ++i  ){
     GDB_ASSERTF(  v[i] < v[i+1],
@@ -13,6 +13,8 @@
 #ifndef SORTEDTAGSET_HH_
 #define SORTEDTAGSET_HH_
 #include <iostream>
+#include <string>
+#include <stdint.h>
 #include <boost/foreach.hpp>
 #include "utils/sequence/ResidueIndexMap/ResidueIndexMap.hh"
 #include "utils/sequence/packedDNA/Sigma4FLArray.hh"
@@ -27,7 +29,7 @@ public:
 
   typedef  Sigma4FLArray                      tagSeqT;
   typedef  std::vector<tagSeqT>            tagSeqVecT;
-  typedef  enum {binary, text}            fileFormatT;
+  typedef  enum {binary, text, autoDetect}  fileFormatT;
   typedef  tagSeqVecT::const_iterator  const_iterator;
   typedef  tagSeqVecT::iterator              iterator;
 
@@ -38,7 +40,9 @@ public:
     initialSort();
   }
 
-  SortedTagSet( std::istream& iStream, fileFormatT fileFormat = text ){
+  SortedTagSet( std::istream& iStream, fileFormatT fileFormat = autoDetect ){
+    if( fileFormat == autoDetect )  fileFormat  =  detectFileFormat( iStream );
+
     if( fileFormat == text )  readFromTextStream  ( iStream );
     else                      readFromBinaryStream( iStream );
   }
@@ -86,6 +90,11 @@ public:
     return _residueIndexMap;
   }
 
+  static const std::string&  binarySignature(){
+    static const std::string  _signature( "recountSortedTagSet001\n" );
+    return _signature;
+  }
+
 
   /* ********** CONVERSION METHODS ********** */
   
@@ -99,19 +108,39 @@ public:
   
   /* ********** I/O METHODS ********** */
 
-  void readFromBinaryStream( std::istream& iStream ){
-    // not yet implemented
+  // binary if the next character of iStream starts binarySignature(),
+  // otherwise text.  Only peeks, so iStream need not be seekable.
+  static fileFormatT  detectFileFormat( std::istream& iStream ){
+    return(  iStream.peek() == binarySignature()[0]  ?  binary  :  text  );
   }
 
+  // format written by writeToBinaryStream
+  void readFromBinaryStream( std::istream& iStream );
+
   // format is one tag string per line, presorted with no duplicated.
   void readFromTextStream  ( std::istream& iStream );
 
+  // binarySignature(), binaryHeaderT, then each tag as written by
+  // Sigma4FLArray::write
+  void writeToBinaryStream ( std::ostream& oStream ) const;
+
 
   /* ********** METHODS FOR DEBUGGING ********** */
 
   void assertIsSorted() const;
 
 private:
+  /* ********** BINARY FORMAT ********** */
+  struct binaryHeaderT{
+    uint32_t  byteOrderMark;
+    uint8_t   tagLengthBytes;   // width of the length written before each tag
+    uint8_t   reserved8;
+    uint16_t  reserved;
+    uint64_t  numTags;
+  };
+
+  static uint32_t  binaryByteOrderMark(){  return 0x01020304;  }
+
   // object data
   tagSeqVecT  v;
 };
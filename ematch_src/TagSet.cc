@@ -6,30 +6,152 @@
  *  Last Modified: $Date: 2009/09/20 11:46:12 $
  *  Description: See header file.
  */
+#include <stdexcept>
 #include "TagSet.hh"
 
 namespace cbrc{
 
 
+namespace{
+
+  // bit packed copy of a query sequence, on the stack unless it is long
+  class PackedQuery{
+  public:
+    PackedQuery(  const TagSet::unpackedSeqT&  seq  )
+      : _sizeInBytes(  sigma4bitPackingUtils::numBytesNeededToStore( seq.size() )  ),
+	_ptr( _stackMem )
+    {
+      if(  _sizeInBytes > sizeof(_stackMem)  ){
+	_heapMem.resize( _sizeInBytes );
+	_ptr  =  &_heapMem[0];
+      }
+      sigma4bitPackingUtils::pack( _ptr, seq );
+    }
+
+    byte* const&   ptr()         const{  return _ptr;          }
+    const size_t&  sizeInBytes() const{  return _sizeInBytes;  }
+
+  private:
+    size_t             _sizeInBytes;
+    byte               _stackMem[64];
+    std::vector<byte>  _heapMem;
+    byte*              _ptr;
+  };
+
+
+  // index of the first key not less than key, without data dependent branches
+  template <typename keyT>
+  size_t  branchFreeLowerBound(  const std::vector<keyT>&  keys,  const keyT&  key  ){
+
+    if(  keys.empty()  )  return 0;
+
+    const keyT*  base  =  &keys[0];
+    size_t       n     =  keys.size();
+
+    while(  n > 1  ){
+      const size_t  half  =  n / 2;
+      base  =  ( base[half - 1] < key )  ?  base + half  :  base;
+      n    -=  half;
+    }
+
+    return  (base - &keys[0])  +  ( *base < key );
+  }
+
+} // end anonymous namespace
+
+
+
 /* --------------- PUBLIC ACCESSORS --------------- */
 
+size_t  TagSet::find(  const std::string&  asciiSeq  ) const{
 
-bool  TagSet::equal(   const size_t&  i,  const unpackedSeqT&  seqToCompare   ) const{
+  if(  hasPackedKeys() && asciiSeq.size() == keyLength()  ){
+
+    const byte* const  residueIndex  =  residueIndexTable();
+
+    uint128T  key     =  0;
+    byte      invalid =  0;
+    for(  size_t i = 0;  i < asciiSeq.size();  ++i  ){
+      const byte  r  =  residueIndex[ (byte) asciiSeq[i] ];
+      invalid  |=  (r == 0xff);
+      key       =  (key << 2) | (r & 3);
+    }
+
+    // let toUnpackedSeq() report the bad character
+    if(  !invalid  )  return  findKey( key );
+  }
+
+  return  find(  toUnpackedSeq( asciiSeq )  );
+}
 
-  if( size(i) != seqToCompare.size() )  return false;   // EXIT
 
-  const size_t  sizeInBytes
-    =  sigma4bitPackingUtils::numBytesNeededToStore( seqToCompare.size() );
 
-  // allocate and initialization bit packed representation of seqToCompare
-  byte* const  packedPtr   = new byte[sizeInBytes];
-  sigma4bitPackingUtils::pack( packedPtr, seqToCompare );
+size_t  TagSet::find(  const unpackedSeqT&  unpackedSeq  ) const{
 
-  const bool  retVal  =  (  memcmp( a[i], packedPtr, sizeInBytes )  ==  0  );
+  if(  hasPackedKeys() && unpackedSeq.size() == keyLength()  ){
 
-  delete[] packedPtr;
+    uint128T  key  =  0;
+    for(  size_t i = 0;  i < unpackedSeq.size();  ++i  ){
+      key  =  (key << 2) | unpackedSeq[i];
+    }
+    return  findKey( key );
+  }
 
-  return  retVal;
+  return  findPacked( unpackedSeq );
+}
+
+
+
+size_t  TagSet::findKey(  const uint128T&  key  ) const{
+
+  size_t  idx;
+  bool    found;
+
+  if(  keyLength() <= maxKeyLength64()  ){
+    const uint64_t  key64  =  (uint64_t) key;
+    idx    =  branchFreeLowerBound( _keys64, key64 );
+    found  =  idx < size()  &&  _keys64[idx] == key64;
+  }
+  else{
+    idx    =  branchFreeLowerBound( _keys128, key );
+    found  =  idx < size()  &&  _keys128[idx] == key;
+  }
+
+  return  found ? idx : size();
+}
+
+
+
+size_t  TagSet::findPacked(  const unpackedSeqT&  seqToMatch  ) const{
+
+  const PackedQuery  query( seqToMatch );
+
+  size_t  lower  =  0;
+  size_t  upper  =  size();
+
+  while(  lower  <  upper  ){
+    const size_t  mid   =   lower  +  (upper - lower) / 2;
+    if(  isLexicallyLess( mid, query.ptr(), seqToMatch.size())  )   lower  =  mid + 1;
+    else                                                            upper  =  mid;
+  }
+
+  if(   upper < size()
+	&& size(upper) == seqToMatch.size()
+	&& memcmp( a[upper], query.ptr(), query.sizeInBytes() ) == 0   ){
+    return upper;
+  }
+  return size();
+}
+
+
+
+bool  TagSet::equal(   const size_t&  i,  const unpackedSeqT&  seqToCompare   ) const{
+
+  if( size(i) != seqToCompare.size() )  return false;   // EXIT
+
+  const PackedQuery  query( seqToCompare );
+
+  return(  memcmp( a[i], query.ptr(), query.sizeInBytes() )  ==  0  );
 }
 
 
@@ -37,30 +159,225 @@ bool  TagSet::equal(   const size_t&  i,  const unpackedSeqT&  seqToCompare   )
 //      or:  size() if seqToMatch is lexically greater than any sequence tag.
 size_t  TagSet::upperBound(  const unpackedSeqT&  seqToMatch  ) const{
 
-  byte* const  packedPtr
-    = new byte[sigma4bitPackingUtils::numBytesNeededToStore( seqToMatch.size() )];
-
-  sigma4bitPackingUtils::pack( packedPtr, seqToMatch );
+  const PackedQuery  query( seqToMatch );
 
   size_t  lower  =  0;
   size_t  upper  =  size();
   
   while(  lower  <  upper  ){
     const size_t  mid   =   lower  +  (upper - lower) / 2;
-    if(  isLexicallyLess( mid, packedPtr, seqToMatch.size())  )   lower  =  mid + 1;
-    else                                                          upper  =  mid;
+    if(  isLexicallyLess( mid, query.ptr(), seqToMatch.size())  )   lower  =  mid + 1;
+    else                                                            upper  =  mid;
   }
 
-  delete[] packedPtr;
-
   return  upper;
 }
 
 
 
+const byte*  TagSet::residueIndexTable(){
+
+  struct tableT{
+    byte  index[256];
+
+    tableT(){
+      for(  size_t c = 0;  c < 256;  ++c  ){
+	try{
+	  index[c]  =  residueIndexMap().toResidueIndex( (char) c );
+	}
+	catch( const std::invalid_argument& ){
+	  index[c]  =  0xff;
+	}
+      }
+    }
+  };
+
+  static const tableT  table;
+  return table.index;
+}
+
+
+
+TagSet::uint128T  TagSet::packedKey(  const size_t&  i  ) const{
+
+  const size_t  sizeInBytes  =  sigma4bitPackingUtils::numBytesNeededToStore( keyLength() );
+
+  uint128T  key  =  0;
+  for(  size_t b = 0;  b < sizeInBytes;  ++b  ){
+    key  =  (key << 8) | a[i][b];
+  }
+
+  // drop the unused low order residues of the last byte
+  return  key >> ( 2 * (SIGMA * sizeInBytes - keyLength()) );
+}
+
+
+
+void  TagSet::buildKeys(){
+
+  _keyLength  =  0;
+  _keys64 .clear();
+  _keys128.clear();
+
+  if(  !size()  )  return;
+
+  const size_t  length  =  size(0);
+
+  if(  length == 0  ||  length > maxKeyLength128()  )  return;
+
+  for(  size_t i = 1;  i < size();  ++i  ){
+    if(  size(i) != length  )  return;
+  }
+
+  _keyLength  =  length;
+
+  // equal length tags sorted lexically are sorted by key
+  if(  keyLength() <= maxKeyLength64()  ){
+    _keys64.resize( size() );
+    for(  size_t i = 0;  i < size();  ++i  )  _keys64[i]  =  (uint64_t) packedKey( i );
+  }
+  else{
+    _keys128.resize( size() );
+    for(  size_t i = 0;  i < size();  ++i  )  _keys128[i]  =  packedKey( i );
+  }
+}
+
+
+
 
 /* --------------- I/O METHODS --------------- */
 
+void  TagSet::allocate(){
+
+  a  =  new byte*[ size()+1 ];
+
+  ASSERTF(  a,
+	    "Failed to allocate array a of size (%zu)", size()+1  );
+
+  // zeroed so that the unused tail of each tag's space is written
+  // reproducibly by writeToBinaryStream
+  mem  =  new byte[ totalSize() ]();
+
+  ASSERTF(  mem,
+	    "Failed to allocate array mem of size (%zu)", totalSize()  );
+}
+
+
+
+TagSet::fileFormatT  TagSet::detectFileFormat(  std::istream& iStream  ){
+
+  const int  firstChar  =  iStream.peek();
+
+  return(  firstChar == binarySignature()[0]  ?  binary  :  text  );
+}
+
+
+
+TagSet::binaryHeaderT  TagSet::makeBinaryHeader(  const uint64_t& size,  const uint64_t& totalSize  ){
+
+  binaryHeaderT  header;
+  header.byteOrderMark    =  binaryByteOrderMark();
+  header.offsetBytes      =  sizeof(uint64_t);
+  header.residuesPerByte  =  SIGMA;
+  header.reserved         =  0;
+  header.size             =  size;
+  header.totalSize        =  totalSize;
+
+  const uint64_t  align  =  binaryAlignment();
+  header.offsetsPos  =  (binarySignature().size() + sizeof(header) + align - 1) / align * align;
+  header.memPos      =  (header.offsetsPos + (size + 1) * sizeof(uint64_t) + align - 1) / align * align;
+  header.fileSize    =  header.memPos + totalSize;
+  return header;
+}
+
+
+
+void  TagSet::readFromBinaryStream(  std::istream& iStream  ){
+
+  std::string  signature( binarySignature().size(), '\0' );
+  iStream.read(  &signature[0], signature.size()  );
+
+  DO_OR_DIEF(  !iStream.fail() && signature == binarySignature(),
+	       "Input error. Binary tag set signature not found"  );
+
+  binaryHeaderT  header;
+  iStream.read(  (char*) &header, sizeof(header)  );
+
+  DO_OR_DIEF(  !iStream.fail(),  "Input error. Could not read binary tag set header"  );
+
+  DO_OR_DIEF(  header.byteOrderMark == binaryByteOrderMark(),
+	       "Binary tag set was written on a machine with the other byte order"  );
+
+  DO_OR_DIEF(  header.offsetBytes == sizeof(uint64_t) && header.residuesPerByte == SIGMA,
+	       "Binary tag set has %u byte offsets and %u residues per byte, expected %zu and %d",
+	       (unsigned) header.offsetBytes, (unsigned) header.residuesPerByte,
+	       sizeof(uint64_t), SIGMA  );
+
+  const binaryHeaderT  expected  =  makeBinaryHeader( header.size, header.totalSize );
+
+  DO_OR_DIEF(  header.offsetsPos == expected.offsetsPos
+	       && header.memPos   == expected.memPos
+	       && header.fileSize == expected.fileSize,
+	       "Binary tag set header array positions are inconsistent"  );
+
+  _size       =  header.size;
+  _totalSize  =  header.totalSize;
+
+  allocate();
+
+  // skip the padding without seeking, so that pipes can be read too
+  iStream.ignore(  header.offsetsPos - binarySignature().size() - sizeof(header)  );
+
+  std::vector<uint64_t>  offsets( size()+1 );
+  iStream.read(  (char*) &offsets[0],  offsets.size() * sizeof(uint64_t)  );
+
+  iStream.ignore(  header.memPos - header.offsetsPos - offsets.size() * sizeof(uint64_t)  );
+
+  iStream.read(  (char*) mem,  totalSize()  );
+
+  DO_OR_DIEF(  !iStream.fail(),  "Input error. Binary tag set file is truncated"  );
+
+  DO_OR_DIEF(  offsets[0] == 0 && offsets[ size() ] == totalSize(),
+	       "Binary tag set offsets do not span the %zu residues", totalSize()  );
+
+  for(  size_t i = 0;  i < size();  ++i  ){
+    DO_OR_DIEF(  offsets[i] <= offsets[i+1],
+		 "Binary tag set offsets decrease at tag %zu", i  );
+    a[i]  =  mem + offsets[i];
+  }
+  a[ size() ]  =  mem + totalSize();
+
+  // the file was written from a tag set which was checked to be sorted when
+  // its text was read, so only the lookup keys need to be rebuilt
+  buildKeys();
+
+} // end method readFromBinaryStream
+
+
+
+void  TagSet::writeToBinaryStream(  std::ostream& oStream  ) const{
+
+  const binaryHeaderT  header  =  makeBinaryHeader( size(), totalSize() );
+
+  std::vector<uint64_t>  offsets( size()+1 );
+  for(  size_t i = 0;  i <= size();  ++i  ){
+    offsets[i]  =  a[i] - mem;
+  }
+
+  const std::string  padding( binaryAlignment(), '\0' );
+
+  oStream.write(  binarySignature().data(),  binarySignature().size()  );
+  oStream.write(  (const char*) &header,  sizeof(header)  );
+  oStream.write(  padding.data(),  header.offsetsPos - binarySignature().size() - sizeof(header)  );
+  oStream.write(  (const char*) &offsets[0],  offsets.size() * sizeof(uint64_t)  );
+  oStream.write(  padding.data(),  header.memPos - header.offsetsPos - offsets.size() * sizeof(uint64_t)  );
+  oStream.write(  (const char*) mem,  totalSize()  );
+
+  DO_OR_DIEF(  !oStream.fail(),  "Output error while writing binary tag set"  );
+}
+
+
+
 void TagSet::readFromTextStream( std::istream& iStream ){
 
   std::string line;
@@ -81,16 +398,7 @@ void TagSet::readFromTextStream( std::istream& iStream ){
 	    "Total size (%zu) should be at least as big as size (%zu)", totalSize(), size()  );
 
 
-  /* --------------- Allocate Memory --------------- */
-  a  =  new byte*[ size()+1 ];
-
-  ASSERTF(  a,
-	    "Failed to allocate array a of size (%zu)", size()+1  );
-
-  mem  =  new byte[ totalSize() ];
-
-  ASSERTF(  mem,
-	    "Failed to allocate array mem of size (%zu)", totalSize()  );
+  allocate();
 
 
   /* ---------- Declare vars for read line loop ---------- */
@@ -128,12 +436,48 @@ void TagSet::readFromTextStream( std::istream& iStream ){
 
   assertIsSorted();
 
+  buildKeys();
+
 } // end method readFromTextStream
 
 
 
 
 
+void  TagSet::assign(  const std::vector<std::string>& tagSeqs  ){
+
+  _size       =  tagSeqs.size();
+  _totalSize  =  0;
+  BOOST_FOREACH(  const std::string& tagSeq, tagSeqs  ){
+    _totalSize  +=  tagSeq.size();
+  }
+
+  allocate();
+
+  ResidueIndexMap::vectorT  residueIndices;
+
+  size_t  totalResidueCount  =  0;
+
+  for(  size_t i = 0;  i < size();  ++i  ){
+    residueIndexMap().assignResidueIndices( residueIndices, tagSeqs[i] );
+
+    a[i]  =  mem + totalResidueCount;
+
+    sigma4bitPackingUtils::pack( a[i], residueIndices );
+
+    totalResidueCount  +=  residueIndices.size();
+  }
+
+  a[ size() ]   =   mem + totalResidueCount;
+
+  if(  size()  )  assertIsSorted();
+
+  buildKeys();
+
+} // end method assign
+
+
+
 void TagSet::assertIsSorted() const{
 
   for(  size_t i = 0;  i < size()-1;  ++i  ){
@@ -7,12 +7,29 @@
  *
  *  Description: Container to map serial numbers to DNA or RNA sequences.
  *
+ *               When every tag has the same length of at most 64 residues
+ *               (the usual case) each tag is also kept as an integer key,
+ *               two bits per residue, in a sorted array.  Lookups of
+ *               sequences of that length then pack the query into a key
+ *               and do a branch-free binary search over the keys, with no
+ *               memory allocation.  Other lookups search the packed
+ *               sequences, packing the query on the stack.
+ *
+ *               Besides the text tag list, a tag set can be saved in a
+ *               binary file (see writeToBinaryStream) which loads with a
+ *               few block reads instead of parsing every line.  The
+ *               constructor recognizes either kind of file by its first
+ *               character.
+ *
  *  Purpose: Created as part of RECOUNT project.
  *
  */
 #ifndef TAGSET_HH_
 #define TAGSET_HH_
 #include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
 #include <boost/foreach.hpp>
 #include "utils/universalTypedefs.hh"
 #include "utils/sorting/sortingUtils.hh"
@@ -27,16 +44,28 @@ public:
 
 
   /* --------------- TYPEDEFS ---------------- */
-  typedef  enum {binary, text}                  fileFormatT;
+  typedef  enum {binary, text, autoDetect}      fileFormatT;
   typedef  sigma4bitPackingUtils::unpackedVecT  unpackedSeqT;
+  __extension__ typedef  unsigned __int128      uint128T;
 
 
   /* --------------- CONSTRUCTORS ------------ */
-  TagSet( std::istream& iStream, fileFormatT fileFormat = text ){
+  TagSet( std::istream& iStream, fileFormatT fileFormat = autoDetect )
+    : _keyLength( 0 )
+  {
+    if( fileFormat == autoDetect )  fileFormat  =  detectFileFormat( iStream );
+
     if( fileFormat == text )  readFromTextStream  ( iStream );
     else                      readFromBinaryStream( iStream );
   }
 
+  // tagSeqs must be sorted with no duplicated tags
+  TagSet( const std::vector<std::string>& tagSeqs )
+    : _keyLength( 0 )
+  {
+    assign( tagSeqs );
+  }
+
   ~TagSet(){
     delete[] a;
     delete[] mem;
@@ -59,15 +88,21 @@ public:
   }
 
 
-  bool  has(  const std::string&  asciiSeq  ){
-    return  has(  toUnpackedSeq( asciiSeq )  );
+  bool  has(  const std::string&  asciiSeq  ) const{
+    return  find( asciiSeq ) != size();
   }
 
   bool  has(  const unpackedSeqT&  unpackedSeq  ) const{
-    const size_t  upperBoundIdx   =   upperBound( unpackedSeq );
-    return   equal(  upperBoundIdx, unpackedSeq  );
+    return  find( unpackedSeq ) != size();
   }
-  
+
+
+  // return the serial number of the sequence, or size() if it is not in the
+  // tag set.  One search, so use it instead of has() followed by operator().
+  size_t  find(  const std::string&   asciiSeq     ) const;
+
+  size_t  find(  const unpackedSeqT&  unpackedSeq  ) const;
+
 
   // returns the serial number of unpackedSeq, assuming it is in the tag set.
   // use has() to test if a tag is in the tag set.
@@ -92,13 +127,19 @@ public:
 
   // if unpackedSeq in set, return its index, otherwise die with error message
   size_t  getSerialNumberOrDie(   const std::string&  asciiSeq   ) const{
-    const  unpackedSeqT  unpackedSeq  =  toUnpackedSeq( asciiSeq );
-    GDB_ASSERTF(  has( unpackedSeq ),
+    const size_t  serialNumber  =  find( asciiSeq );
+    GDB_ASSERTF(  serialNumber != size(),
 		  "No serial number for string: \"%s\"", asciiSeq.c_str()  );
-    return  upperBound( unpackedSeq );
+    return  serialNumber;
   }
 
 
+  // true iff lookups of sequences of length keyLength() use the integer keys
+  bool  hasPackedKeys() const{  return  _keyLength > 0;  }
+
+  const size_t&  keyLength() const{  return _keyLength;  }
+
+
   /* ---------- CLASS CONSTANTS ---------- */
 
   static const ResidueIndexMap& residueIndexMap(){
@@ -106,6 +147,11 @@ public:
     return _residueIndexMap;
   }
 
+  static const std::string&  binarySignature(){
+    static const std::string  _signature( "recountTagSet001\n" );
+    return _signature;
+  }
+
 
   /* ---------- CONVERSION METHODS ---------- */
   
@@ -124,14 +170,56 @@ public:
   
   /* --------------- I/O METHODS --------------- */
 
-  void readFromBinaryStream( std::istream& iStream ){
-    // not yet implemented
-  }
+  // binary if the next character of iStream starts binarySignature(),
+  // otherwise text.  Only peeks, so iStream need not be seekable.
+  static fileFormatT  detectFileFormat(  std::istream& iStream  );
+
+  // format written by writeToBinaryStream
+  void  readFromBinaryStream(  std::istream& iStream  );
 
   // format is one tag string per line, presorted with no duplicated tags.
   void  readFromTextStream(  std::istream& iStream  );
 
+  // same as readFromTextStream, from tag strings already in memory
+  void  assign(  const std::vector<std::string>& tagSeqs  );
+
+  // binarySignature(), binaryHeaderT, then the residue offset of each
+  // tag (size()+1 uint64_t) and the totalSize() bytes of packed sequence
+  // memory, each array starting at a multiple of binaryAlignment() bytes.
+  void  writeToBinaryStream(  std::ostream& oStream  ) const;
+
 private:
+  /* ---------- BINARY FORMAT ---------- */
+  struct binaryHeaderT{
+    uint32_t  byteOrderMark;
+    uint8_t   offsetBytes;       // width of the residue offsets
+    uint8_t   residuesPerByte;   // packing of the sequence memory
+    uint16_t  reserved;
+    uint64_t  size;
+    uint64_t  totalSize;
+
+    // positions of the arrays from the beginning of the file
+    uint64_t  offsetsPos;
+    uint64_t  memPos;
+    uint64_t  fileSize;
+  };
+
+  static uint32_t  binaryByteOrderMark(){  return 0x01020304;  }
+  static uint64_t  binaryAlignment()    {  return 64;  }
+
+  // header for a tag set of the given size, array positions filled in
+  static binaryHeaderT  makeBinaryHeader(  const uint64_t& size,  const uint64_t& totalSize  );
+
+  // allocate a and mem for size() tags of totalSize() residues
+  void  allocate();
+
+  // residues per key of each width
+  static size_t  maxKeyLength64 (){  return 32;  }
+  static size_t  maxKeyLength128(){  return 64;  }
+
+  // residue index of each character, 0xff for characters not in the alphabet
+  static const byte*  residueIndexTable();
+
   // return true iff i_th tag seq is the same as seqToCompare.
   bool  equal(   const size_t&  i,  const unpackedSeqT&  seqToCompare  ) const;
 
@@ -139,6 +227,18 @@ private:
   // or size() if TAG > max(element)
   size_t  upperBound(  const unpackedSeqT&  seqToMatch  ) const;
 
+  // find() by searching the packed sequences
+  size_t  findPacked(  const unpackedSeqT&  seqToMatch  ) const;
+
+  // find() of a key of keyLength() residues
+  size_t  findKey(  const uint128T&  key  ) const;
+
+  // key of the ith tag, which must have keyLength() residues
+  uint128T  packedKey(  const size_t&  i  ) const;
+
+  // fill _keys64 or _keys128 if all tags have the same length
+  void  buildKeys();
+
   void assertIsSorted() const;
 
   // Return true iff the i_th sequence is lexically less than the j_th sequence
@@ -177,6 +277,12 @@ private:
   byte*   mem;   // memory to hold contents of sequences
   size_t  _size;
   size_t  _totalSize;
+
+  // length of every tag when the keys below are used, otherwise 0;
+  // keys are kept in _keys64 up to maxKeyLength64() residues, else in _keys128
+  size_t                 _keyLength;
+  std::vector<uint64_t>  _keys64;
+  std::vector<uint128T>  _keys128;
 };
 
 
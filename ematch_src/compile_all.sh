@@ -2,19 +2,27 @@
 # Optimized build flags for maximum performance
 OPTFLAGS="-Wall -O3 -march=native -mtune=native -flto -ffast-math -funroll-loops -finline-functions -std=c++20"
 
-g++ $OPTFLAGS FindNeighboursWithQualJuxt.cc -o FindNeighboursWithQualJuxt
+g++ $OPTFLAGS FindNeighboursWithQualJuxt.cc -o FindNeighboursWithQualJuxt -I../src
 
-g++ $OPTFLAGS -DCBRC_OPTIMIZE=2 -o runRecountExpectationMatchingTagCorrector \
-	./RecountComputerForGraphOnDisk.cc ./RecountExpectationMatchingTagCorrector.cc ./RecountNeighborList.cc ./RecountNeighborProbGraphOnDisk.cc ./RecountTagCounts.cc ./TagSet.cc ./utils/perlish/perlish.cc ./utils/sequence/ResidueIndexMap/ResidueIndexMap.cc ./utils/sequence/packedDNA/sigma4bitPackingUtils.cc runRecountExpectationMatchingTagCorrector.cc	\
+g++ $OPTFLAGS -fopenmp -DCBRC_OPTIMIZE=2 -o runRecountExpectationMatchingTagCorrector \
+	./RecountAndersonTagCorrector.cc ./RecountComponentTagCorrector.cc ./RecountComputerForGraphInMemory.cc ./RecountComputerForGraphOnDisk.cc ./RecountExpectationMatchingTagCorrector.cc ./RecountGraphComponents.cc ./RecountNeighborList.cc ./RecountNeighborProbGraphInMemory.cc ./RecountNeighborProbGraphOnDisk.cc ./RecountTagCounts.cc ./TagSet.cc ./utils/perlish/perlish.cc ./utils/sequence/ResidueIndexMap/ResidueIndexMap.cc ./utils/sequence/packedDNA/sigma4bitPackingUtils.cc runRecountExpectationMatchingTagCorrector.cc	\
 	-lboost_regex -I.
 
-g++ $OPTFLAGS -DCBRC_OPTIMIZE=2 -o writeRecountNeighborProbGraph \
+g++ $OPTFLAGS -fopenmp -DCBRC_OPTIMIZE=2 -o runRecountExpectationMatchingPipeline \
+	./RecountAndersonTagCorrector.cc ./RecountComponentTagCorrector.cc ./RecountComputerForGraphInMemory.cc ./RecountComputerForGraphOnDisk.cc ./RecountExpectationMatchingTagCorrector.cc ./RecountGraphComponents.cc ./RecountNeighborList.cc ./RecountNeighborProbGraphBuilder.cc ./RecountNeighborProbGraphInMemory.cc ./RecountNeighborProbGraphOnDisk.cc ./RecountTagCounts.cc ./TagSet.cc ./utils/perlish/perlish.cc ./utils/sequence/ResidueIndexMap/ResidueIndexMap.cc ./utils/sequence/packedDNA/sigma4bitPackingUtils.cc runRecountExpectationMatchingPipeline.cc	\
+	-lboost_regex -I. -I../src
+
+g++ $OPTFLAGS -fopenmp -DCBRC_OPTIMIZE=2 -o writeRecountNeighborProbGraph \
 	./RecountNeighborList.cc ./RecountNeighborProbGraphWriter.cc ./TagSet.cc ./utils/perlish/perlish.cc ./utils/sequence/ResidueIndexMap/ResidueIndexMap.cc ./utils/sequence/packedDNA/sigma4bitPackingUtils.cc writeRecountNeighborProbGraph.cc	\
 	-lboost_regex -I.
 
-g++ $OPTFLAGS -DCBRC_DEBUG -DGDB_DEBUG -DCBRC_OPTIMIZE=2 -o dumpRecountNeighborProbGraphOnDisk_ConnectedComponentSize \
-./graph/ConnectedComponentOnlineComputer.cc ./RecountNeighborList.cc \
-./RecountNeighborProbGraphOnDisk.cc ./TagSet.cc \
+g++ $OPTFLAGS -DCBRC_OPTIMIZE=2 -o writeBinaryTagSet \
+	./SortedTagSet.cc ./TagSet.cc ./utils/perlish/perlish.cc ./utils/sequence/ResidueIndexMap/ResidueIndexMap.cc ./utils/sequence/packedDNA/Sigma4FLArray.cc ./utils/sequence/packedDNA/sigma4bitPackingUtils.cc writeBinaryTagSet.cc	\
+	-lboost_regex -I.
+
+g++ $OPTFLAGS -fopenmp -DCBRC_DEBUG -DGDB_DEBUG -DCBRC_OPTIMIZE=2 -o dumpRecountNeighborProbGraphOnDisk_ConnectedComponentSize \
+./RecountGraphComponents.cc ./RecountNeighborList.cc \
+./RecountNeighborProbGraphInMemory.cc ./TagSet.cc \
 ./utils/argvParsing/ArgvParser.cc \
 ./utils/perlish/perlish.cc \
 ./utils/sequence/ResidueIndexMap/ResidueIndexMap.cc \
@@ -1,96 +1,62 @@
-/*  
+/*
  *  Author: Paul Horton
  *  Organization: Computational Biology Research Center, AIST, Japan
  *  Copyright (C) 2009, Paul Horton, All rights reserved.
  *  Creation Date: 2009.5.10
  *  Last Modified: $Date: 2009/09/24 04:35:23 $
  *
- *  Purpose: try code involving RecountNeighborProbGraph
+ *  Purpose: print, or save in binary, the connected components of the tags
+ *           of a RecountNeighborProbGraph
  */
 #include <iostream>
 #include "utils/argvParsing/ArgvParser.hh"
-#include "./RecountNeighborProbGraphOnDisk.hh"
-#include "./graph/ConnectedComponentOnlineComputer.hh"
+#include "./RecountNeighborProbGraphInMemory.hh"
+#include "./RecountGraphComponents.hh"
+#define  USAGE                  [OPTIONS] tagSeqsFile neighborsProbGraphFile
+#define  THREADS_FLAG           -t|--threads
+#define  OUTPUT_FLAG            -o|--output
+#define  HISTOGRAM_FLAG         -s|--size-histogram
 
 /* ********** PARAMETERS FROM COMMAND LINE ********** */
 static std::ifstream  arg_tagSeqs_ifstream;
-static std::ifstream  arg_neighborsProbGraphOnDisk_ifstream;
+static std::string    arg_neighborsProbGraphFile;
+static size_t         arg_numThreads;
+static std::ofstream  arg_outfile;
+static bool           arg_sizeHistogram;
 
 
 namespace cbrc{
 
 
-void dumpNeighborList(  const TagSet&              tagID_to_seq,
-			const RecountNeighborList  neighborList  ){
-
-  std::cout  <<  tagID_to_seq.toString( neighborList.id() )  <<  " ";
-
-  BOOST_FOREACH( const RecountTagIdProbPair& tagIdProbPair, neighborList ){
-    std::cout  <<  "("  <<  tagID_to_seq.toString( tagIdProbPair.id() )
-	       <<  ","  <<  tagIdProbPair.prob()  <<  ") ";
-
-  }
-  std::cout << std::endl;
-}
-
-
 void dumpRecountNeighborProbGraphOnDisk(){
 
     const TagSet  tagID_to_seq( arg_tagSeqs_ifstream );
 
-    RecountNeighborProbGraphOnDisk
-      neighborProbGraph( tagID_to_seq, arg_neighborsProbGraphOnDisk_ifstream );
-
-
-    ConnectedComponentOnlineComputer ccoc(neighborProbGraph.size());
-
-    neighborProbGraph.readFirstNode();
+    const RecountNeighborProbGraphInMemory
+      neighborProbGraph( tagID_to_seq, arg_neighborsProbGraphFile );
 
+    const RecountGraphComponents
+      graphComponents( neighborProbGraph, tagID_to_seq.size(), arg_numThreads );
 
-    do{
-
-        const RecountNeighborList& neighborList = neighborProbGraph.curNeighborList();
-
-        BOOST_FOREACH( const RecountTagIdProbPair& tagIdProbPair, neighborList ){
-
-                    if (neighborList.id() >= neighborProbGraph.size() ) {
-                        std::cout << "If 1\n";
-                        std::cout << neighborList.id() << " " << tagIdProbPair.id() << " " << neighborProbGraph.size() <<  "\n";
-                     
-                    }
-                    if (tagIdProbPair.id() >= neighborProbGraph.size() ) {
-                        std::cout << "If 2\n";
-                        std::cout << neighborList.id() << " " << tagIdProbPair.id() << " " << neighborProbGraph.size() <<  "\n";
-                     
-                    }
-/*--------------------------------------------------
-* 
-*                     if (neighborList.id() == tagIdProbPair.id() ) {
-*                         std::cout << "If 3\n";
-*                         std::cout << neighborList.id() << " " << tagIdProbPair.id() << " " << neighborProbGraph.size() <<  "\n";
-*                      
-*                     }
-* 
-*--------------------------------------------------*/
-                    if (neighborList.id() != tagIdProbPair.id()) {
-                        
-                        //std::cout << neighborList.id() << " " << tagIdProbPair.id() << " " << neighborProbGraph.size() <<  "\n";
-                        ccoc.addEdge( neighborList.id(), tagIdProbPair.id());
-                    }
-
-        }
-
-        
-       //dumpNeighborList( tagID_to_seq, neighborProbGraph.curNeighborList() );
-    } while(  neighborProbGraph.readNextNode()  );
-
-
-   FLEArray<unsigned int> nodeComponents(  neighborProbGraph.size() );
-    std::cout << "number of components: " << ccoc.getNodeComponents( nodeComponents ) << "\n";
-    std::cout << nodeComponents << std::endl;
+    if(  arg_outfile.is_open()  ){
+      graphComponents.write( arg_outfile );
+      return;
+    }
 
+    std::cout << "number of components: " << graphComponents.numComponents() << "\n";
 
+    if( arg_sizeHistogram ){
+      for(  size_t i = 0;  i < graphComponents.sizeHistogram().size();  ++i  ){
+	std::cout  <<  graphComponents.sizeHistogram()[i].first   <<  "\t"
+		   <<  graphComponents.sizeHistogram()[i].second  <<  "\n";
+      }
+      return;
+    }
 
+    for(  size_t i = 0;  i < graphComponents.size();  ++i  ){
+      std::cout  <<  ( i ? " " : "" )  <<  graphComponents.componentId( i );
+    }
+    std::cout << std::endl;
 
 } // end dumpRecountNeighborProbGraphOnDisk
 
@@ -100,11 +66,52 @@ void dumpRecountNeighborProbGraphOnDisk(){
 
 
 int main( int argc, const char* argv[] ){
-  cbrc::ArgvParser argvP( argc, argv, "tagSeqsFile neighborsProbGraphOnDiskFile" );
-  
+  cbrc::ArgvParser argvP( argc, argv, Q(USAGE) );
+
+  argvP.setDoc( "-h|-help|--help",
+		"\
+$0 "Q(USAGE)"\n\
+\n\
+Print the number of connected components of the tags of the graph,\n\
+then the component of each tag.\n\
+\n\
+tagSeqsFile\n\
+    tag list, as read by runRecountExpectationMatchingTagCorrector\n\
+\n\
+neighborsProbGraphFile\n\
+    binary neighbor graph written by writeRecountNeighborProbGraph,\n\
+    loaded into memory.\n\
+\n\
+OPTIONS\n\
+\n\
+    "Q(THREADS_FLAG)"\n\
+        Add the edges of the graph with this many threads.\n\
+        The components are numbered the same for any number of threads.\n\
+\n\
+    "Q(OUTPUT_FLAG)"\n\
+        Instead of printing, write the component ids and size histogram\n\
+        to this binary file, for runRecountExpectationMatchingTagCorrector\n\
+        --components-file\n\
+\n\
+    "Q(HISTOGRAM_FLAG)"\n\
+        Print the component sizes, each with its number of components,\n\
+        instead of the component of each tag.\n\
+"
+		);  /* end setDoc help */
+
+  argvP.printDoc();
+
+  /* ----- Default values ----- */
+  arg_numThreads     =  0;
+  arg_sizeHistogram  =  false;
+
+  argvP.set( arg_numThreads,     Q(THREADS_FLAG) );
+  argvP.set( arg_sizeHistogram,  Q(HISTOGRAM_FLAG) );
+  argvP.setCautiously( arg_outfile,   Q(OUTPUT_FLAG) );
+
   argvP.setOrDie( arg_tagSeqs_ifstream, 1 );
 
-  argvP.setOrDie( arg_neighborsProbGraphOnDisk_ifstream, 2 );
+  argvP.setOrDie( arg_neighborsProbGraphFile, 2 );
 
   argvP.dieIfUnusedArgs();
 
@@ -113,4 +120,3 @@ int main( int argc, const char* argv[] ){
   return 1;
 
 }
-
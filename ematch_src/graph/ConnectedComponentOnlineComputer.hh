@@ -20,9 +20,8 @@
  *          connected components.
  *
  *  Requirements: space: linear in the number of vertices v. (not edges!)
- *                time:  O( vLogv ) I think. Could be made almost linear if disjoint set was
- *                more carefully implemented. In particular "path compression" is used but
- *                "union by rank" is not.
+ *                time:  almost linear in the number of edges added, as both
+ *                "union by size" and path compression (by path halving) are used.
  *
  *  Reference: Uses Disjoint-set forests algorithm.
  *             For example see "Introduction to Algorithms" by C, L, & R.
@@ -37,57 +36,49 @@ namespace cbrc{
 class ConnectedComponentOnlineComputer {
 public:
   ConnectedComponentOnlineComputer( nodeIndexT numNodes ) : numNodes(numNodes) {
-    nodeToComponent.setSize( numNodes );
-    nodeToComponent.fill( unassignedComponentIndexValue() );
-    compressionStack.setSize( numNodes );
-    curComponent = 0;
+    parent.setSize( numNodes );
+    for( nodeIndexT i = 0; i < numNodes; ++i ) parent[i] = i;
+    treeSize.setSize( numNodes );
+    treeSize.fill( 1 );
   }
 
-  void addNode( nodeIndexT n0 ){
-    if(  isUnassignedComponentIndex( nodeToComponent[n0] )  ){
-      nodeToComponent[n0] = ++curComponent;
-    }
-  }
+  // every node starts out in a component of its own, so nothing to do.
+  void addNode( nodeIndexT ){}
   
   void addEdge( nodeIndexT n0, nodeIndexT n1 );
 
   void addGraph( const Graph& g );
 
-  // return component index of component containing node N
+  // return component index of component containing node N;
+  // the index of the representative node of the component. The value
+  // is only meaningful for comparing two nodes for equality; it is not
+  // a component number, and may change as further edges are added.
   nodeIndexT getComponent( const nodeIndexT& n ){
-    nodeIndexT tempN = n;
-    return _getComponent( tempN );
+    return _getComponent( n );
   }
 
   nodeIndexT getNodeComponents( FLEArray<nodeIndexT>& nodeComponents ); // returns number of components.
 private:
-  nodeIndexT unassignedComponentIndexValue() const{
-    return numNodes;
-  }
-
-  bool isUnassignedComponentIndex( const nodeIndexT& index ){
-    return(  index == numNodes  );
+  // return the representative (root) of the tree holding n,
+  // pointing every other node on the way at its grandparent.
+  nodeIndexT _getComponent( nodeIndexT n ){
+    while( parent[n] != n ){
+      parent[n] = parent[ parent[n] ];
+      n = parent[n];
+    }
+    return n;
   }
 
-  void compressPaths();
-
-  // returns number of components.
-  nodeIndexT renumberComponents( FLEArray<nodeIndexT>& nodeComponents ); 
-
-  nodeIndexT _getComponent( nodeIndexT& n /* modifies n */ );
-
   // object data.
 
-  // if   nodeToComponent[i] = k > 0, i is the representative of cluster k,
-  // else nodeToComponent[i] = -p, where p is the parent of node i
-  FLEArray<int>        nodeToComponent;
+  // parent[i] is the parent of node i in its tree, i itself for the
+  // representative of each component
+  FLEArray<nodeIndexT> parent;
 
-  // stack used for path-compression
-  FLEArray<nodeIndexT> compressionStack;
-  nodeIndexT           stackTop;
+  // treeSize[i] is the number of nodes in the tree of representative i
+  FLEArray<nodeIndexT> treeSize;
 
   const nodeIndexT numNodes;
-  nodeIndexT curComponent;
 };
 
 }; // end namespace
@@ -84,6 +84,7 @@ $0 tagSeqsFile tagNeighborProbFile tagCountsFile\n\
 \n\
 tagSeqsFile\n\
     text file holding unique tag sequences, one per line\n\
+    or the binary tag set written from it by writeBinaryTagSet\n\
 \n\
 tagNeighborProbGraphFile\n\
     binary file holding information on the neighbor tags which may be\n\
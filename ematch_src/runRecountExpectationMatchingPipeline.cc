@@ -0,0 +1,359 @@
+/*
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.10.8
+ *  Last Modified: $Date$
+ *
+ *  Input:  tags with their raw counts and per base Solexa quality scores,
+ *          the input of FindNeighboursWithQualJuxt
+ *  Output: corrected tag counts, as output by
+ *          runRecountExpectationMatchingTagCorrector
+ *
+ *  Purpose: Runs the whole Expectation-Matching pipeline of run_Expmatch.py
+ *           (FindNeighboursWithQualJuxt, GenerateTagListFileWithBaseCount.py,
+ *           writeRecountNeighborProbGraph and
+ *           runRecountExpectationMatchingTagCorrector) in one process,
+ *           passing the tag set, counts and neighbor graph in memory
+ *           instead of through text and binary files.
+ */
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "utils/argvParsing/ArgvParser.hh"
+#include "utils/perlish/perlish.hh"
+#include "./RecountNeighborProbGraphBuilder.hh"
+#include "./RecountComputerForGraphOnDisk.hh"
+#include "./RecountComputerForGraphInMemory.hh"
+#include "./RecountExpectationMatchingTagCorrector.hh"
+#include "./RecountAndersonTagCorrector.hh"
+#include "./RecountComponentTagCorrector.hh"
+#define  USAGE                  [OPTIONS] qualTagsFile
+#define  ROUNDS_TO_WAIT_FLAG    -r|--rounds-to-wait
+#define  THREADS_FLAG           -t|--threads
+#define  ANDERSON_FLAG          -a|--anderson
+#define  TOLERANCE_FLAG         -e|--tolerance
+#define  ITERATIONS_FLAG        -i|--report-iterations
+#define  COMPONENTS_FLAG        -c|--components
+#define  MEMORY_BUDGET_FLAG     -m|--memory-budget
+#define  SPILL_FILE_FLAG        -s|--spill-file
+
+
+/* --------------- PARAMETERS FROM COMMAND LINE --------------- */
+static std::string  arg_qualTagsFilename;
+size_t              arg_roundsToWait;
+size_t              arg_numThreads;
+size_t              arg_andersonHistory;
+double              arg_tolerance;
+bool                arg_reportIterations;
+bool                arg_components;
+size_t              arg_memoryBudgetMB;
+std::string         arg_spillFilename;
+
+
+namespace cbrc{
+
+  // parse line "rawCount tag [quality scores]" of the qualTagsFile into
+  // tagSeq, spelled with the residue indices of TagSet, and rawCount.
+  // The quality scores are parsed into solexaQuals unless it is NULL.
+  // return false for comment and blank lines.
+  bool parseQualTagLine(  const std::string&    line,
+			  /***/ std::string&    tagSeq,
+			  /***/ tagCountT&      rawCount,
+			  std::vector<double>*  solexaQuals  ){
+
+    if(  line.empty() || line[0] == '#'  )  return false;
+
+    const char*  cur  =  line.c_str();
+    char*        end;
+
+    rawCount  =  strtod( cur, &end );
+    if(  end == cur  )  return false;
+    cur  =  end;
+
+    // zero counts are raised as in FindNeighboursWithQualJuxt
+    if(  rawCount == 0.0  )  rawCount  =  0.00001;
+
+    while(  isspace( *cur )  )  ++cur;
+
+    // bases other than ACGT become the residue index of A,
+    // as in FindNeighboursWithQualJuxt
+    tagSeq.clear();
+    for(  ;  *cur && !isspace( *cur );  ++cur  ){
+      switch( *cur ){
+      case 'C':  tagSeq.push_back( '1' );  break;
+      case 'G':  tagSeq.push_back( '2' );  break;
+      case 'T':  tagSeq.push_back( '3' );  break;
+      default:   tagSeq.push_back( '0' );
+      }
+    }
+
+    if(  !solexaQuals  )  return true;
+
+    solexaQuals->clear();
+    for( ;; ){
+      const double  qual  =  strtod( cur, &end );
+      if(  end == cur  )  break;
+      solexaQuals->push_back( qual );
+      cur  =  end;
+    }
+
+    return true;
+  }
+
+
+
+  // run tagCorrector, then print its corrected counts
+  template <typename tagCorrectorT>
+  void inferTrueTagCounts(  tagCorrectorT&  tagCorrector,
+			    const TagSet&   tagID_to_seq  ){
+
+    tagCorrector.inferTrueTagCounts();
+
+    if( arg_reportIterations ){
+      std::cerr  <<  "# "  <<  tagCorrector.numIterations()  <<  " passes over the neighbor graph,"
+		 <<  " best estimate from pass "  <<  tagCorrector.bestEstCountsIteration() + 1
+		 <<  ", error "  <<  tagCorrector.bestEstError()  <<  std::endl;
+    }
+
+    tagCorrector.bestEstCounts().print( tagID_to_seq );
+  }
+
+
+  // components iterate independently, so their rounds are not passes
+  // over the whole graph; report both units separately
+  void inferTrueTagCounts(  RecountComponentTagCorrector&  tagCorrector,
+			    const TagSet&                  tagID_to_seq  ){
+
+    tagCorrector.inferTrueTagCounts();
+
+    if( arg_reportIterations ){
+      std::cerr  <<  "# "  <<  tagCorrector.numIterations()  <<  " passes over the neighbor graph"
+		 <<  " (rounds weighted by component size),"
+		 <<  " at most "  <<  tagCorrector.maxComponentIterations()  <<  " rounds in one component,"
+		 <<  " best estimates from component rounds up to "
+		 <<  tagCorrector.bestEstCountsIteration() + 1
+		 <<  ", error "  <<  tagCorrector.bestEstError()  <<  std::endl;
+    }
+
+    tagCorrector.bestEstCounts().print( tagID_to_seq );
+  }
+
+
+
+  void runRecountExpectationMatchingTagCorrector(  const TagSet&                      tagID_to_seq,
+						   const RecountTagCounts&            observedCounts,
+						   const RecountExpectationComputer&  recountComputer  ){
+
+    if( arg_andersonHistory ){
+      RecountAndersonTagCorrector
+	tagCorrector( recountComputer, observedCounts, arg_roundsToWait, arg_tolerance, arg_andersonHistory );
+
+      inferTrueTagCounts( tagCorrector, tagID_to_seq );
+      return;
+    }
+
+    RecountExpectationMatchingTagCorrector
+      tagCorrector( recountComputer, observedCounts, arg_roundsToWait, arg_tolerance );
+
+    inferTrueTagCounts( tagCorrector, tagID_to_seq );
+  }
+
+
+
+  void runRecountExpectationMatchingPipeline(){
+
+    DO_OR_DIEF(  !arg_components  ||  !arg_andersonHistory,
+		 "%s cannot be combined with %s",  Q(COMPONENTS_FLAG), Q(ANDERSON_FLAG)  );
+
+    std::ifstream  qualTagsFile( arg_qualTagsFilename.c_str() );
+
+    DO_OR_DIEF(  qualTagsFile.good(),
+		 "Could not open file \"%s\"", arg_qualTagsFilename.c_str()  );
+
+
+    /* ***** First pass: tags and their counts ***** */
+    std::vector<std::string>  tagSeqs;
+    std::vector<tagCountT>    rawCounts;
+
+    std::string  line, tagSeq;
+    tagCountT    rawCount;
+
+    while(  perlish::slurpLine( line, qualTagsFile )  ){
+      if(  !parseQualTagLine( line, tagSeq, rawCount, NULL )  )  continue;
+      tagSeqs  .push_back( tagSeq   );
+      rawCounts.push_back( rawCount );
+    }
+
+    std::vector<std::string>  sortedTagSeqs( tagSeqs );
+    std::sort( sortedTagSeqs.begin(), sortedTagSeqs.end() );
+
+    const std::vector<std::string>::const_iterator  duplicate
+      =  std::adjacent_find( sortedTagSeqs.begin(), sortedTagSeqs.end() );
+
+    DO_OR_DIEF(  duplicate == sortedTagSeqs.end(),
+		 "Tag \"%s\" occurs more than once in \"%s\"",
+		 duplicate->c_str(), arg_qualTagsFilename.c_str()  );
+
+    const TagSet  tagID_to_seq( sortedTagSeqs );
+
+    std::vector<std::string>().swap( sortedTagSeqs );
+
+    RecountTagCounts  observedCounts( tagID_to_seq.size() );
+
+    for(  size_t i = 0;  i < tagSeqs.size();  ++i  ){
+      observedCounts[ tagID_to_seq.getSerialNumberOrDie( tagSeqs[i] ) ]  =  rawCounts[i];
+    }
+
+    std::vector<std::string>().swap( tagSeqs   );
+    std::vector<tagCountT>  ().swap( rawCounts );
+
+    assert(   observedCounts.min()  >=  1.0   );
+
+
+    /* ***** Second pass: neighbor graph from the quality scores ***** */
+    qualTagsFile.clear();
+    qualTagsFile.seekg( 0 );
+
+    RecountNeighborProbGraphBuilder
+      graphBuilder( tagID_to_seq, arg_memoryBudgetMB << 20, arg_spillFilename );
+
+    std::vector<double>  solexaQuals;
+
+    while(  perlish::slurpLine( line, qualTagsFile )  ){
+      if(  !parseQualTagLine( line, tagSeq, rawCount, &solexaQuals )  )  continue;
+      graphBuilder.addTag( tagSeq, solexaQuals );
+    }
+
+    graphBuilder.finish();
+
+
+    if(  graphBuilder.spilled()  ){
+      std::ifstream  graphFile( arg_spillFilename.c_str(), std::ios::binary );
+
+      DO_OR_DIEF(  graphFile.good(),
+		   "Could not open graph spill file \"%s\"", arg_spillFilename.c_str()  );
+
+      RecountNeighborProbGraphOnDisk  neighborGraph( tagID_to_seq, graphFile );
+
+      RecountComputerForGraphOnDisk  recountComputer( neighborGraph );
+
+      runRecountExpectationMatchingTagCorrector( tagID_to_seq, observedCounts, recountComputer );
+
+      remove( arg_spillFilename.c_str() );
+      return;
+    }
+
+    std::vector<tagIdT>  nodeIds;
+    std::vector<size_t>  offsets;
+    tagIdVecT            neighborIds;
+    probVecT             neighborProbs;
+
+    graphBuilder.releaseArrays( nodeIds, offsets, neighborIds, neighborProbs );
+
+    const RecountNeighborProbGraphInMemory
+      neighborGraph( tagID_to_seq, nodeIds, offsets, neighborIds, neighborProbs );
+
+    if( arg_components ){
+      RecountComponentTagCorrector
+	tagCorrector( neighborGraph, observedCounts, arg_roundsToWait, arg_tolerance, arg_numThreads );
+
+      inferTrueTagCounts( tagCorrector, tagID_to_seq );
+      return;
+    }
+
+    RecountComputerForGraphInMemory  recountComputer( neighborGraph, arg_numThreads );
+
+    runRecountExpectationMatchingTagCorrector( tagID_to_seq, observedCounts, recountComputer );
+  }
+
+} // end namescape cbrc
+
+
+
+int main( int argc, const char* argv[] ){
+  cbrc::ArgvParser argvP( argc, argv, Q(USAGE) );
+
+    argvP.setDoc( "-h|-help|--help",
+		"\
+$0 "Q(USAGE)"\n\
+\n\
+\n\
+qualTagsFile\n\
+    text file with one tag per line: its raw count, its sequence, then the\n\
+    Solexa quality score of each base, separated by white space.  Lines\n\
+    starting with '#' are skipped.  The same input as FindNeighboursWithQualJuxt\n\
+\n\
+\n\
+OPTIONS\n\
+\n\
+    "Q(ROUNDS_TO_WAIT_FLAG)"\n\
+        Number of iterations to wait for improvement before terminating.\n\
+\n\
+    "Q(ANDERSON_FLAG)"\n\
+        Accelerate the search with Anderson mixing of this many previous\n\
+        estimates, needing far fewer passes over the graph. 0 (default) for\n\
+        the plain fixed point iteration.\n\
+\n\
+    "Q(TOLERANCE_FLAG)"\n\
+        Stop once the estimate changes (with "Q(ANDERSON_FLAG)", once the\n\
+        expected counts differ from the observed counts) by at most this\n\
+        much for every tag. 0 (default) to stop only after\n\
+        "Q(ROUNDS_TO_WAIT_FLAG)" rounds without improvement.\n\
+\n\
+    "Q(ITERATIONS_FLAG)"\n\
+        Report the number of passes over the graph to stderr.\n\
+\n\
+    "Q(COMPONENTS_FLAG)"\n\
+        Correct each connected component of the graph separately, as in\n\
+        runRecountExpectationMatchingTagCorrector. Not used with\n\
+        "Q(ANDERSON_FLAG)", nor once the graph is spilled to disk.\n\
+\n\
+    "Q(THREADS_FLAG)"\n\
+        Compute expected counts with this many threads, as in\n\
+        runRecountExpectationMatchingTagCorrector. Not used once the graph\n\
+        is spilled to disk.\n\
+\n\
+    "Q(MEMORY_BUDGET_FLAG)"\n\
+        Megabytes the neighbor graph may use in memory, 0 (default) for no\n\
+        limit. Larger graphs are written to the spill file and read from\n\
+        disk on every iteration.\n\
+\n\
+    "Q(SPILL_FILE_FLAG)"\n\
+        File to spill the neighbor graph to, removed when done.\n\
+        Default qualTagsFile with .spill.bin appended.\n\
+\n\
+"
+		);  /* end setDoc help */
+
+  argvP.printDoc();
+
+  /* ----- Default values ----- */
+  arg_roundsToWait      =  10;
+  arg_numThreads        =  0;
+  arg_andersonHistory   =  0;
+  arg_tolerance         =  0.0;
+  arg_reportIterations  =  false;
+  arg_components        =  false;
+  arg_memoryBudgetMB    =  0;
+
+  argvP.set( arg_roundsToWait,      Q(ROUNDS_TO_WAIT_FLAG) );
+  argvP.set( arg_andersonHistory,   Q(ANDERSON_FLAG) );
+  argvP.set( arg_tolerance,         Q(TOLERANCE_FLAG) );
+  argvP.set( arg_reportIterations,  Q(ITERATIONS_FLAG) );
+  argvP.set( arg_components,        Q(COMPONENTS_FLAG) );
+  argvP.set( arg_numThreads,        Q(THREADS_FLAG) );
+  argvP.set( arg_memoryBudgetMB,    Q(MEMORY_BUDGET_FLAG) );
+  argvP.set( arg_spillFilename,     Q(SPILL_FILE_FLAG) );
+
+  argvP.setOrDie( arg_qualTagsFilename, 1 );
+
+  argvP.dieIfUnusedArgs();
+
+  if(  arg_spillFilename.empty()  )  arg_spillFilename  =  arg_qualTagsFilename + ".spill.bin";
+
+  cbrc::runRecountExpectationMatchingPipeline();
+  return 0;
+}
@@ -9,43 +9,157 @@
  */
 #include <iostream>
 #include "utils/argvParsing/ArgvParser.hh"
+#include "./RecountComputerForGraphOnDisk.hh"
+#include "./RecountComputerForGraphInMemory.hh"
 #include "./RecountExpectationMatchingTagCorrector.hh"
+#include "./RecountAndersonTagCorrector.hh"
+#include "./RecountComponentTagCorrector.hh"
 #define  USAGE                  [OPTIONS] tagSeqsFile tagNeighborProbGraphFile tagCountsFile
 #define  ROUNDS_TO_WAIT_FLAG    -r|--rounds-to-wait
+#define  ON_DISK_FLAG           -d|--on-disk
+#define  THREADS_FLAG           -t|--threads
+#define  ANDERSON_FLAG          -a|--anderson
+#define  TOLERANCE_FLAG         -e|--tolerance
+#define  ITERATIONS_FLAG        -i|--report-iterations
+#define  COMPONENTS_FLAG        -c|--components
+#define  COMPONENTS_FILE_FLAG   -C|--components-file
 
 
 /* --------------- PARAMETERS FROM COMMAND LINE --------------- */
 static std::ifstream  arg_tagSeqsFile;
-static std::ifstream  arg_tagNeighborProbGraphFile;
+static std::string    arg_tagNeighborProbGraphFile;
 static std::ifstream  arg_tagCountsFile;
 size_t                arg_roundsToWait;
+bool                  arg_onDisk;
+size_t                arg_numThreads;
+size_t                arg_andersonHistory;
+double                arg_tolerance;
+bool                  arg_reportIterations;
+bool                  arg_components;
+std::string           arg_componentsFile;
 
 
 namespace cbrc{
 
-  void runRecountExpectationMatchingTagCorrector(){
+  // run tagCorrector, then print its corrected counts
+  template <typename tagCorrectorT>
+  void inferTrueTagCounts(  tagCorrectorT&  tagCorrector,
+			    const TagSet&   tagID_to_seq  ){
 
-    const TagSet  tagID_to_seq( arg_tagSeqsFile );
+    tagCorrector.inferTrueTagCounts();
+
+    if( arg_reportIterations ){
+      std::cerr  <<  "# "  <<  tagCorrector.numIterations()  <<  " passes over the neighbor graph,"
+		 <<  " best estimate from pass "  <<  tagCorrector.bestEstCountsIteration() + 1
+		 <<  ", error "  <<  tagCorrector.bestEstError()  <<  std::endl;
+    }
+
+    tagCorrector.bestEstCounts().print( tagID_to_seq );
+  }
+
+
+  // components iterate independently, so their rounds are not passes
+  // over the whole graph; report both units separately
+  void inferTrueTagCounts(  RecountComponentTagCorrector&  tagCorrector,
+			    const TagSet&                  tagID_to_seq  ){
+
+    tagCorrector.inferTrueTagCounts();
+
+    if( arg_reportIterations ){
+      std::cerr  <<  "# "  <<  tagCorrector.numIterations()  <<  " passes over the neighbor graph"
+		 <<  " (rounds weighted by component size),"
+		 <<  " at most "  <<  tagCorrector.maxComponentIterations()  <<  " rounds in one component,"
+		 <<  " best estimates from component rounds up to "
+		 <<  tagCorrector.bestEstCountsIteration() + 1
+		 <<  ", error "  <<  tagCorrector.bestEstError()  <<  std::endl;
+    }
+
+    tagCorrector.bestEstCounts().print( tagID_to_seq );
+  }
 
-    RecountNeighborProbGraphOnDisk neighborGraph( tagID_to_seq, arg_tagNeighborProbGraphFile );
 
-    RecountComputerForGraphOnDisk recountComputer( neighborGraph );
 
-    RecountTagCounts observedCounts( neighborGraph.tagID_to_seq(), arg_tagCountsFile );
+  void runRecountExpectationMatchingTagCorrector(  const TagSet&                      tagID_to_seq,
+						   const RecountExpectationComputer&  recountComputer  ){
+
+    RecountTagCounts observedCounts( tagID_to_seq, arg_tagCountsFile );
 
     assert(   observedCounts.min()  >=  1.0   );
 
 
+    if( arg_andersonHistory ){
+      RecountAndersonTagCorrector
+	tagCorrector( recountComputer, observedCounts, arg_roundsToWait, arg_tolerance, arg_andersonHistory );
+
+      inferTrueTagCounts( tagCorrector, tagID_to_seq );
+      return;
+    }
+
     RecountExpectationMatchingTagCorrector
-      tagCorrector( recountComputer, observedCounts, arg_roundsToWait );
+      tagCorrector( recountComputer, observedCounts, arg_roundsToWait, arg_tolerance );
 
-    tagCorrector.inferTrueTagCounts();
+    inferTrueTagCounts( tagCorrector, tagID_to_seq );
+  }
 
-    //std::cout  <<  "Converged after: "  <<  tagCorrector.bestEstCountsIteration()
-	//       <<  " iterations\n"
-	//       <<  "# Corrected counts:\n";
-    tagCorrector.bestEstCounts().print( tagID_to_seq );
-							
+
+  void runRecountExpectationMatchingTagCorrector(){
+
+    if(  !arg_componentsFile.empty()  )  arg_components  =  true;
+
+    DO_OR_DIEF(  !arg_components  ||  ( !arg_onDisk && !arg_andersonHistory ),
+		 "%s cannot be combined with %s or %s",
+		 Q(COMPONENTS_FLAG), Q(ON_DISK_FLAG), Q(ANDERSON_FLAG)  );
+
+    const TagSet  tagID_to_seq( arg_tagSeqsFile );
+
+    if( arg_onDisk ){
+      // stream the graph from the file on every iteration
+      std::ifstream  graphFile( arg_tagNeighborProbGraphFile.c_str(), std::ios::binary );
+
+      DO_OR_DIEF(  graphFile.good(),
+		   "Could not open graph file \"%s\"", arg_tagNeighborProbGraphFile.c_str()  );
+
+      RecountNeighborProbGraphOnDisk neighborGraph( tagID_to_seq, graphFile );
+
+      RecountComputerForGraphOnDisk recountComputer( neighborGraph );
+
+      runRecountExpectationMatchingTagCorrector( tagID_to_seq, recountComputer );
+      return;
+    }
+
+    const RecountNeighborProbGraphInMemory
+      neighborGraph( tagID_to_seq, arg_tagNeighborProbGraphFile );
+
+    if( arg_components ){
+      RecountTagCounts observedCounts( tagID_to_seq, arg_tagCountsFile );
+
+      assert(   observedCounts.min()  >=  1.0   );
+
+      if(  !arg_componentsFile.empty()  ){
+	std::ifstream  componentsFile( arg_componentsFile.c_str(), std::ios::binary );
+
+	DO_OR_DIEF(  componentsFile.good(),
+		     "Could not open components file \"%s\"", arg_componentsFile.c_str()  );
+
+	const RecountGraphComponents  graphComponents( componentsFile );
+
+	RecountComponentTagCorrector
+	  tagCorrector( neighborGraph, graphComponents, observedCounts, arg_roundsToWait, arg_tolerance, arg_numThreads );
+
+	inferTrueTagCounts( tagCorrector, tagID_to_seq );
+	return;
+      }
+
+      RecountComponentTagCorrector
+	tagCorrector( neighborGraph, observedCounts, arg_roundsToWait, arg_tolerance, arg_numThreads );
+
+      inferTrueTagCounts( tagCorrector, tagID_to_seq );
+      return;
+    }
+
+    RecountComputerForGraphInMemory recountComputer( neighborGraph, arg_numThreads );
+
+    runRecountExpectationMatchingTagCorrector( tagID_to_seq, recountComputer );
   }
 
 } // end namescape cbrc
@@ -63,10 +177,12 @@ $0 "Q(USAGE)"\n\
 tagSeqsFile\n\
     text file holding unique header line then tag sequences one per line\n\
     header line holds 2 integers:  number_of_sequences and total_sequence_length\n\
+    or the binary tag set written from it by writeBinaryTagSet\n\
 \n\
 tagNeighborProbGraphFile\n\
     binary file holding information on the neighbor tags which may be\n\
     mistakenly generated for each tag, and the probability of such error.\n\
+    Files in format version 001 are mapped into memory and used in place.\n\
 \n\
 tagCountsFile\n\
    text file consisting of lines, each line holding a tag sequence and its count\n\
@@ -76,6 +192,40 @@ OPTIONS\n\
 \n\
     "Q(ROUNDS_TO_WAIT_FLAG)"\n\
         Number of iterations to wait for improvement before terminating.\n\
+\n\
+    "Q(ON_DISK_FLAG)"\n\
+        Re-read tagNeighborProbGraphFile from disk on every iteration instead\n\
+        of loading it into memory once. Slower, but for graphs too large for RAM.\n\
+\n\
+    "Q(ANDERSON_FLAG)"\n\
+        Accelerate the search with Anderson mixing of this many previous\n\
+        estimates, needing far fewer passes over the graph. 0 (default) for\n\
+        the plain fixed point iteration.\n\
+\n\
+    "Q(TOLERANCE_FLAG)"\n\
+        Stop once the estimate changes (with "Q(ANDERSON_FLAG)", once the\n\
+        expected counts differ from the observed counts) by at most this\n\
+        much for every tag. 0 (default) to stop only after\n\
+        "Q(ROUNDS_TO_WAIT_FLAG)" rounds without improvement.\n\
+\n\
+    "Q(ITERATIONS_FLAG)"\n\
+        Report the number of passes over the graph to stderr.\n\
+\n\
+    "Q(COMPONENTS_FLAG)"\n\
+        Correct each connected component of the graph separately, each\n\
+        stopping on its own, so that small components do not wait for the\n\
+        slowest one. Components are spread over "Q(THREADS_FLAG)" threads,\n\
+        largest first. Not used with "Q(ON_DISK_FLAG)" or "Q(ANDERSON_FLAG)".\n\
+\n\
+    "Q(COMPONENTS_FILE_FLAG)"\n\
+        Same as "Q(COMPONENTS_FLAG)", but read the components of the graph from\n\
+        this file, as written by\n\
+        dumpRecountNeighborProbGraphOnDisk_ConnectedComponentSize --output\n\
+\n\
+    "Q(THREADS_FLAG)"\n\
+        Compute expected counts with this many threads, each summing the counts\n\
+        of its own tags over a transposed copy of the graph. The corrected counts\n\
+        are the same for any number of threads. Not used with "Q(ON_DISK_FLAG)".\n\
 \n\
 "
 		);  /* end setDoc help */
@@ -83,9 +233,22 @@ OPTIONS\n\
   argvP.printDoc();
 
   /* ----- Default values ----- */
-  arg_roundsToWait  =  10;
+  arg_roundsToWait      =  10;
+  arg_onDisk            =  false;
+  arg_numThreads        =  0;
+  arg_andersonHistory   =  0;
+  arg_tolerance         =  0.0;
+  arg_reportIterations  =  false;
+  arg_components        =  false;
 
-  argvP.set( arg_roundsToWait, Q(ROUNDS_TO_WAIT_FLAG) );
+  argvP.set( arg_roundsToWait,      Q(ROUNDS_TO_WAIT_FLAG) );
+  argvP.set( arg_onDisk,            Q(ON_DISK_FLAG) );
+  argvP.set( arg_andersonHistory,   Q(ANDERSON_FLAG) );
+  argvP.set( arg_tolerance,         Q(TOLERANCE_FLAG) );
+  argvP.set( arg_reportIterations,  Q(ITERATIONS_FLAG) );
+  argvP.set( arg_components,        Q(COMPONENTS_FLAG) );
+  argvP.set( arg_componentsFile,    Q(COMPONENTS_FILE_FLAG) );
+  argvP.set( arg_numThreads,        Q(THREADS_FLAG) );
 
   argvP.setOrDie( arg_tagSeqsFile             , 1 );
   argvP.setOrDie( arg_tagNeighborProbGraphFile, 2 );
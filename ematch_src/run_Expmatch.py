@@ -19,15 +19,6 @@ from pathlib import Path
 from typing import List
 
 
-def cleanup_files(*files: Path) -> None:
-    """Remove multiple files silently."""
-    for filepath in files:
-        try:
-            filepath.unlink(missing_ok=True)
-        except Exception:
-            pass
-
-
 def run_command(cmd: List[str], check: bool = True) -> subprocess.CompletedProcess:
     """Execute a command with optional error checking."""
     return subprocess.run(cmd, check=check)
@@ -52,51 +43,12 @@ def main():
         print(f"Error: Input file '{args.input_file}' not found", file=sys.stderr)
         sys.exit(1)
 
-    input_file = args.input_file
-    base = input_file.stem
-    directory = input_file.parent
-
-    # File paths
-    nbq = directory / f"{base}.nbq"
-    tgl = directory / f"{base}.taglist"
-    binfile = directory / f"{base}.bin"
-    rcountf = directory / f"{base}.raw_count"
-
-    try:
-        # Step 1: Find neighbours with quality (Juxtaposition)
-        run_command([
-            "./ematch_src/FindNeighboursWithQualJuxt",
-            str(input_file),
-            "1"
-        ])
-
-        # Step 2: Generate tag list file with base count
-        with tgl.open('w') as outfile:
-            subprocess.run(
-                ["python3", "./ematch_src/GenerateTagListFileWithBaseCount.py", str(nbq)],
-                stdout=outfile,
-                check=True
-            )
-
-        # Step 3: Write recount neighbor probability graph
-        run_command([
-            "./ematch_src/writeRecountNeighborProbGraph",
-            str(tgl),
-            str(nbq),
-            str(binfile)
-        ])
-
-        # Step 4: Run expectation-matching tag corrector
-        run_command([
-            "./ematch_src/runRecountExpectationMatchingTagCorrector",
-            str(tgl),
-            str(binfile),
-            str(rcountf)
-        ])
-
-    finally:
-        # Cleanup all temporary files
-        cleanup_files(nbq, tgl, binfile, rcountf)
+    # The whole pipeline (neighbor generation, tag list, neighbor graph and
+    # expectation matching) runs in one process, without temporary files
+    run_command([
+        "./ematch_src/runRecountExpectationMatchingPipeline",
+        str(args.input_file)
+    ])
 
 
 if __name__ == "__main__":
@@ -979,7 +979,7 @@ B<FLENumArrayFast> is exactly analogous to B<FLEArrayFast>.
 
 There is no "Range" class defined but several methods take index regions in the form
 C<size_t begIdx, size_t endIdx>. As in the C++ standard template library, these intervals
-are half open, covering indices I<i>: I<begIdx> ≦ I<i> < I<endIdx>. In this documentation
+are half open, covering indices I<i>: I<begIdx> <= I<i> < I<endIdx>. In this documentation
 this is often written as S<"[begIdx, endIdx)">.
 The empty range is represented by setting I<begIdx> and I<endIdx> to
 the same value (any value is fine for this).
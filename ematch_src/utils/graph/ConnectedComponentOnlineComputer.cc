@@ -8,119 +8,45 @@
  *  Description: See header files.
  */
 
+#include <algorithm>
 #include "utils/graph/ConnectedComponentOnlineComputer.hh"
 
 namespace cbrc{
 
 
 
-nodeIndexT ConnectedComponentOnlineComputer::_getComponent( nodeIndexT& n /* modifies n */ ){
-  stackTop = 0;
-
-  while( nodeToComponent[n] <= 0 ){
-    compressionStack[stackTop++] = n;
-    n = -nodeToComponent[n];
-  }
-  nodeIndexT answer = nodeToComponent[n];
-
-  // do path compression.
-  for( nodeIndexT i = 0; i < stackTop; ++i ){
-    nodeToComponent[ compressionStack[i] ] = -n;
-  }
-
-  return answer;
-}
-
-
 void ConnectedComponentOnlineComputer::addEdge( nodeIndexT n0, nodeIndexT n1 ){
-  
-  unsigned int c0 = _getComponent( n0 /* modifies n0 */ );
-  unsigned int c1 = _getComponent( n1 /* modifies n1 */ );
-
-  if( c0 == c1 ){
-    if( c0 == unassignedComponentIndexValue() ){
-      nodeToComponent[n0] = ++curComponent;
-      nodeToComponent[n1] = -n0;
-    }
-    return;
-  }
-  
-  if( c0 < c1 ){
-    nodeToComponent[n1] = -n0;
-  }else{
-    nodeToComponent[n0] = -n1;
-  }
 
-}
+  nodeIndexT r0 = _getComponent( n0 );
+  nodeIndexT r1 = _getComponent( n1 );
 
+  if( r0 == r1 ) return;
 
-unsigned int
-ConnectedComponentOnlineComputer::getNodeComponents( FLEArray<unsigned int>& nodeComponents ){
-  // std::cout << "at getNodeComponents, nodeComponents: " << nodeComponents << std::endl;
-  assert( nodeComponents.size() == nodeToComponent.size() );
-  compressPaths();
-  unsigned int maxComponent = 0;
+  // union by size: hang the smaller tree under the root of the larger one.
+  if( treeSize[r0] < treeSize[r1] ) std::swap( r0, r1 );
 
-  for( unsigned int i = 0; i < numNodes; ++i ){
-    if(  isUnassignedComponentIndex( nodeToComponent[i] )  ){
-      continue;
-    }
-
-    if( nodeToComponent[i] <= 0 ){
-      // subtract 1 to number components from 0.
-      nodeComponents[i] = nodeToComponent[ -nodeToComponent[i] ] - 1; 
-    }
-
-    if( nodeToComponent[i] > 0 ){
-      nodeComponents[i] = nodeToComponent[i] - 1;  // subtract 1 to number components from 0.
-      if( maxComponent < nodeComponents[i] ) maxComponent = nodeComponents[i];
-    }
-
-  }
-
-  for( unsigned int i = 0; i < numNodes; ++i ){
-    if(  isUnassignedComponentIndex( nodeToComponent[i] )  ){
-      nodeComponents[i] = ++maxComponent;
-    }
-  }
-
-  // at this point the list is correct but some integers are skipped,
-  // so renumber the components to 0, 1, 2, ...
-  return renumberComponents( nodeComponents );
+  parent[r1] = r0;
+  treeSize[r0] += treeSize[r1];
 }
 
 
 unsigned int
-ConnectedComponentOnlineComputer::renumberComponents( FLEArray<unsigned int>& nodeComponents ){
+ConnectedComponentOnlineComputer::getNodeComponents( FLEArray<unsigned int>& nodeComponents ){
+  assert( nodeComponents.size() == numNodes );
 
+  // number the components 0, 1, 2, ... in the order of their first node.
+  FLEArray<unsigned int> rootToComponent( numNodes, numNodes );
   unsigned int componentCount = 0;
 
-  FLEArray<unsigned int> toUniqueComponentNumber( numNodes, unassignedComponentIndexValue() );
-
   for( unsigned int i = 0; i < numNodes; ++i ){
-    if(  toUniqueComponentNumber[ nodeComponents[i] ] == unassignedComponentIndexValue() ){
-      toUniqueComponentNumber[ nodeComponents[i] ] = componentCount++;
+    const nodeIndexT root = _getComponent( i );
+    if( rootToComponent[root] == numNodes ){
+      rootToComponent[root] = componentCount++;
     }
-    nodeComponents[i] = toUniqueComponentNumber[ nodeComponents[i] ];
+    nodeComponents[i] = rootToComponent[root];
   }
 
   return componentCount;
-}  
-
-  
-
-void ConnectedComponentOnlineComputer::compressPaths(){
-  for( unsigned int i = 0; i < numNodes; ++i ){
-    unsigned int n = i;
-    stackTop = 0;
-    while( nodeToComponent[n] <= 0 ){
-      compressionStack[stackTop++] = n;
-      n = -nodeToComponent[n];
-    }
-    for( unsigned int j = 0; j < stackTop; ++j ){
-      nodeToComponent[ compressionStack[j] ] = -n;
-    }
-  }
 }
 
 
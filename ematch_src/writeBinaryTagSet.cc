@@ -0,0 +1,88 @@
+/*  
+ *  Author: Paul Horton
+ *  Organization: Computational Biology Research Center, AIST, Japan
+ *  Copyright (C) 2009, Paul Horton, All rights reserved.
+ *  Creation Date: 2009.9.20
+ *  Last Modified: $Date$
+ *
+ *  Input:  text tag list, as read by TagSet or SortedTagSet
+ *  Output: the same tag set in binary format, which the programs
+ *          reading tag lists load without parsing
+ *
+ *  Purpose: Created for RECOUNT project
+ *
+ */
+#include <iostream>
+#include <fstream>
+#include "utils/argvParsing/ArgvParser.hh"
+#include "./TagSet.hh"
+#include "./SortedTagSet.hh"
+#define  SORTED_TAG_SET_FLAG    -s|--sorted-tag-set
+
+
+/* ********** PARAMETERS FROM COMMAND LINE ********** */
+
+static std::istream*   arg_tagSeqsIstreamPtr  =  NULL;
+static std::ofstream   arg_outfile;
+static bool            arg_sortedTagSet;
+
+namespace cbrc{
+
+  void writeBinaryTagSet(){
+
+    if( arg_sortedTagSet ){
+      const SortedTagSet  tagSet( *arg_tagSeqsIstreamPtr, SortedTagSet::text );
+      tagSet.writeToBinaryStream( arg_outfile );
+      return;
+    }
+
+    const TagSet  tagSet( *arg_tagSeqsIstreamPtr, TagSet::text );
+    tagSet.writeToBinaryStream( arg_outfile );
+  }
+
+} // end namescape cbrc
+
+
+
+int main( int argc, const char* argv[] ){
+  cbrc::ArgvParser argvP( argc, argv, "tagSeqsFile outputFile" );
+
+  argvP.setDoc( "-h|--help|--man",
+		"\
+[OPTIONS] tagSeqsFile outputFile\n\
+\n\
+ARGUMENTS\n\
+\n\
+tagSeqsFile\n\
+    File holding the tag count and total length on the first line,\n\
+    followed by the tag sequences, one per line\n\
+\n\
+outputFile\n\
+    File to output binary tag set to\n\
+\n\
+OPTIONS\n\
+\n\
+    "Q(SORTED_TAG_SET_FLAG)"\n\
+        Read and write the SortedTagSet format, whose text first line\n\
+        holds only the tag count."
+		);
+
+  argvP.printDoc();
+
+  /* ----- Default values ----- */
+  arg_sortedTagSet  =  false;
+
+  argvP.set( arg_sortedTagSet, Q(SORTED_TAG_SET_FLAG) );
+
+  size_t curArg = 0;
+
+  argvP.setOrDie( arg_tagSeqsIstreamPtr, ++curArg );
+
+  argvP.setCautiouslyOrDie( arg_outfile, ++curArg );
+  
+  argvP.dieIfUnusedArgs();
+
+  cbrc::writeBinaryTagSet();
+
+  return 1;
+}
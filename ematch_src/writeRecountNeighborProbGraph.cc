@@ -15,6 +15,9 @@
 #include <iostream>
 #include "utils/argvParsing/ArgvParser.hh"
 #include "./RecountNeighborProbGraphWriter.hh"
+#define  FORMAT_VERSION_FLAG    -v|--format-version
+#define  FLOAT_PROBS_FLAG       -f|--float-probs
+#define  THREADS_FLAG           -t|--threads
 
 
 /* ********** PARAMETERS FROM COMMAND LINE ********** */
@@ -22,14 +25,22 @@
 static std::istream*   arg_tagSeqsIstreamPtr       =  NULL;
 static std::istream*   arg_tagNeighborsIstreamPtr  =  NULL;
 static std::ofstream   arg_outfile;
+static size_t          arg_formatVersion;
+static bool            arg_floatProbs;
+static size_t          arg_numThreads;
 
 namespace cbrc{
 
   void writeRecountNeighborProbGraph(){
 
-    RecountNeighborProbGraphWriter graphWriter( *arg_tagSeqsIstreamPtr );
+    RecountNeighborProbGraphWriter graphWriter( *arg_tagSeqsIstreamPtr, arg_numThreads );
 
-    graphWriter.write( arg_outfile, *arg_tagNeighborsIstreamPtr );
+    if( arg_formatVersion == 0 ){
+      graphWriter.write( arg_outfile, *arg_tagNeighborsIstreamPtr );
+      return;
+    }
+
+    graphWriter.write001( arg_outfile, *arg_tagNeighborsIstreamPtr, arg_floatProbs );
     
   }
 
@@ -42,23 +53,52 @@ int main( int argc, const char* argv[] ){
 
   argvP.setDoc( "-h|--help|--man",
 		"\
-tagSeqsFile tagNeighborsFile\n\
+[OPTIONS] tagSeqsFile tagNeighborsFile outputFile\n\
 \n\
 ARGUMENTS\n\
 \n\
 tagSeqsFile\n\
     File holdings tag sequences, one per line\n\
+    or the binary tag set written from it by writeBinaryTagSet\n\
 \n\
 neighborListFile\n\
     File holding neighboring tags and probabilities for each tag,\n\
     each line representing the neighborhood of a single tag sequence\n\
 \n\
 outputFile\n\
-    File to output binary stream to"
+    File to output binary stream to\n\
+\n\
+OPTIONS\n\
+\n\
+    "Q(FORMAT_VERSION_FLAG)"\n\
+        Binary format version, 0 (the original record list) or 1 (default),\n\
+        aligned arrays with an offset index which can be mapped into memory.\n\
+\n\
+    "Q(FLOAT_PROBS_FLAG)"\n\
+        Store probabilities as 4 byte floats. Version 1 only.\n\
+\n\
+    "Q(THREADS_FLAG)"\n\
+        Parse the neighbor lists with this many threads. The output is the\n\
+        same for any number of threads."
 		);
 
   argvP.printDoc();
 
+  /* ----- Default values ----- */
+  arg_formatVersion  =  1;
+  arg_floatProbs     =  false;
+  arg_numThreads     =  0;
+
+  argvP.set( arg_formatVersion, Q(FORMAT_VERSION_FLAG) );
+  argvP.set( arg_floatProbs,    Q(FLOAT_PROBS_FLAG) );
+  argvP.set( arg_numThreads,    Q(THREADS_FLAG) );
+
+  if(  arg_formatVersion > 1  )  argvP.die( "format version must be 0 or 1" );
+
+  if(  arg_floatProbs && arg_formatVersion == 0  ){
+    argvP.die( "float probabilities need format version 1" );
+  }
+
   size_t curArg = 0;
 
   argvP.setOrDie( arg_tagSeqsIstreamPtr,      ++curArg );
@@ -48,6 +48,7 @@ ARGUMENTS\n\
 \n\
 tagSeqsFile\n\
     File holdings tag sequences, one per line\n\
+    or the binary tag set written from it by writeBinaryTagSet -s\n\
 \n\
 neighborListFile\n\
     File holding neighboring tags and probabilities for each tag,\n\
@@ -6,6 +6,7 @@
  *  Last Modified: $Date: 2009/07/06 08:25:07 $
  *  Description: See header file.
  */
+#include <algorithm>
 #include "utils/FLArray/FLEArrayByIndexSortingPredicate.hh"
 #include "KnapsackEnumerator.hh"
 
@@ -14,65 +15,124 @@ namespace cbrc{
 void KnapsackEnumerator::
 computeCombinations(  const KnapsackObjectVector&  objects  ){
 
-  /* ***** Initialize global variables used for search ***** */
-  _combinations.clear();
+  _combinations      .clear();
+  _combinationWeights.clear();
+
+  auto  saveCombination  =  [this](  const idVecT&  combination,  const weightT&  weight  ){
+    _combinations      .push_back( combination );
+    _combinationWeights.push_back( weight      );
+  };
+
+  visitCombinations( objects, saveCombination );
+
+} // end computeCombinations.
+
+
+
+void KnapsackEnumerator::
+sortObjectUniverse(  const KnapsackObjectVector&  objects  ){
 
   _objectUniverse = objects;
 
   std::stable_sort(  _objectUniverse.begin(),
 		     _objectUniverse.end()  );
+}
+
+
+
+void KnapsackEnumerator::
+startBestFirst(  const KnapsackObjectVector&  objects,
+		 const size_t&                maxCombinations  ){
+
+  sortObjectUniverse( objects );
+
+  _bestFirstNodes    .clear();
+  _freeBestFirstNodes.clear();
+  _bestFirstHeap = bestFirstHeapT();
+  _numBestFirstPushes  =  0;
+
+  _numCombinationsLeft  =  maxCombinations  ?  maxCombinations  :  size_t(-1);
+
+  // the lightest combination of all is the lightest object alone
+  if(  objectUniverse().size()  )  pushBestFirst( noParent(), 0 );
+}
+
+
+
+bool KnapsackEnumerator::
+nextCombination(  idVecT&  combination,  weightT&  weight  ){
 
-  idStack .resize(  objectUniverse().size()  );
-  sumStack.resize(  objectUniverse().size()  );
-
-  for(  idT id = 0;  id < objectUniverse().size();  ++id  ){
-    const weightT&  curWeight  =  objectUniverse()(id).weight();
-    if(  curWeight  <=  capacity()  ){
-      idStack [0]  =  id;
-      sumStack[0]  =  curWeight;
-      computeCombinationsAux( 0 );
-    }
-    else{
-      break;
-    }
+  if(  _bestFirstHeap.empty()  ||  !_numCombinationsLeft  )  return false;
+
+  --_numCombinationsLeft;
+
+  const size_t  node  =  std::get<2>( _bestFirstHeap.top() );
+  _bestFirstHeap.pop();
+
+  // copied, pushBestFirst may move the nodes
+  const bestFirstNodeT  cur  =  _bestFirstNodes[node];
+
+  if(  size_t( cur.last + 1 )  <  objectUniverse().size()  ){
+    pushBestFirst( node,       cur.last + 1 );  // add the next object
+    pushBestFirst( cur.parent, cur.last + 1 );  // or take it in place of the last one
   }
 
-  // just a stub for now.
-} // end computeCombinations.
+
+  /* ***** Read the combination back from its chain of nodes ***** */
+  weight  =  cur.weight;
+
+  combination.clear();
+  for(  size_t n = node;  n != noParent();  n = _bestFirstNodes[n].parent  ){
+    combination.push_back( _bestFirstNodes[n].last );
+  }
+  std::reverse(  combination.begin(),  combination.end()  );
+
+  // the heap entry of node is gone
+  releaseBestFirst( node );
+
+  return true;
+} // end method nextCombination.
+
 
 
-/*
- *  idStack[0..dfsLevel] holds current combination
- * sumStack[dfsLevel]    holds sum of idStack[0..dfsLevel]
- */
 void KnapsackEnumerator::
-computeCombinationsAux(  const size_t&  dfsLevel  ){
+pushBestFirst(  const size_t&  parent,  const idT&  last  ){
 
-  // Save current combination
-  _combinations.push_back( idStack );
-  _combinations[ _combinations.size() - 1 ].resize( dfsLevel+1 );
+  // summed in the same order as sumStack, for the same weights
+  const weightT  weight
+    =  ( parent == noParent()  ?  0  :  _bestFirstNodes[parent].weight )
+    +  objectUniverse()( last ).weight();
 
+  if(  weight  >  capacity()  )  return;
 
-  /* ***** Continue Depth First Search at next level ***** */
+  const bestFirstNodeT  newNode  =  { weight, parent, last, 1 };
 
-  const idT    nextLevel  =  dfsLevel + 1;
-  const idT&      prevId  =  idStack[dfsLevel];
-  const weightT&  curSum  =  sumStack[dfsLevel];
+  size_t  node;
+  if(  _freeBestFirstNodes.size()  ){
+    node  =  _freeBestFirstNodes.back();
+    _freeBestFirstNodes.pop_back();
+    _bestFirstNodes[node]  =  newNode;
+  }
+  else{
+    node  =  _bestFirstNodes.size();
+    _bestFirstNodes.push_back( newNode );
+  }
+
+  if(  parent != noParent()  )  ++_bestFirstNodes[parent].refs;
 
+  _bestFirstHeap.push(  heapEntryT( weight, _numBestFirstPushes++, node )  );
+}
 
-  for(  size_t id = prevId + 1;  id < objectUniverse().size();  ++id  ){
 
-    const weightT  newSum  =  curSum + objectUniverse()( id ).weight();
 
-    if(  newSum  <=  capacity()  ){
-      idStack [ nextLevel ]  =  id;
-      sumStack[ nextLevel ]  =  newSum;
-      computeCombinationsAux( nextLevel );
-    }else{
-      break;
-    }
+void KnapsackEnumerator::
+releaseBestFirst(  size_t  node  ){
+
+  while(  node != noParent()  &&  !--_bestFirstNodes[node].refs  ){
+    _freeBestFirstNodes.push_back( node );
+    node  =  _bestFirstNodes[node].parent;
   }
-} // end method computeCombinationsAux.
+}
 
 } // end namespace cbrc
 
@@ -10,6 +10,27 @@
  *               Compute all of the subsets of the items which can
  *               fit in the knapsack.
  *
+ *               computeCombinations stores all of them at once, with
+ *               their weights.  visitCombinations hands each one, with
+ *               its weight, to a visitor during the depth first search
+ *               instead, the weight summed along the way.
+ *               startBestFirst and nextCombination instead yield them
+ *               one at a time, lightest first, from a heap holding only
+ *               the frontier of the search, and can stop after the
+ *               lightest maxCombinations of them.
+ *
+ *               Best first order: with the objects sorted lightest
+ *               first, each combination C, with last (heaviest) object
+ *               l, has two successors: C plus object l+1, and C with l
+ *               replaced by l+1.  Neither is lighter than C, and every
+ *               combination is reached exactly once from {0}, so popping
+ *               the lightest combination from the heap and pushing its
+ *               successors which fit yields them in order of weight.
+ *               A combination is kept as its last object and the node
+ *               of the combination without it.  A node is reclaimed once
+ *               it is popped and no node left on the heap descends from
+ *               it, so only the frontier and its ancestors are kept.
+ *
  *  Purpose: Created for use in the sequence tag count corrector
  *           project RECOUNT
  *
@@ -17,6 +38,9 @@
 #ifndef KNAPSACKENUMERATOR_HH_
 #define KNAPSACKENUMERATOR_HH_
 #include <iostream>
+#include <functional>
+#include <queue>
+#include <tuple>
 #include "utils/FLArray/FLEArray.hh"
 #include "KnapsackObject.hh"
 #include "KnapsackObjectVector.hh"
@@ -53,6 +77,9 @@ public:
   // computed quantity
   const std::vector<idVecT>&  combinations()  {  return _combinations;  }
 
+  // total weight of each of combinations()
+  const std::vector<weightT>&  combinationWeights()  {  return _combinationWeights;  }
+
   const KnapsackObjectVector&  objectUniverse() const{
     return _objectUniverse;
   }
@@ -60,13 +87,63 @@ public:
   /* ********** METHODS ********** */
   void computeCombinations( const KnapsackObjectVector&  objects  );
 
+  // call visitor( combination, weight ) for each combination which fits,
+  // in depth first order, with combination as indices into objectUniverse()
+  // in increasing order and weight its total weight.  combination is only
+  // valid during the call.
+  template<typename visitorT>
+  void visitCombinations(  const KnapsackObjectVector&  objects,  visitorT&  visitor  );
+
+  // start yielding the combinations of objects lightest first, stopping
+  // after maxCombinations of them.  0 for no limit.
+  void startBestFirst(  const KnapsackObjectVector&  objects,
+			const size_t&                maxCombinations  =  0  );
+
+  // set combination to the next lightest combination, as indices into
+  // objectUniverse() in increasing order, and weight to its total weight.
+  // Return false once there are no more.
+  bool nextCombination(  idVecT&  combination,  weightT&  weight  );
+
   friend void tryKnapsackEnumerator(); 
 
 private:
 
 
+  /* ********** PRIVATE TYPES ********** */
+
+  // combination of object last and the objects of node parent.
+  // refs counts the heap entry of the node, while it is on the heap,
+  // and the nodes whose parent it is
+  struct bestFirstNodeT{
+    weightT  weight;
+    size_t   parent;
+    idT      last;
+    size_t   refs;
+  };
+
+  // (weight, push count, node index), the lighter and then older node
+  // first.  Node indices are reused, so they cannot give the age.
+  typedef  std::tuple<weightT, size_t, size_t>  heapEntryT;
+
+  typedef  std::priority_queue< heapEntryT,
+				std::vector<heapEntryT>,
+				std::greater<heapEntryT> >  bestFirstHeapT;
+
+  static size_t  noParent(){  return size_t(-1);  }
+
+
   /* ********** OTHER PRIVATE METHODS ********** */
-  void computeCombinationsAux(  const size_t&  dfsLevel  );
+  template<typename visitorT>
+  void visitCombinationsAux(  const size_t&  dfsLevel,  visitorT&  visitor  );
+
+  void sortObjectUniverse(  const KnapsackObjectVector&  objects  );
+
+  // add a node for the combination of parent plus object last, if it fits
+  void pushBestFirst(  const size_t&  parent,  const idT&  last  );
+
+  // drop one reference to node, reclaiming it and then its ancestors
+  // as they become unreferenced
+  void releaseBestFirst(  size_t  node  );
 
 
   /* ** object data ** */
@@ -75,16 +152,88 @@ private:
   weightT  _capacity;
 
   // quantity to compute
-  std::vector<idVecT>  _combinations;
+  std::vector<idVecT>   _combinations;
+  std::vector<weightT>  _combinationWeights;
 
   // computation stack
-  idVecT                idStack;   //  idStack[i] is id of ith object in current combination
+  idVecT                idStack;   //  idStack[i] is id of ith object in current combination, and no more
   std::vector<weightT>  sumStack;  // sumStack[i] is sum of objects sumStack[0..i]
 
   // list of objects in universe, sorted by lightest first.
   KnapsackObjectVector  _objectUniverse;  
 
+  // best first search state
+  std::vector<bestFirstNodeT>  _bestFirstNodes;
+  std::vector<size_t>          _freeBestFirstNodes;  // reclaimed indices of _bestFirstNodes
+  bestFirstHeapT               _bestFirstHeap;
+  size_t                       _numBestFirstPushes;
+  size_t                       _numCombinationsLeft;
+
 };
 
+
+
+/* ********** TEMPLATE METHOD DEFINITIONS ********** */
+
+template<typename visitorT>
+void KnapsackEnumerator::
+visitCombinations(  const KnapsackObjectVector&  objects,  visitorT&  visitor  ){
+
+  /* ***** Initialize global variables used for search ***** */
+  sortObjectUniverse( objects );
+
+  // reserved so that the search never reallocates
+  idStack .reserve(  objectUniverse().size()  );
+  sumStack.resize (  objectUniverse().size()  );
+
+  for(  idT id = 0;  id < objectUniverse().size();  ++id  ){
+    const weightT&  curWeight  =  objectUniverse()(id).weight();
+    if(  curWeight  <=  capacity()  ){
+      idStack.assign( 1, id );
+      sumStack[0]  =  curWeight;
+      visitCombinationsAux( 0, visitor );
+    }
+    else{
+      break;
+    }
+  }
+} // end visitCombinations.
+
+
+
+/*
+ *  idStack                holds current combination
+ * sumStack[dfsLevel]      holds sum of idStack[0..dfsLevel]
+ */
+template<typename visitorT>
+void KnapsackEnumerator::
+visitCombinationsAux(  const size_t&  dfsLevel,  visitorT&  visitor  ){
+
+  visitor(  idStack,  sumStack[dfsLevel]  );
+
+
+  /* ***** Continue Depth First Search at next level ***** */
+
+  const idT    nextLevel  =  dfsLevel + 1;
+  const idT       prevId  =  idStack[dfsLevel];
+  const weightT   curSum  =  sumStack[dfsLevel];
+
+
+  for(  size_t id = prevId + 1;  id < objectUniverse().size();  ++id  ){
+
+    const weightT  newSum  =  curSum + objectUniverse()( id ).weight();
+
+    if(  newSum  <=  capacity()  ){
+      idStack.push_back( id );
+      sumStack[ nextLevel ]  =  newSum;
+      visitCombinationsAux( nextLevel, visitor );
+      idStack.pop_back();
+    }else{
+      break;
+    }
+  }
+} // end method visitCombinationsAux.
+
+
 } // end namespace cbrc
 #endif // KNAPSACKENUMERATOR_HH_
@@ -36,6 +36,8 @@ public:
     : _v( other._v )
   {}
 
+  KnapsackObjectVector&  operator=( const KnapsackObjectVector& other ) = default;
+
   KnapsackObjectVector( const std::vector<KnapsackObject>& v )
     : _v( v )
   {}
@@ -10,20 +10,31 @@
 #include "./KnapsackEnumerator.hh"
 #include "./KnapsackObjectVector.hh"
 #include "utils/argvParsing/ArgvParser.hh"
+#include "QualityModel.hh"
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
-#include <map>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#define USAGE [OPTIONS] capacity TagsCountQualFile
+#define TOP_K_FLAG -k|--top-k
+#define THREADS_FLAG -t|--threads
 
 
 typedef cbrc::KnapsackEnumerator::weightT weightT;
 weightT arg_capacity;
+size_t arg_topK;
+size_t arg_numThreads;
 std::istream* arg_objectStreamPtr;
-std::vector<std::string> GlobalVec;
 
 namespace cbrc {
 
@@ -45,27 +56,6 @@ std::string GetPathNameFromFilename(const std::string& filename) {
 }
 
 
-double Solexa2Phred(double sQ) {
-    // Convert Solexa into Phred Quality
-    double pQ = 10.00 * log(1.00 + pow(10.00, (sQ / 10.0))) / log(10.00);
-    return pQ;
-}
-
-double Phred2ErrProb(double pQ) {
-    double errprob = (pow(10, -(pQ) / 10.00)) / 3;
-    return errprob;
-}
-
-
-std::string Int2String(int IntVal) {
-    std::string S;
-    std::stringstream out;
-    out << IntVal;
-    S = out.str();
-
-    return S;
-}
-
 std::string Double2String(double IntVal) {
     std::string S;
     std::ostringstream out;
@@ -75,181 +65,167 @@ std::string Double2String(double IntVal) {
     return S;
 }
 
-std::string DNA2Num(std::string DNAStr) {
-    std::map<char, int> lookup;
-    lookup['A'] = 0;
-    lookup['C'] = 1;
-    lookup['G'] = 2;
-    lookup['T'] = 3;
-
-
-    std::string FinalNumTag = "";
-    for (unsigned i = 0; i < DNAStr.size(); i++) {
-        int cb = lookup[DNAStr[i]];
-        std::string cbstr = Int2String(cb);
-        FinalNumTag.append(cbstr);
+// Part of a line of TagsCountQualFile after the count: the tag and its
+// qualities, which are all its neighbors depend on
+inline std::string_view TagAndQualities(const std::string& Line) {
+    const size_t CountBegin = Line.find_first_not_of(" \t");
+    const size_t CountEnd = Line.find_first_of(" \t", CountBegin);
+    if (CountEnd == std::string::npos) {
+        return std::string_view(Line);
     }
-
-
-    return FinalNumTag;
+    return std::string_view(Line).substr(CountEnd);
 }
 
-std::vector<std::string> getRemainingBase(char Base) {
-    std::vector<std::string> RemBases;
-
-    std::vector<char> AllBases;
-    AllBases.push_back('A');
-    AllBases.push_back('C');
-    AllBases.push_back('G');
-    AllBases.push_back('T');
-
-
-    for (unsigned i = 0; i < AllBases.size(); i++) {
-        if (Base != AllBases[i]) {
-            char rB = AllBases[i];
-            std::stringstream ss;
-            std::string tempStr;
-            ss << rB;
-            ss >> tempStr;
-
-            RemBases.push_back(tempStr);
-        }
+// Digit of each base in the numeric tags; other characters are written as 0
+inline char BaseDigit(char Base) {
+    switch (Base) {
+        case 'C':
+            return '1';
+        case 'G':
+            return '2';
+        case 'T':
+            return '3';
+        default:
+            return '0';
     }
-
-
-    return RemBases;
 }
 
-std::string CreateNeighborTag(std::string NBases, std::vector<size_t> Pos2Mut, std::string OTag) {
-    std::string NewString = OTag;
-
-    for (unsigned i = 0; i < Pos2Mut.size(); i++) {
-        char Base = NBases[i];
-
-        std::stringstream ss;
-        std::string tempBase;
-        ss << Base;
-        ss >> tempBase;
-
-        NewString.replace(Pos2Mut[i], 1, tempBase);
+/*
+ * Writes the neighbors of tags without allocating per neighbor.
+ *
+ * The numeric key of the tag, one digit per base, is kept in a buffer. The
+ * neighbors of each set of substituted positions are visited odometer style:
+ * each substituted position is a wheel running over the bases other than the
+ * tag's own (all four for non ACGT characters), the last position turning
+ * fastest. Each step rewrites the turned digits of the key in place and
+ * appends the key to the output, so the neighbors come out in the same order
+ * as the recursive string enumeration this replaces.
+ *
+ * Each thread has its own NeighborExpander, whose buffers are reused from tag
+ * to tag.
+ */
+class NeighborExpander {
+public:
+    NeighborExpander(double Capacity)
+        : sack(Capacity), Solexa(QualityScale::Solexa, QualityFormula::LogRatio) {}
+
+    // Append the .nb and .nbq lines for Line, a line of TagsCountQualFile
+    void ExpandLine(const std::string& Line, std::string& NbOut, std::string& NbqOut);
+
+private:
+    // Append the neighbors of the tag substituted at Pos2Mutate
+    void ExpandCombination(double FEprobProd, std::string& NbOut, std::string& NbqOut);
+
+    KnapsackEnumerator sack;
+    KnapsackEnumerator::idVecT combination;
+
+    // -log error probabilities of the qualities, looked up for integer scores
+    const QualityModel Solexa;
+
+    std::string Tag;
+    std::string Key;  // numeric key of Tag, or of its current neighbor
+    std::vector<double> LogProbs;  // -log error probability of each position
+
+    // for each substituted position, its substitute digits and the current one
+    std::vector<size_t> Pos2Mutate;
+    std::vector<char> AltDigits;  // 4 per position
+    std::vector<unsigned char> NumAlts;
+    std::vector<unsigned char> Odometer;
+};
+
+void NeighborExpander::ExpandLine(const std::string& Line, std::string& NbOut,
+                                  std::string& NbqOut) {
+    std::stringstream ss(Line);
+    std::string ObservedCount;
+    double Quality;
+
+    Tag.clear();
+    ss >> ObservedCount >> Tag;
+
+    Key.resize(Tag.size());
+    for (size_t i = 0; i < Tag.size(); i++) {
+        Key[i] = BaseDigit(Tag[i]);
     }
 
+    NbOut.append(Tag).append("\t").append(Key).append("\t\t");
+    NbqOut.append(Tag).append("\t").append(Key).append("\t\t");
 
-    return NewString;
-}
-
-
-void EnumAll(const std::vector<std::vector<std::string>>& allVecs, size_t vecIndex,
-             std::string strSoFar) {
-    if (vecIndex >= allVecs.size()) {
-        // cout << strSoFar << endl;
-        GlobalVec.push_back(strSoFar);
-
-        return;
+    LogProbs.clear();
+    while (ss >> Quality) {
+        LogProbs.push_back(Solexa.negLogBaseErrProb(Quality));
     }
-    for (size_t i = 0; i < allVecs[vecIndex].size(); i++) {
-        EnumAll(allVecs, vecIndex + 1, strSoFar + allVecs[vecIndex][i]);
-    }
-}
-
-
-void GetNbBaseForEachPos(std::vector<size_t> Positions2Mutate, std::string OrgTag,
-                         double FEprobProd, std::ostream& NBF, std::ostream& NBQF) {
-    std::vector<std::vector<std::string>> RemBasesAllPosVec;
-
-    for (unsigned i = 0; i < Positions2Mutate.size(); i++) {
-        int p2m = Positions2Mutate[i];
-        char Base2Mutate = OrgTag[p2m];
-        // std::cout << "\t\t" << p2m << "," << Base2Mutate << "\tRB: ";
-        std::vector<std::string> remBases = getRemainingBase(Base2Mutate);
 
-        RemBasesAllPosVec.push_back(remBases);
-
-
-        // for (unsigned j=0; j<remBases.size(); j++) {
-        // std::cout << remBases[j] << ",";
-        //}
-        // std::cout << std::endl;
+    if (LogProbs.size() > Tag.size()) {
+        std::cerr << "Tag " << Tag << " has more qualities than bases" << std::endl;
+        exit(1);
     }
 
-    EnumAll(RemBasesAllPosVec, 0, "");
-
-    for (unsigned i = 0; i < GlobalVec.size(); i++) {
-        // std::cout << "\t\t\t" << GlobalVec[i] << "->";
-        std::string NeighborBases = GlobalVec[i];
+    KnapsackObjectVector objects(LogProbs);
+    sack.startBestFirst(objects, arg_topK);
 
-        if (NeighborBases.size() != Positions2Mutate.size()) {
-            std::cerr << "NeighborBases Not Equal to Position2Mutate" << std::endl;
-            break;
+    // combinations are visited lightest (most probable) first, without storing
+    // them, each with its summed -log error probability
+    weightT curWeight;
+    while (sack.nextCombination(combination, curWeight)) {
+        Pos2Mutate.clear();
+        for (size_t j = 0; j < combination.size(); ++j) {
+            Pos2Mutate.push_back(sack.objectUniverse()(combination[j]).id());
         }
 
-        std::string NeighborTag = CreateNeighborTag(NeighborBases, Positions2Mutate, OrgTag);
-        std::string NeighborTagNum = DNA2Num(NeighborTag);
-
-
-        // double logFEprobProd = -log(FEprobProd);
-        // std::cout <<  NeighborTagNum << "\t";
-        NBF << NeighborTagNum << "\t";
-        NBQF << FEprobProd << "\t";
-        // std::cout << "\t\tnb_str: " <<  NeighborTag << "\t"  << NeighborTagNum << "\t" <<
-        // FEprobProd << "\t" << logFEprobProd <<std::endl;
+        ExpandCombination(exp(-curWeight), NbOut, NbqOut);
     }
 
-    // std::cout << std::endl;
-
-
-    GlobalVec.clear();
+    NbOut.push_back('\n');
+    NbqOut.push_back('\n');
 }
 
-std::vector<double> ConvErrProbVec2LogProbVec(std::vector<double> ProbVec) {
-    std::vector<double> LogProbVec;
-
-    for (unsigned i = 0; i < ProbVec.size(); i++) {
-        double logProb = -log(ProbVec[i]);
-        LogProbVec.push_back(logProb);
-    }
+void NeighborExpander::ExpandCombination(double FEprobProd, std::string& NbOut,
+                                         std::string& NbqOut) {
+    const size_t k = Pos2Mutate.size();
 
-    return LogProbVec;
-}
+    // formatted as the default ostream << double, once for all the neighbors
+    char Prob[32];
+    const int ProbLength = snprintf(Prob, sizeof(Prob), "%g\t", FEprobProd);
 
-void tryKnapsackEnumeratorVectOfPair(double capacity, std::vector<double>& VOProb,
-                                     std::string InitTag, std::ostream& nbf, std::ostream& nbqf) {
-    KnapsackEnumerator sack(capacity);
-    // std::cout << "capacity is: " << sack.capacity() << std::endl;
+    AltDigits.resize(4 * k);
+    NumAlts.resize(k);
+    Odometer.assign(k, 0);
 
-    std::vector<double> VOlogProb = ConvErrProbVec2LogProbVec(VOProb);
-
-    KnapsackObjectVector objects(VOlogProb);
-    sack.computeCombinations(objects);
+    for (size_t i = 0; i < k; i++) {
+        const char Base = Tag[Pos2Mutate[i]];
+        NumAlts[i] = 0;
+        for (const char* b = "ACGT"; *b; ++b) {
+            if (*b != Base) {
+                AltDigits[4 * i + NumAlts[i]++] = BaseDigit(*b);
+            }
+        }
+        Key[Pos2Mutate[i]] = AltDigits[4 * i];
+    }
 
-    /*--------------------------------------------------
-     *   std::cout  <<  "Sorted objects are:\n";
-     *   std::cout << "Array sack.objectUniverse():" << std::endl;
-     *   for( size_t i = 0; i < sack.objectUniverse().size(); ++i ){
-     *     if( i ) std::cout << " ";
-     *     std::cout << sack.objectUniverse()(i);
-     *   }
-     *   std::cout << std::endl;
-     *
-     *--------------------------------------------------*/
+    for (;;) {
+        NbOut.append(Key).push_back('\t');
+        NbqOut.append(Prob, ProbLength);
 
-    for (size_t i = 0; i < sack.combinations().size(); ++i) {
-        const KnapsackEnumerator::idVecT& curCombination = sack.combinations()[i];
-        std::vector<size_t> AllPos2Mutate;
-        double FinalErrProb = 1;
-        for (size_t j = 0; j < curCombination.size(); ++j) {
-            size_t Pos2Mutate = sack.objectUniverse()(curCombination[j]).id();
-            // std::cout << Pos2Mutate << ",";
-            AllPos2Mutate.push_back(Pos2Mutate);
-            FinalErrProb *= VOProb[Pos2Mutate];
+        // turn the last wheel, carrying into the ones before it
+        size_t i = k;
+        while (i > 0 && ++Odometer[i - 1] == NumAlts[i - 1]) {
+            --i;
+            Odometer[i] = 0;
+            Key[Pos2Mutate[i]] = AltDigits[4 * i];
         }
+        if (i == 0) {
+            break;
+        }
+        Key[Pos2Mutate[i - 1]] = AltDigits[4 * (i - 1) + Odometer[i - 1]];
+    }
 
-        GetNbBaseForEachPos(AllPos2Mutate, InitTag, FinalErrProb, nbf, nbqf);
-
-        // std::cout  <<  std::endl;
+    // back to the tag itself for the next combination
+    for (size_t i = 0; i < k; i++) {
+        Key[Pos2Mutate[i]] = BaseDigit(Tag[Pos2Mutate[i]]);
     }
 }
 
+
 void tryKnapsackEnumerator() {
     KnapsackEnumerator sack(arg_capacity);
     // std::cout << "capacity is: " << sack.capacity() << std::endl;
@@ -285,17 +261,50 @@ void tryKnapsackEnumerator() {
 
 
 int main(int argc, const char* argv[]) {
-    // cbrc::ArgvParser argvP( argc, argv, "capacity TagsCountQualFile" );
-
-
-    // argvP.setOrDie( arg_capacity, 1 );
-    // arg_objectStreamPtr  =  argvP.getIstreamPtr( 2 );
-    // argvP.dieIfUnusedArgs();
-
-    double Capacity = static_cast<double>(atof(argv[1]));
-    std::string TagsCountQualFile = argv[2];
-    std::string line;
-
+    cbrc::ArgvParser argvP(argc, argv, Q(USAGE));
+
+    argvP.setDoc("-h|-help|--help",
+                 "\
+$0 "Q(USAGE)"\n\
+\n\
+For each tag, write the neighbor tags it may be misread as, and their\n\
+error probabilities, to TagsCountQualFile_capacity.nb and .nbq\n\
+\n\
+capacity\n\
+    maximum summed -log error probability of the substituted positions,\n\
+    so neighbors less probable than exp(-capacity) are left out.\n\
+\n\
+TagsCountQualFile\n\
+    text file with one tag per line: count, sequence and Solexa qualities\n\
+\n\
+OPTIONS\n\
+\n\
+    "Q(TOP_K_FLAG)"\n\
+        Keep only this many of the most probable sets of substituted positions\n\
+        for each tag. 0 (default) for all of them.\n\
+\n\
+    "Q(THREADS_FLAG)"\n\
+        Expand the tags with this many threads. The output is the same for\n\
+        any number of threads.\n\
+"
+                 ); /* end setDoc help */
+
+    argvP.printDoc();
+
+    /* ----- Default values ----- */
+    arg_topK = 0;
+    arg_numThreads = 0;
+
+    argvP.set(arg_topK, Q(TOP_K_FLAG));
+    argvP.set(arg_numThreads, Q(THREADS_FLAG));
+
+    std::string TagsCountQualFile;
+    argvP.setOrDie(arg_capacity, 1);
+    argvP.setOrDie(TagsCountQualFile, 2);
+
+    argvP.dieIfUnusedArgs();
+
+    double Capacity = arg_capacity;
     std::string capacity = cbrc::Double2String(Capacity);
 
     std::string baseName = cbrc::GetBaseNameFromFilename(TagsCountQualFile);
@@ -317,38 +326,52 @@ int main(int argc, const char* argv[]) {
 
 
     if (TCQFile.is_open()) {
-        while (getline(TCQFile, line)) {
-            std::stringstream ss(line);
-            std::string ObservedCount;
-            std::string Tag;
-            double Quality;
-
-            ss >> ObservedCount >> Tag;
-
-            std::string NumericTag = cbrc::DNA2Num(Tag);
-
-            // std::cout <<  Tag  << "\t" << NumericTag <<"\t\t";
-            nbFile << Tag << "\t" << NumericTag << "\t\t";
-            nbqFile << Tag << "\t" << NumericTag << "\t\t";
-
-
-            std::vector<std::pair<int, double>> VecOfIndexProbPair;
-            std::vector<double> VecOfProb;
+        // tags are expanded in chunks, in parallel, and written in input order
+        const size_t ChunkSize = 4096;
+        std::vector<std::string> Lines(ChunkSize);
+        std::vector<std::string> NbChunk(ChunkSize);
+        std::vector<std::string> NbqChunk(ChunkSize);
+
+        // The neighbors of a tag depend on its qualities through the
+        // capacity, so only lines repeating both the tag and the qualities
+        // of an earlier line in the chunk can share its neighbors; those are
+        // copied from the earlier line instead of being expanded again
+        std::vector<size_t> Source(ChunkSize);
+        std::unordered_map<std::string_view, size_t> FirstLine;
+
+        for (;;) {
+            size_t NumLines = 0;
+            while (NumLines < ChunkSize && getline(TCQFile, Lines[NumLines])) {
+                NumLines++;
+            }
+            if (NumLines == 0) {
+                break;
+            }
 
-            int mmPos = -1;
-            while (ss >> Quality) {
-                mmPos++;
-                double eP = cbrc::Phred2ErrProb(cbrc::Solexa2Phred(Quality));
-                // std::cout << "\t" <<  Quality << "," << eP  << "," << mmPos << std::endl;
-                VecOfProb.push_back(eP);
+            FirstLine.clear();
+            for (size_t i = 0; i < NumLines; i++) {
+                Source[i] = FirstLine.emplace(cbrc::TagAndQualities(Lines[i]), i).first->second;
             }
 
-            // Pass VecOfIndexPair and Capacity here to Knapsack function
-            cbrc::tryKnapsackEnumeratorVectOfPair(Capacity, VecOfProb, Tag, nbFile, nbqFile);
+#pragma omp parallel num_threads(std::max<size_t>(arg_numThreads, 1))
+            {
+                cbrc::NeighborExpander Expander(Capacity);
+
+#pragma omp for schedule(dynamic, 16)
+                for (long i = 0; i < long(NumLines); i++) {
+                    NbChunk[i].clear();
+                    NbqChunk[i].clear();
+                    if (Source[i] == size_t(i)) {
+                        Expander.ExpandLine(Lines[i], NbChunk[i], NbqChunk[i]);
+                    }
+                }
+            }
 
-            // std::cout << std::endl;
-            nbFile << std::endl;
-            nbqFile << std::endl;
+            for (size_t i = 0; i < NumLines; i++) {
+                const size_t j = Source[i];
+                nbFile.write(NbChunk[j].data(), NbChunk[j].size());
+                nbqFile.write(NbqChunk[j].data(), NbqChunk[j].size());
+            }
         }
 
         TCQFile.close();
@@ -0,0 +1,68 @@
+#include "BufferedWriter.hh"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+BufferedWriter::BufferedWriter(std::size_t capacity)
+    : file_(nullptr), buffer_(capacity < 64 ? 64 : capacity), used_(0), failed_(false) {}
+
+BufferedWriter::~BufferedWriter() {
+    close();
+}
+
+bool BufferedWriter::open(const std::string& fileName) {
+    close();
+    file_ = std::fopen(fileName.c_str(), "w");
+    failed_ = (file_ == nullptr);
+    return file_ != nullptr;
+}
+
+bool BufferedWriter::close() {
+    if (file_ != nullptr) {
+        flush();
+        if (std::fclose(file_) != 0) {
+            failed_ = true;
+        }
+        file_ = nullptr;
+    }
+    used_ = 0;
+    return !failed_;
+}
+
+void BufferedWriter::write(const char* s, std::size_t n) {
+    while (n > 0) {
+        if (used_ == buffer_.size()) {
+            flush();
+        }
+        std::size_t chunk = std::min(n, buffer_.size() - used_);
+        std::memcpy(buffer_.data() + used_, s, chunk);
+        used_ += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+void BufferedWriter::writeDouble(double x) {
+    // %g with precision 6 never needs more than 13 characters plus sign
+    if (buffer_.size() - used_ < 32) {
+        flush();
+    }
+    char* first = buffer_.data() + used_;
+    std::to_chars_result res =
+        std::to_chars(first, buffer_.data() + buffer_.size(), x, std::chars_format::general, 6);
+    used_ = res.ptr - buffer_.data();
+}
+
+void BufferedWriter::flush() {
+    if (used_ > 0 && file_ != nullptr) {
+        if (std::fwrite(buffer_.data(), 1, used_, file_) != used_) {
+            failed_ = true;
+        }
+    }
+    used_ = 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file BufferedWriter.hh
+ * @brief Block-buffered text output for the large neighbor files
+ *
+ * FindNeighboursWithQual writes one token per generated neighbor to the
+ * .nb and .nbq files.  Through std::ofstream every token goes through the
+ * locale-aware formatting machinery and a sentry; BufferedWriter instead
+ * formats into its own buffer and hands it to the OS in large blocks.
+ * Doubles are written with std::to_chars in the same form operator<< uses
+ * by default (%g, six significant digits), so the files do not change.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef BUFFERED_WRITER_HH
+#define BUFFERED_WRITER_HH
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdio>
+
+/**
+ * @brief Writes text to a file through a fixed-size buffer
+ *
+ * @par Example:
+ * @code
+ * BufferedWriter out;
+ * out.open("tags.nbq");
+ * out.write(tag);
+ * out.put('\t');
+ * out.writeDouble(0.00123);
+ * out.close();
+ * @endcode
+ */
+class BufferedWriter {
+   public:
+    /**
+     * @param capacity Buffer size in bytes
+     */
+    explicit BufferedWriter(std::size_t capacity = 1 << 16);
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    /**
+     * @brief Open (truncate) a file for writing
+     * @return false if the file could not be opened
+     */
+    bool open(const std::string& fileName);
+
+    /// Flush and close; returns false if any write failed
+    bool close();
+
+    /// Write one character
+    void put(char c) {
+        if (used_ == buffer_.size()) {
+            flush();
+        }
+        buffer_[used_++] = c;
+    }
+
+    /// Write n characters
+    void write(const char* s, std::size_t n);
+
+    /// Write a string
+    void write(const std::string& s) { write(s.data(), s.size()); }
+
+    /// Write a double as std::ostream << x would with default settings
+    void writeDouble(double x);
+
+    /// Hand the buffered bytes to the OS
+    void flush();
+
+   private:
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    std::size_t used_;
+    bool failed_;
+};
+
+#endif  // BUFFERED_WRITER_HH
@@ -0,0 +1,98 @@
+#include "ConnectedComponents.hh"
+
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+// Disjoint-set forest over the rows of a matrix
+class DisjointSets {
+   public:
+    explicit DisjointSets(std::size_t n) : parent_(n), size_(n, 1) {
+        for (std::size_t i = 0; i < n; i++) {
+            parent_[i] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    std::uint32_t find(std::uint32_t x) {
+        while (parent_[x] != x) {
+            parent_[x] = parent_[parent_[x]];  // path halving
+            x = parent_[x];
+        }
+        return x;
+    }
+
+    void unite(std::uint32_t a, std::uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return;
+        }
+        if (size_[a] < size_[b]) {
+            std::swap(a, b);
+        }
+        parent_[b] = a;
+        size_[a] += size_[b];
+    }
+
+   private:
+    std::vector<std::uint32_t> parent_;
+    std::vector<std::uint32_t> size_;
+};
+
+}  // namespace
+
+
+ComponentSplit SplitIntoComponents(const CsrMatrix& A) {
+    const std::size_t n = A.numRows;
+
+    DisjointSets sets(n);
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::uint64_t k = A.rowPtr[i]; k < A.rowPtr[i + 1]; k++) {
+            sets.unite(static_cast<std::uint32_t>(i), A.colIdx[k]);
+        }
+    }
+
+    ComponentSplit split;
+    split.component.resize(n);
+    split.localIndex.resize(n);
+
+    // Number the roots in order of first appearance
+    const std::uint32_t unnumbered = static_cast<std::uint32_t>(-1);
+    std::vector<std::uint32_t> rootNumber(n, unnumbered);
+    for (std::size_t i = 0; i < n; i++) {
+        std::uint32_t root = sets.find(static_cast<std::uint32_t>(i));
+        if (rootNumber[root] == unnumbered) {
+            rootNumber[root] = static_cast<std::uint32_t>(split.members.size());
+            split.members.emplace_back();
+        }
+        std::uint32_t c = rootNumber[root];
+        split.component[i] = c;
+        split.localIndex[i] = static_cast<std::uint32_t>(split.members[c].size());
+        split.members[c].push_back(static_cast<std::uint32_t>(i));
+    }
+
+    return split;
+}
+
+CsrMatrix ExtractComponent(const CsrMatrix& A, const ComponentSplit& split, std::size_t c) {
+    const std::vector<std::uint32_t>& rows = split.members[c];
+
+    std::size_t nnz = 0;
+    for (std::uint32_t i : rows) {
+        nnz += A.rowPtr[i + 1] - A.rowPtr[i];
+    }
+
+    SparseMatrixBuilder builder(rows.size(), nnz);
+    for (std::uint32_t i : rows) {
+        for (std::uint64_t k = A.rowPtr[i]; k < A.rowPtr[i + 1]; k++) {
+            builder.addEntry(split.localIndex[A.colIdx[k]], A.values[k]);
+        }
+        builder.endRow();
+    }
+
+    return builder.finish();
+}
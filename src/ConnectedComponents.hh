@@ -0,0 +1,56 @@
+/**
+ * @file ConnectedComponents.hh
+ * @brief Split the read-error matrix into independent connected components
+ *
+ * Two tags are linked when either is a neighbor of the other, i.e. when
+ * A(i,j) or A(j,i) is nonzero.  The EM problem decouples exactly along the
+ * connected components of that graph, so every component can be solved on
+ * its own diagonal block of A.  This is what src/lr_ccomp.pl arranges with
+ * one temporary file per component; here the components are found with a
+ * disjoint-set forest (union by size, path halving) in one pass over the
+ * CSR entries.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef CONNECTED_COMPONENTS_HH
+#define CONNECTED_COMPONENTS_HH
+
+#include "SparseMatrixBuilder.hh"
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Connected components of the nonzero pattern of a square matrix
+ */
+struct ComponentSplit {
+    std::vector<std::uint32_t> component;             ///< Component of every row
+    std::vector<std::uint32_t> localIndex;            ///< Position of a row in its component
+    std::vector<std::vector<std::uint32_t>> members;  ///< Rows of every component, ascending
+
+    std::size_t numComponents() const { return members.size(); }
+};
+
+/**
+ * @brief Find the connected components of A
+ *
+ * Components are numbered in order of their first row.
+ *
+ * @param A Square CSR matrix
+ */
+ComponentSplit SplitIntoComponents(const CsrMatrix& A);
+
+/**
+ * @brief Diagonal block of A on one component, in local indices
+ *
+ * Row and column k of the block are row members[c][k] of A.  No entry of
+ * those rows leaves the component, so nothing is dropped.
+ */
+CsrMatrix ExtractComponent(const CsrMatrix& A, const ComponentSplit& split, std::size_t c);
+
+#endif  // CONNECTED_COMPONENTS_HH
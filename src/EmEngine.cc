@@ -0,0 +1,77 @@
+#include "EmEngine.hh"
+
+#include <vector>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+EmEngine::EmEngine(const CsrMatrix& A, const CsrMatrix& At, const std::vector<double>& counts)
+    : A_(A),
+      At_(At),
+      counts_(counts),
+      ratio_(A.numRows, 0.0),
+      rowParts_(PartitionRowsByNnz(A, SpmvPartCount(A))),
+      colParts_(PartitionRowsByNnz(At, SpmvPartCount(At))) {}
+
+template <typename PropOf>
+double EmEngine::fusedStep(std::vector<double>& m, double lambda, PropOf propOf) {
+    // Pass 1, rows of A: r_i = n_i / (A p)_i
+    const long rowBlocks = static_cast<long>(rowParts_.size() - 1);
+#pragma omp parallel for schedule(static, 1) if (rowBlocks > 1)
+    for (long t = 0; t < rowBlocks; t++) {
+        for (std::size_t i = rowParts_[t]; i < rowParts_[t + 1]; i++) {
+            double sum = 0.0;
+            for (std::uint64_t k = A_.rowPtr[i]; k < A_.rowPtr[i + 1]; k++) {
+                sum += A_.values[k] * propOf(A_.colIdx[k]);
+            }
+            ratio_[i] = counts_[i] / sum;
+        }
+    }
+
+    // Pass 2, columns of A: m_j = p_j (A^T r)_j.  Only m_j is read before
+    // it is overwritten, so m can be updated in place.
+    double logLik = 0.0;
+    const long colBlocks = static_cast<long>(colParts_.size() - 1);
+#pragma omp parallel for schedule(static, 1) reduction(+ : logLik) if (colBlocks > 1)
+    for (long t = 0; t < colBlocks; t++) {
+        for (std::size_t j = colParts_[t]; j < colParts_[t + 1]; j++) {
+            double sum = 0.0;
+            for (std::uint64_t k = At_.rowPtr[j]; k < At_.rowPtr[j + 1]; k++) {
+                sum += At_.values[k] * ratio_[At_.colIdx[k]];
+            }
+            const double p = propOf(j);
+            m[j] = p * sum;
+            if (p != 0.0) {
+                logLik += m[j] * std::log(p * lambda);
+            }
+        }
+    }
+
+    return -lambda + logLik;
+}
+
+double EmEngine::step(std::vector<double>& m, double lambda, bool normalize, int clamp) {
+    const std::size_t clampAt = clamp < 0 ? m.size() : static_cast<std::size_t>(clamp);
+
+    double scale = 1.0 / lambda;
+    if (normalize) {
+        double tot = 0.0;
+        for (std::size_t j = 0; j < m.size(); j++) {
+            if (j != clampAt) {
+                tot += m[j] / lambda;
+            }
+        }
+        scale /= tot;
+    }
+
+    const double* mp = m.data();
+    return fusedStep(m, lambda, [mp, scale, clampAt](std::size_t j) {
+        return j == clampAt ? 0.0 : mp[j] * scale;
+    });
+}
+
+double EmEngine::stepWithP(const std::vector<double>& p, std::vector<double>& m, double lambda) {
+    const double* pp = p.data();
+    return fusedStep(m, lambda, [pp](std::size_t j) { return pp[j]; });
+}
@@ -0,0 +1,94 @@
+/**
+ * @file EmEngine.hh
+ * @brief Fused EM iteration shared by the EstimateTrueCount estimators
+ *
+ * One EM step of the estimators is
+ *
+ *     p = m / lambda            (optionally one tag clamped to 0, then p /= sum p)
+ *     r = n ./ (A p)
+ *     m = p .* (A^T r)
+ *     logLik = -lambda + sum_{p_j != 0} m_j log(p_j lambda)
+ *
+ * Written with whole-vector helpers this allocates five temporaries and
+ * walks memory six times per step.  EmEngine computes p on the fly and
+ * does the step in two passes: one over the CSR rows of A (producing r in
+ * a workspace owned by the engine) and one over the CSC form of A
+ * (updating m in place and accumulating the log-likelihood).  Nothing is
+ * allocated once the engine is constructed.
+ *
+ * Both passes are row gathers (the second over A^T), so with OpenMP they
+ * run in parallel without atomics; the rows are split into blocks of
+ * about equal nnz once, when the engine is constructed.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef EM_ENGINE_HH
+#define EM_ENGINE_HH
+
+#include "SparseMatrixBuilder.hh"
+
+#include <vector>
+
+#include <cstddef>
+
+/**
+ * @brief Runs EM steps against a fixed read-error matrix and observed counts
+ *
+ * The matrix and the counts are referenced, not copied; they must outlive
+ * the engine.
+ *
+ * @par Example:
+ * @code
+ * EmEngine em(A, At, rawCount);
+ * vector<double> theM = rawCount;
+ * for (int m = 0; m < maxStep; m++) {
+ *     double logLik = em.step(theM, lambda);
+ * }
+ * @endcode
+ */
+class EmEngine {
+   public:
+    /**
+     * @param A      Read-error matrix in CSR form
+     * @param At     Its transpose (A in CSC form)
+     * @param counts Observed count of every tag
+     */
+    EmEngine(const CsrMatrix& A, const CsrMatrix& At, const std::vector<double>& counts);
+
+    /**
+     * @brief One EM step with p = m / lambda
+     *
+     * @param m         Expected counts; updated in place
+     * @param lambda    Total count
+     * @param normalize Rescale p to sum to one before the step
+     * @param clamp     Tag whose p is forced to zero, or -1
+     * @return Log-likelihood of the updated counts
+     */
+    double step(std::vector<double>& m, double lambda, bool normalize = false, int clamp = -1);
+
+    /**
+     * @brief One E-step for proportions chosen by the caller
+     *
+     * @param p      Proportion of every tag
+     * @param m      Expected counts; overwritten
+     * @param lambda Total count
+     * @return Log-likelihood of the updated counts
+     */
+    double stepWithP(const std::vector<double>& p, std::vector<double>& m, double lambda);
+
+   private:
+    template <typename PropOf>
+    double fusedStep(std::vector<double>& m, double lambda, PropOf propOf);
+
+    const CsrMatrix& A_;
+    const CsrMatrix& At_;
+    const std::vector<double>& counts_;
+    std::vector<double> ratio_;          ///< n ./ (A p), one entry per tag
+    std::vector<std::size_t> rowParts_;  ///< Row blocks of A, by nnz
+    std::vector<std::size_t> colParts_;  ///< Row blocks of At, by nnz
+};
+
+#endif  // EM_ENGINE_HH
@@ -0,0 +1,98 @@
+#include "EntropyObjective.hh"
+
+#include <vector>
+
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+double logistic(double x) {
+    return 1. / (1. + std::exp(-x));
+}
+
+}  // namespace
+
+
+EntropyObjective::EntropyObjective(const std::vector<double>& m, double gamma)
+    : m_(m), gamma_(gamma), sumM_(0.0), h_(m.size()), logP_(m.size()) {
+    for (double mj : m) {
+        sumM_ += mj;
+    }
+}
+
+double EntropyObjective::cache(const std::vector<double>& x) {
+    const std::size_t n = m_.size();
+
+    double sumH = 0.0;
+    for (std::size_t j = 0; j < n; j++) {
+        h_[j] = logistic(x[j]);
+        sumH += h_[j];
+    }
+
+    for (std::size_t j = 0; j < n; j++) {
+        logP_[j] = (h_[j] > 0) ? std::log(h_[j] / sumH) : 0.0;
+    }
+
+    return sumH;
+}
+
+double EntropyObjective::value(const std::vector<double>& x) {
+    const double sumH = cache(x);
+
+    // -f + gamma * ent, terms with p_j = 0 contribute nothing
+    double res = 0.0;
+    for (std::size_t j = 0; j < m_.size(); j++) {
+        if (h_[j] > 0) {
+            res -= (m_[j] + gamma_ * h_[j] / sumH) * logP_[j];
+        }
+    }
+    return res;
+}
+
+double EntropyObjective::gradient(const std::vector<double>& x, std::vector<double>& grad) {
+    const std::size_t n = m_.size();
+    const double sumH = cache(x);
+
+    double res = 0.0;
+    double sumT = 0.0;  // sum_j h_j (1 + log p_j)
+    for (std::size_t j = 0; j < n; j++) {
+        if (h_[j] > 0) {
+            res -= (m_[j] + gamma_ * h_[j] / sumH) * logP_[j];
+            sumT += h_[j] * (1 + logP_[j]);
+        }
+    }
+
+    grad.resize(n);
+    const double invS = 1.0 / sumH;
+    for (std::size_t k = 0; k < n; k++) {
+        const double hk = h_[k];
+        const double derH = hk * (1 - hk);  // h'(x_k)
+
+        // d f / d x_k, with m_k h'_k / h_k written as m_k (1 - h_k)
+        const double derF = m_[k] * (1 - hk) - derH * sumM_ * invS;
+
+        // d ent / d x_k
+        const double own = (hk > 0) ? (1 + logP_[k]) * sumH : 0.0;
+        const double derEnt = -derH * (own - sumT) * invS * invS;
+
+        grad[k] = -derF + gamma_ * derEnt;
+    }
+
+    return res;
+}
+
+std::vector<double> EntropyObjective::proportions(const std::vector<double>& x) {
+    std::vector<double> p(x.size());
+
+    double sumH = 0.0;
+    for (std::size_t j = 0; j < x.size(); j++) {
+        p[j] = logistic(x[j]);
+        sumH += p[j];
+    }
+    for (double& pj : p) {
+        pj /= sumH;
+    }
+
+    return p;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file EntropyObjective.hh
+ * @brief Objective of the entropy-regularized M-step of EstimateTrueCount_EntropyFast
+ *
+ * The M-step picks proportions p_j = h(x_j) / S, S = sum_j h(x_j), with h
+ * the logistic function, by minimizing
+ *
+ *     F(x) = -sum_j m_j log p_j - gamma sum_j p_j log p_j
+ *
+ * over unconstrained x.  Differentiating each coordinate separately sums
+ * over all j for every k, an O(n^2) gradient with O(n^2) exp() calls.
+ * With h'_k = h_k (1 - h_k), M = sum_j m_j and T = sum_j h_j (1 + log p_j)
+ * the sums collapse to
+ *
+ *     dF/dx_k = -m_k (1 - h_k) + h'_k M / S
+ *               - gamma h'_k ((1 + log p_k) S - T) / S^2
+ *
+ * so one pass caching h(x) and log p gives the value and the whole
+ * gradient in O(n) with n exp() and n log() calls.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef ENTROPY_OBJECTIVE_HH
+#define ENTROPY_OBJECTIVE_HH
+
+#include <vector>
+
+#include <cstddef>
+
+/**
+ * @brief F(x) and its gradient for fixed expected counts m and weight gamma
+ *
+ * The counts are referenced, not copied; they must outlive the objective.
+ */
+class EntropyObjective {
+   public:
+    /**
+     * @param m     Expected count of every tag
+     * @param gamma Weight of the entropy term
+     */
+    EntropyObjective(const std::vector<double>& m, double gamma);
+
+    /// Number of variables
+    std::size_t size() const { return m_.size(); }
+
+    /// F(x)
+    double value(const std::vector<double>& x);
+
+    /**
+     * @brief F(x) and dF/dx in one pass
+     *
+     * @param x    Point
+     * @param grad Gradient at x; resized to size()
+     * @return F(x)
+     */
+    double gradient(const std::vector<double>& x, std::vector<double>& grad);
+
+    /// Proportions p_j = h(x_j) / S
+    static std::vector<double> proportions(const std::vector<double>& x);
+
+   private:
+    /// Fills h_ and logP_, returns S
+    double cache(const std::vector<double>& x);
+
+    const std::vector<double>& m_;
+    const double gamma_;
+    double sumM_;
+    std::vector<double> h_;     ///< h(x_j)
+    std::vector<double> logP_;  ///< log p_j, only where h(x_j) > 0
+};
+
+#endif  // ENTROPY_OBJECTIVE_HH
@@ -0,0 +1,292 @@
+#include "EntropyOptimizer.hh"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+
+namespace {
+
+double dot(const std::vector<double>& x, const std::vector<double>& y) {
+    double res = 0;
+    for (std::size_t i = 0; i < x.size(); i++) {
+        res += x[i] * y[i];
+    }
+    return res;
+}
+
+// Step t along -der with sufficient decrease, halving from t = 1
+double backtrackingLineSearch(const std::vector<double>& x_vect, EntropyObjective& objective,
+                              const std::vector<double>& der_vect, double new_fx) {
+    double alpha = 0.1;
+    double beta = 0.5;
+    double t = 1;
+
+    std::vector<double> tmp_x_vect(der_vect.size());
+    const double der_norm2 = dot(der_vect, der_vect);
+
+    while (1) {
+        // x + t * ( - derX )
+        for (std::size_t jj = 0; jj < tmp_x_vect.size(); jj++) {
+            tmp_x_vect[jj] = x_vect[jj] - t * der_vect[jj];
+        }
+
+        // sortie normale
+        if (objective.value(tmp_x_vect) <= new_fx - alpha * t * der_norm2) {
+            break;
+        }
+
+        t *= beta;
+
+        // sortie anormale
+        if (t == 0) {
+            break;
+        }
+    }
+
+    return t;
+}
+
+// One descent from a random start; returns the final point
+std::vector<double> gradient_descent(EntropyObjective& objective, int& n_iter) {
+    const std::size_t n = objective.size();
+    std::vector<double> new_x_vect(n);
+    std::vector<double> der_vect(n);
+
+    // Generate Random Number for x_vect
+    std::vector<double> x_vect;
+    for (std::size_t i = 0; i < n; i++) {
+        x_vect.push_back(sin(rand()) * 5);
+    }
+
+    n_iter = 0;
+    double new_fx = objective.value(x_vect);
+    double old_fx = 0;
+
+    // param
+    int n_iter_max = 1000;
+    double nu = pow(10, -4);
+
+    while (1) {
+        objective.gradient(x_vect, der_vect);
+        double epsilon = backtrackingLineSearch(x_vect, objective, der_vect, new_fx);
+
+        // maj x
+        for (std::size_t jj = 0; jj < n; jj++) {
+            new_x_vect[jj] = x_vect[jj] - epsilon * der_vect[jj];
+        }
+        // maj fx
+        new_fx = objective.value(new_x_vect);
+
+        // sortie anormale
+        if (n_iter > 0 && new_fx > old_fx) {
+            break;
+        }
+
+        // sortie normale
+        if ((n_iter > 0 && std::fabs((new_fx - old_fx) / old_fx) < nu * n) ||
+            (n_iter == n_iter_max)) {
+            break;
+        }
+
+        x_vect = new_x_vect;
+        n_iter += 1;
+        old_fx = new_fx;
+    }
+
+    return new_x_vect;
+}
+
+}  // namespace
+
+
+int GradientDescentOptimizer::minimize(EntropyObjective& objective, std::vector<double>& x) {
+    int iter0 = 0;
+    int iter1 = 0;
+    std::vector<double> x0_vect = gradient_descent(objective, iter0);
+    std::vector<double> x1_vect = gradient_descent(objective, iter1);
+
+    if (objective.value(x0_vect) < objective.value(x1_vect)) {
+        x = x0_vect;
+    } else {
+        x = x1_vect;
+    }
+    return iter0 + iter1;
+}
+
+
+LbfgsHistory::LbfgsHistory(std::size_t memory, std::size_t n)
+    : memory_(std::max<std::size_t>(memory, 1)),
+      s_(memory_, std::vector<double>(n)),
+      y_(memory_, std::vector<double>(n)),
+      rho_(memory_),
+      alpha_(memory_),
+      sNew_(n),
+      yNew_(n),
+      stored_(0),
+      newest_(0) {}
+
+bool LbfgsHistory::push(const std::vector<double>& x, const std::vector<double>& xNew,
+                        const std::vector<double>& g, const std::vector<double>& gNew) {
+    double sy = 0;
+    for (std::size_t j = 0; j < sNew_.size(); j++) {
+        sNew_[j] = xNew[j] - x[j];
+        yNew_[j] = gNew[j] - g[j];
+        sy += sNew_[j] * yNew_[j];
+    }
+    if (!(sy > 1e-12 * std::sqrt(dot(sNew_, sNew_) * dot(yNew_, yNew_)))) {
+        return false;
+    }
+
+    const std::size_t next = (stored_ == 0) ? newest_ : (newest_ + 1) % memory_;
+    s_[next].swap(sNew_);
+    y_[next].swap(yNew_);
+    rho_[next] = 1.0 / sy;
+    newest_ = next;
+    stored_ = std::min(stored_ + 1, memory_);
+    return true;
+}
+
+void LbfgsHistory::multiply(std::vector<double>& d) {
+    if (stored_ == 0) {
+        return;
+    }
+
+    const std::size_t n = d.size();
+    for (std::size_t k = 0; k < stored_; k++) {
+        std::size_t i = (newest_ + memory_ - k) % memory_;
+        alpha_[i] = rho_[i] * dot(s_[i], d);
+        for (std::size_t j = 0; j < n; j++) {
+            d[j] -= alpha_[i] * y_[i][j];
+        }
+    }
+    const double scale = dot(s_[newest_], y_[newest_]) / dot(y_[newest_], y_[newest_]);
+    for (std::size_t j = 0; j < n; j++) {
+        d[j] *= scale;
+    }
+    for (std::size_t k = stored_; k-- > 0;) {
+        std::size_t i = (newest_ + memory_ - k) % memory_;
+        double beta = rho_[i] * dot(y_[i], d);
+        for (std::size_t j = 0; j < n; j++) {
+            d[j] += (alpha_[i] - beta) * s_[i][j];
+        }
+    }
+}
+
+
+LbfgsOptimizer::LbfgsOptimizer(std::size_t memory, int maxIter, double tolerance)
+    : memory_(std::max<std::size_t>(memory, 1)), maxIter_(maxIter), tolerance_(tolerance) {}
+
+int LbfgsOptimizer::minimize(EntropyObjective& objective, std::vector<double>& x) {
+    const std::size_t n = x.size();
+    const double armijo = 1e-4;
+
+    LbfgsHistory history(memory_, n);
+
+    std::vector<double> g(n);
+    std::vector<double> d(n);
+    std::vector<double> xNew(n);
+    std::vector<double> gNew(n);
+
+    double fx = objective.gradient(x, g);
+
+    for (int iter = 0; iter < maxIter_; iter++) {
+        // d = -H g by the two-loop recursion
+        d = g;
+        if (history.size() > 0) {
+            history.multiply(d);
+        } else {
+            double gNorm = std::sqrt(dot(g, g));
+            double scale = (gNorm > 1.0) ? 1.0 / gNorm : 1.0;
+            for (std::size_t j = 0; j < n; j++) {
+                d[j] *= scale;
+            }
+        }
+        for (std::size_t j = 0; j < n; j++) {
+            d[j] = -d[j];
+        }
+
+        double slope = dot(g, d);
+        if (!(slope < 0)) {
+            // Not a descent direction: forget the curvature and follow -g
+            history.clear();
+            double gNorm = std::sqrt(dot(g, g));
+            if (gNorm == 0) {
+                return iter;
+            }
+            double step = (gNorm > 1.0) ? 1.0 / gNorm : 1.0;
+            for (std::size_t j = 0; j < n; j++) {
+                d[j] = -step * g[j];
+            }
+            slope = dot(g, d);
+        }
+
+        // Backtracking line search from the full quasi-Newton step
+        double t = 1.0;
+        double fNew = 0;
+        while (1) {
+            for (std::size_t j = 0; j < n; j++) {
+                xNew[j] = x[j] + t * d[j];
+            }
+            fNew = objective.gradient(xNew, gNew);
+            if (fNew <= fx + armijo * t * slope) {
+                break;
+            }
+            t *= 0.5;
+            if (t < 1e-20) {
+                return iter;  // no further decrease possible
+            }
+        }
+
+        // Keep the pair only if it has positive curvature
+        history.push(x, xNew, g, gNew);
+
+        bool converged =
+            std::fabs(fx - fNew) <= tolerance_ * std::max({std::fabs(fx), std::fabs(fNew), 1.0});
+
+        x.swap(xNew);
+        g.swap(gNew);
+        fx = fNew;
+
+        if (converged) {
+            return iter + 1;
+        }
+    }
+
+    return maxIter_;
+}
+
+
+std::unique_ptr<EntropyOptimizer> MakeEntropyOptimizer(const std::string& name) {
+    if (name == "lbfgs") {
+        return std::make_unique<LbfgsOptimizer>();
+    }
+    if (name == "gd") {
+        return std::make_unique<GradientDescentOptimizer>();
+    }
+    return nullptr;
+}
+
+std::vector<double> EntropyStartingPoint(const std::vector<double>& m) {
+    double mMax = 0;
+    for (double mj : m) {
+        mMax = std::max(mMax, mj);
+    }
+
+    std::vector<double> x(m.size(), 0.0);
+    if (mMax <= 0) {
+        return x;
+    }
+
+    // h(x_j) = m_j / (2 max m), i.e. x_j = logit of that, floored
+    const double floor = 1e-12;
+    for (std::size_t j = 0; j < m.size(); j++) {
+        double r = std::max(0.5 * m[j] / mMax, floor);
+        x[j] = std::log(r / (1 - r));
+    }
+    return x;
+}
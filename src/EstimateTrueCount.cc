@@ -3,6 +3,10 @@
 // Copyright 2009, Edward Wijaya
 // =====================================================================================
 
+#include "EmEngine.hh"
+#include "NeighborMatrixFile.hh"
+#include "SparseMatrixBuilder.hh"
+#include "TagIndex.hh"
 #include "Utilities.hh"
 
 #include <algorithm>
@@ -22,69 +26,6 @@
 using namespace std;
 
 
-// Optimized: pass by const reference
-double computeLogLik(const std::vector<double>& m, const std::vector<double>& p,
-                     const double& lmbd) {
-    double Result = 0.0;
-    for (unsigned i = 0; i < p.size(); i++) {
-        Result += m[i] * log(p[i] * lmbd);
-    }
-
-    return (-lmbd + Result);
-}
-
-// Optimized: pass by const reference, reserve space
-vector<double> multiplyVecWithVecCorsp(const std::vector<double>& Vec1,
-                                       const std::vector<double>& Vec2) {
-    vector<double> Result;
-    Result.reserve(Vec1.size());  // Pre-allocate
-
-    for (unsigned i = 0; i < Vec1.size(); i++) {
-        Result.push_back(Vec1[i] * Vec2[i]);
-    }
-
-    return Result;
-}
-
-// Optimized: pass by const reference, reserve space
-vector<double> divideVecWithVecCorsp(const std::vector<double>& Vec1,
-                                     const std::vector<double>& Vec2) {
-    vector<double> Result;
-    Result.reserve(Vec1.size());  // Pre-allocate
-
-    for (unsigned i = 0; i < Vec1.size(); i++) {
-        Result.push_back(Vec1[i] / Vec2[i]);
-    }
-
-    return Result;
-}
-
-// Optimized: pass by const reference, reserve space, use multiplication instead of division
-vector<double> divideVecWithScalar(const std::vector<double>& Vec, const double& theC) {
-    vector<double> Result;
-    Result.reserve(Vec.size());  // Pre-allocate
-
-    const double inv_theC = 1.0 / theC;  // Division is slower than multiplication
-    for (unsigned i = 0; i < Vec.size(); i++) {
-        Result.push_back(Vec[i] * inv_theC);
-    }
-
-    return Result;
-}
-
-// Optimized: pass by const reference
-vector<double> sparseM_vec_prod(const vector<double>& p, const std::vector<int>& rowId,
-                                const std::vector<int>& colId, const std::vector<double>& realVal) {
-    std::vector<double> Result(p.size(), 0.0);  // More efficient initialization
-
-    for (unsigned i = 0; i < rowId.size(); i++) {
-        Result[rowId[i]] += realVal[i] * p[colId[i]];
-    }
-
-    return Result;
-}
-
-
 // Optimized: pass by const reference
 double getMainTagPropInit(const std::vector<double>& arg) {
     double mainTagProp = 0.0;
@@ -128,47 +69,32 @@ vector<pair<int, int>> getIndexFromVector(std::vector<string>& nbNt, std::vector
 }
 
 
-// Optimized: pass by const reference, reserve space
-vector<pair<int, int>> getIndexFromMap(const std::vector<string>& nbNt,
-                                       const std::map<string, int>& m) {
+// Pair every neighbor found in the .prop file with its ordinal
+vector<pair<int, int>> getIndexFromOrd(const std::vector<int>& nbOrd) {
     vector<pair<int, int>> foundIndex;
-    foundIndex.reserve(nbNt.size());  // Pre-allocate worst case
+    foundIndex.reserve(nbOrd.size());
 
-    for (unsigned i = 0; i < nbNt.size(); i++) {
-        // Cache the iterator result
-        map<string, int>::const_iterator iter = m.find(nbNt[i]);
-
-        if (iter != m.end()) {
-            int j = iter->second;
-            foundIndex.push_back(make_pair(i, j));
+    for (unsigned i = 0; i < nbOrd.size(); i++) {
+        if (nbOrd[i] != TagIndex::npos) {
+            foundIndex.push_back(make_pair(i, nbOrd[i]));
         }
     }
 
     return foundIndex;
 }
 
-// Optimized: pass by const reference, reserve space, cache map lookups
-vector<double> getPropSum(const std::vector<string>& neigb, const map<string, double>& m) {
-    vector<double> propVec;
-    propVec.reserve(neigb.size());
-
-    // Find value of a neighbors from the map, otherwise return zero
-    // OPTIMIZATION: Cache the iterator instead of double lookup
-    for (unsigned i = 0; i < neigb.size(); i++) {
-        map<string, double>::const_iterator iter = m.find(neigb[i]);
-        double value = (iter != m.end()) ? iter->second : 0.0;
-        propVec.push_back(value);
-    }
-
-    // Sum the vector in three-three
-    // Resulting vector = nofpos
+// Sum of the neighbor proportions at every position (three substitutions each)
+vector<double> getPropSum(const std::vector<int>& nbOrd, const std::vector<double>& tagProp) {
     vector<double> pSum;
-    int nofPos = neigb.size() / 3;
-    pSum.reserve(nofPos);  // Pre-allocate
+    int nofPos = nbOrd.size() / 3;
+    pSum.reserve(nofPos);
 
     int b = 0;
     for (int k = 0; k < nofPos; k++) {
-        double output = propVec[b] + propVec[b + 1] + propVec[b + 2];
+        double output = 0.0;
+        for (int j = b; j < b + 3; j++) {
+            output += (nbOrd[j] != TagIndex::npos) ? tagProp[nbOrd[j]] : 0.0;
+        }
         pSum.push_back(output);
         b += 3;
     }
@@ -176,17 +102,13 @@ vector<double> getPropSum(const std::vector<string>& neigb, const map<string, do
     return pSum;
 }
 
-// Optimized: pass by const reference, reserve space, cache map lookups
-vector<double> getNumTagProp(const std::vector<string>& neigb, const map<string, double>& m) {
+// Proportion of every neighbor, zero if it is not in the .prop file
+vector<double> getNumTagProp(const std::vector<int>& nbOrd, const std::vector<double>& tagProp) {
     vector<double> propVec;
-    propVec.reserve(neigb.size());
-
-    // Find value of neighbors from the map, otherwise return zero
-    // OPTIMIZATION: Cache the iterator instead of double lookup
-    for (unsigned i = 0; i < neigb.size(); i++) {
-        map<string, double>::const_iterator iter = m.find(neigb[i]);
-        double value = (iter != m.end()) ? iter->second : 0.0;
-        propVec.push_back(value);
+    propVec.reserve(nbOrd.size());
+
+    for (unsigned i = 0; i < nbOrd.size(); i++) {
+        propVec.push_back((nbOrd[i] != TagIndex::npos) ? tagProp[nbOrd[i]] : 0.0);
     }
 
     return propVec;
@@ -200,19 +122,6 @@ vector<double> getNumTagProp(const std::vector<string>& neigb, const map<string,
  * =====================================================================================
  */
 
-struct sort_pred {
-    // for sorting Vector of Vector. Only  based on first->second ascendingly
-    bool operator()(const std::vector<int>& fs, const std::vector<int>& sc) { return fs < sc; }
-};
-
-struct sort_pred_double {
-    // for sorting Vector of Vector. Only  based on second->first ascendingly
-    bool operator()(const std::vector<double>& lhs, const std::vector<double>& rhs) {
-        return (lhs[1] < rhs[1] || (rhs[0] == lhs[0] && lhs[1] < rhs[1]));
-    }
-};
-
-
 struct strCmp {
     bool operator()(const char* s1, const char* s2) const { return strcmp(s1, s2) < 0; }
 };
@@ -233,25 +142,20 @@ int main(int arg_count, char* arg_vec[]) {
 
     /*
        Final Output Variables (Sparse)
-       RA -> Vector with real value
-       JA -> Vector with colum index
-       IA -> Vector with row index
+       A  -> read-error matrix, one row per tag (CSR)
+       At -> its transpose, i.e. A in CSC form
     */
 
-    vector<double> RA;
-    vector<int> JA;
-    vector<int> IA;
+    CsrMatrix A;
+    CsrMatrix At;
     vector<string> ordNumTags;
-    map<string, int> ordNumTagsMap;
+    TagIndex tagIndex;
 
-    vector<vector<int>> accumIndexInOrd;
-    vector<vector<int>> accumIndexIA;
-    vector<vector<double>> accumIndexRA;
     vector<double> rawCount;  // raw count container
     vector<string> Tags;
 
-    // Store Prop File as Hash
-    map<string, double> theMap;
+    // Proportion of every tag in the .prop file, by ordinal
+    vector<double> tagProp;
     string line;
     string qualFileName = arg_vec[1];
     string baseName = GetBaseNameFromFilename(qualFileName);
@@ -260,253 +164,192 @@ int main(int arg_count, char* arg_vec[]) {
     string nbFileName = pathName + baseName + ".nb";
     string propFileName = pathName + baseName + ".prop";
     string nbQualFileName = pathName + baseName + ".nbq";
+    string nbmFileName = pathName + baseName + ".nbm";
 
-    ifstream propfile(propFileName.c_str());
-
-    int numberOfSeq = 0;
-    int ordId = 0;
-
-    if (propfile.is_open()) {
-        while (getline(propfile, line)) {
-            numberOfSeq++;
-            stringstream ss(line);
-            string numTag;
-            double prop;
-
-            ss >> numTag >> prop;
-            // cout << numTag << "\t" << prop << endl;
-            theMap.insert(make_pair(numTag, prop));
-            JA.push_back(numberOfSeq - 1);
-            ordNumTagsMap.insert(make_pair(numTag, ordId++));
-        }
-        propfile.close();
-
+    int lineno_ = 0;
 
+    // A binary matrix written by FindNeighboursWithQual --nbm replaces
+    // the text parsing below, unless it is left over from an earlier run
+    NeighborMatrixFile nbmFile;
+    if (nbmFile.openIfCurrent(nbmFileName, nbFileName, qualFileName)) {
+        nbmFile.toCsr(A, Tags, rawCount);
+        lineno_ = static_cast<int>(nbmFile.numTags());
+        nbmFile.close();
     } else {
-        cout << "Unable to open input file\n";
-    };
-
-
-    // for( map<const string, int, strCmp>::iterator iter = ordNumTagsMap.begin(); iter !=
-    // ordNumTagsMap.end(); ++iter) {
-    //      cout << (*iter).first << " - " << (*iter).second << endl;
-    // }
-
-    // Initialize IA first column
-    // it's the same with JA
-    IA = JA;
-
-    // Begin iterating the neigbours file and quality file, then find
-    // estimated error mean
+        ifstream propfile(propFileName.c_str());
+
+        int numberOfSeq = 0;
+        int ordId = 0;
+
+        if (propfile.is_open()) {
+            while (getline(propfile, line)) {
+                numberOfSeq++;
+                stringstream ss(line);
+                string numTag;
+                double prop;
+
+                ss >> numTag >> prop;
+                // cout << numTag << "\t" << prop << endl;
+                tagProp.push_back(prop);
+                tagIndex.insert(numTag, ordId++);
+            }
+            propfile.close();
 
-    ifstream nbfile(nbFileName.c_str());
-    ifstream qlfile(qualFileName.c_str());
-    ifstream nbqfile(nbQualFileName.c_str());
 
-    string nbline;
-    string qlline;
-    string nbqline;
+        } else {
+            cout << "Unable to open input file\n";
+        };
 
-    int lineno = 0;
-    int lineno_ = 0;
 
-    // std::clock_t startTime = std::clock();
+        // for( map<const string, int, strCmp>::iterator iter = ordNumTagsMap.begin(); iter !=
+        // ordNumTagsMap.end(); ++iter) {
+        //      cout << (*iter).first << " - " << (*iter).second << endl;
+        // }
 
-    if (nbfile.is_open() && qlfile.is_open() && nbqfile.is_open()) {
-        while (getline(nbfile, nbline) && getline(qlfile, qlline) && getline(nbqfile, nbqline)) {
-            stringstream sn(nbline);
+        // Rows arrive in tag order, so the CSR arrays are filled directly
+        SparseMatrixBuilder builder(numberOfSeq);
 
-            // Parsing Neighbors File
-            string numTagd;
-            string numTags;
-            string numTagnb;
-            vector<string> nbnumTags;
+        // Begin iterating the neigbours file and quality file, then find
+        // estimated error mean
 
-            sn >> numTags >> numTagd;
-            Tags.push_back(numTags);
-            string numTag = numTagd;
+        ifstream nbfile(nbFileName.c_str());
+        ifstream qlfile(qualFileName.c_str());
+        ifstream nbqfile(nbQualFileName.c_str());
 
-            while (sn >> numTagd) {
-                nbnumTags.push_back(numTagd);
-            }
+        string nbline;
+        string qlline;
+        string nbqline;
 
 
-            // Parsing Quality File
-            stringstream sq(qlline);
-            double tableEntry;
-            sq >> tableEntry;
-            double observedCount = tableEntry;
+        // std::clock_t startTime = std::clock();
 
+        if (nbfile.is_open() && qlfile.is_open() && nbqfile.is_open()) {
+            while (getline(nbfile, nbline) && getline(qlfile, qlline) && getline(nbqfile, nbqline)) {
+                stringstream sn(nbline);
 
-            // Parsing Neighbourhood Quality file
-            stringstream sp(nbqline);
-            string Tagsq;
-            string numTagq;
-            double numTagProp;
-            vector<double> nbnumTagsProp;
+                // Parsing Neighbors File
+                string numTagd;
+                string numTags;
+                string numTagnb;
+                vector<string> nbnumTags;
 
-            sp >> Tagsq >> numTagq;
-
-            while (sp >> numTagProp) {
-                nbnumTagsProp.push_back(numTagProp);
-            }
+                sn >> numTags >> numTagd;
+                Tags.push_back(numTags);
+                string numTag = numTagd;
 
+                while (sn >> numTagd) {
+                    nbnumTags.push_back(numTagd);
+                }
 
-            //
-            // Begin computing Rtags.A
-            //
 
-            vector<double> propSum = getPropSum(nbnumTags, theMap);
-            vector<double> propOfNumTag = getNumTagProp(nbnumTags, theMap);
-            double MainTagProp = getMainTagPropInit(nbnumTagsProp);
+                // Parsing Quality File
+                stringstream sq(qlline);
+                double tableEntry;
+                sq >> tableEntry;
+                double observedCount = tableEntry;
 
-            vector<double> rTagsQual;
-            rTagsQual.reserve(nbnumTagsProp.size());
 
-            // Find Error Mean
-            int groupIndex = 0;
-            for (unsigned x = 0; x < propSum.size(); x += 1) {
-                double rTagsQual1 =
-                    nbnumTagsProp[groupIndex] * propOfNumTag[groupIndex] / propSum[x];
-                double rTagsQual2 =
-                    nbnumTagsProp[groupIndex + 1] * propOfNumTag[groupIndex + 1] / propSum[x];
-                double rTagsQual3 =
-                    nbnumTagsProp[groupIndex + 2] * propOfNumTag[groupIndex + 2] / propSum[x];
+                // Parsing Neighbourhood Quality file
+                stringstream sp(nbqline);
+                string Tagsq;
+                string numTagq;
+                double numTagProp;
+                vector<double> nbnumTagsProp;
 
-                if (isnan(rTagsQual1)) {
-                    rTagsQual1 = 0;
-                }
+                sp >> Tagsq >> numTagq;
 
-                if (isnan(rTagsQual2)) {
-                    rTagsQual2 = 0;
+                while (sp >> numTagProp) {
+                    nbnumTagsProp.push_back(numTagProp);
                 }
 
-                if (isnan(rTagsQual3)) {
-                    rTagsQual3 = 0;
-                }
 
-                rTagsQual.push_back(rTagsQual1);
-                rTagsQual.push_back(rTagsQual2);
-                rTagsQual.push_back(rTagsQual3);
+                //
+                // Begin computing Rtags.A
+                //
 
-                groupIndex += 3;
-            }
+                // Resolve every neighbor once; absent ones get TagIndex::npos
+                vector<int> nbOrd;
+                tagIndex.findAll(nbnumTags, nbOrd);
 
-            MainTagProp = getMainTagPropMeanScaled(rTagsQual);
-            vector<pair<int, int>> indexInOrd = getIndexFromMap(nbnumTags, ordNumTagsMap);
-
-            vector<vector<int>> indexInOrdLineNo;
-            for (unsigned k = 0; k < indexInOrd.size(); k++) {
-                pair<int, int> tpl = indexInOrd[k];
-                // cout << tpl.first << "-" << tpl.second << endl;
-                vector<int> temp;
-                temp.push_back(tpl.first);
-                temp.push_back(lineno++);
-                temp.push_back(tpl.second);
-                indexInOrdLineNo.push_back(temp);
-            }
+                vector<double> propSum = getPropSum(nbOrd, tagProp);
+                vector<double> propOfNumTag = getNumTagProp(nbOrd, tagProp);
+                double MainTagProp = getMainTagPropInit(nbnumTagsProp);
 
-            // printf("%.7f\t", MainTagProp);
-            // prn_vec<double>(rTagsQual,"\t");
-            // cout << endl;
+                vector<double> rTagsQual;
+                rTagsQual.reserve(nbnumTagsProp.size());
 
-            accumIndexInOrd.insert(accumIndexInOrd.end(), indexInOrdLineNo.begin(),
-                                   indexInOrdLineNo.end());
+                // Find Error Mean
+                int groupIndex = 0;
+                for (unsigned x = 0; x < propSum.size(); x += 1) {
+                    double rTagsQual1 =
+                        nbnumTagsProp[groupIndex] * propOfNumTag[groupIndex] / propSum[x];
+                    double rTagsQual2 =
+                        nbnumTagsProp[groupIndex + 1] * propOfNumTag[groupIndex + 1] / propSum[x];
+                    double rTagsQual3 =
+                        nbnumTagsProp[groupIndex + 2] * propOfNumTag[groupIndex + 2] / propSum[x];
 
-            int tln = lineno_++;
+                    if (isnan(rTagsQual1)) {
+                        rTagsQual1 = 0;
+                    }
 
-            RA.push_back(MainTagProp);
-            rawCount.push_back(double(observedCount));
+                    if (isnan(rTagsQual2)) {
+                        rTagsQual2 = 0;
+                    }
 
-            // For IA and RA
-            vector<vector<int>> forIA;
-            vector<vector<double>> forRA;
+                    if (isnan(rTagsQual3)) {
+                        rTagsQual3 = 0;
+                    }
 
-            for (unsigned n = 0; n < rTagsQual.size(); n++) {
-                vector<int> temp2;
-                vector<double> temp3;
+                    rTagsQual.push_back(rTagsQual1);
+                    rTagsQual.push_back(rTagsQual2);
+                    rTagsQual.push_back(rTagsQual3);
 
-                if (rTagsQual[n] > 0) {
-                    // cout << rTagsQual[n] << "-" << tln << "-" << n+1 << " ";
-                    temp2.push_back(n + 1);
-                    temp2.push_back(tln);
-                    forIA.push_back(temp2);
-
-                    temp3.push_back(double(tln));
-                    temp3.push_back(double(n + 1));
-                    temp3.push_back(rTagsQual[n]);
-                    forRA.push_back(temp3);
+                    groupIndex += 3;
                 }
-            }
-
-            accumIndexIA.insert(accumIndexIA.end(), forIA.begin(), forIA.end());
-            accumIndexRA.insert(accumIndexRA.end(), forRA.begin(), forRA.end());
-
-
-            // cout << " ------- " <<endl;
-        }
-        nbfile.close();
-        qlfile.close();
-        nbqfile.close();
-    } else {
-        cout << "One of the three files NB,QL, and NBQ cannot be open\n";
-    }
 
+                MainTagProp = getMainTagPropMeanScaled(rTagsQual);
+                vector<pair<int, int>> indexInOrd = getIndexFromOrd(nbOrd);
 
-    // cerr << "# CPU time for parsing two files: " << (clock() - startTime + 0.0) / CLOCKS_PER_SEC
-    //     << " seconds\n";
-
+                int tln = lineno_++;
+                rawCount.push_back(double(observedCount));
 
-    /*
-     Here we extract show all the sparse matrix param (RA,JA,IA);
-     Then convert them into the standard SparseMatrix
-    */
+                // Diagonal first, then every neighbor present in the .prop file
+                builder.addEntry(tln, MainTagProp);
+                for (unsigned k = 0; k < indexInOrd.size(); k++) {
+                    double rTagQual = rTagsQual[indexInOrd[k].first];
+                    if (rTagQual > 0) {
+                        builder.addEntry(indexInOrd[k].second, rTagQual);
+                    }
+                }
+                builder.endRow();
 
-    // std::clock_t startSparseTime = std::clock();
 
-    // cout << "DIM " << lineno_ << "x" << lineno_ << endl;
-    // cout << "RAW COUNT ";
-    // prn_vec_err<double>(rawCount,",");
-    // cout << rawCount.size();
-    // cout << endl;
+                // cout << " ------- " <<endl;
+            }
+            nbfile.close();
+            qlfile.close();
+            nbqfile.close();
+        } else {
+            cout << "One of the three files NB,QL, and NBQ cannot be open\n";
+        }
 
-    // Print and keep RA
-    std::stable_sort(accumIndexRA.begin(), accumIndexRA.end(), sort_pred_double());
-    for (unsigned z = 0; z < accumIndexRA.size(); z++) {
-        vector<double> dbtriplet = accumIndexRA[z];
-        // cout << "\t" << dbtriplet[0] << "\t" << dbtriplet[1] << "\t" << dbtriplet[2] <<  endl;
-        RA.push_back(dbtriplet[2]);
-    }
 
+        // cerr << "# CPU time for parsing two files: " << (clock() - startTime + 0.0) / CLOCKS_PER_SEC
+        //     << " seconds\n";
 
-    // Print and Keep IA
-    std::sort(accumIndexIA.begin(), accumIndexIA.end(), sort_pred());
-    for (unsigned y = 0; y < accumIndexIA.size(); y++) {
-        vector<int> duplet = accumIndexIA[y];
-        IA.push_back(duplet[1]);
-    }
 
+        // Every .nb line is a row and every .prop line a column; the two
+        // files must come from the same input
+        if (builder.hasRejectedEntries() ||
+            builder.numRows() != static_cast<size_t>(numberOfSeq)) {
+            cerr << "Error: unequal dimension sizes in sparse matrix" << endl;
+            exit(EXIT_FAILURE);
+        }
 
-    // Print and Keep JA
-    std::sort(accumIndexInOrd.begin(), accumIndexInOrd.end(), sort_pred());
-    for (unsigned k = 0; k < accumIndexInOrd.size(); k++) {
-        vector<int> triplet = accumIndexInOrd[k];
-        JA.push_back(triplet[2]);
+        A = builder.finish();
     }
 
-    if (RA.size() != IA.size() || IA.size() != JA.size()) {
-        cerr << "RA : ";
-        // prn_vec_err<double>(RA, " ");
-        cerr << RA.size() << endl;
-        cerr << "IA : ";
-        // prn_vec_err<int>(IA, " ");
-        cerr << IA.size() << endl;
-        cerr << "JA : ";
-        // prn_vec_err<int>(JA," ");
-        cerr << JA.size() << endl;
-        cerr << "Error: unequal dimension sizes in sparse matrix" << endl;
-        exit(EXIT_FAILURE);
-    }
+    At = TransposeCsr(A);
 
 
     // cerr << "# CPU time for storing and sorting SparseM: " << (clock() - startSparseTime + 0.0) /
@@ -526,7 +369,7 @@ int main(int arg_count, char* arg_vec[]) {
     double lambda = double(lineno_);
     int maxStep = 50;
 
-    vector<double> nCount = rawCount;
+    EmEngine em(A, At, rawCount);
     vector<double> theM = rawCount;
 
     // OPTIMIZATION: Add convergence threshold for early exit
@@ -537,20 +380,8 @@ int main(int arg_count, char* arg_vec[]) {
     for (int m = 0; m < maxStep; m++) {
         // cout << "Step " << m << endl;
 
-        vector<double> thePM;
-        vector<double> theP;
-        vector<double> sparseM_prod_P;
-        vector<double> rSums;
-        vector<double> tsparseM_prod_rSums;
-        double logLik;
-
-        thePM = theM;
-        theP = divideVecWithScalar(theM, lambda);
-        sparseM_prod_P = sparseM_vec_prod(theP, IA, JA, RA);
-        rSums = divideVecWithVecCorsp(nCount, sparseM_prod_P);
-        tsparseM_prod_rSums = sparseM_vec_prod(rSums, JA, IA, RA);
-        theM = multiplyVecWithVecCorsp(theP, tsparseM_prod_rSums);
-        logLik = computeLogLik(theM, theP, lambda);
+        // theP = theM / lambda; theM = theP .* At (nCount ./ (A theP))
+        double logLik = em.step(theM, lambda);
 
         // OPTIMIZATION: Check for convergence and exit early
         if (m > 0 && fabs(logLik - prev_logLik) < convergence_threshold) {
@@ -3,6 +3,9 @@
 // Copyright 2009, Edward Wijaya
 // =====================================================================================
 
+#include "EmEngine.hh"
+#include "SparseMatrixBuilder.hh"
+#include "TagIndex.hh"
 #include "Utilities.hh"
 
 #include <algorithm>
@@ -22,61 +25,6 @@
 using namespace std;
 
 
-double computeLogLik(std::vector<double>& m, std::vector<double>& p, double& lmbd) {
-    double Result = 0;
-    for (unsigned i = 0; i < p.size(); i++) {
-        Result += m[i] * log(p[i] * lmbd);
-    }
-
-    return (-lmbd + Result);
-}
-
-vector<double> multiplyVecWithVecCorsp(std::vector<double>& Vec1, std::vector<double>& Vec2) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec1.size(); i++) {
-        double Res = Vec1[i] * Vec2[i];
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
-vector<double> divideVecWithVecCorsp(std::vector<double>& Vec1, std::vector<double>& Vec2) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec1.size(); i++) {
-        double Res = Vec1[i] / Vec2[i];
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
-
-vector<double> divideVecWithScalar(std::vector<double>& Vec, double& theC) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec.size(); i++) {
-        double Res = Vec[i] / theC;
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
-
-vector<double> sparseM_vec_prod(vector<double>& p, std::vector<int>& rowId, std::vector<int>& colId,
-                                std::vector<double>& realVal) {
-    std::vector<double> Result;
-    Result.assign(p.size(), 0);
-
-    for (unsigned i = 0; i < rowId.size(); i++) {
-        // cout << realVal[i] << " " << p(colId[i]) << endl;
-        Result[rowId[i]] += realVal[i] * p[colId[i]];
-    }
-
-    return Result;
-}
-
-
 double getMainTagPropInit(std::vector<double>& arg) {
     double mainTagProp = 0;
 
@@ -118,74 +66,48 @@ vector<pair<int, int>> getIndexFromVector(std::vector<string>& nbNt, std::vector
 }
 
 
-vector<pair<int, int>> getIndexFromMap(std::vector<string>& nbNt, std::map<string, int>& m) {
+// Pair every neighbor found in the .prop file with its ordinal
+vector<pair<int, int>> getIndexFromOrd(const std::vector<int>& nbOrd) {
     vector<pair<int, int>> foundIndex;
+    foundIndex.reserve(nbOrd.size());
 
-    for (unsigned i = 0; i < nbNt.size(); i++) {
-        map<string, int>::iterator iter = m.find(nbNt[i]);
-
-        if (iter != m.end()) {
-            int j = iter->second;
-            pair<int, int> tuple = make_pair(i, j);
-            foundIndex.push_back(tuple);
+    for (unsigned i = 0; i < nbOrd.size(); i++) {
+        if (nbOrd[i] != TagIndex::npos) {
+            foundIndex.push_back(make_pair(i, nbOrd[i]));
         }
     }
 
     return foundIndex;
 }
 
-vector<double> getPropSum(std::vector<string>& neigb, map<string, double>& m) {
-    vector<double> propVec;
-
-    // Find value of a neigbours
-    // from the map, otherwise return zero
-
-    for (unsigned i = 0; i < neigb.size(); i++) {
-        map<string, double>::iterator iter = m.find(neigb[i]);
-        double value = 0;
-
-        if (iter != m.end()) {
-            value = m[neigb[i]];
-        }
-        propVec.push_back(value);
-        // cout << neigb[i] << " " << value << endl;
-    }
-
-
-    // Sum the vector in three-three
-    // Resulting vector = nofpos
-
+// Sum of the neighbor proportions at every position (three substitutions each)
+vector<double> getPropSum(const std::vector<int>& nbOrd, const std::vector<double>& tagProp) {
     vector<double> pSum;
-    int nofPos = neigb.size() / 3;
+    int nofPos = nbOrd.size() / 3;
+    pSum.reserve(nofPos);
+
     int b = 0;
     for (int k = 0; k < nofPos; k++) {
-        double output = propVec[b] + propVec[b + 1] + propVec[b + 2];
+        double output = 0.0;
+        for (int j = b; j < b + 3; j++) {
+            output += (nbOrd[j] != TagIndex::npos) ? tagProp[nbOrd[j]] : 0.0;
+        }
         pSum.push_back(output);
         b += 3;
     }
 
-
     return pSum;
 }
 
-vector<double> getNumTagProp(std::vector<string>& neigb, map<string, double>& m) {
+// Proportion of every neighbor, zero if it is not in the .prop file
+vector<double> getNumTagProp(const std::vector<int>& nbOrd, const std::vector<double>& tagProp) {
     vector<double> propVec;
+    propVec.reserve(nbOrd.size());
 
-    // Find value of a neigbours
-    // from the map, otherwise return zero
-
-    for (unsigned i = 0; i < neigb.size(); i++) {
-        map<string, double>::iterator iter = m.find(neigb[i]);
-        double value = 0;
-
-        if (iter != m.end()) {
-            value = m[neigb[i]];
-        }
-        propVec.push_back(value);
-        // cout << neigb[i] << " " << value << endl;
+    for (unsigned i = 0; i < nbOrd.size(); i++) {
+        propVec.push_back((nbOrd[i] != TagIndex::npos) ? tagProp[nbOrd[i]] : 0.0);
     }
 
-
     return propVec;
 }
 
@@ -197,19 +119,6 @@ vector<double> getNumTagProp(std::vector<string>& neigb, map<string, double>& m)
  * =====================================================================================
  */
 
-struct sort_pred {
-    // for sorting Vector of Vector. Only  based on first->second ascendingly
-    bool operator()(const std::vector<int>& fs, const std::vector<int>& sc) { return fs < sc; }
-};
-
-struct sort_pred_double {
-    // for sorting Vector of Vector. Only  based on second->first ascendingly
-    bool operator()(const std::vector<double>& lhs, const std::vector<double>& rhs) {
-        return (lhs[1] < rhs[1] || (rhs[0] == lhs[0] && lhs[1] < rhs[1]));
-    }
-};
-
-
 struct strCmp {
     bool operator()(const char* s1, const char* s2) const { return strcmp(s1, s2) < 0; }
 };
@@ -230,25 +139,20 @@ int main(int arg_count, char* arg_vec[]) {
 
     /*
        Final Output Variables (Sparse)
-       RA -> Vector with real value
-       JA -> Vector with colum index
-       IA -> Vector with row index
+       A  -> read-error matrix, one row per tag (CSR)
+       At -> its transpose, i.e. A in CSC form
     */
 
-    vector<double> RA;
-    vector<int> JA;
-    vector<int> IA;
+    CsrMatrix A;
+    CsrMatrix At;
     vector<string> ordNumTags;
-    map<string, int> ordNumTagsMap;
+    TagIndex tagIndex;
 
-    vector<vector<int>> accumIndexInOrd;
-    vector<vector<int>> accumIndexIA;
-    vector<vector<double>> accumIndexRA;
     vector<double> rawCount;  // raw count container
     vector<string> Tags;
 
-    // Store Prop File as Hash
-    map<string, double> theMap;
+    // Proportion of every tag in the .prop file, by ordinal
+    vector<double> tagProp;
     string line;
     string qualFileName = arg_vec[1];
     string Capacity = arg_vec[2];
@@ -263,6 +167,8 @@ int main(int arg_count, char* arg_vec[]) {
     // cout << propFileName << endl;
     // cout << nbQualFileName << endl;
 
+    int lineno_ = 0;
+
     ifstream propfile(propFileName.c_str());
 
     int numberOfSeq = 0;
@@ -277,9 +183,8 @@ int main(int arg_count, char* arg_vec[]) {
 
             ss >> numTag >> prop;
             // cout << numTag << "\t" << prop << endl;
-            theMap.insert(make_pair(numTag, prop));
-            JA.push_back(numberOfSeq - 1);
-            ordNumTagsMap.insert(make_pair(numTag, ordId++));
+            tagProp.push_back(prop);
+            tagIndex.insert(numTag, ordId++);
         }
         propfile.close();
 
@@ -294,9 +199,8 @@ int main(int arg_count, char* arg_vec[]) {
     //      cout << (*iter).first << " - " << (*iter).second << endl;
     // }
 
-    // Initialize IA first column
-    // it's the same with JA
-    IA = JA;
+    // Rows arrive in tag order, so the CSR arrays are filled directly
+    SparseMatrixBuilder builder(numberOfSeq);
 
     // Begin iterating the neigbours file and quality file, then find
     // estimated error mean
@@ -309,8 +213,6 @@ int main(int arg_count, char* arg_vec[]) {
     string qlline;
     string nbqline;
 
-    int lineno = 0;
-    int lineno_ = 0;
 
     // std::clock_t startTime = std::clock();
 
@@ -358,8 +260,12 @@ int main(int arg_count, char* arg_vec[]) {
             // Begin computing Rtags.A
             //
 
-            vector<double> propSum = getPropSum(nbnumTags, theMap);
-            vector<double> propOfNumTag = getNumTagProp(nbnumTags, theMap);
+            // Resolve every neighbor once; absent ones get TagIndex::npos
+            vector<int> nbOrd;
+            tagIndex.findAll(nbnumTags, nbOrd);
+
+            vector<double> propSum = getPropSum(nbOrd, tagProp);
+            vector<double> propOfNumTag = getNumTagProp(nbOrd, tagProp);
             double MainTagProp = getMainTagPropInit(nbnumTagsProp);
 
             vector<double> rTagsQual;
@@ -395,54 +301,20 @@ int main(int arg_count, char* arg_vec[]) {
             }
 
             MainTagProp = getMainTagPropMeanScaled(rTagsQual);
-            vector<pair<int, int>> indexInOrd = getIndexFromMap(nbnumTags, ordNumTagsMap);
-
-            vector<vector<int>> indexInOrdLineNo;
-            for (unsigned k = 0; k < indexInOrd.size(); k++) {
-                pair<int, int> tpl = indexInOrd[k];
-                // cout << tpl.first << "-" << tpl.second << endl;
-                vector<int> temp;
-                temp.push_back(tpl.first);
-                temp.push_back(lineno++);
-                temp.push_back(tpl.second);
-                indexInOrdLineNo.push_back(temp);
-            }
-
-            // printf("%.7f\t", MainTagProp);
-            // prn_vec<double>(rTagsQual,"\t");
-            // cout << endl;
-
-            accumIndexInOrd.insert(accumIndexInOrd.end(), indexInOrdLineNo.begin(),
-                                   indexInOrdLineNo.end());
+            vector<pair<int, int>> indexInOrd = getIndexFromOrd(nbOrd);
 
             int tln = lineno_++;
-
-            RA.push_back(MainTagProp);
             rawCount.push_back(double(observedCount));
 
-            // For IA and RA
-            vector<vector<int>> forIA;
-            vector<vector<double>> forRA;
-
-            for (unsigned n = 0; n < rTagsQual.size(); n++) {
-                vector<int> temp2;
-                vector<double> temp3;
-
-                if (rTagsQual[n] > 0) {
-                    // cout << rTagsQual[n] << "-" << tln << "-" << n+1 << " ";
-                    temp2.push_back(n + 1);
-                    temp2.push_back(tln);
-                    forIA.push_back(temp2);
-
-                    temp3.push_back(double(tln));
-                    temp3.push_back(double(n + 1));
-                    temp3.push_back(rTagsQual[n]);
-                    forRA.push_back(temp3);
+            // Diagonal first, then every neighbor present in the .prop file
+            builder.addEntry(tln, MainTagProp);
+            for (unsigned k = 0; k < indexInOrd.size(); k++) {
+                double rTagQual = rTagsQual[indexInOrd[k].first];
+                if (rTagQual > 0) {
+                    builder.addEntry(indexInOrd[k].second, rTagQual);
                 }
             }
-
-            accumIndexIA.insert(accumIndexIA.end(), forIA.begin(), forIA.end());
-            accumIndexRA.insert(accumIndexRA.end(), forRA.begin(), forRA.end());
+            builder.endRow();
 
 
             // cout << " ------- " <<endl;
@@ -461,57 +333,18 @@ int main(int arg_count, char* arg_vec[]) {
     // cout << Tags.size() << endl;
 
 
-    /*
-     Here we extract show all the sparse matrix param (RA,JA,IA);
-     Then convert them into the standard SparseMatrix
-    */
-
-    // std::clock_t startSparseTime = std::clock();
-
-    // cout << "DIM " << lineno_ << "x" << lineno_ << endl;
-    // cout << "RAW COUNT ";
-    // prn_vec_err<double>(rawCount,",");
-    // cout << rawCount.size();
-    // cout << endl;
-
-    // Print and keep RA
-    std::stable_sort(accumIndexRA.begin(), accumIndexRA.end(), sort_pred_double());
-    for (unsigned z = 0; z < accumIndexRA.size(); z++) {
-        vector<double> dbtriplet = accumIndexRA[z];
-        // cout << "\t" << dbtriplet[0] << "\t" << dbtriplet[1] << "\t" << dbtriplet[2] <<  endl;
-        RA.push_back(dbtriplet[2]);
-    }
-
-
-    // Print and Keep IA
-    std::sort(accumIndexIA.begin(), accumIndexIA.end(), sort_pred());
-    for (unsigned y = 0; y < accumIndexIA.size(); y++) {
-        vector<int> duplet = accumIndexIA[y];
-        IA.push_back(duplet[1]);
-    }
-
-
-    // Print and Keep JA
-    std::sort(accumIndexInOrd.begin(), accumIndexInOrd.end(), sort_pred());
-    for (unsigned k = 0; k < accumIndexInOrd.size(); k++) {
-        vector<int> triplet = accumIndexInOrd[k];
-        JA.push_back(triplet[2]);
-    }
-
-    if (RA.size() != IA.size() || IA.size() != JA.size()) {
-        cerr << "RA : ";
-        // prn_vec_err<double>(RA, " ");
-        cerr << RA.size() << endl;
-        cerr << "IA : ";
-        // prn_vec_err<int>(IA, " ");
-        cerr << IA.size() << endl;
-        cerr << "JA : ";
-        // prn_vec_err<int>(JA," ");
-        cerr << JA.size() << endl;
+    // Every .nb line is a row and every .prop line a column; the two
+    // files must come from the same input
+    if (builder.hasRejectedEntries() ||
+        builder.numRows() != static_cast<size_t>(numberOfSeq)) {
         cerr << "Error: unequal dimension sizes in sparse matrix" << endl;
         exit(EXIT_FAILURE);
     }
 
+    A = builder.finish();
+
+    At = TransposeCsr(A);
+
 
     // cerr << "# CPU time for storing and sorting SparseM: " << (clock() - startSparseTime + 0.0) /
     // CLOCKS_PER_SEC
@@ -530,26 +363,14 @@ int main(int arg_count, char* arg_vec[]) {
     double lambda = double(lineno_);
     int maxStep = 50;
 
-    vector<double> nCount = rawCount;
+    EmEngine em(A, At, rawCount);
     vector<double> theM = rawCount;
 
     for (int m = 0; m < maxStep; m++) {
         // cout << "Step " << m << endl;
 
-        vector<double> thePM;
-        vector<double> theP;
-        vector<double> sparseM_prod_P;
-        vector<double> rSums;
-        vector<double> tsparseM_prod_rSums;
-        double logLik;
-
-        thePM = theM;
-        theP = divideVecWithScalar(theM, lambda);
-        sparseM_prod_P = sparseM_vec_prod(theP, IA, JA, RA);
-        rSums = divideVecWithVecCorsp(nCount, sparseM_prod_P);
-        tsparseM_prod_rSums = sparseM_vec_prod(rSums, JA, IA, RA);
-        theM = multiplyVecWithVecCorsp(theP, tsparseM_prod_rSums);
-        logLik = computeLogLik(theM, theP, lambda);
+        // theP = theM / lambda; theM = theP .* At (nCount ./ (A theP))
+        em.step(theM, lambda);
 
         /*
         prn_vec_oneval<double>(theP,"\t",3);
@@ -3,6 +3,12 @@
 // Copyright 2009, Edward Wijaya
 // =====================================================================================
 
+#include "EmEngine.hh"
+#include "EntropyObjective.hh"
+#include "EntropyOptimizer.hh"
+#include "NeighborMatrixFile.hh"
+#include "SparseMatrixBuilder.hh"
+#include "TagIndex.hh"
 #include "Utilities.hh"
 
 #include <algorithm>
@@ -10,6 +16,7 @@
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <numeric>
 #include <sstream>
 #include <string>
@@ -24,428 +31,6 @@
 using namespace std;
 
 
-// BEgin Entropy Code
-
-double h(double x) {
-    return 1. / (1. + exp(-x));
-}
-
-
-vector<double> h_alloc(std::vector<double>& x_vect) {
-    //
-    vector<double> res_vect;
-
-    //
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        res_vect.push_back(h(x_vect[i]));
-    }
-    return res_vect;
-}
-
-
-double der_h(double x) {
-    return exp(-x) / pow((1 + exp(-x)), 2);
-}
-
-
-// ######
-// #
-// # UTIL
-// #
-// ######
-
-
-// sum
-
-double compute_sum(std::vector<double>& x_vect) {
-    double res = 0;
-
-    // sum
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        res += x_vect[i];
-    }
-
-    return res;
-}
-
-
-// sum
-
-double compute_sum_hx_vect(std::vector<double>& x_vect) {
-    double res = 0;
-
-    // sum
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        res += h(x_vect[i]);
-    }
-
-    return res;
-}
-
-
-// sum
-
-double compute_dot(std::vector<double>& x_vect, std::vector<double>& y_vect) {
-    double res = 0;
-
-    // sum
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        res += x_vect[i] * y_vect[i];
-    }
-
-    return res;
-}
-
-
-// turn a positive vector into probabilities
-
-int make_proba(std::vector<double>& x_vect, std::vector<double>& res_vect) {
-    // precal
-    double tmp_sum = compute_sum(x_vect);
-
-
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        res_vect[i] = x_vect[i] / tmp_sum;
-    }
-
-    return 0;
-}
-
-
-// turn a positive vector into probabilities
-
-vector<double> make_proba_alloc(std::vector<double>& x_vect) {
-    vector<double> res_vect;
-
-    // precal
-    double tmp_sum = compute_sum(x_vect);
-
-
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        res_vect.push_back(x_vect[i] / tmp_sum);
-    }
-
-    return res_vect;
-}
-
-
-// sum
-
-int copy_vect(std::vector<double>& x_vect, std::vector<double>& res_vect) {
-    // sum
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        res_vect[i] = x_vect[i];
-    }
-
-    return 0;
-}
-
-
-// alloc
-
-vector<double> alloc_vect(int nx) {
-    //
-    vector<double> res_vect;
-
-    // sum
-    for (int i = 0; i < nx; i++) {
-        res_vect.push_back(0);
-    }
-
-    return res_vect;
-}
-
-
-// ######
-// #
-// # FUNC
-// #
-// ######
-
-
-// likelihood
-
-double f(std::vector<double>& x_vect, std::vector<double>& m_vect) {
-    //
-    double res = 0;
-
-    // precal
-    double sum_hx = compute_sum_hx_vect(x_vect);
-
-    double pi;
-
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        pi = h(x_vect[i]) / sum_hx;
-        if (pi > 0) {
-            res += m_vect[i] * log(pi);
-        }
-    }
-
-
-    return res;
-}
-
-
-// entropy
-
-double ent(std::vector<double>& x_vect) {
-    //
-    double res = 0;
-
-    // precal
-    double sum_hx = compute_sum_hx_vect(x_vect);
-
-    double pi;
-
-    for (unsigned i = 0; i < x_vect.size(); i++) {
-        pi = h(x_vect[i]) / sum_hx;
-        if (pi > 0) {
-            res -= pi * log(pi);
-        }
-    }
-    return res;
-}
-
-
-// ######
-// #
-// # DERIVATIVES
-// #
-// ######
-
-
-// likelihood
-
-
-double der_f_k(std::vector<double>& x_vect, std::vector<double>& m_vect, int kk) {
-    double res = 0;
-
-
-    // precal
-    double tmp_sum = compute_sum_hx_vect(x_vect);
-
-
-    for (int jj = 0; jj < static_cast<int>(x_vect.size()); jj++) {
-        int tmp_bool = (kk == jj);
-        double hx_j = h(x_vect[jj]);
-        double der_hx_k = der_h(x_vect[kk]);
-        double ckj = der_hx_k * (tmp_sum * tmp_bool - hx_j) / pow(tmp_sum, 2);
-        res += m_vect[jj] * tmp_sum * ckj / hx_j;
-    }
-
-    return res;
-}
-
-
-// entropy
-
-double der_ent_k(std::vector<double>& x_vect, int kk) {
-    double res = 0;
-
-    // precal
-    double tmp_sum = compute_sum_hx_vect(x_vect);
-
-
-    for (int jj = 0; jj < static_cast<int>(x_vect.size()); jj++) {
-        int tmp_bool = (kk == jj);
-        double hx_j = h(x_vect[jj]);
-        double der_hx_k = der_h(x_vect[kk]);
-        double ckj = der_hx_k * (tmp_sum * tmp_bool - hx_j) / pow(tmp_sum, 2);
-        if (hx_j > 0) {
-            res += -ckj * (1 + log(hx_j / tmp_sum));
-        }
-    }
-
-    return res;
-}
-
-
-// ######
-// #
-// # - f() + gamma * ent()
-// #
-// ######
-
-
-//
-
-double final_f(std::vector<double>& x_vect, std::vector<double>& m_vect, double gamma) {
-    return -f(x_vect, m_vect) + gamma * ent(x_vect);
-}
-
-
-//
-
-int final_der(std::vector<double>& x_vect, std::vector<double>& m_vect, double gamma,
-              std::vector<double>& res_vect) {
-    //
-    for (unsigned jj = 0; jj < res_vect.size(); jj++) {
-        res_vect[jj] = -der_f_k(x_vect, m_vect, jj) + gamma * der_ent_k(x_vect, jj);
-    }
-
-
-    return 0;
-}
-
-
-// ######
-// #
-// # GRADIENT
-// #
-// ######
-
-
-//
-
-double backtrackingLineSearch(std::vector<double>& x_vect, std::vector<double>& m_vect,
-                              std::vector<double>& der_vect, double new_fx, double gamma) {
-    //
-    double alpha = 0.1;
-    double beta = 0.5;
-
-    //
-    double t = 1;
-
-    //
-    vector<double> tmp_x_vect = alloc_vect(der_vect.size());
-
-    double res_a;
-    double res_b;
-
-    //
-    while (1) {
-        // x + t * ( - derX )
-        for (unsigned jj = 0; jj < tmp_x_vect.size(); jj++) {
-            tmp_x_vect[jj] = x_vect[jj] - t * der_vect[jj];
-        }
-
-        //
-        res_a = final_f(tmp_x_vect, m_vect, gamma);
-        res_b = new_fx + alpha * t * (-compute_dot(der_vect, der_vect));
-
-        // sortie normale
-        if (res_a <= res_b) {
-            break;
-        }
-
-        // maj
-        t *= beta;
-
-        // sortie anormale
-        if (t == 0) {
-            break;
-        }
-    }
-
-
-    return t;
-}
-
-
-//
-
-vector<double> gradient_descent(std::vector<double>& m_vect, double gamma) {
-    //
-    // vector <double> x_vect = alloc_vect( m_vect.size() );
-    vector<double> new_x_vect = alloc_vect(m_vect.size());
-    vector<double> der_vect = alloc_vect(m_vect.size());
-
-
-    // Generate Random Number for x_vect
-    vector<double> x_vect;
-    for (int i = 0; i < static_cast<int>(m_vect.size()); i++) {
-        x_vect.push_back(sin(rand()) * 5);
-    }
-
-    //
-    int n_iter = 0;
-    double new_fx = final_f(x_vect, m_vect, gamma);
-    double old_fx = 0;
-    double epsilon = 0;
-
-    // param
-    int n_iter_max = 1000;
-    double nu = pow(10, -4);
-
-
-    //
-    while (1) {
-        // gradient
-        final_der(x_vect, m_vect, gamma, der_vect);
-
-        // epsilon
-        epsilon = backtrackingLineSearch(x_vect, m_vect, der_vect, new_fx, gamma);
-
-        // maj x
-        for (unsigned jj = 0; jj < x_vect.size(); jj++) {
-            new_x_vect[jj] = x_vect[jj] - epsilon * der_vect[jj];
-        }
-        // maj fx
-        new_fx = final_f(new_x_vect, m_vect, gamma);
-
-        // sortie anormale
-        if (n_iter > 0 && new_fx > old_fx) {
-            break;
-        }
-
-        // sortie normale
-        if ((n_iter > 0 && abs((new_fx - old_fx) / old_fx) < nu * x_vect.size()) ||
-            (n_iter == n_iter_max)) {
-            break;
-        }
-
-        // maj
-        copy_vect(new_x_vect, x_vect);
-        n_iter += 1;
-        old_fx = new_fx;
-    }
-
-    //
-    // cout << "gradient_descent() : " << n_iter << " iterations" << endl;
-
-    //
-    return new_x_vect;
-}
-
-
-//
-
-vector<double> wrap_gradient_descent(std::vector<double>& m_vect, double gamma) {
-    //
-    vector<double> x0_vect = gradient_descent(m_vect, gamma);
-    vector<double> x1_vect = gradient_descent(m_vect, gamma);
-    vector<double> best_x_vect;
-
-    //
-    double fx0 = final_f(x0_vect, m_vect, gamma);
-    double fx1 = final_f(x1_vect, m_vect, gamma);
-
-    //
-    if (fx0 < fx1) {
-        best_x_vect = x0_vect;
-    } else {
-        best_x_vect = x1_vect;
-    }
-
-    //
-    // double best_ent = ent( best_x_vect );
-    // cout << "best_ent = "<< best_ent << endl;
-
-    //
-    vector<double> hx_vect = h_alloc(best_x_vect);
-    vector<double> res_vect = make_proba_alloc(hx_vect);
-
-    // prn_vec <double>( res_vect, " ");
-    // cout << endl;
-    // exit(0);
-
-    //
-    return res_vect;
-}
-
-
-// End Entropy Code
-
 string ConvertInt2String(int IntVal) {
     std::string S;
     std::stringstream out;
@@ -466,63 +51,6 @@ string ConvertDouble2String(double DblVal) {
 }
 
 
-double computeLogLik(std::vector<double>& m, std::vector<double>& p, double& lmbd) {
-    double Result = 0;
-    for (unsigned i = 0; i < p.size(); i++) {
-        if (p[i] != 0.00) {
-            Result += m[i] * log(p[i] * lmbd);
-        }
-    }
-
-    return (-lmbd + Result);
-}
-
-vector<double> multiplyVecWithVecCorsp(std::vector<double>& Vec1, std::vector<double>& Vec2) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec1.size(); i++) {
-        double Res = Vec1[i] * Vec2[i];
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
-vector<double> divideVecWithVecCorsp(std::vector<double>& Vec1, std::vector<double>& Vec2) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec1.size(); i++) {
-        double Res = Vec1[i] / Vec2[i];
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
-
-vector<double> divideVecWithScalar(std::vector<double>& Vec, double& theC) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec.size(); i++) {
-        double Res = Vec[i] / theC;
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
-
-vector<double> sparseM_vec_prod(vector<double>& p, std::vector<int>& rowId, std::vector<int>& colId,
-                                std::vector<double>& realVal) {
-    std::vector<double> Result;
-    Result.assign(p.size(), 0);
-
-    for (unsigned i = 0; i < rowId.size(); i++) {
-        // cout << realVal[i] << " " << p(colId[i]) << endl;
-        Result[rowId[i]] += realVal[i] * p[colId[i]];
-    }
-
-    return Result;
-}
-
-
 double getMainTagPropInit(std::vector<double>& arg) {
     double mainTagProp = 0;
 
@@ -564,74 +92,48 @@ vector<pair<int, int>> getIndexFromVector(std::vector<string>& nbNt, std::vector
 }
 
 
-vector<pair<int, int>> getIndexFromMap(std::vector<string>& nbNt, std::map<string, int>& m) {
+// Pair every neighbor found in the .prop file with its ordinal
+vector<pair<int, int>> getIndexFromOrd(const std::vector<int>& nbOrd) {
     vector<pair<int, int>> foundIndex;
+    foundIndex.reserve(nbOrd.size());
 
-    for (unsigned i = 0; i < nbNt.size(); i++) {
-        map<string, int>::iterator iter = m.find(nbNt[i]);
-
-        if (iter != m.end()) {
-            int j = iter->second;
-            pair<int, int> tuple = make_pair(i, j);
-            foundIndex.push_back(tuple);
+    for (unsigned i = 0; i < nbOrd.size(); i++) {
+        if (nbOrd[i] != TagIndex::npos) {
+            foundIndex.push_back(make_pair(i, nbOrd[i]));
         }
     }
 
     return foundIndex;
 }
 
-vector<double> getPropSum(std::vector<string>& neigb, map<string, double>& m) {
-    vector<double> propVec;
-
-    // Find value of a neigbours
-    // from the map, otherwise return zero
-
-    for (unsigned i = 0; i < neigb.size(); i++) {
-        map<string, double>::iterator iter = m.find(neigb[i]);
-        double value = 0;
-
-        if (iter != m.end()) {
-            value = m[neigb[i]];
-        }
-        propVec.push_back(value);
-        // cout << neigb[i] << " " << value << endl;
-    }
-
-
-    // Sum the vector in three-three
-    // Resulting vector = nofpos
-
+// Sum of the neighbor proportions at every position (three substitutions each)
+vector<double> getPropSum(const std::vector<int>& nbOrd, const std::vector<double>& tagProp) {
     vector<double> pSum;
-    int nofPos = neigb.size() / 3;
+    int nofPos = nbOrd.size() / 3;
+    pSum.reserve(nofPos);
+
     int b = 0;
     for (int k = 0; k < nofPos; k++) {
-        double output = propVec[b] + propVec[b + 1] + propVec[b + 2];
+        double output = 0.0;
+        for (int j = b; j < b + 3; j++) {
+            output += (nbOrd[j] != TagIndex::npos) ? tagProp[nbOrd[j]] : 0.0;
+        }
         pSum.push_back(output);
         b += 3;
     }
 
-
     return pSum;
 }
 
-vector<double> getNumTagProp(std::vector<string>& neigb, map<string, double>& m) {
+// Proportion of every neighbor, zero if it is not in the .prop file
+vector<double> getNumTagProp(const std::vector<int>& nbOrd, const std::vector<double>& tagProp) {
     vector<double> propVec;
+    propVec.reserve(nbOrd.size());
 
-    // Find value of a neigbours
-    // from the map, otherwise return zero
-
-    for (unsigned i = 0; i < neigb.size(); i++) {
-        map<string, double>::iterator iter = m.find(neigb[i]);
-        double value = 0;
-
-        if (iter != m.end()) {
-            value = m[neigb[i]];
-        }
-        propVec.push_back(value);
-        // cout << neigb[i] << " " << value << endl;
+    for (unsigned i = 0; i < nbOrd.size(); i++) {
+        propVec.push_back((nbOrd[i] != TagIndex::npos) ? tagProp[nbOrd[i]] : 0.0);
     }
 
-
     return propVec;
 }
 
@@ -643,19 +145,6 @@ vector<double> getNumTagProp(std::vector<string>& neigb, map<string, double>& m)
  * =====================================================================================
  */
 
-struct sort_pred {
-    // for sorting Vector of Vector. Only  based on first->second ascendingly
-    bool operator()(const std::vector<int>& fs, const std::vector<int>& sc) { return fs < sc; }
-};
-
-struct sort_pred_double {
-    // for sorting Vector of Vector. Only  based on second->first ascendingly
-    bool operator()(const std::vector<double>& lhs, const std::vector<double>& rhs) {
-        return (lhs[1] < rhs[1] || (rhs[0] == lhs[0] && lhs[1] < rhs[1]));
-    }
-};
-
-
 struct strCmp {
     bool operator()(const char* s1, const char* s2) const { return strcmp(s1, s2) < 0; }
 };
@@ -669,32 +158,32 @@ struct strCmp {
  */
 
 int main(int arg_count, char* arg_vec[]) {
-    if (arg_count != 3) {
-        cerr << "Expected two argument inputfile and beta" << endl;
+    // Optional third argument picks the M-step solver: lbfgs (default,
+    // deterministic, warm-started) or gd (the original random-start descent)
+    string optimizerName = (arg_count == 4) ? arg_vec[3] : "lbfgs";
+    unique_ptr<EntropyOptimizer> optimizer = MakeEntropyOptimizer(optimizerName);
+    if (arg_count < 3 || arg_count > 4 || !optimizer) {
+        cerr << "Expected two argument inputfile and beta, optionally followed by lbfgs or gd"
+             << endl;
         return EXIT_FAILURE;
     }
     srand(time(0));
     /*
        Final Output Variables (Sparse)
-       RA -> Vector with real value
-       JA -> Vector with colum index
-       IA -> Vector with row index
+       A  -> read-error matrix, one row per tag (CSR)
+       At -> its transpose, i.e. A in CSC form
     */
 
-    vector<double> RA;
-    vector<int> JA;
-    vector<int> IA;
+    CsrMatrix A;
+    CsrMatrix At;
     vector<string> ordNumTags;
-    map<string, int> ordNumTagsMap;
+    TagIndex tagIndex;
 
-    vector<vector<int>> accumIndexInOrd;
-    vector<vector<int>> accumIndexIA;
-    vector<vector<double>> accumIndexRA;
     vector<double> rawCount;  // raw count container
     vector<string> Tags;
 
-    // Store Prop File as Hash
-    map<string, double> theMap;
+    // Proportion of every tag in the .prop file, by ordinal
+    vector<double> tagProp;
     string line;
     string qualFileName = arg_vec[1];
     string baseName = GetBaseNameFromFilename(qualFileName);
@@ -703,257 +192,196 @@ int main(int arg_count, char* arg_vec[]) {
     string nbFileName = pathName + baseName + ".nb";
     string propFileName = pathName + baseName + ".prop";
     string nbQualFileName = pathName + baseName + ".nbq";
+    string nbmFileName = pathName + baseName + ".nbm";
 
 
     double beta = static_cast<double>(atof(arg_vec[2]));
 
 
-    ifstream propfile(propFileName.c_str());
-
-    int numberOfSeq = 0;
-    int ordId = 0;
-
-    if (propfile.is_open()) {
-        while (getline(propfile, line)) {
-            numberOfSeq++;
-            stringstream ss(line);
-            string numTag;
-            double prop;
-
-            ss >> numTag >> prop;
-            // cout << numTag << "\t" << prop << endl;
-            theMap.insert(make_pair(numTag, prop));
-            JA.push_back(numberOfSeq - 1);
-            ordNumTagsMap.insert(make_pair(numTag, ordId++));
-        }
-        propfile.close();
-
+    int lineno_ = 0;
 
+    // A binary matrix written by FindNeighboursWithQual --nbm replaces
+    // the text parsing below, unless it is left over from an earlier run
+    NeighborMatrixFile nbmFile;
+    if (nbmFile.openIfCurrent(nbmFileName, nbFileName, qualFileName)) {
+        nbmFile.toCsr(A, Tags, rawCount);
+        lineno_ = static_cast<int>(nbmFile.numTags());
+        nbmFile.close();
     } else {
-        cout << "Unable to open input file\n";
-    };
-
-
-    // for( map<const string, int, strCmp>::iterator iter = ordNumTagsMap.begin(); iter !=
-    // ordNumTagsMap.end(); ++iter) {
-    //      cout << (*iter).first << " - " << (*iter).second << endl;
-    // }
-
-    // Initialize IA first column
-    // it's the same with JA
-    IA = JA;
-
-    // Begin iterating the neigbours file and quality file, then find
-    // estimated error mean
-
-    ifstream nbfile(nbFileName.c_str());
-    ifstream qlfile(qualFileName.c_str());
-    ifstream nbqfile(nbQualFileName.c_str());
-
-    string nbline;
-    string qlline;
-    string nbqline;
+        ifstream propfile(propFileName.c_str());
+
+        int numberOfSeq = 0;
+        int ordId = 0;
+
+        if (propfile.is_open()) {
+            while (getline(propfile, line)) {
+                numberOfSeq++;
+                stringstream ss(line);
+                string numTag;
+                double prop;
+
+                ss >> numTag >> prop;
+                // cout << numTag << "\t" << prop << endl;
+                tagProp.push_back(prop);
+                tagIndex.insert(numTag, ordId++);
+            }
+            propfile.close();
 
-    int lineno = 0;
-    int lineno_ = 0;
 
-    // std::clock_t startTime = std::clock();
+        } else {
+            cout << "Unable to open input file\n";
+        };
 
-    if (nbfile.is_open() && qlfile.is_open() && nbqfile.is_open()) {
-        while (getline(nbfile, nbline) && getline(qlfile, qlline) && getline(nbqfile, nbqline)) {
-            stringstream sn(nbline);
 
-            // Parsing Neighbors File
-            string numTagd;
-            string numTags;
-            string numTagnb;
-            vector<string> nbnumTags;
+        // for( map<const string, int, strCmp>::iterator iter = ordNumTagsMap.begin(); iter !=
+        // ordNumTagsMap.end(); ++iter) {
+        //      cout << (*iter).first << " - " << (*iter).second << endl;
+        // }
 
-            sn >> numTags >> numTagd;
-            Tags.push_back(numTags);
-            string numTag = numTagd;
+        // Rows arrive in tag order, so the CSR arrays are filled directly
+        SparseMatrixBuilder builder(numberOfSeq);
 
-            while (sn >> numTagd) {
-                nbnumTags.push_back(numTagd);
-            }
+        // Begin iterating the neigbours file and quality file, then find
+        // estimated error mean
 
+        ifstream nbfile(nbFileName.c_str());
+        ifstream qlfile(qualFileName.c_str());
+        ifstream nbqfile(nbQualFileName.c_str());
 
-            // Parsing Quality File
-            stringstream sq(qlline);
-            double tableEntry;
-            sq >> tableEntry;
-            double observedCount = tableEntry;
+        string nbline;
+        string qlline;
+        string nbqline;
 
 
-            // Parsing Neighbourhood Quality file
-            stringstream sp(nbqline);
-            string Tagsq;
-            string numTagq;
-            double numTagProp;
-            vector<double> nbnumTagsProp;
+        // std::clock_t startTime = std::clock();
 
-            sp >> Tagsq >> numTagq;
+        if (nbfile.is_open() && qlfile.is_open() && nbqfile.is_open()) {
+            while (getline(nbfile, nbline) && getline(qlfile, qlline) && getline(nbqfile, nbqline)) {
+                stringstream sn(nbline);
 
-            while (sp >> numTagProp) {
-                nbnumTagsProp.push_back(numTagProp);
-            }
+                // Parsing Neighbors File
+                string numTagd;
+                string numTags;
+                string numTagnb;
+                vector<string> nbnumTags;
 
+                sn >> numTags >> numTagd;
+                Tags.push_back(numTags);
+                string numTag = numTagd;
 
-            //
-            // Begin computing Rtags.A
-            //
+                while (sn >> numTagd) {
+                    nbnumTags.push_back(numTagd);
+                }
 
-            vector<double> propSum = getPropSum(nbnumTags, theMap);
-            vector<double> propOfNumTag = getNumTagProp(nbnumTags, theMap);
-            double MainTagProp = getMainTagPropInit(nbnumTagsProp);
 
-            vector<double> rTagsQual;
-            rTagsQual.reserve(nbnumTagsProp.size());
+                // Parsing Quality File
+                stringstream sq(qlline);
+                double tableEntry;
+                sq >> tableEntry;
+                double observedCount = tableEntry;
 
-            // Find Error Mean
-            int groupIndex = 0;
-            for (unsigned x = 0; x < propSum.size(); x += 1) {
-                double rTagsQual1 =
-                    nbnumTagsProp[groupIndex] * propOfNumTag[groupIndex] / propSum[x];
-                double rTagsQual2 =
-                    nbnumTagsProp[groupIndex + 1] * propOfNumTag[groupIndex + 1] / propSum[x];
-                double rTagsQual3 =
-                    nbnumTagsProp[groupIndex + 2] * propOfNumTag[groupIndex + 2] / propSum[x];
 
-                if (isnan(rTagsQual1)) {
-                    rTagsQual1 = 0;
-                }
+                // Parsing Neighbourhood Quality file
+                stringstream sp(nbqline);
+                string Tagsq;
+                string numTagq;
+                double numTagProp;
+                vector<double> nbnumTagsProp;
 
-                if (isnan(rTagsQual2)) {
-                    rTagsQual2 = 0;
-                }
+                sp >> Tagsq >> numTagq;
 
-                if (isnan(rTagsQual3)) {
-                    rTagsQual3 = 0;
+                while (sp >> numTagProp) {
+                    nbnumTagsProp.push_back(numTagProp);
                 }
 
-                rTagsQual.push_back(rTagsQual1);
-                rTagsQual.push_back(rTagsQual2);
-                rTagsQual.push_back(rTagsQual3);
 
-                groupIndex += 3;
-            }
+                //
+                // Begin computing Rtags.A
+                //
 
-            MainTagProp = getMainTagPropMeanScaled(rTagsQual);
-            vector<pair<int, int>> indexInOrd = getIndexFromMap(nbnumTags, ordNumTagsMap);
-
-            vector<vector<int>> indexInOrdLineNo;
-            for (unsigned k = 0; k < indexInOrd.size(); k++) {
-                pair<int, int> tpl = indexInOrd[k];
-                // cout << tpl.first << "-" << tpl.second << endl;
-                vector<int> temp;
-                temp.push_back(tpl.first);
-                temp.push_back(lineno++);
-                temp.push_back(tpl.second);
-                indexInOrdLineNo.push_back(temp);
-            }
+                // Resolve every neighbor once; absent ones get TagIndex::npos
+                vector<int> nbOrd;
+                tagIndex.findAll(nbnumTags, nbOrd);
 
-            // printf("%.7f\t", MainTagProp);
-            // prn_vec<double>(rTagsQual,"\t");
-            // cout << endl;
+                vector<double> propSum = getPropSum(nbOrd, tagProp);
+                vector<double> propOfNumTag = getNumTagProp(nbOrd, tagProp);
+                double MainTagProp = getMainTagPropInit(nbnumTagsProp);
 
-            accumIndexInOrd.insert(accumIndexInOrd.end(), indexInOrdLineNo.begin(),
-                                   indexInOrdLineNo.end());
+                vector<double> rTagsQual;
+                rTagsQual.reserve(nbnumTagsProp.size());
 
-            int tln = lineno_++;
+                // Find Error Mean
+                int groupIndex = 0;
+                for (unsigned x = 0; x < propSum.size(); x += 1) {
+                    double rTagsQual1 =
+                        nbnumTagsProp[groupIndex] * propOfNumTag[groupIndex] / propSum[x];
+                    double rTagsQual2 =
+                        nbnumTagsProp[groupIndex + 1] * propOfNumTag[groupIndex + 1] / propSum[x];
+                    double rTagsQual3 =
+                        nbnumTagsProp[groupIndex + 2] * propOfNumTag[groupIndex + 2] / propSum[x];
 
-            RA.push_back(MainTagProp);
-            rawCount.push_back(double(observedCount));
+                    if (isnan(rTagsQual1)) {
+                        rTagsQual1 = 0;
+                    }
 
-            // For IA and RA
-            vector<vector<int>> forIA;
-            vector<vector<double>> forRA;
+                    if (isnan(rTagsQual2)) {
+                        rTagsQual2 = 0;
+                    }
 
-            for (unsigned n = 0; n < rTagsQual.size(); n++) {
-                vector<int> temp2;
-                vector<double> temp3;
+                    if (isnan(rTagsQual3)) {
+                        rTagsQual3 = 0;
+                    }
 
-                if (rTagsQual[n] > 0) {
-                    // cout << rTagsQual[n] << "-" << tln << "-" << n+1 << " ";
-                    temp2.push_back(n + 1);
-                    temp2.push_back(tln);
-                    forIA.push_back(temp2);
+                    rTagsQual.push_back(rTagsQual1);
+                    rTagsQual.push_back(rTagsQual2);
+                    rTagsQual.push_back(rTagsQual3);
 
-                    temp3.push_back(double(tln));
-                    temp3.push_back(double(n + 1));
-                    temp3.push_back(rTagsQual[n]);
-                    forRA.push_back(temp3);
+                    groupIndex += 3;
                 }
-            }
-
-            accumIndexIA.insert(accumIndexIA.end(), forIA.begin(), forIA.end());
-            accumIndexRA.insert(accumIndexRA.end(), forRA.begin(), forRA.end());
-
 
-            // cout << " ------- " <<endl;
-        }
-        nbfile.close();
-        qlfile.close();
-        nbqfile.close();
-    } else {
-        cout << "One of the three files NB,QL, and NBQ cannot be open\n";
-    }
-
-
-    // cerr << "# CPU time for parsing two files: " << (clock() - startTime + 0.0) / CLOCKS_PER_SEC
-    //     << " seconds\n";
+                MainTagProp = getMainTagPropMeanScaled(rTagsQual);
+                vector<pair<int, int>> indexInOrd = getIndexFromOrd(nbOrd);
 
+                int tln = lineno_++;
+                rawCount.push_back(double(observedCount));
 
-    /*
-     Here we extract show all the sparse matrix param (RA,JA,IA);
-     Then convert them into the standard SparseMatrix
-    */
+                // Diagonal first, then every neighbor present in the .prop file
+                builder.addEntry(tln, MainTagProp);
+                for (unsigned k = 0; k < indexInOrd.size(); k++) {
+                    double rTagQual = rTagsQual[indexInOrd[k].first];
+                    if (rTagQual > 0) {
+                        builder.addEntry(indexInOrd[k].second, rTagQual);
+                    }
+                }
+                builder.endRow();
 
-    // std::clock_t startSparseTime = std::clock();
 
-    // cout << "DIM " << lineno_ << "x" << lineno_ << endl;
-    // cout << "RAW COUNT ";
-    // prn_vec_err<double>(rawCount,",");
-    // cout << rawCount.size();
-    // cout << endl;
+                // cout << " ------- " <<endl;
+            }
+            nbfile.close();
+            qlfile.close();
+            nbqfile.close();
+        } else {
+            cout << "One of the three files NB,QL, and NBQ cannot be open\n";
+        }
 
-    // Print and keep RA
-    std::stable_sort(accumIndexRA.begin(), accumIndexRA.end(), sort_pred_double());
-    for (unsigned z = 0; z < accumIndexRA.size(); z++) {
-        vector<double> dbtriplet = accumIndexRA[z];
-        // cout << "\t" << dbtriplet[0] << "\t" << dbtriplet[1] << "\t" << dbtriplet[2] <<  endl;
-        RA.push_back(dbtriplet[2]);
-    }
 
+        // cerr << "# CPU time for parsing two files: " << (clock() - startTime + 0.0) / CLOCKS_PER_SEC
+        //     << " seconds\n";
 
-    // Print and Keep IA
-    std::sort(accumIndexIA.begin(), accumIndexIA.end(), sort_pred());
-    for (unsigned y = 0; y < accumIndexIA.size(); y++) {
-        vector<int> duplet = accumIndexIA[y];
-        IA.push_back(duplet[1]);
-    }
 
+        // Every .nb line is a row and every .prop line a column; the two
+        // files must come from the same input
+        if (builder.hasRejectedEntries() ||
+            builder.numRows() != static_cast<size_t>(numberOfSeq)) {
+            cerr << "Error: unequal dimension sizes in sparse matrix" << endl;
+            exit(EXIT_FAILURE);
+        }
 
-    // Print and Keep JA
-    std::sort(accumIndexInOrd.begin(), accumIndexInOrd.end(), sort_pred());
-    for (unsigned k = 0; k < accumIndexInOrd.size(); k++) {
-        vector<int> triplet = accumIndexInOrd[k];
-        JA.push_back(triplet[2]);
+        A = builder.finish();
     }
 
-    if (RA.size() != IA.size() || IA.size() != JA.size()) {
-        cerr << "RA : ";
-        // prn_vec_err<double>(RA, " ");
-        cerr << RA.size() << endl;
-        cerr << "IA : ";
-        // prn_vec_err<int>(IA, " ");
-        cerr << IA.size() << endl;
-        cerr << "JA : ";
-        // prn_vec_err<int>(JA," ");
-        cerr << JA.size() << endl;
-        cerr << "Error: unequal dimension sizes in sparse matrix" << endl;
-        exit(EXIT_FAILURE);
-    }
+    At = TransposeCsr(A);
 
 
     // cerr << "# CPU time for storing and sorting SparseM: " << (clock() - startSparseTime + 0.0) /
@@ -973,38 +401,21 @@ int main(int arg_count, char* arg_vec[]) {
     double lambda = double(lineno_);
     int maxStep = 50;
 
-    vector<double> nCount = rawCount;
+    EmEngine em(A, At, rawCount);
     vector<double> theM = rawCount;
     double temp_loglik = 0;
 
-    for (int m = 0; m < maxStep; m++) {
-        vector<double> theP;
-        vector<double> theP_temp;
-        vector<double> sparseM_prod_P;
-        vector<double> rSums;
-        vector<double> tsparseM_prod_rSums;
-        double logLik;
-
+    // Every M-step starts from the previous one's solution
+    vector<double> theX = EntropyStartingPoint(theM);
 
+    for (int m = 0; m < maxStep; m++) {
         // M-Step
-        theP = divideVecWithScalar(theM, lambda);
-
-        // Print M to a temporary vector
-
-        vector<double> thePnew = wrap_gradient_descent(theM, beta);
-
-        // Assinged the New Estimated P
-        theP = thePnew;
-
-        // E-Step
-        sparseM_prod_P = sparseM_vec_prod(theP, IA, JA, RA);
-        rSums = divideVecWithVecCorsp(nCount, sparseM_prod_P);
-        tsparseM_prod_rSums = sparseM_vec_prod(rSums, JA, IA, RA);
-        theM = multiplyVecWithVecCorsp(theP, tsparseM_prod_rSums);
-
+        EntropyObjective objective(theM, beta);
+        optimizer->minimize(objective, theX);
+        vector<double> theP = EntropyObjective::proportions(theX);
 
-        // Compute Loglik
-        logLik = computeLogLik(theM, theP, lambda);
+        // E-Step and Loglik
+        double logLik = em.stepWithP(theP, theM, lambda);
         double diff_loglik = logLik - temp_loglik;
         temp_loglik = logLik;
 
@@ -3,6 +3,11 @@
 // Copyright 2009, Edward Wijaya
 // =====================================================================================
 
+#include "ConnectedComponents.hh"
+#include "LikelihoodRatio.hh"
+#include "NeighborMatrixFile.hh"
+#include "SparseMatrixBuilder.hh"
+#include "TagIndex.hh"
 #include "Utilities.hh"
 
 #include <algorithm>
@@ -16,6 +21,7 @@
 #include <vector>
 
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>  // strcmp()
@@ -40,52 +46,6 @@ double computeLogLikdebug(std::vector<double>& m, std::vector<double>& p, double
     return (-lmbd + Result);
 }
 
-// Optimized: pass by const reference
-double computeLogLik(const std::vector<double>& m, const std::vector<double>& p,
-                     const double& lmbd) {
-    double Result = 0.0;
-    double pjtotfree = 0.0;
-    for (unsigned i = 0; i < p.size(); i++) {
-        if (p[i] != 0.00) {
-            double temp = m[i] * (log(p[i] * lmbd));
-            pjtotfree += p[i];
-            // cout << "Free " << i << "\t"  <<   m[i] << "\t"  << fixed << setprecision(5)  << p[i]
-            // << "\t" << lmbd <<  "\t" << temp << endl;
-            Result += temp;
-        }
-    }
-
-    // cout << "PJTOTFREE = " <<  pjtotfree << endl;
-
-
-    return (-lmbd + Result);
-}
-
-double relative_diff_loglik(double& x, double& y) {
-    double res = 0;
-    res = abs(x - y) / max(abs(x), abs(y));
-
-    return res;
-}
-
-// Optimized: pass by const reference, reserve space, use multiplication
-vector<double> normalizeP(const std::vector<double>& pn) {
-    double tot = 0.0;
-    for (unsigned i = 0; i < pn.size(); i++) {
-        tot += pn[i];
-    }
-
-    vector<double> nVec;
-    nVec.reserve(pn.size());  // Pre-allocate
-
-    const double inv_tot = 1.0 / tot;  // Multiply is faster than divide
-    for (unsigned j = 0; j < pn.size(); j++) {
-        nVec.push_back(pn[j] * inv_tot);
-    }
-
-    return nVec;
-}
-
 /*--------------------------------------------------
  * double computeLogLik(std::vector <double> &m, std::vector <double> &p, double &lmbd) {
  *
@@ -108,17 +68,6 @@ vector<double> normalizeP(const std::vector<double>& pn) {
  * }
  *
  *--------------------------------------------------*/
-vector<double> multiplyVecWithVecCorsp(std::vector<double>& Vec1, std::vector<double>& Vec2) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec1.size(); i++) {
-        double Res = Vec1[i] * Vec2[i];
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
-
 vector<double> multiplyVecWithVecCorspDebug(std::vector<double>& Vec1, std::vector<double>& Vec2) {
     vector<double> Result;
 
@@ -131,17 +80,6 @@ vector<double> multiplyVecWithVecCorspDebug(std::vector<double>& Vec1, std::vect
     return Result;
 }
 
-vector<double> divideVecWithVecCorsp(std::vector<double>& Vec1, std::vector<double>& Vec2) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec1.size(); i++) {
-        double Res = Vec1[i] / Vec2[i];
-        // cout << Vec1[i] << " - " << Vec2[i] << "\tRes : " << Res << endl;
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
 vector<double> divideVecWithVecCorspDebug(std::vector<double>& Vec1, std::vector<double>& Vec2) {
     vector<double> Result;
 
@@ -154,16 +92,6 @@ vector<double> divideVecWithVecCorspDebug(std::vector<double>& Vec1, std::vector
     return Result;
 }
 
-vector<double> divideVecWithScalar(std::vector<double>& Vec, double& theC) {
-    vector<double> Result;
-
-    for (unsigned i = 0; i < Vec.size(); i++) {
-        double Res = Vec[i] / theC;
-        Result.push_back(Res);
-    }
-
-    return Result;
-}
 vector<double> divideVecWithScalarDebug(std::vector<double>& Vec, double& theC) {
     vector<double> Result;
 
@@ -204,21 +132,6 @@ vector<double> sparseM_vec_prodDebugSPSM(vector<double>& p, std::vector<int>& ro
     return Result;
 }
 
-vector<double> sparseM_vec_prod(vector<double>& p, std::vector<int>& rowId, std::vector<int>& colId,
-                                std::vector<double>& realVal) {
-    std::vector<double> Result;
-    Result.assign(p.size(), 0.00);
-
-    for (unsigned i = 0; i < rowId.size(); i++) {
-        // cout << realVal[i] << " " << p(colId[i]) << endl;
-
-        Result[rowId[i]] += realVal[i] * p[colId[i]];
-    }
-
-    return Result;
-}
-
-
 double getMainTagPropInit(std::vector<double>& arg) {
     double mainTagProp = 0;
 
@@ -260,74 +173,48 @@ vector<pair<int, int>> getIndexFromVector(std::vector<string>& nbNt, std::vector
 }
 
 
-vector<pair<int, int>> getIndexFromMap(std::vector<string>& nbNt, std::map<string, int>& m) {
+// Pair every neighbor found in the .prop file with its ordinal
+vector<pair<int, int>> getIndexFromOrd(const std::vector<int>& nbOrd) {
     vector<pair<int, int>> foundIndex;
+    foundIndex.reserve(nbOrd.size());
 
-    for (unsigned i = 0; i < nbNt.size(); i++) {
-        map<string, int>::iterator iter = m.find(nbNt[i]);
-
-        if (iter != m.end()) {
-            int j = iter->second;
-            pair<int, int> tuple = make_pair(i, j);
-            foundIndex.push_back(tuple);
+    for (unsigned i = 0; i < nbOrd.size(); i++) {
+        if (nbOrd[i] != TagIndex::npos) {
+            foundIndex.push_back(make_pair(i, nbOrd[i]));
         }
     }
 
     return foundIndex;
 }
 
-vector<double> getPropSum(std::vector<string>& neigb, map<string, double>& m) {
-    vector<double> propVec;
-
-    // Find value of a neigbours
-    // from the map, otherwise return zero
-
-    for (unsigned i = 0; i < neigb.size(); i++) {
-        map<string, double>::iterator iter = m.find(neigb[i]);
-        double value = 0;
-
-        if (iter != m.end()) {
-            value = m[neigb[i]];
-        }
-        propVec.push_back(value);
-        // cout << neigb[i] << " " << value << endl;
-    }
-
-
-    // Sum the vector in three-three
-    // Resulting vector = nofpos
-
+// Sum of the neighbor proportions at every position (three substitutions each)
+vector<double> getPropSum(const std::vector<int>& nbOrd, const std::vector<double>& tagProp) {
     vector<double> pSum;
-    int nofPos = neigb.size() / 3;
+    int nofPos = nbOrd.size() / 3;
+    pSum.reserve(nofPos);
+
     int b = 0;
     for (int k = 0; k < nofPos; k++) {
-        double output = propVec[b] + propVec[b + 1] + propVec[b + 2];
+        double output = 0.0;
+        for (int j = b; j < b + 3; j++) {
+            output += (nbOrd[j] != TagIndex::npos) ? tagProp[nbOrd[j]] : 0.0;
+        }
         pSum.push_back(output);
         b += 3;
     }
 
-
     return pSum;
 }
 
-vector<double> getNumTagProp(std::vector<string>& neigb, map<string, double>& m) {
+// Proportion of every neighbor, zero if it is not in the .prop file
+vector<double> getNumTagProp(const std::vector<int>& nbOrd, const std::vector<double>& tagProp) {
     vector<double> propVec;
+    propVec.reserve(nbOrd.size());
 
-    // Find value of a neigbours
-    // from the map, otherwise return zero
-
-    for (unsigned i = 0; i < neigb.size(); i++) {
-        map<string, double>::iterator iter = m.find(neigb[i]);
-        double value = 0;
-
-        if (iter != m.end()) {
-            value = m[neigb[i]];
-        }
-        propVec.push_back(value);
-        // cout << neigb[i] << " " << value << endl;
+    for (unsigned i = 0; i < nbOrd.size(); i++) {
+        propVec.push_back((nbOrd[i] != TagIndex::npos) ? tagProp[nbOrd[i]] : 0.0);
     }
 
-
     return propVec;
 }
 
@@ -339,19 +226,6 @@ vector<double> getNumTagProp(std::vector<string>& neigb, map<string, double>& m)
  * =====================================================================================
  */
 
-struct sort_pred {
-    // for sorting Vector of Vector. Only  based on first->second ascendingly
-    bool operator()(const std::vector<int>& fs, const std::vector<int>& sc) { return fs < sc; }
-};
-
-struct sort_pred_double {
-    // for sorting Vector of Vector. Only  based on second->first ascendingly
-    bool operator()(const std::vector<double>& lhs, const std::vector<double>& rhs) {
-        return (lhs[1] < rhs[1] || (rhs[0] == lhs[0] && lhs[1] < rhs[1]));
-    }
-};
-
-
 struct strCmp {
     bool operator()(const char* s1, const char* s2) const { return strcmp(s1, s2) < 0; }
 };
@@ -365,32 +239,47 @@ struct strCmp {
  */
 
 int main(int arg_count, char* arg_vec[]) {
-    if (arg_count != 2) {
-        cerr << "Expected one argument" << endl;
+    // --ccomp:     solve every connected component of the neighbor graph separately
+    // --warm:      start every clamped EM from the free solution, update locally
+    // --converged: restart every clamped EM, but run it to convergence; the
+    //              reference that --warm is checked against
+    bool ccomp = false;
+    LikelihoodRatioOptions options;
+    bool badArgs = (arg_count < 2);
+    for (int a = 2; a < arg_count; a++) {
+        if (strcmp(arg_vec[a], "--ccomp") == 0) {
+            ccomp = true;
+        } else if (strcmp(arg_vec[a], "--warm") == 0 && options.start == ClampedStart::Restart) {
+            options.start = ClampedStart::WarmStart;
+        } else if (strcmp(arg_vec[a], "--converged") == 0 &&
+                   options.start == ClampedStart::Restart) {
+            options.start = ClampedStart::ConvergedRestart;
+        } else {
+            badArgs = true;
+        }
+    }
+    if (badArgs) {
+        cerr << "Usage: EstimateTrueCount_llratio FileName [--ccomp] [--warm | --converged]"
+             << endl;
         return EXIT_FAILURE;
     }
 
     /*
        Final Output Variables (Sparse)
-       RA -> Vector with real value
-       JA -> Vector with colum index
-       IA -> Vector with row index
+       A  -> read-error matrix, one row per tag (CSR)
+       At -> its transpose, i.e. A in CSC form
     */
 
-    vector<double> RA;
-    vector<int> JA;
-    vector<int> IA;
+    CsrMatrix A;
+    CsrMatrix At;
     vector<string> ordNumTags;
-    map<string, int> ordNumTagsMap;
+    TagIndex tagIndex;
 
-    vector<vector<int>> accumIndexInOrd;
-    vector<vector<int>> accumIndexIA;
-    vector<vector<double>> accumIndexRA;
     vector<double> rawCount;  // raw count container
     vector<string> Tags;
 
-    // Store Prop File as Hash
-    map<string, double> theMap;
+    // Proportion of every tag in the .prop file, by ordinal
+    vector<double> tagProp;
     string line;
     string qualFileName = arg_vec[1];
     string baseName = GetBaseNameFromFilename(qualFileName);
@@ -399,456 +288,248 @@ int main(int arg_count, char* arg_vec[]) {
     string nbFileName = pathName + baseName + ".nb";
     string propFileName = pathName + baseName + ".prop";
     string nbQualFileName = pathName + baseName + ".nbq";
+    string nbmFileName = pathName + baseName + ".nbm";
     // cout << propFileName << endl;
 
-    ifstream propfile(propFileName.c_str());
-
-    int numberOfSeq = 0;
-    int ordId = 0;
-    vector<double> Pinit;
-
-    if (propfile.is_open()) {
-        while (getline(propfile, line)) {
-            numberOfSeq++;
-            stringstream ss(line);
-            string numTag;
-            double prop;
-
-            ss >> numTag >> prop;
-            // cout << numTag << "\t" << prop << endl;
-            theMap.insert(make_pair(numTag, prop));
-            JA.push_back(numberOfSeq - 1);
-            Pinit.push_back(prop);
-            ordNumTagsMap.insert(make_pair(numTag, ordId++));
-        }
-        propfile.close();
-
+    int lineno_ = 0;
 
+    // A binary matrix written by FindNeighboursWithQual --nbm replaces
+    // the text parsing below, unless it is left over from an earlier run
+    NeighborMatrixFile nbmFile;
+    if (nbmFile.openIfCurrent(nbmFileName, nbFileName, qualFileName)) {
+        nbmFile.toCsr(A, Tags, rawCount);
+        lineno_ = static_cast<int>(nbmFile.numTags());
+        nbmFile.close();
     } else {
-        cout << "Unable to open input file\n";
-    };
-
-
-    // for( map<const string, int, strCmp>::iterator iter = ordNumTagsMap.begin(); iter !=
-    // ordNumTagsMap.end(); ++iter) {
-    //      cout << (*iter).first << " - " << (*iter).second << endl;
-    // }
-
-    // Initialize IA first column
-    // it's the same with JA
-    IA = JA;
+        ifstream propfile(propFileName.c_str());
+
+        int numberOfSeq = 0;
+        int ordId = 0;
+        vector<double> Pinit;
+
+        if (propfile.is_open()) {
+            while (getline(propfile, line)) {
+                numberOfSeq++;
+                stringstream ss(line);
+                string numTag;
+                double prop;
+
+                ss >> numTag >> prop;
+                // cout << numTag << "\t" << prop << endl;
+                tagProp.push_back(prop);
+                Pinit.push_back(prop);
+                tagIndex.insert(numTag, ordId++);
+            }
+            propfile.close();
 
-    // Begin iterating the neigbours file and quality file, then find
-    // estimated error mean
 
-    ifstream nbfile(nbFileName.c_str());
-    ifstream qlfile(qualFileName.c_str());
-    ifstream nbqfile(nbQualFileName.c_str());
+        } else {
+            cout << "Unable to open input file\n";
+        };
 
-    string nbline;
-    string qlline;
-    string nbqline;
 
-    int lineno = 0;
-    int lineno_ = 0;
+        // for( map<const string, int, strCmp>::iterator iter = ordNumTagsMap.begin(); iter !=
+        // ordNumTagsMap.end(); ++iter) {
+        //      cout << (*iter).first << " - " << (*iter).second << endl;
+        // }
 
-    // std::clock_t startTime = std::clock();
+        // Rows arrive in tag order, so the CSR arrays are filled directly
+        SparseMatrixBuilder builder(numberOfSeq);
 
-    if (nbfile.is_open() && qlfile.is_open() && nbqfile.is_open()) {
-        while (getline(nbfile, nbline) && getline(qlfile, qlline) && getline(nbqfile, nbqline)) {
-            stringstream sn(nbline);
+        // Begin iterating the neigbours file and quality file, then find
+        // estimated error mean
 
-            // Parsing Neighbors File
-            string numTagd;
-            string numTags;
-            string numTagnb;
-            vector<string> nbnumTags;
+        ifstream nbfile(nbFileName.c_str());
+        ifstream qlfile(qualFileName.c_str());
+        ifstream nbqfile(nbQualFileName.c_str());
 
-            sn >> numTags >> numTagd;
-            Tags.push_back(numTags);
-            string numTag = numTagd;
-
-            while (sn >> numTagd) {
-                nbnumTags.push_back(numTagd);
-            }
+        string nbline;
+        string qlline;
+        string nbqline;
 
 
-            // Parsing Quality File
-            stringstream sq(qlline);
-            double tableEntry;
-            sq >> tableEntry;
-            double observedCount = tableEntry;
+        // std::clock_t startTime = std::clock();
 
+        if (nbfile.is_open() && qlfile.is_open() && nbqfile.is_open()) {
+            while (getline(nbfile, nbline) && getline(qlfile, qlline) && getline(nbqfile, nbqline)) {
+                stringstream sn(nbline);
 
-            // Parsing Neighbourhood Quality file
-            stringstream sp(nbqline);
-            string Tagsq;
-            string numTagq;
-            double numTagProp;
-            vector<double> nbnumTagsProp;
+                // Parsing Neighbors File
+                string numTagd;
+                string numTags;
+                string numTagnb;
+                vector<string> nbnumTags;
 
-            sp >> Tagsq >> numTagq;
+                sn >> numTags >> numTagd;
+                Tags.push_back(numTags);
+                string numTag = numTagd;
 
-            while (sp >> numTagProp) {
-                nbnumTagsProp.push_back(numTagProp);
-            }
+                while (sn >> numTagd) {
+                    nbnumTags.push_back(numTagd);
+                }
 
 
-            //
-            // Begin computing Rtags.A
-            //
+                // Parsing Quality File
+                stringstream sq(qlline);
+                double tableEntry;
+                sq >> tableEntry;
+                double observedCount = tableEntry;
 
-            vector<double> propSum = getPropSum(nbnumTags, theMap);
-            vector<double> propOfNumTag = getNumTagProp(nbnumTags, theMap);
-            double MainTagProp = getMainTagPropInit(nbnumTagsProp);
 
-            vector<double> rTagsQual;
-            rTagsQual.reserve(nbnumTagsProp.size());
+                // Parsing Neighbourhood Quality file
+                stringstream sp(nbqline);
+                string Tagsq;
+                string numTagq;
+                double numTagProp;
+                vector<double> nbnumTagsProp;
 
-            // Find Error Mean
-            int groupIndex = 0;
-            for (unsigned x = 0; x < propSum.size(); x += 1) {
-                double rTagsQual1 =
-                    nbnumTagsProp[groupIndex] * propOfNumTag[groupIndex] / propSum[x];
-                double rTagsQual2 =
-                    nbnumTagsProp[groupIndex + 1] * propOfNumTag[groupIndex + 1] / propSum[x];
-                double rTagsQual3 =
-                    nbnumTagsProp[groupIndex + 2] * propOfNumTag[groupIndex + 2] / propSum[x];
+                sp >> Tagsq >> numTagq;
 
-                if (isnan(rTagsQual1)) {
-                    rTagsQual1 = 0;
+                while (sp >> numTagProp) {
+                    nbnumTagsProp.push_back(numTagProp);
                 }
 
-                if (isnan(rTagsQual2)) {
-                    rTagsQual2 = 0;
-                }
 
-                if (isnan(rTagsQual3)) {
-                    rTagsQual3 = 0;
-                }
+                //
+                // Begin computing Rtags.A
+                //
 
-                rTagsQual.push_back(rTagsQual1);
-                rTagsQual.push_back(rTagsQual2);
-                rTagsQual.push_back(rTagsQual3);
+                // Resolve every neighbor once; absent ones get TagIndex::npos
+                vector<int> nbOrd;
+                tagIndex.findAll(nbnumTags, nbOrd);
 
-                groupIndex += 3;
-            }
+                vector<double> propSum = getPropSum(nbOrd, tagProp);
+                vector<double> propOfNumTag = getNumTagProp(nbOrd, tagProp);
+                double MainTagProp = getMainTagPropInit(nbnumTagsProp);
 
-            MainTagProp = getMainTagPropMeanScaled(rTagsQual);
+                vector<double> rTagsQual;
+                rTagsQual.reserve(nbnumTagsProp.size());
 
+                // Find Error Mean
+                int groupIndex = 0;
+                for (unsigned x = 0; x < propSum.size(); x += 1) {
+                    double rTagsQual1 =
+                        nbnumTagsProp[groupIndex] * propOfNumTag[groupIndex] / propSum[x];
+                    double rTagsQual2 =
+                        nbnumTagsProp[groupIndex + 1] * propOfNumTag[groupIndex + 1] / propSum[x];
+                    double rTagsQual3 =
+                        nbnumTagsProp[groupIndex + 2] * propOfNumTag[groupIndex + 2] / propSum[x];
 
-            vector<pair<int, int>> indexInOrd = getIndexFromMap(nbnumTags, ordNumTagsMap);
-            // cout << indexInOrd.size() << "\t" << rTagsQual.size() << endl;
+                    if (isnan(rTagsQual1)) {
+                        rTagsQual1 = 0;
+                    }
 
-            vector<vector<int>> indexInOrdLineNo;
-            for (unsigned k = 0; k < indexInOrd.size(); k++) {
-                pair<int, int> tpl = indexInOrd[k];
-                // cout << tpl.first << "-" << tpl.second << endl;
-                vector<int> temp;
-                temp.push_back(tpl.first);
-                temp.push_back(lineno++);
-                temp.push_back(tpl.second);
-                indexInOrdLineNo.push_back(temp);
-            }
+                    if (isnan(rTagsQual2)) {
+                        rTagsQual2 = 0;
+                    }
 
-            // printf("%.7f\t", MainTagProp);
-            // cout << "RTAGS QUAL " ;;
-            // prn_vec<double>(rTagsQual,"\t");
-            // cout << endl;
+                    if (isnan(rTagsQual3)) {
+                        rTagsQual3 = 0;
+                    }
 
-            accumIndexInOrd.insert(accumIndexInOrd.end(), indexInOrdLineNo.begin(),
-                                   indexInOrdLineNo.end());
+                    rTagsQual.push_back(rTagsQual1);
+                    rTagsQual.push_back(rTagsQual2);
+                    rTagsQual.push_back(rTagsQual3);
 
-            int tln = lineno_++;
+                    groupIndex += 3;
+                }
 
-            RA.push_back(MainTagProp);
-            rawCount.push_back(double(observedCount));
+                MainTagProp = getMainTagPropMeanScaled(rTagsQual);
 
-            // For IA and RA
-            vector<vector<int>> forIA;
-            vector<vector<double>> forRA;
 
-            for (unsigned n = 0; n < rTagsQual.size(); n++) {
-                vector<int> temp2;
-                vector<double> temp3;
+                vector<pair<int, int>> indexInOrd = getIndexFromOrd(nbOrd);
 
-                if (rTagsQual[n] > 0) {
-                    // cout << rTagsQual[n] << "-" << tln << "-" << n+1 << " ";
-                    temp2.push_back(n + 1);
-                    temp2.push_back(tln);
-                    forIA.push_back(temp2);
+                int tln = lineno_++;
+                rawCount.push_back(double(observedCount));
 
-                    temp3.push_back(double(tln));
-                    temp3.push_back(double(n + 1));
-                    temp3.push_back(rTagsQual[n]);
-                    forRA.push_back(temp3);
+                // Diagonal first, then every neighbor present in the .prop file
+                builder.addEntry(tln, MainTagProp);
+                for (unsigned k = 0; k < indexInOrd.size(); k++) {
+                    double rTagQual = rTagsQual[indexInOrd[k].first];
+                    if (rTagQual > 0) {
+                        builder.addEntry(indexInOrd[k].second, rTagQual);
+                    }
                 }
-            }
-
-            accumIndexIA.insert(accumIndexIA.end(), forIA.begin(), forIA.end());
-            accumIndexRA.insert(accumIndexRA.end(), forRA.begin(), forRA.end());
+                builder.endRow();
 
 
-            // cout << " ------- " <<endl;
+                // cout << " ------- " <<endl;
+            }
+            nbfile.close();
+            qlfile.close();
+            nbqfile.close();
+        } else {
+            cout << "One of the three files NB,QL, and NBQ cannot be open\n";
         }
-        nbfile.close();
-        qlfile.close();
-        nbqfile.close();
-    } else {
-        cout << "One of the three files NB,QL, and NBQ cannot be open\n";
-    }
-
-
-    // cerr << "# CPU time for parsing two files: " << (clock() - startTime + 0.0) / CLOCKS_PER_SEC
-    //     << " seconds\n";
-
-
-    /*
-     Here we extract show all the sparse matrix param (RA,JA,IA);
-     Then convert them into the standard SparseMatrix
-    */
-
-    // std::clock_t startSparseTime = std::clock();
-
-    // cout << "DIM " << lineno_ << "x" << lineno_ << endl;
-    // cout << "RAW COUNT ";
-    // prn_vec_err<double>(rawCount,",");
-    // cout << rawCount.size();
-    // cout << endl;
-
-    // Print and keep RA
-    std::stable_sort(accumIndexRA.begin(), accumIndexRA.end(), sort_pred_double());
-    for (unsigned z = 0; z < accumIndexRA.size(); z++) {
-        vector<double> dbtriplet = accumIndexRA[z];
-        // cout << "\t" << dbtriplet[0] << "\t" << dbtriplet[1] << "\t" << dbtriplet[2] <<  endl;
-        RA.push_back(dbtriplet[2]);
-    }
-
 
-    // Print and Keep IA
-    std::sort(accumIndexIA.begin(), accumIndexIA.end(), sort_pred());
-    for (unsigned y = 0; y < accumIndexIA.size(); y++) {
-        vector<int> duplet = accumIndexIA[y];
-        IA.push_back(duplet[1]);
-    }
 
+        // cerr << "# CPU time for parsing two files: " << (clock() - startTime + 0.0) / CLOCKS_PER_SEC
+        //     << " seconds\n";
 
-    // Print and Keep JA
-    std::sort(accumIndexInOrd.begin(), accumIndexInOrd.end(), sort_pred());
-    for (unsigned k = 0; k < accumIndexInOrd.size(); k++) {
-        vector<int> triplet = accumIndexInOrd[k];
-        JA.push_back(triplet[2]);
-    }
 
+        // Every .nb line is a row and every .prop line a column; the two
+        // files must come from the same input
+        if (builder.hasRejectedEntries() ||
+            builder.numRows() != static_cast<size_t>(numberOfSeq)) {
+            cerr << "Error: unequal dimension sizes in sparse matrix" << endl;
+            exit(EXIT_FAILURE);
+        }
 
-    if (RA.size() != IA.size() || IA.size() != JA.size()) {
-        cerr << "RA : ";
-        // prn_vec_err<double>(RA, " ");
-        cerr << RA.size() << endl;
-        cerr << "IA : ";
-        // prn_vec_err<int>(IA, " ");
-        cerr << IA.size() << endl;
-        cerr << "JA : ";
-        // prn_vec_err<int>(JA," ");
-        cerr << JA.size() << endl;
-        cerr << "Error: unequal dimension sizes in sparse matrix" << endl;
-        exit(EXIT_FAILURE);
+        A = builder.finish();
     }
 
-
-    // Compute Lfree = unclamped likelihood
-    double lambda_free = double(lineno_);
-    int maxStep_free = 51;
-
-    vector<double> nCount_free = rawCount;
-    vector<double> theM_free = rawCount;
-    double loglik_free = 0;
+    At = TransposeCsr(A);
 
     vector<double> ExpCountFreeVec;
-    // double m_temp_free = 0;
-    double temp_loglik_free = 0;
-
-    for (int m_free = 0; m_free < maxStep_free; m_free++) {
-        // cout << "Free Step " << m_free << endl;
-
-        vector<double> theP_free;
-        vector<double> sparseM_prod_P_free;
-        vector<double> rSums_free;
-        vector<double> tsparseM_prod_rSums_free;
-
-
-        theP_free = divideVecWithScalar(theM_free, lambda_free);
-        vector<double> theP_freeNrm = normalizeP(theP_free);
+    vector<double> llRatio;
+    vector<char> hasRatio;
 
-        sparseM_prod_P_free = sparseM_vec_prod(theP_freeNrm, IA, JA, RA);
-        rSums_free = divideVecWithVecCorsp(nCount_free, sparseM_prod_P_free);
-        tsparseM_prod_rSums_free = sparseM_vec_prod(rSums_free, JA, IA, RA);
-        theM_free = multiplyVecWithVecCorsp(theP_freeNrm, tsparseM_prod_rSums_free);
-        loglik_free = computeLogLik(theM_free, theP_freeNrm, lambda_free);
-
-        // cout << loglik_free << endl;
-
-        // double diff_mfree = theM_free[0] - m_temp_free;
-        // m_temp_free = theM_free[0];
-        // double diff_loglik_free = loglik_free - temp_loglik_free;
-        double diff_loglik_free = relative_diff_loglik(loglik_free, temp_loglik_free);
-        temp_loglik_free = loglik_free;
-
-        /*--------------------------------------------------
-         *      cout << "Free Step " << m_free << "\t"  ;
-         *      cout << "\tLoglik Free " << loglik_free << "\tll_diff " << diff_loglik_free  <<
-         *endl; cout << "theP\t" ; prn_vec<double>(theP_free,"\t"); cout << endl; cout << "theM\t" ;
-         *      prn_vec<double>(theM_free,"\t");
-         *      cout << endl;
-         *      cout << "lambda\t" ;
-         *      cout << lambda_free << endl;
-         *--------------------------------------------------*/
-
-
-        // Show only the last iteration
-        if (diff_loglik_free < 0.001) {
-            // if ( m_free == maxStep_free-1) {
-
-            for (unsigned i = 0; i < theM_free.size(); i++) {
-                double ExpCount_free = theM_free[i];
-
-                ExpCountFreeVec.push_back(ExpCount_free);
-
-                // cout << Tags[i] << "\t" << fixed <<  setprecision(3) <<  rawCount[i] << "\t";
-                // printf("%.3f", ExpCount);
-                // cout << "\t";
-                // cout << endl;
+    if (!ccomp) {
+        ComputeLikelihoodRatios(A, At, rawCount, double(lineno_), options, ExpCountFreeVec,
+                                llRatio, hasRatio);
+    } else {
+        // Every connected component is an independent EM problem with its
+        // own total (lambda = number of tags in the component), exactly as
+        // if lr_ccomp.pl had written it to a file of its own
+        ComponentSplit split = SplitIntoComponents(A);
+        const long numComponents = static_cast<long>(split.numComponents());
+
+        ExpCountFreeVec.assign(Tags.size(), 0.0);
+        llRatio.assign(Tags.size(), 0.0);
+        hasRatio.assign(Tags.size(), 0);
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (long c = 0; c < numComponents; c++) {
+            const vector<uint32_t>& rows = split.members[c];
+
+            CsrMatrix B = ExtractComponent(A, split, c);
+            CsrMatrix Bt = TransposeCsr(B);
+            vector<double> counts;
+            counts.reserve(rows.size());
+            for (uint32_t i : rows) {
+                counts.push_back(rawCount[i]);
             }
 
+            vector<double> expFree, ratio;
+            vector<char> done;
+            ComputeLikelihoodRatios(B, Bt, counts, double(rows.size()), options, expFree, ratio,
+                                    done);
 
-            break;
+            for (size_t k = 0; k < rows.size(); k++) {
+                ExpCountFreeVec[rows[k]] = expFree[k];
+                llRatio[rows[k]] = ratio[k];
+                hasRatio[rows[k]] = done[k];
+            }
         }
     }
 
-    // cout << "++++++++++ END OF LOGLIK FREE ++++++" << endl;
-
-
-    // Compute L0 = likelihood of each tag clamped into 0
-    // Run this EM inside a loop of tags inside every connected components
-    // cout << Tags.size() << endl;
-
-    // cout << "CC Size " << Tags.size() << endl;
     for (unsigned tag_i = 0; tag_i < Tags.size(); tag_i++) {
-        // cout << "Tag No To Clamp: " << tag_i << " " <<  Tags[tag_i] << "\t" << fixed <<
-        // setprecision(3) <<  rawCount[tag_i] << "\t"  ;
         cout << Tags[tag_i] << "\t" << fixed << setprecision(5) << rawCount[tag_i] << "\t"
              << ExpCountFreeVec[tag_i] << "\t";
-        // cout <<  Tags[tag_i] << "\t" << fixed <<  setprecision(3) <<  rawCount[tag_i] << "\t"  ;
-        // printf("%.3f", ExpCountFreeVec[tag_i]);
-        // cout << "\t";
-
-
-        // For each of this tag run EM
-        /*
-         * *********************
-         *
-         * BEGIN EM Step
-         *
-         *********************
-         */
-        // std::clock_t startEMTime = std::clock();
-
-        double lambda = double(lineno_);
-        int maxStep = 51;
-
-        double temp_loglik = 0;
-        vector<double> nCount = rawCount;
-        vector<double> theM = rawCount;
-
-        // cout << endl;
-
-        for (int m = 0; m < maxStep; m++) {
-            vector<double> theP;
-            vector<double> sparseM_prod_Pnew;
-            vector<double> rSums;
-            vector<double> tsparseM_prod_rSums;
-            double loglik = 0.00;
-
-            // cout << "\tStep " << m <<  endl;
-            // theP                = divideVecWithScalarDebug(theM,lambda);
-            theP = divideVecWithScalar(theM, lambda);
-
-
-            vector<double> thePnew = theP;
-            vector<double> nCountnew = nCount;
-
-            thePnew[tag_i] = 0.000;
-
-            vector<double> thePnewNrm = normalizeP(thePnew);
-            // double totPnew = 0.00;
-            sparseM_prod_Pnew = sparseM_vec_prod(thePnewNrm, IA, JA, RA);
-            // sparseM_prod_Pnew   = sparseM_vec_prodDebugSPSM(thePnewNrm,IA,JA,RA);
-            // cout << "sparseM_prod_Pnew" << endl;
-            // prn_vec<double>(sparseM_prod_Pnew, "\n");
-            // cout << endl;
-
-            rSums = divideVecWithVecCorsp(nCountnew, sparseM_prod_Pnew);
-            // rSums               = divideVecWithVecCorspDebug(nCountnew,sparseM_prod_Pnew);
-
-            // cout << "rSums" << endl;
-            // prn_vec<double>(rSums, "\n");
-            // cout << endl
-
-            tsparseM_prod_rSums = sparseM_vec_prod(rSums, JA, IA, RA);
-            // tsparseM_prod_rSums = sparseM_vec_prodDebug(rSums,JA,IA,RA);
-            // cout << "tsparseM_prod_rSums" << endl;
-            // prn_vec<double>(tsparseM_prod_rSums, "\n");
-            // cout << endl;
-
-
-            // theM                = multiplyVecWithVecCorspDebug(thePnewNrm, tsparseM_prod_rSums);
-            theM = multiplyVecWithVecCorsp(thePnewNrm, tsparseM_prod_rSums);
-
-            // cout << "theM" << endl;
-            // prn_vec<double>(theM, "\n");
-            // cout << endl;
-
-
-            // loglik              = computeLogLikdebug(theM, thePnewNrm, lambda);
-            loglik = computeLogLik(theM, thePnewNrm, lambda);
-
-            // cout << "\t" << theM[0] << endl;;
-            // prn_vec<double>(theM, "\n");
-            // cout << "Pnew" << endl;
-            // prn_vec<double>(thePnewNrm, "\n");
-            // cout << lambda;
-            // cout << endl;
-
-
-            // double diff_loglik = loglik - temp_loglik;
-            double diff_loglik = relative_diff_loglik(loglik, temp_loglik);
-
-            temp_loglik = loglik;
-
-            double llfree_ll = loglik_free - loglik;
-            // cout << " LL " <<  loglik << " " << llfree_ll <<  endl;
-
-
-            // if ( m == maxStep-1) {
-            if (diff_loglik < 0.01) {
-                // cout << "LL_free=" << loglik_free <<", LL_0= " << loglik << "\t" << llfree_ll <<
-                // endl;
-                cout << fixed << setprecision(15) << "\t" << llfree_ll;
-                cout << "\n";
-
-                // for (unsigned i=0; i<theM.size(); i++) {
-                // double ExpCount = theM[i];
-                // cout << "\t\t" << Tags[i] << "\t" << fixed <<  setprecision(3) <<  rawCount[i] <<
-                // "\t"; printf("%.3f", ExpCount); cout << "\t"; cout << endl;
-                // }
-
-                // final_step = m;
-                break;
-            }
+        if (hasRatio[tag_i]) {
+            cout << fixed << setprecision(15) << "\t" << llRatio[tag_i];
+            cout << "\n";
         }
-
-        // cout << "Final Step " << final_step << endl;
-        // cout << endl;
     }
 
     // cerr << "# CPU time for EM: " << (clock() - startEMTime + 0.0) / CLOCKS_PER_SEC
@@ -3,8 +3,14 @@
 // Copyright 2009, Edward Wijaya
 // =====================================================================================
 
+#include "BufferedWriter.hh"
+#include "NeighborMatrixFile.hh"
+#include "NeighborTopologyCache.hh"
+#include "QualityModel.hh"
+#include "SparseMatrixBuilder.hh"
 #include "Utilities.hh"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -12,105 +18,61 @@
 #include <vector>
 
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 
 using namespace std;
 
-// Optimized: inline for frequent calls, use log10 instead of log(x)/log(10)
-inline double Solexa2Phred(double sQ) {
-    // Convert Solexa into Phred Quality
-    // Optimized: log10 is faster than log(x)/log(10)
-    double pQ = 10.00 * log10(1.00 + pow(10.00, (sQ / 10.0)));
-    return pQ;
-}
-
 // Optimized: use std::to_string instead of stringstream
 inline string ConvertInt2String(int IntVal) {
     return std::to_string(IntVal);
 }
 
-// Optimized: pass by const reference, reserve space, avoid string conversions
-vector<int> MismatchPos(const std::vector<int>& STag, const string& Nb) {
-    vector<int> MMPos;
-    MMPos.reserve(STag.size());  // Pre-allocate worst case
-
-    // Optimized: avoid string conversions by comparing directly
-    for (unsigned i = 0; i < STag.size(); i++) {
-        int tagDigit = STag[i];
-        int nbDigit = Nb[i] - '0';  // Convert char to int directly
-
-        if (nbDigit != tagDigit) {
-            MMPos.push_back(i);
-        }
+// Probability of reading a given wrong base at every position of a read.
+// A neighbor's error is the product over its mismatched positions, so this
+// is the only place the read's Solexa qualities are converted; integer
+// scores are looked up in the model's tables.
+void PositionErrors(const QualityModel& model, const std::vector<double>& Qual,
+                    std::vector<double>& err) {
+    for (unsigned i = 0; i < err.size(); i++) {
+        err[i] = model.baseErrProb(i < Qual.size() ? Qual[i] : 0.0);
     }
-
-    return MMPos;
 }
 
-// Optimized: pass by const reference, cache constant division
-double MultiplyError(const std::vector<double>& Qual, const std::vector<int>& Pos) {
-    double Result = 1.0;
-    static const double one_third = 1.0 / 3.0;  // Cache constant
-
-    for (unsigned i = 0; i < Pos.size(); i++) {
-        double phred = Solexa2Phred(Qual[Pos[i]]);
-        // Optimized: use exp10 if available, or precalculate pow(10, -x/10)
-        double err = pow(10.0, -phred / 10.0) * one_third;
-        Result *= err;
-    }
-
-    return Result;
-}
 
-// Optimized: pass by const reference, reserve space
-vector<int> MismatchPosByVec(const std::vector<int>& STag, const vector<int>& Nb) {
-    vector<int> MMPos;
-    MMPos.reserve(STag.size());  // Pre-allocate
+// Proportion of every tag exactly as GenerateProportion writes it to the
+// .prop file: entry j belongs to the tag whose numeric form is j in base 4.
+vector<double> ReadTagProportions(const string& fileName) {
+    vector<double> rawCounts;
+    ifstream infile(fileName.c_str());
+    string line;
 
-    for (unsigned i = 0; i < STag.size(); i++) {
-        if (Nb[i] != STag[i]) {
-            MMPos.push_back(i);
+    while (getline(infile, line)) {
+        if (line.find("#") == 0) {
+            continue;
         }
+        stringstream ss(line);
+        int tableEntry = 0;
+        ss >> tableEntry;
+        rawCounts.push_back(tableEntry);
     }
 
-    return MMPos;
-}
-
-// Optimized: pass by const reference where possible
-double normalizeQualByMismatches1Tag(const std::vector<int>& SeedTag,
-                                     const std::vector<int>& NbTags,
-                                     const std::vector<double>& qual) {
-    vector<int> mmPos = MismatchPosByVec(SeedTag, NbTags);
-    double ErrorProb = MultiplyError(qual, mmPos);
-    return ErrorProb;
-}
-
-
-// Optimized: pass by const reference and return modified copy
-vector<int> neighbors(const vector<int>& arg, int posNo, int baseNo) {
-    // pass base position and return neighbors
-    vector<int> transfVec = arg;  // Copy constructor
-    transfVec[posNo] = baseNo;
-    return transfVec;
-}
-
-
-// Optimized: pass by const reference, reserve space, avoid string conversions
-string Vec2Str(const vector<int>& NTg) {
-    string StTg;
-    StTg.reserve(NTg.size());  // Pre-allocate
-
-    // Optimized: convert int to char directly (0-3 -> '0'-'3')
-    for (unsigned i = 0; i < NTg.size(); i++) {
-        StTg += ('0' + NTg[i]);  // Much faster than ConvertInt2String
+    vector<double> tagProp;
+    tagProp.reserve(rawCounts.size());
+    for (unsigned i = 0; i < rawCounts.size(); i++) {
+        float prop = rawCounts[i] / double(rawCounts.size());
+        tagProp.push_back(prop);
     }
-    return StTg;
+
+    return tagProp;
 }
 
 
 int main(int arg_count, char* arg_vec[]) {
-    if (arg_count < 3) {
-        cerr << "Expected two arguments FileName and Max Hamming Distance" << endl;
+    if (arg_count < 4) {
+        cerr << "Usage: FindNeighboursWithQual FileName MaxHammingDistance BaseErrProbLim [--nbm]"
+             << endl;
         return EXIT_FAILURE;
     }
 
@@ -139,15 +101,52 @@ int main(int arg_count, char* arg_vec[]) {
 
     string nbFileName = pathName + baseName + ".nb";
     string nbqFileName = pathName + baseName + ".nbq";
+    string nbmFileName = pathName + baseName + ".nbm";
+
+    // Optionally also write the finished error matrix in binary CSR form,
+    // which the EstimateTrueCount_* programs load instead of the text files
+    bool writeMatrix = (arg_count > 4 && string(arg_vec[4]) == "--nbm");
+    if (writeMatrix && hd != 1) {
+        cerr << "Binary neighbor matrix is only written for Hamming distance 1" << endl;
+        writeMatrix = false;
+    }
+
+    // A matrix from an earlier run would no longer match the new text files
+    if (!writeMatrix) {
+        remove(nbmFileName.c_str());
+    }
+
+    vector<double> tagProp;
+    vector<string> nbmTags;
+    vector<double> nbmRawCounts;
+
+    if (writeMatrix) {
+        tagProp = ReadTagProportions(filename);
+    }
+    SparseMatrixBuilder nbmBuilder(tagProp.size());
 
-    ofstream nbFile;
-    nbFile.open(nbFileName.c_str(), ios::out);
+    BufferedWriter nbFile;
+    nbFile.open(nbFileName);
 
-    ofstream nbqFile;
-    nbqFile.open(nbqFileName.c_str(), ios::out);
+    BufferedWriter nbqFile;
+    nbqFile.open(nbqFileName);
 
     vector<string> DNAStrings;
 
+    // Per-read work buffers, reused for every line
+    vector<double> qualBase;
+    qualBase.reserve(50);  // Reserve typical read length
+    vector<int> numTag;
+    vector<double> posErr;
+    const QualityModel solexa(QualityScale::Solexa);
+    string digits;  // numTag as '0'-'3' characters, mutated in place per neighbor
+
+    // Hamming distance 1 neighbors of recently seen tags; only their error
+    // probabilities are recomputed when a tag is read again
+    NeighborTopologyCache topologyCache;
+    NeighborTopology builtTopology;
+    vector<pair<std::uint32_t, double>> rowEntries;
+
     if (myfile.is_open()) {
         while (getline(myfile, line)) {
             if (line.find("#") == 0) {
@@ -158,19 +157,20 @@ int main(int arg_count, char* arg_vec[]) {
             string DNA;
             double qualSc;
             double rawCount;
-            vector<double> qualBase;
-            qualBase.reserve(50);  // Reserve typical read length
+            qualBase.clear();
 
             // ss >> rawCount >> DNA;
             ss >> rawCount >> DNA;
 
+            if (writeMatrix) {
+                nbmTags.push_back(DNA);
+                nbmRawCounts.push_back(rawCount);
+            }
+
             if (rawCount == 0.00) {
                 rawCount = rawCount + 0.00001;
             }
 
-            string dnaTag;
-            dnaTag = DNA;
-
             while (ss >> qualSc) {
                 qualBase.push_back(qualSc);
             }
@@ -178,12 +178,14 @@ int main(int arg_count, char* arg_vec[]) {
             // we process string line by line here
             // avoiding slurping with push_back
 
-            nbFile << DNA << "\t";
-            nbqFile << DNA << "\t";
+            nbFile.write(DNA);
+            nbFile.put('\t');
+            nbqFile.write(DNA);
+            nbqFile.put('\t');
 
             // Convert string to numeric using optimized switch (faster than map)
-            vector<int> numTag;
-            numTag.reserve(DNA.size());  // Pre-allocate
+            numTag.clear();
+            digits.clear();
 
             for (unsigned j = 0; j < DNA.size(); j++) {
                 int cb;
@@ -205,93 +207,126 @@ int main(int arg_count, char* arg_vec[]) {
                         break;
                 }
                 numTag.push_back(cb);
+                digits.push_back(static_cast<char>('0' + cb));
             }
 
-            // prn_vec(numTag);
-            prn_vec_binos<int>(numTag, nbFile);
-            nbFile << "\t\t";
+            nbFile.write(digits);
+            nbFile.write("\t\t", 2);
+
+            nbqFile.write(digits);
+            nbqFile.write("\t\t", 2);
 
-            prn_vec_binos<int>(numTag, nbqFile);
-            nbqFile << "\t\t";
+            // Error of every single substitution; a neighbor's error is the
+            // product over its mismatched positions
+            posErr.resize(numTag.size());
+            PositionErrors(solexa, qualBase, posErr);
 
             if (hd == 1) {
+                const NeighborTopology* topology = topologyCache.find(digits);
+                if (topology == nullptr) {
+                    BuildNeighborTopology(digits, tagProp, builtTopology);
+                    topology = topologyCache.insert(digits, builtTopology);
+                    if (topology == nullptr) {
+                        topology = &builtTopology;
+                    }
+                }
+
+                // The neighbor differs from the tag at one position only
+                nbFile.write(topology->nbText);
                 for (unsigned p = 0; p < numTag.size(); p++) {
                     for (int b = 1; b <= 3; b++) {
-                        // cerr << " Pos: " << p << ", base= " << b << endl;
-
-                        int bval = b;
-                        if (numTag[p] == b) {
-                            bval = 0;
-                        }
-
-                        vector<int> nbnumTag = neighbors(numTag, p, bval);
-                        double nrmQual = normalizeQualByMismatches1Tag(numTag, nbnumTag, qualBase);
+                        nbqFile.writeDouble(posErr[p]);
+                        nbqFile.put('\t');
+                    }
+                }
 
+                if (writeMatrix) {
+                    // The error at each position is shared among its three
+                    // substitutions in proportion to their abundance; the
+                    // diagonal depends on the neighbor entries, so they are
+                    // collected first and the row is emitted diagonal first
+                    rowEntries.clear();
+                    double errSum = 0.0;
+
+                    for (const NeighborShare& s : topology->shares) {
+                        double rTagsQual = posErr[s.position] * s.prop / s.propSum;
+                        rowEntries.push_back(make_pair(s.neighbor, rTagsQual));
+                        errSum += rTagsQual;
+                    }
 
-                        // prn_vec <int>(nbnumTag);
-                        prn_vec_binos<int>(nbnumTag, nbFile);
-                        nbFile << "\t";
-                        nbqFile << nrmQual << "\t";
+                    nbmBuilder.addEntry(nbmTags.size() - 1, max(0.01, min(1.00, (1.00 - errSum))));
+                    for (unsigned k = 0; k < rowEntries.size(); k++) {
+                        nbmBuilder.addEntry(rowEntries[k].first, rowEntries[k].second);
                     }
+                    nbmBuilder.endRow();
                 }
 
-                nbFile << endl;
-                nbqFile << endl;
+                nbFile.put('\n');
+                nbqFile.put('\n');
             } else {
                 int TagLen = static_cast<int>(numTag.size());
 
                 for (int p = 0; p < TagLen; p++) {
+                    const char ownP = digits[p];
+
                     // First loop is to generate tags 1 position differ
                     for (int b = 0; b <= 3; b++) {
-                        int bval = b;
                         if (numTag[p] == b) {
                             continue;
                         }
 
-                        vector<int> nbnumTag = neighbors(numTag, p, bval);
-                        string SnbnumTag = Vec2Str(nbnumTag);
-                        double nrmQual = normalizeQualByMismatches1Tag(numTag, nbnumTag, qualBase);
-
+                        double nrmQual = posErr[p];
 
                         // We want to keep all 1 mismatch neighbors
-                        nbqFile << nrmQual << "\t";
+                        nbqFile.writeDouble(nrmQual);
+                        nbqFile.put('\t');
 
+                        // 2 mismatch neighbors only below a likely enough
+                        // first substitution
+                        if (nrmQual < BaseErrProbLim) {
+                            continue;
+                        }
 
                         //
                         // Second loop for tags in 2 position differ
+                        digits[p] = static_cast<char>('0' + b);
                         for (int l = p + 1; l < TagLen; l++) {
-                            for (int c = 0; c <= 3; c++) {
-                                int cval = c;
+                            const char ownL = digits[l];
 
-                                if (nbnumTag[l] == c) {
+                            for (int c = 0; c <= 3; c++) {
+                                if (numTag[l] == c) {
                                     continue;
                                 }
-                                vector<int> nbnumTag2 = neighbors(nbnumTag, l, cval);
-                                string SnbnumTag2 = Vec2Str(nbnumTag2);
-                                double nrmQual2 =
-                                    normalizeQualByMismatches1Tag(numTag, nbnumTag2, qualBase);
-
-                                if (nrmQual >= BaseErrProbLim) {
-                                    nbFile << SnbnumTag2;
-                                    nbFile << "\t";
-                                    nbqFile << nrmQual2 << "\t";
-                                }
+                                double nrmQual2 = posErr[p] * posErr[l];
+
+                                digits[l] = static_cast<char>('0' + c);
+                                nbFile.write(digits);
+                                nbFile.put('\t');
+                                nbqFile.writeDouble(nrmQual2);
+                                nbqFile.put('\t');
                             }
+                            digits[l] = ownL;
                         }
                     }
+                    digits[p] = ownP;
                 }
 
 
-                nbFile << endl;
-                nbqFile << endl;
+                nbFile.put('\n');
+                nbqFile.put('\n');
             }
         }
         myfile.close();
         nbFile.close();
         nbqFile.close();
+
+        if (writeMatrix && !WriteNeighborMatrixFile(nbmFileName, nbmTags, nbmBuilder.finish(),
+                                                    nbmRawCounts, filename)) {
+            return EXIT_FAILURE;
+        }
     }
 
     else
-        nbFile << "Unable to open file\n";
+        nbFile.write("Unable to open file\n");
     return 0;
 }
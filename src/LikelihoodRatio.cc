@@ -0,0 +1,292 @@
+#include "LikelihoodRatio.hh"
+
+#include "EmEngine.hh"
+
+#include <algorithm>
+#include <vector>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+double relativeDiff(double x, double y) {
+    return std::fabs(x - y) / std::max(std::fabs(x), std::fabs(y));
+}
+
+// Clamped EM started from the free solution.  Only counts that move are
+// re-estimated; every change to a count is pushed into (A w)_i of the rows
+// that have it as a neighbor, and those rows are revisited in the next
+// sweep.  State touched by one clamp is restored before the next one.
+class LocalClampedEm {
+   public:
+    LocalClampedEm(const CsrMatrix& A, const CsrMatrix& At, const std::vector<double>& counts,
+                   const std::vector<double>& mFree, double lambda, double tolerance,
+                   int maxSweeps)
+        : A_(A),
+          At_(At),
+          counts_(counts),
+          mFree_(mFree),
+          lambda_(lambda),
+          tolerance_(tolerance),
+          maxSweeps_(maxSweeps),
+          w_(mFree),
+          qFree_(MultiplyCsr(A, mFree)),
+          q_(qFree_),
+          rowMark_(A.numRows, 0),
+          colMark_(A.numRows, 0),
+          rowTouched_(A.numRows, 0),
+          colTouched_(A.numRows, 0),
+          epoch_(0),
+          clampId_(0),
+          sumFree_(0.0) {
+        for (double m : mFree) {
+            sumFree_ += m;
+        }
+    }
+
+    // Lfree - L0 for tag c; false if the local iteration did not settle
+    bool ratio(std::uint32_t c, double& llRatio) {
+        clampId_++;
+        dWlog_ = 0.0;
+        dSum_ = 0.0;
+        dirtyRows_.clear();
+
+        const bool reseed = (w_[c] >= kNegligible);
+        setCount(c, 0.0);
+
+        // The tags that have to take over c's reads may have been driven to
+        // (almost) zero by the free EM, which cannot grow them back; start
+        // those from their raw counts as the restart does
+        for (std::uint64_t kc = At_.rowPtr[c]; kc < At_.rowPtr[c + 1]; kc++) {
+            const std::uint32_t i = At_.colIdx[kc];
+            for (std::uint64_t k = A_.rowPtr[i]; k < A_.rowPtr[i + 1]; k++) {
+                const std::uint32_t j = A_.colIdx[k];
+                if (reseed && j != c && w_[j] < kNegligible && counts_[j] > w_[j]) {
+                    setCount(j, counts_[j]);
+                }
+            }
+
+            // Recompute the row instead of trusting q - A_ic w_c, which can
+            // cancel to zero or below.  A row left at zero is explained by no
+            // tag and, as in the restart, drops out of the likelihood.
+            double q = 0.0;
+            for (std::uint64_t k = A_.rowPtr[i]; k < A_.rowPtr[i + 1]; k++) {
+                q += A_.values[k] * w_[A_.colIdx[k]];
+            }
+            q_[i] = q;
+        }
+
+        bool converged = false;
+        for (int sweep = 0; sweep < maxSweeps_; sweep++) {
+            if (dirtyRows_.empty()) {
+                converged = true;
+                break;
+            }
+
+            // Every column of a row whose (A w)_i changed needs a new update
+            epoch_++;
+            candidates_.clear();
+            for (std::uint32_t i : dirtyRows_) {
+                for (std::uint64_t k = A_.rowPtr[i]; k < A_.rowPtr[i + 1]; k++) {
+                    std::uint32_t j = A_.colIdx[k];
+                    if (j != c && colMark_[j] != epoch_) {
+                        colMark_[j] = epoch_;
+                        candidates_.push_back(j);
+                    }
+                }
+            }
+            dirtyRows_.clear();
+
+            for (std::uint32_t j : candidates_) {
+                const double w = w_[j];
+                if (w == 0.0) {
+                    continue;  // EM never revives a zero count
+                }
+                double sum = 0.0;
+                for (std::uint64_t k = At_.rowPtr[j]; k < At_.rowPtr[j + 1]; k++) {
+                    std::uint32_t i = At_.colIdx[k];
+                    sum += At_.values[k] * counts_[i] / q_[i];
+                }
+                // A count the EM drives to zero shrinks by a constant factor
+                // every step and would never pass a relative test; once it is
+                // negligible only growth is propagated
+                const double m = w * sum;
+                if (std::fabs(m - w) > tolerance_ * w && (m > w || m > kNegligible)) {
+                    setCount(j, m);
+                }
+            }
+        }
+
+        // L = -lambda + sum_j w_j log(w_j lambda) - S log S, S = sum_j w_j
+        const double sumClamped = sumFree_ + dSum_;
+        llRatio = -dWlog_ + sumClamped * std::log(sumClamped) - sumFree_ * std::log(sumFree_);
+
+        restore();
+        return converged;
+    }
+
+   private:
+    static constexpr double kNegligible = 1e-6;  ///< Expected count treated as zero
+
+    double term(double w) const { return w > 0.0 ? w * std::log(w * lambda_) : 0.0; }
+
+    void setCount(std::uint32_t j, double m) {
+        if (colTouched_[j] != clampId_) {
+            colTouched_[j] = clampId_;
+            touchedCols_.push_back(j);
+        }
+
+        const double delta = m - w_[j];
+        dWlog_ += term(m) - term(w_[j]);
+        dSum_ += delta;
+        w_[j] = m;
+
+        for (std::uint64_t k = At_.rowPtr[j]; k < At_.rowPtr[j + 1]; k++) {
+            std::uint32_t i = At_.colIdx[k];
+            q_[i] += At_.values[k] * delta;
+            if (rowTouched_[i] != clampId_) {
+                rowTouched_[i] = clampId_;
+                touchedRows_.push_back(i);
+            }
+            if (rowMark_[i] != epoch_ + 1) {
+                rowMark_[i] = epoch_ + 1;
+                dirtyRows_.push_back(i);
+            }
+        }
+    }
+
+    void restore() {
+        for (std::uint32_t j : touchedCols_) {
+            w_[j] = mFree_[j];
+        }
+        for (std::uint32_t i : touchedRows_) {
+            q_[i] = qFree_[i];
+        }
+        touchedCols_.clear();
+        touchedRows_.clear();
+        epoch_++;
+    }
+
+    const CsrMatrix& A_;
+    const CsrMatrix& At_;
+    const std::vector<double>& counts_;
+    const std::vector<double>& mFree_;
+    const double lambda_;
+    const double tolerance_;
+    const int maxSweeps_;
+
+    std::vector<double> w_;      ///< Current counts (free solution outside the touched set)
+    std::vector<double> qFree_;  ///< A mFree
+    std::vector<double> q_;      ///< A w
+
+    std::vector<std::uint64_t> rowMark_;     ///< Row already queued for the next sweep
+    std::vector<std::uint64_t> colMark_;     ///< Column already a candidate this sweep
+    std::vector<std::uint64_t> rowTouched_;  ///< Row changed by the current clamp
+    std::vector<std::uint64_t> colTouched_;  ///< Column changed by the current clamp
+    std::uint64_t epoch_;
+    std::uint64_t clampId_;
+
+    std::vector<std::uint32_t> dirtyRows_;
+    std::vector<std::uint32_t> candidates_;
+    std::vector<std::uint32_t> touchedRows_;
+    std::vector<std::uint32_t> touchedCols_;
+
+    double sumFree_;
+    double dWlog_;  ///< Change of sum_j w_j log(w_j lambda)
+    double dSum_;   ///< Change of sum_j w_j
+};
+
+}  // namespace
+
+
+void ComputeLikelihoodRatios(const CsrMatrix& A, const CsrMatrix& At,
+                             const std::vector<double>& rawCount, double lambda,
+                             const LikelihoodRatioOptions& options, std::vector<double>& expFree,
+                             std::vector<double>& llRatio, std::vector<char>& hasRatio) {
+    const std::size_t numTags = rawCount.size();
+    const bool warm = (options.start == ClampedStart::WarmStart);
+    const bool converge = (options.start != ClampedStart::Restart);
+    EmEngine em(A, At, rawCount);
+
+    // Compute Lfree = unclamped likelihood
+    std::vector<double> theM_free = rawCount;
+    double loglik_free = 0;
+    double temp_loglik_free = 0;
+
+    for (int m_free = 0; m_free < options.maxSteps; m_free++) {
+        // theP_free = normalized theM_free; theM_free = theP_free .* At (n ./ (A theP_free))
+        loglik_free = em.step(theM_free, lambda, true);
+
+        double diff_loglik_free = relativeDiff(loglik_free, temp_loglik_free);
+        temp_loglik_free = loglik_free;
+
+        if (diff_loglik_free < options.freeTolerance) {
+            break;
+        }
+    }
+    expFree = theM_free;
+
+    // Converged ratios continue the same run to a fixed point
+    if (converge) {
+        for (int m_free = 0; m_free < options.convergedMaxSteps; m_free++) {
+            loglik_free = em.step(theM_free, lambda, true);
+
+            double diff_loglik_free = relativeDiff(loglik_free, temp_loglik_free);
+            temp_loglik_free = loglik_free;
+
+            if (diff_loglik_free < options.convergedTolerance) {
+                break;
+            }
+        }
+    }
+
+    // Compute L0 = likelihood of each tag clamped into 0
+    llRatio.assign(numTags, 0.0);
+    hasRatio.assign(numTags, 0);
+
+    if (numTags == 1) {
+        // Nothing else can explain the reads of a lone tag
+        llRatio[0] = HUGE_VAL;
+        hasRatio[0] = 1;
+        return;
+    }
+
+    if (warm) {
+        const long n = static_cast<long>(numTags);
+#pragma omp parallel
+        {
+            LocalClampedEm local(A, At, rawCount, theM_free, lambda, options.warmTolerance,
+                                 options.warmMaxSweeps);
+#pragma omp for schedule(dynamic, 64)
+            for (long tag_i = 0; tag_i < n; tag_i++) {
+                hasRatio[tag_i] = local.ratio(static_cast<std::uint32_t>(tag_i), llRatio[tag_i]);
+            }
+        }
+        return;
+    }
+
+    const int maxStep = converge ? options.convergedMaxSteps : options.maxSteps;
+    const double tolerance = converge ? options.convergedTolerance : options.clampedTolerance;
+    std::vector<double> theM;
+    for (std::size_t tag_i = 0; tag_i < numTags; tag_i++) {
+        double temp_loglik = 0;
+        theM = rawCount;
+
+        for (int m = 0; m < maxStep; m++) {
+            // thePnew = theM / lambda with tag_i clamped to 0, then normalized;
+            // theM = thePnew .* At (nCount ./ (A thePnew))
+            double loglik = em.step(theM, lambda, true, static_cast<int>(tag_i));
+
+            double diff_loglik = relativeDiff(loglik, temp_loglik);
+            temp_loglik = loglik;
+
+            if (diff_loglik < tolerance) {
+                llRatio[tag_i] = loglik_free - loglik;
+                hasRatio[tag_i] = 1;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/**
+ * @file LikelihoodRatio.hh
+ * @brief Per-tag log-likelihood ratios of EstimateTrueCount_llratio
+ *
+ * For every tag the ratio is Lfree - L0, where Lfree is the log-likelihood
+ * of the unclamped EM solution and L0 that of the EM solution with the
+ * tag's proportion clamped to zero.
+ *
+ * The original clamped EM restarts from the raw counts for every tag and
+ * iterates over the whole matrix.  Clamping one tag only perturbs its
+ * neighborhood, so the warm-start mode starts every clamped run from the
+ * free solution and re-estimates only the tags whose expected count
+ * actually moves: the clamp changes (A p)_i for the rows that have the
+ * tag as a neighbor, those rows change the update of their columns, and
+ * so on outward until the change in every count falls below a residual
+ * tolerance.  The EM update is invariant to a common scale of p, so the
+ * renormalization after clamping does not need to touch the other tags;
+ * it enters only the log-likelihood, which is kept up to date
+ * incrementally.  The work per tag is proportional to the size of the
+ * perturbed neighborhood instead of to the whole matrix.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef LIKELIHOOD_RATIO_HH
+#define LIKELIHOOD_RATIO_HH
+
+#include "SparseMatrixBuilder.hh"
+
+#include <vector>
+
+/**
+ * @brief How every clamped EM is started
+ */
+enum class ClampedStart {
+    Restart,           ///< From the raw counts, EM over all tags (original behavior)
+    ConvergedRestart,  ///< As Restart, but every run is iterated to convergence
+    WarmStart,         ///< From the free solution, local updates only
+};
+
+/**
+ * @brief Stopping rules of the free and clamped EM runs
+ *
+ * The restart defaults are those of the original estimator: both runs
+ * stop once the relative change of the log-likelihood between two steps
+ * falls below the tolerance, which for the clamped runs typically happens
+ * after two or three steps, well before the EM has converged.
+ *
+ * The free run is always stopped by the original rule and its counts are
+ * reported as expFree in every mode.  A warm start needs a free solution
+ * that is a fixed point, so ConvergedRestart and WarmStart continue a copy
+ * of that run to convergedTolerance and take Lfree from it;
+ * ConvergedRestart also runs every clamped EM to convergedTolerance.  The
+ * ratios of those two modes agree with each other, not with the two-step
+ * restart.
+ */
+struct LikelihoodRatioOptions {
+    ClampedStart start = ClampedStart::Restart;
+    double freeTolerance = 0.001;       ///< Free run, relative log-likelihood change
+    double clampedTolerance = 0.01;     ///< Restarted clamped runs, same measure
+    int maxSteps = 51;                  ///< EM steps per restarted run
+    double convergedTolerance = 1e-12;  ///< Converged free and clamped runs, same measure
+    int convergedMaxSteps = 5000;       ///< EM steps of a converged run
+    double warmTolerance = 1e-6;        ///< Relative count change that is still propagated
+    int warmMaxSweeps = 10000;          ///< Local sweeps per warm-started clamp
+};
+
+/**
+ * @brief Log-likelihood ratio of every tag
+ *
+ * @param A        Read-error matrix in CSR form
+ * @param At       Its transpose
+ * @param rawCount Observed count of every tag
+ * @param lambda   Total used by the EM (the number of tags)
+ * @param options  How the clamped runs are started and stopped
+ * @param expFree  Unclamped expected count of every tag, by the original stopping rule
+ * @param llRatio  Lfree - L0 of every tag
+ * @param hasRatio 0 where the clamped EM did not converge
+ */
+void ComputeLikelihoodRatios(const CsrMatrix& A, const CsrMatrix& At,
+                             const std::vector<double>& rawCount, double lambda,
+                             const LikelihoodRatioOptions& options, std::vector<double>& expFree,
+                             std::vector<double>& llRatio, std::vector<char>& hasRatio);
+
+#endif  // LIKELIHOOD_RATIO_HH
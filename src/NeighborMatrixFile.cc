@@ -0,0 +1,307 @@
+#include "NeighborMatrixFile.hh"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+const char kMagic[8] = {'N', 'G', 'S', 'N', 'B', 'M', '\0', '\0'};
+const std::uint32_t kVersion = 2;
+const std::uint64_t kByteOrder = 0x0102030405060708ULL;
+
+inline std::uint64_t align8(std::uint64_t n) {
+    return (n + 7) & ~static_cast<std::uint64_t>(7);
+}
+
+// Byte offsets of every section, measured from the start of the file
+struct Layout {
+    std::uint64_t tags;
+    std::uint64_t rowOffsets;
+    std::uint64_t colIndex;
+    std::uint64_t values;
+    std::uint64_t rawCounts;
+    std::uint64_t end;
+};
+
+Layout computeLayout(std::uint64_t numTags, std::uint64_t nnz, std::uint64_t tagLength) {
+    Layout l;
+    l.tags = align8(sizeof(NeighborMatrixHeader));
+    l.rowOffsets = align8(l.tags + numTags * tagLength);
+    l.colIndex = l.rowOffsets + (numTags + 1) * sizeof(std::uint64_t);
+    l.values = align8(l.colIndex + nnz * sizeof(std::uint32_t));
+    l.rawCounts = l.values + nnz * sizeof(double);
+    l.end = l.rawCounts + numTags * sizeof(double);
+    return l;
+}
+
+// The estimators index straight through the row offsets and column
+// indices, so every one of them is checked once here; returns the problem
+// found, or an empty string
+string checkMatrix(const char* bytes, std::uint64_t numTags, std::uint64_t nnz,
+                   std::uint64_t tagLength) {
+    const Layout l = computeLayout(numTags, nnz, tagLength);
+    const std::uint64_t* rows = reinterpret_cast<const std::uint64_t*>(bytes + l.rowOffsets);
+    const std::uint32_t* cols = reinterpret_cast<const std::uint32_t*>(bytes + l.colIndex);
+
+    if (rows[0] != 0 || rows[numTags] != nnz) {
+        return "corrupt row offsets";
+    }
+    for (std::uint64_t i = 0; i < numTags; i++) {
+        if (rows[i + 1] < rows[i]) {
+            return "row offsets decrease at row " + std::to_string(i);
+        }
+    }
+    for (std::uint64_t k = 0; k < nnz; k++) {
+        if (cols[k] >= numTags) {
+            return "column index " + std::to_string(cols[k]) + " out of range at entry " +
+                   std::to_string(k);
+        }
+    }
+    return string();
+}
+
+// Modification time of a stat'ed file, in ns since the epoch
+inline std::int64_t mtimeNs(const struct stat& st) {
+    return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+void writePadding(std::ofstream& out, std::uint64_t from, std::uint64_t to) {
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    out.write(zeros, static_cast<std::streamsize>(to - from));
+}
+
+}  // namespace
+
+
+bool WriteNeighborMatrixFile(const std::string& fileName, const std::vector<std::string>& tags,
+                             const CsrMatrix& A, const std::vector<double>& rawCounts,
+                             const std::string& sourceFileName) {
+    const std::uint64_t numTags = tags.size();
+    const std::uint64_t nnz = A.nnz();
+    const std::uint32_t tagLength = tags.empty() ? 0 : static_cast<std::uint32_t>(tags[0].size());
+
+    if (A.numRows != numTags || A.numCols != numTags || A.rowPtr.size() != numTags + 1 ||
+        A.colIdx.size() != nnz || rawCounts.size() != numTags || A.rowPtr.back() != nnz) {
+        std::cerr << "Error: inconsistent neighbor matrix, not writing " << fileName << std::endl;
+        return false;
+    }
+
+    std::ofstream out(fileName.c_str(), std::ios::out | std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Unable to open " << fileName << " for writing" << std::endl;
+        return false;
+    }
+
+    NeighborMatrixHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.tagLength = tagLength;
+    header.numTags = numTags;
+    header.nnz = nnz;
+    header.byteOrder = kByteOrder;
+
+    struct stat sourceStat;
+    if (!sourceFileName.empty() && stat(sourceFileName.c_str(), &sourceStat) == 0) {
+        header.sourceSize = static_cast<std::uint64_t>(sourceStat.st_size);
+        header.sourceMtime = mtimeNs(sourceStat);
+    }
+
+    const Layout l = computeLayout(numTags, nnz, tagLength);
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writePadding(out, sizeof(header), l.tags);
+
+    for (std::uint64_t i = 0; i < numTags; i++) {
+        if (tags[i].size() != tagLength) {
+            std::cerr << "Error: tag " << tags[i] << " differs in length from " << tags[0]
+                      << std::endl;
+            return false;
+        }
+        out.write(tags[i].data(), tagLength);
+    }
+    writePadding(out, l.tags + numTags * tagLength, l.rowOffsets);
+
+    out.write(reinterpret_cast<const char*>(A.rowPtr.data()),
+              static_cast<std::streamsize>(A.rowPtr.size() * sizeof(std::uint64_t)));
+    out.write(reinterpret_cast<const char*>(A.colIdx.data()),
+              static_cast<std::streamsize>(nnz * sizeof(std::uint32_t)));
+    writePadding(out, l.colIndex + nnz * sizeof(std::uint32_t), l.values);
+    out.write(reinterpret_cast<const char*>(A.values.data()),
+              static_cast<std::streamsize>(nnz * sizeof(double)));
+    out.write(reinterpret_cast<const char*>(rawCounts.data()),
+              static_cast<std::streamsize>(numTags * sizeof(double)));
+
+    return out.good();
+}
+
+
+NeighborMatrixFile::NeighborMatrixFile()
+    : base_(nullptr),
+      mapSize_(0),
+      numTags_(0),
+      nnz_(0),
+      sourceSize_(0),
+      sourceMtime_(0),
+      tagLength_(0),
+      tags_(nullptr),
+      rowOffsets_(nullptr),
+      colIndex_(nullptr),
+      values_(nullptr),
+      rawCounts_(nullptr) {}
+
+NeighborMatrixFile::~NeighborMatrixFile() {
+    close();
+}
+
+bool NeighborMatrixFile::open(const std::string& fileName) {
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            std::cerr << "Unable to open " << fileName << ": " << std::strerror(errno) << std::endl;
+        }
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        static_cast<std::uint64_t>(st.st_size) < sizeof(NeighborMatrixHeader)) {
+        std::cerr << "Error: " << fileName << " is too short to be a neighbor matrix" << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Unable to map " << fileName << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    const NeighborMatrixHeader* header = static_cast<const NeighborMatrixHeader*>(base);
+    const char* bytes = static_cast<const char*>(base);
+
+    string problem;
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+        problem = "bad magic";
+    } else if (header->byteOrder != kByteOrder) {
+        problem = "written on a machine with a different byte order";
+    } else if (header->version != kVersion) {
+        problem = "unsupported version " + std::to_string(header->version);
+    } else if (header->numTags > static_cast<std::uint64_t>(st.st_size) ||
+               header->nnz > static_cast<std::uint64_t>(st.st_size) ||
+               computeLayout(header->numTags, header->nnz, header->tagLength).end !=
+                   static_cast<std::uint64_t>(st.st_size)) {
+        problem = "size does not match header";
+    } else {
+        problem = checkMatrix(bytes, header->numTags, header->nnz, header->tagLength);
+    }
+
+    if (!problem.empty()) {
+        std::cerr << "Error: " << fileName << ": " << problem << std::endl;
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    const Layout l = computeLayout(header->numTags, header->nnz, header->tagLength);
+
+    base_ = base;
+    mapSize_ = st.st_size;
+    numTags_ = header->numTags;
+    nnz_ = header->nnz;
+    sourceSize_ = header->sourceSize;
+    sourceMtime_ = header->sourceMtime;
+    tagLength_ = header->tagLength;
+    tags_ = bytes + l.tags;
+    rowOffsets_ = reinterpret_cast<const std::uint64_t*>(bytes + l.rowOffsets);
+    colIndex_ = reinterpret_cast<const std::uint32_t*>(bytes + l.colIndex);
+    values_ = reinterpret_cast<const double*>(bytes + l.values);
+    rawCounts_ = reinterpret_cast<const double*>(bytes + l.rawCounts);
+
+    madvise(base_, mapSize_, MADV_SEQUENTIAL);
+
+    return true;
+}
+
+bool NeighborMatrixFile::openIfCurrent(const std::string& fileName, const std::string& nbFileName,
+                                       const std::string& sourceFileName) {
+    if (!open(fileName)) {
+        return false;
+    }
+
+    struct stat nbmStat;
+    struct stat nbStat;
+    if (stat(fileName.c_str(), &nbmStat) == 0 && stat(nbFileName.c_str(), &nbStat) == 0 &&
+        mtimeNs(nbmStat) < mtimeNs(nbStat)) {
+        std::cerr << "Ignoring " << fileName << ": older than " << nbFileName << std::endl;
+        close();
+        return false;
+    }
+
+    struct stat sourceStat;
+    if (stat(sourceFileName.c_str(), &sourceStat) == 0 &&
+        (static_cast<std::uint64_t>(sourceStat.st_size) != sourceSize_ ||
+         mtimeNs(sourceStat) != sourceMtime_)) {
+        std::cerr << "Ignoring " << fileName << ": " << sourceFileName
+                  << " has changed since it was written" << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void NeighborMatrixFile::close() {
+    if (base_ != nullptr) {
+        munmap(base_, mapSize_);
+    }
+    base_ = nullptr;
+    mapSize_ = 0;
+    numTags_ = 0;
+    nnz_ = 0;
+    sourceSize_ = 0;
+    sourceMtime_ = 0;
+    tagLength_ = 0;
+    tags_ = nullptr;
+    rowOffsets_ = nullptr;
+    colIndex_ = nullptr;
+    values_ = nullptr;
+    rawCounts_ = nullptr;
+}
+
+std::string NeighborMatrixFile::tag(std::uint64_t i) const {
+    return string(tags_ + i * tagLength_, tagLength_);
+}
+
+void NeighborMatrixFile::toCsr(CsrMatrix& A, std::vector<std::string>& tags,
+                               std::vector<double>& rawCounts) const {
+    A.numRows = numTags_;
+    A.numCols = numTags_;
+    A.rowPtr.assign(rowOffsets_, rowOffsets_ + numTags_ + 1);
+    A.colIdx.assign(colIndex_, colIndex_ + nnz_);
+    A.values.assign(values_, values_ + nnz_);
+
+    tags.clear();
+    tags.reserve(numTags_);
+    for (std::uint64_t i = 0; i < numTags_; i++) {
+        tags.push_back(tag(i));
+    }
+
+    rawCounts.assign(rawCounts_, rawCounts_ + numTags_);
+}
@@ -0,0 +1,158 @@
+/**
+ * @file NeighborMatrixFile.hh
+ * @brief Binary, memory-mappable CSR form of the tag neighbor matrix
+ *
+ * The EstimateTrueCount_* programs normally rebuild the read-error matrix
+ * from three text files (.nb, .prop, .nbq) plus the quality file.  This
+ * module defines a single binary file (.nbm) holding the finished matrix
+ * in compressed sparse row form, so the estimators can map it and start
+ * the EM immediately.
+ *
+ * File layout (native byte order, every section 8-byte aligned):
+ * - NeighborMatrixHeader
+ * - tags        : numTags records of tagLength ACGT characters
+ * - rowOffsets  : numTags + 1 std::uint64_t
+ * - colIndex    : nnz std::uint32_t
+ * - values      : nnz double (misread probability, diagonal included)
+ * - rawCounts   : numTags double
+ *
+ * Row i holds the entries of matrix row i; its diagonal entry comes first,
+ * followed by the neighbors in the order FindNeighboursWithQual generates
+ * them.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef NEIGHBOR_MATRIX_FILE_HH
+#define NEIGHBOR_MATRIX_FILE_HH
+
+#include "SparseMatrixBuilder.hh"
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-size header at the start of a .nbm file
+ */
+struct NeighborMatrixHeader {
+    char magic[8];            ///< "NGSNBM\0\0"
+    std::uint32_t version;    ///< Format version, currently 2
+    std::uint32_t tagLength;  ///< Length of every tag in bases
+    std::uint64_t numTags;    ///< Number of rows (and columns)
+    std::uint64_t nnz;        ///< Number of stored entries
+    std::uint64_t byteOrder;  ///< 0x0102030405060708 in the writer's byte order
+    std::uint64_t sourceSize;   ///< Size of the tag file the matrix was built from
+    std::int64_t sourceMtime;   ///< Its modification time, in ns since the epoch
+};
+
+/**
+ * @brief Write a neighbor matrix in .nbm format
+ *
+ * @param fileName  Output file name
+ * @param tags      Tag sequences, all of the same length
+ * @param A         Read-error matrix, one row per tag
+ * @param rawCounts Observed count of every tag
+ * @param sourceFileName Tag file the matrix was built from; its size and
+ *                  modification time are stored for openIfCurrent
+ * @return true on success, false if the file could not be written
+ */
+bool WriteNeighborMatrixFile(const std::string& fileName, const std::vector<std::string>& tags,
+                             const CsrMatrix& A, const std::vector<double>& rawCounts,
+                             const std::string& sourceFileName = std::string());
+
+/**
+ * @brief Read-only, memory-mapped view of a .nbm file
+ *
+ * @par Example:
+ * @code
+ * NeighborMatrixFile nbm;
+ * if (nbm.open("sample.nbm")) {
+ *     const std::uint64_t* rows = nbm.rowOffsets();
+ *     // rows[i] .. rows[i+1] index colIndex() and values() of row i
+ * }
+ * @endcode
+ */
+class NeighborMatrixFile {
+   public:
+    NeighborMatrixFile();
+    ~NeighborMatrixFile();
+
+    NeighborMatrixFile(const NeighborMatrixFile&) = delete;
+    NeighborMatrixFile& operator=(const NeighborMatrixFile&) = delete;
+
+    /**
+     * @brief Map a .nbm file
+     *
+     * A missing file is not an error (the caller falls back to the text
+     * files); a file that exists but is malformed is reported on stderr.
+     * Row offsets that decrease and column indices out of range count as
+     * malformed, so the arrays can be indexed without further checks.
+     *
+     * @param fileName File to map
+     * @return true if the file was mapped and validated
+     */
+    bool open(const std::string& fileName);
+
+    /**
+     * @brief Map a .nbm file only if it still matches its input
+     *
+     * FindNeighboursWithQual writes the .nbm right after the .nb file, and
+     * stores the size and modification time of the tag file it read.  A
+     * .nbm older than nbFileName, or whose stored size or time differs
+     * from sourceFileName, belongs to an earlier run; it is reported on
+     * stderr and not mapped.  Only the two files are stat'ed; missing ones
+     * are not checked.
+     *
+     * @param fileName       File to map
+     * @param nbFileName     Neighbor list of the same input
+     * @param sourceFileName Tag file the estimator was given
+     * @return true if the file was mapped, validated and is current
+     */
+    bool openIfCurrent(const std::string& fileName, const std::string& nbFileName,
+                       const std::string& sourceFileName);
+
+    /// Unmap the file
+    void close();
+
+    bool isOpen() const { return base_ != nullptr; }
+    std::uint64_t numTags() const { return numTags_; }
+    std::uint64_t nnz() const { return nnz_; }
+    unsigned tagLength() const { return tagLength_; }
+
+    /// Tag sequence of row i
+    std::string tag(std::uint64_t i) const;
+
+    const std::uint64_t* rowOffsets() const { return rowOffsets_; }
+    const std::uint32_t* colIndex() const { return colIndex_; }
+    const double* values() const { return values_; }
+    const double* rawCounts() const { return rawCounts_; }
+
+    /**
+     * @brief Copy out the matrix, tag list and raw counts used by the estimators
+     *
+     * Replaces the text parsing step; the copies are straight memory copies.
+     */
+    void toCsr(CsrMatrix& A, std::vector<std::string>& tags,
+               std::vector<double>& rawCounts) const;
+
+   private:
+    void* base_;
+    std::size_t mapSize_;
+    std::uint64_t numTags_;
+    std::uint64_t nnz_;
+    std::uint64_t sourceSize_;
+    std::int64_t sourceMtime_;
+    unsigned tagLength_;
+    const char* tags_;
+    const std::uint64_t* rowOffsets_;
+    const std::uint32_t* colIndex_;
+    const double* values_;
+    const double* rawCounts_;
+};
+
+#endif  // NEIGHBOR_MATRIX_FILE_HH
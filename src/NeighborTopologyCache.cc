@@ -0,0 +1,86 @@
+#include "NeighborTopologyCache.hh"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+void BuildNeighborTopology(std::string_view digits, const std::vector<double>& tagProp,
+                           NeighborTopology& topology) {
+    topology.nbText.clear();
+    topology.shares.clear();
+
+    // Numeric value of the tag in base 4; neighbors beyond 31 bases can
+    // never fall inside the .prop numbering
+    const int TagLen = static_cast<int>(digits.size());
+    std::uint64_t tagVal = 0;
+    for (int p = 0; p < TagLen && TagLen <= 31; p++) {
+        tagVal = (tagVal << 2) | static_cast<std::uint64_t>(digits[p] - '0');
+    }
+
+    std::string neighbor(digits);
+    topology.nbText.reserve(3 * digits.size() * (digits.size() + 1));
+
+    for (int p = 0; p < TagLen; p++) {
+        const int own = digits[p] - '0';
+        std::uint64_t nbVal[3];
+
+        for (int b = 1; b <= 3; b++) {
+            int bval = b;
+            if (own == b) {
+                bval = 0;
+            }
+
+            neighbor[p] = static_cast<char>('0' + bval);
+            topology.nbText.append(neighbor);
+            topology.nbText.push_back('\t');
+
+            nbVal[b - 1] = tagProp.size();
+            if (TagLen <= 31) {
+                std::uint64_t place = std::uint64_t(1) << (2 * (TagLen - 1 - p));
+                nbVal[b - 1] = tagVal + (bval - own) * place;
+            }
+        }
+        neighbor[p] = digits[p];
+
+        double nbProp[3];
+        double propSum = 0.0;
+        for (int b = 0; b < 3; b++) {
+            nbProp[b] = (nbVal[b] < tagProp.size()) ? tagProp[nbVal[b]] : 0.0;
+            propSum += nbProp[b];
+        }
+
+        for (int b = 0; b < 3; b++) {
+            if (nbProp[b] > 0) {
+                topology.shares.push_back({static_cast<std::uint32_t>(p),
+                                           static_cast<std::uint32_t>(nbVal[b]), nbProp[b],
+                                           propSum});
+            }
+        }
+    }
+}
+
+
+NeighborTopologyCache::NeighborTopologyCache(std::size_t maxTags)
+    : index_(maxTags), maxTags_(maxTags < 1 ? 1 : maxTags) {}
+
+const NeighborTopology* NeighborTopologyCache::find(std::string_view digits) const {
+    int slot = index_.find(digits);
+    return slot == TagIndex::npos ? nullptr : &topologies_[slot];
+}
+
+const NeighborTopology* NeighborTopologyCache::insert(std::string_view digits,
+                                                      const NeighborTopology& topology) {
+    if (topologies_.size() >= maxTags_) {
+        index_ = TagIndex(maxTags_);
+        topologies_.clear();
+    }
+
+    if (!index_.insert(digits, static_cast<int>(topologies_.size()))) {
+        return nullptr;
+    }
+    topologies_.push_back(topology);
+    return &topologies_.back();
+}
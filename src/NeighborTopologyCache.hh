@@ -0,0 +1,103 @@
+/**
+ * @file NeighborTopologyCache.hh
+ * @brief Quality-independent part of a tag's Hamming distance 1 neighbors
+ *
+ * The neighbors of a tag, and where they fall in the .prop numbering used
+ * for the binary neighbor matrix, depend only on the tag.  Only their error
+ * probabilities depend on the read's qualities.  FindNeighboursWithQual
+ * builds this topology once per distinct tag and keeps it in a cache keyed
+ * on the 2-bit packed tag, so that a tag read many times with different
+ * qualities only has its probabilities recomputed.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef NEIGHBOR_TOPOLOGY_CACHE_HH
+#define NEIGHBOR_TOPOLOGY_CACHE_HH
+
+#include "TagIndex.hh"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A substitution whose neighbor has a proportion in the .prop table
+ */
+struct NeighborShare {
+    std::uint32_t position;  ///< Substituted position
+    std::uint32_t neighbor;  ///< Neighbor's entry in the proportion table
+    double prop;             ///< Proportion of the neighbor
+    double propSum;          ///< Summed proportion of the 3 substitutions at position
+};
+
+/**
+ * @brief Neighbors of a tag at Hamming distance 1
+ *
+ * The neighbors are in the order FindNeighboursWithQual writes them: for
+ * each position, substitutions 1, 2 and 3, with 0 in place of the tag's own
+ * base.
+ */
+struct NeighborTopology {
+    std::string nbText;                ///< Neighbor keys for the .nb line, each followed by a tab
+    std::vector<NeighborShare> shares;  ///< Neighbors present in the proportion table
+};
+
+/**
+ * @brief Build the topology of a tag
+ *
+ * @param digits   Tag written in '0'-'3'
+ * @param tagProp  Proportion of every tag, indexed by its value in base 4
+ *                 (empty when no neighbor matrix is written)
+ * @param topology Result
+ */
+void BuildNeighborTopology(std::string_view digits, const std::vector<double>& tagProp,
+                           NeighborTopology& topology);
+
+/**
+ * @brief Topologies of recently seen tags, keyed on the packed tag
+ *
+ * Holds at most maxTags tags, all of one length.  When full it is emptied
+ * before the next insertion, so memory stays bounded however many distinct
+ * tags the input has.
+ *
+ * @par Example:
+ * @code
+ * NeighborTopologyCache cache;
+ * const NeighborTopology* t = cache.find(digits);
+ * if (t == nullptr) {
+ *     BuildNeighborTopology(digits, tagProp, scratch);
+ *     t = cache.insert(digits, scratch);
+ * }
+ * @endcode
+ */
+class NeighborTopologyCache {
+   public:
+    /// @param maxTags Number of tags held before the cache is emptied
+    explicit NeighborTopologyCache(std::size_t maxTags = 4096);
+
+    /// Cached topology of a tag, or nullptr; valid until the next insert
+    const NeighborTopology* find(std::string_view digits) const;
+
+    /**
+     * @brief Cache the topology of a tag
+     * @return The cached copy, valid until the next insert, or nullptr if
+     *         the tag cannot be cached (not packable, of another length
+     *         than the cached tags, or already cached)
+     */
+    const NeighborTopology* insert(std::string_view digits, const NeighborTopology& topology);
+
+    std::size_t size() const { return topologies_.size(); }
+
+   private:
+    TagIndex index_;
+    std::vector<NeighborTopology> topologies_;
+    std::size_t maxTags_;
+};
+
+#endif  // NEIGHBOR_TOPOLOGY_CACHE_HH
@@ -0,0 +1,157 @@
+/**
+ * @file QualityModel.hh
+ * @brief Base error probabilities of quality scores, through lookup tables
+ *
+ * Every neighbor generator turns each base's quality score into the
+ * probability that the base was misread, with a log10, and two pow() calls
+ * for Solexa scores.  Quality scores are nearly always integers, so
+ * QualityModel computes the probabilities of every integer score once, and
+ * looks them up; other scores (e.g. averaged qualities) fall back on the
+ * same formulas, so both paths agree.
+ *
+ * Solexa scores are converted to Phred first:
+ *   phred = 10 log10(1 + 10^(solexa / 10)),  error = 10^(-phred / 10)
+ * and an error is shared equally by the three other bases.  Scores given as
+ * ASCII characters are decoded with AsciiToScore (Phred+33, Phred+64 or
+ * Solexa+64).
+ *
+ * The tools of ematch_src and knapsack_src include this header from src/.
+ * They were written with log(x) / log(10) and a division by 3, which round
+ * differently in the last bits, so they ask for QualityFormula::LogRatio
+ * and their output is unchanged.  src/quality_model.py is its Python
+ * counterpart.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef QUALITY_MODEL_HH
+#define QUALITY_MODEL_HH
+
+#include <cmath>
+
+/// How quality scores relate to error probabilities
+enum class QualityScale {
+    Solexa,  ///< Solexa scores: 10 log10(p / (1 - p)), may be negative
+    Phred    ///< Phred scores: -10 log10(p)
+};
+
+/// How the conversions are evaluated, to the last bit
+enum class QualityFormula {
+    Log10,    ///< log10(x), and the error times 1/3
+    LogRatio  ///< log(x) / log(10), and the error divided by 3
+};
+
+/**
+ * @brief Error probabilities of quality scores of one scale
+ *
+ * @par Example:
+ * @code
+ * const QualityModel solexa(QualityScale::Solexa);
+ * double e = solexa.baseErrProb(20);       // table lookup
+ * double f = solexa.baseErrProb(20.5);     // computed
+ * double g = QualityModel(QualityScale::Phred)
+ *                .errProb(AsciiToScore('I', kPhred33Offset));  // Q40
+ * const QualityModel juxt(QualityScale::Solexa, QualityFormula::LogRatio);
+ * @endcode
+ */
+class QualityModel {
+   public:
+    /// Range of the integer scores held in the tables
+    static constexpr int kMinScore = -64;
+    static constexpr int kMaxScore = 127;
+
+    explicit QualityModel(QualityScale scale = QualityScale::Solexa,
+                          QualityFormula formula = QualityFormula::Log10)
+        : scale_(scale), formula_(formula) {
+        for (int q = kMinScore; q <= kMaxScore; q++) {
+            errProb_[q - kMinScore] = computeErrProb(q);
+            baseErrProb_[q - kMinScore] = shareErrProb(errProb_[q - kMinScore]);
+            negLogBaseErrProb_[q - kMinScore] = -std::log(baseErrProb_[q - kMinScore]);
+        }
+    }
+
+    QualityScale scale() const { return scale_; }
+    QualityFormula formula() const { return formula_; }
+
+    /// Phred score of a score
+    double phred(double score) const {
+        if (scale_ == QualityScale::Phred) {
+            return score;
+        }
+        return formula_ == QualityFormula::Log10 ? SolexaToPhred(score)
+                                                 : SolexaToPhredLogRatio(score);
+    }
+
+    /// Probability that a base of this score was misread
+    double errProb(double score) const {
+        int q;
+        return tableIndex(score, q) ? errProb_[q] : computeErrProb(score);
+    }
+
+    /// Probability that a base of this score was misread as one given other base
+    double baseErrProb(double score) const {
+        int q;
+        return tableIndex(score, q) ? baseErrProb_[q] : shareErrProb(computeErrProb(score));
+    }
+
+    /// -log of baseErrProb, the weight of a substitution in a knapsack of -log probabilities
+    double negLogBaseErrProb(double score) const {
+        int q;
+        return tableIndex(score, q) ? negLogBaseErrProb_[q]
+                                    : -std::log(shareErrProb(computeErrProb(score)));
+    }
+
+    /// Phred score of a Solexa score
+    static double SolexaToPhred(double solexa) {
+        return 10.0 * std::log10(1.0 + std::pow(10.0, solexa / 10.0));
+    }
+
+    /// SolexaToPhred as QualityFormula::LogRatio evaluates it
+    static double SolexaToPhredLogRatio(double solexa) {
+        return 10.0 * std::log(1.0 + std::pow(10.0, solexa / 10.0)) / std::log(10.0);
+    }
+
+    /// Error probability of a Phred score
+    static double PhredToErrProb(double phred) { return std::pow(10.0, -phred / 10.0); }
+
+   private:
+    static constexpr double kOneThird = 1.0 / 3.0;
+    static constexpr int kTableSize = kMaxScore - kMinScore + 1;
+
+    double computeErrProb(double score) const { return PhredToErrProb(phred(score)); }
+
+    // Share of an error for one of the three other bases
+    double shareErrProb(double errProb) const {
+        return formula_ == QualityFormula::Log10 ? errProb * kOneThird : errProb / 3;
+    }
+
+    // Index of an integer score in the tables
+    static bool tableIndex(double score, int& index) {
+        if (!(score >= kMinScore && score <= kMaxScore)) {
+            return false;
+        }
+        int q = static_cast<int>(score);
+        index = q - kMinScore;
+        return q == score;
+    }
+
+    QualityScale scale_;
+    QualityFormula formula_;
+    double errProb_[kTableSize];
+    double baseErrProb_[kTableSize];
+    double negLogBaseErrProb_[kTableSize];
+};
+
+/// ASCII offsets of the FASTQ quality encodings
+constexpr int kPhred33Offset = 33;  ///< Sanger and Illumina 1.8+, Phred scores
+constexpr int kPhred64Offset = 64;  ///< Illumina 1.3 to 1.7, Phred scores
+constexpr int kSolexa64Offset = 64;  ///< Solexa and Illumina 1.0, Solexa scores
+
+/// Score of an ASCII encoded quality character
+inline int AsciiToScore(char c, int offset) {
+    return static_cast<int>(static_cast<unsigned char>(c)) - offset;
+}
+
+#endif  // QUALITY_MODEL_HH
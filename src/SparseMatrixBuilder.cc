@@ -0,0 +1,109 @@
+#include "SparseMatrixBuilder.hh"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _OPENMP
+#include <omp.h>
+
+namespace {
+
+// Below this many entries a product is cheaper than waking the threads
+const std::size_t kMinParallelNnz = 1 << 15;
+
+}  // namespace
+#endif
+
+SparseMatrixBuilder::SparseMatrixBuilder(std::size_t numCols, std::size_t expectedNnz) {
+    matrix_.numCols = numCols;
+    matrix_.rowPtr.reserve(numCols + 1);
+    matrix_.rowPtr.push_back(0);
+    matrix_.colIdx.reserve(expectedNnz);
+    matrix_.values.reserve(expectedNnz);
+}
+
+CsrMatrix SparseMatrixBuilder::finish() {
+    matrix_.numRows = matrix_.rowPtr.size() - 1;
+
+    CsrMatrix A = std::move(matrix_);
+    matrix_ = CsrMatrix();
+    matrix_.numCols = A.numCols;
+    matrix_.rowPtr.push_back(0);
+    rejected_ = false;
+    return A;
+}
+
+CsrMatrix TransposeCsr(const CsrMatrix& A) {
+    CsrMatrix At;
+    At.numRows = A.numCols;
+    At.numCols = A.numRows;
+    At.rowPtr.assign(A.numCols + 1, 0);
+    At.colIdx.resize(A.nnz());
+    At.values.resize(A.nnz());
+
+    // Count the entries of every column of A
+    for (std::size_t k = 0; k < A.nnz(); k++) {
+        At.rowPtr[A.colIdx[k] + 1]++;
+    }
+    for (std::size_t j = 0; j < A.numCols; j++) {
+        At.rowPtr[j + 1] += At.rowPtr[j];
+    }
+
+    // Scatter; walking A row by row keeps every column in row order
+    std::vector<std::uint64_t> next(At.rowPtr.begin(), At.rowPtr.end() - 1);
+    for (std::size_t i = 0; i < A.numRows; i++) {
+        for (std::uint64_t k = A.rowPtr[i]; k < A.rowPtr[i + 1]; k++) {
+            std::uint64_t dst = next[A.colIdx[k]]++;
+            At.colIdx[dst] = static_cast<std::uint32_t>(i);
+            At.values[dst] = A.values[k];
+        }
+    }
+
+    return At;
+}
+
+std::vector<std::size_t> PartitionRowsByNnz(const CsrMatrix& A, std::size_t parts) {
+    std::vector<std::size_t> bounds(parts + 1, A.numRows);
+    bounds[0] = 0;
+
+    for (std::size_t t = 1; t < parts; t++) {
+        std::uint64_t target = A.nnz() * t / parts;
+        auto it = std::lower_bound(A.rowPtr.begin(), A.rowPtr.begin() + A.numRows, target);
+        bounds[t] = std::max(bounds[t - 1], static_cast<std::size_t>(it - A.rowPtr.begin()));
+    }
+
+    return bounds;
+}
+
+std::size_t SpmvPartCount(const CsrMatrix& A) {
+#ifdef _OPENMP
+    return A.nnz() >= kMinParallelNnz ? static_cast<std::size_t>(omp_get_max_threads()) : 1;
+#else
+    (void)A;
+    return 1;
+#endif
+}
+
+std::vector<double> MultiplyCsr(const CsrMatrix& A, const std::vector<double>& x) {
+    std::vector<double> y(A.numRows, 0.0);
+
+    const std::vector<std::size_t> bounds = PartitionRowsByNnz(A, SpmvPartCount(A));
+    const long parts = static_cast<long>(bounds.size() - 1);
+
+#pragma omp parallel for schedule(static, 1) if (parts > 1)
+    for (long t = 0; t < parts; t++) {
+        for (std::size_t i = bounds[t]; i < bounds[t + 1]; i++) {
+            double sum = 0.0;
+            for (std::uint64_t k = A.rowPtr[i]; k < A.rowPtr[i + 1]; k++) {
+                sum += A.values[k] * x[A.colIdx[k]];
+            }
+            y[i] = sum;
+        }
+    }
+
+    return y;
+}
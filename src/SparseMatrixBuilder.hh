@@ -0,0 +1,142 @@
+/**
+ * @file SparseMatrixBuilder.hh
+ * @brief Direct CSR/CSC assembly of the read-error matrix
+ *
+ * The estimators used to collect every nonzero as a small heap-allocated
+ * vector, sort the triplets and copy them into coordinate arrays.  The
+ * matrix rows are produced in order (one row per tag line), so the CSR
+ * arrays can instead be appended to directly; the CSC form needed for the
+ * transposed product is then obtained with one counting pass and one
+ * scatter pass over the CSR arrays.  Neither step sorts or allocates per
+ * entry.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef SPARSE_MATRIX_BUILDER_HH
+#define SPARSE_MATRIX_BUILDER_HH
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Sparse matrix in compressed sparse row form
+ *
+ * The CSC form of a matrix is stored as the CsrMatrix of its transpose.
+ */
+struct CsrMatrix {
+    std::size_t numRows = 0;
+    std::size_t numCols = 0;
+    std::vector<std::uint64_t> rowPtr;  ///< numRows + 1 offsets into colIdx/values
+    std::vector<std::uint32_t> colIdx;  ///< Column of every entry
+    std::vector<double> values;         ///< Value of every entry
+
+    std::size_t nnz() const { return values.size(); }
+};
+
+/**
+ * @brief Builds a CsrMatrix one row at a time
+ *
+ * @par Example:
+ * @code
+ * SparseMatrixBuilder builder(numTags);
+ * for (each tag line) {
+ *     builder.addEntry(row, mainTagProp);
+ *     for (each neighbor) builder.addEntry(col, prob);
+ *     builder.endRow();
+ * }
+ * CsrMatrix A = builder.finish();
+ * CsrMatrix At = TransposeCsr(A);
+ * @endcode
+ */
+class SparseMatrixBuilder {
+   public:
+    /**
+     * @param numCols     Number of columns of the matrix
+     * @param expectedNnz Capacity hint for the entry arrays
+     */
+    explicit SparseMatrixBuilder(std::size_t numCols, std::size_t expectedNnz = 0);
+
+    /**
+     * @brief Append an entry to the current row
+     *
+     * An entry outside the column range is not stored; it is remembered so
+     * the caller can report the inconsistent input (see hasRejectedEntries).
+     *
+     * @return false if col >= numCols
+     */
+    bool addEntry(std::uint32_t col, double value) {
+        if (col >= matrix_.numCols) {
+            rejected_ = true;
+            return false;
+        }
+        matrix_.colIdx.push_back(col);
+        matrix_.values.push_back(value);
+        return true;
+    }
+
+    /// Close the current row and start the next one
+    void endRow() { matrix_.rowPtr.push_back(matrix_.values.size()); }
+
+    /// Number of completed rows
+    std::size_t numRows() const { return matrix_.rowPtr.size() - 1; }
+
+    /// Whether addEntry was given a column out of range since the last finish()
+    bool hasRejectedEntries() const { return rejected_; }
+
+    /// Hand over the assembled matrix; the builder is left empty
+    CsrMatrix finish();
+
+   private:
+    CsrMatrix matrix_;
+    bool rejected_ = false;
+};
+
+/**
+ * @brief CSR form of the transpose (i.e. the CSC form of A)
+ *
+ * Counts the entries of every column, turns the counts into offsets and
+ * scatters the entries; runs in O(nnz + numCols) without sorting.
+ */
+CsrMatrix TransposeCsr(const CsrMatrix& A);
+
+/**
+ * @brief Split the rows of A into contiguous blocks of about equal nnz
+ *
+ * Used to hand every thread the same amount of work in a row-parallel
+ * product; a block boundary is found by binary search in rowPtr, so this
+ * is O(parts log numRows).
+ *
+ * @param A     CSR matrix
+ * @param parts Number of blocks
+ * @return parts + 1 row boundaries, the first 0 and the last A.numRows
+ */
+std::vector<std::size_t> PartitionRowsByNnz(const CsrMatrix& A, std::size_t parts);
+
+/**
+ * @brief Number of row blocks to use for a parallel product over A
+ *
+ * The number of OpenMP threads, or 1 if OpenMP is disabled or A is too
+ * small for threading to pay off.
+ */
+std::size_t SpmvPartCount(const CsrMatrix& A);
+
+/**
+ * @brief Sparse matrix-vector product y = A x
+ *
+ * Every y_i is a gather over row i, so rows can be computed in parallel
+ * without atomics or per-thread buffers; with OpenMP the rows are split
+ * by PartitionRowsByNnz.  Multiplying by TransposeCsr(A) gives A^T x the
+ * same way.
+ *
+ * @param A CSR matrix
+ * @param x Dense vector of length A.numCols
+ * @return Dense vector of length A.numRows
+ */
+std::vector<double> MultiplyCsr(const CsrMatrix& A, const std::vector<double>& x);
+
+#endif  // SPARSE_MATRIX_BUILDER_HH
@@ -0,0 +1,149 @@
+#include "TagIndex.hh"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+// 2-bit code of a base in either alphabet, or -1
+inline int baseCode(char c) {
+    switch (c) {
+        case '0':
+        case 'A':
+            return 0;
+        case '1':
+        case 'C':
+            return 1;
+        case '2':
+        case 'G':
+            return 2;
+        case '3':
+        case 'T':
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+// splitmix64 finalizer; spreads nearby packed tags over the whole table
+inline std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+}  // namespace
+
+
+bool PackTag(std::string_view tag, PackedTag& packed) {
+    if (tag.size() > 64) {
+        return false;
+    }
+
+    packed.hi = 0;
+    packed.lo = 0;
+    for (char c : tag) {
+        int code = baseCode(c);
+        if (code < 0) {
+            return false;
+        }
+        packed.hi = (packed.hi << 2) | (packed.lo >> 62);
+        packed.lo = (packed.lo << 2) | static_cast<std::uint64_t>(code);
+    }
+
+    return true;
+}
+
+
+TagIndex::TagIndex(std::size_t expectedSize) : mask_(0), size_(0), tagLength_(0) {
+    // Keep the load factor at or below one half
+    std::size_t capacity = 16;
+    while (capacity < 2 * expectedSize) {
+        capacity <<= 1;
+    }
+    slots_.resize(capacity);
+    mask_ = capacity - 1;
+}
+
+std::size_t TagIndex::slotOf(const PackedTag& key) const {
+    return mix(key.lo ^ mix(key.hi)) & mask_;
+}
+
+void TagIndex::grow() {
+    std::vector<Slot> old;
+    old.swap(slots_);
+    slots_.resize(old.size() * 2);
+    mask_ = slots_.size() - 1;
+
+    for (const Slot& s : old) {
+        if (s.ord != npos) {
+            std::size_t i = slotOf(s.key);
+            while (slots_[i].ord != npos) {
+                i = (i + 1) & mask_;
+            }
+            slots_[i] = s;
+        }
+    }
+}
+
+bool TagIndex::insert(std::string_view tag, int ord) {
+    PackedTag key;
+    if (ord == npos || !PackTag(tag, key)) {
+        return false;
+    }
+    if (size_ == 0) {
+        tagLength_ = tag.size();
+    } else if (tag.size() != tagLength_) {
+        return false;
+    }
+
+    if (2 * (size_ + 1) > slots_.size()) {
+        grow();
+    }
+
+    std::size_t i = slotOf(key);
+    while (slots_[i].ord != npos) {
+        if (slots_[i].key == key) {
+            return false;
+        }
+        i = (i + 1) & mask_;
+    }
+
+    slots_[i].key = key;
+    slots_[i].ord = ord;
+    size_++;
+    return true;
+}
+
+int TagIndex::find(const PackedTag& key) const {
+    std::size_t i = slotOf(key);
+    while (slots_[i].ord != npos) {
+        if (slots_[i].key == key) {
+            return slots_[i].ord;
+        }
+        i = (i + 1) & mask_;
+    }
+    return npos;
+}
+
+int TagIndex::find(std::string_view tag) const {
+    PackedTag key;
+    if (tag.size() != tagLength_ || !PackTag(tag, key)) {
+        return npos;
+    }
+    return find(key);
+}
+
+void TagIndex::findAll(const std::vector<std::string>& tags, std::vector<int>& ords) const {
+    ords.resize(tags.size());
+    for (std::size_t i = 0; i < tags.size(); i++) {
+        ords[i] = find(tags[i]);
+    }
+}
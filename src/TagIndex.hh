@@ -0,0 +1,102 @@
+/**
+ * @file TagIndex.hh
+ * @brief Hash index from tags to their ordinal, keyed on 2-bit packed tags
+ *
+ * The estimators look up every neighbor of every tag.  Keying a std::map on
+ * the tag string costs about log2(n) string comparisons per lookup; here a
+ * tag is packed two bits per base into a 128-bit integer key (so tags of up
+ * to 64 bases are supported) and stored in an open-addressing hash table
+ * with linear probing, so a lookup is a hash plus, typically, one or two
+ * probes into a contiguous array.
+ *
+ * Both alphabets used in the pipeline are accepted and pack identically:
+ * the numeric form written by FindNeighboursWithQual ('0'-'3') and ACGT.
+ *
+ * @author Edward Wijaya
+ * @date 2009-2025
+ * @copyright Copyright 2009-2025, NGSFeatures Project
+ */
+
+#ifndef TAG_INDEX_HH
+#define TAG_INDEX_HH
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A tag of up to 64 bases packed two bits per base
+ */
+struct PackedTag {
+    std::uint64_t hi = 0;  ///< Bases beyond the last 32
+    std::uint64_t lo = 0;  ///< Last (up to) 32 bases
+
+    bool operator==(const PackedTag& o) const { return hi == o.hi && lo == o.lo; }
+};
+
+/**
+ * @brief Pack a tag written in '0'-'3' or ACGT
+ *
+ * @param tag    Tag to pack
+ * @param packed Packed result
+ * @return false if the tag is longer than 64 bases or has another character
+ */
+bool PackTag(std::string_view tag, PackedTag& packed);
+
+/**
+ * @brief Open-addressing hash map from packed tag to ordinal
+ *
+ * All tags in one index must have the same length; lookups of a tag with
+ * a different length simply miss.
+ *
+ * @par Example:
+ * @code
+ * TagIndex index;
+ * index.insert("0123", 0);
+ * int ord = index.find("0123");   // 0
+ * int none = index.find("0120");  // TagIndex::npos
+ * @endcode
+ */
+class TagIndex {
+   public:
+    static constexpr int npos = -1;
+
+    /// @param expectedSize Number of tags the index will hold
+    explicit TagIndex(std::size_t expectedSize = 0);
+
+    /**
+     * @brief Add a tag; like std::map::insert the first ordinal of a tag wins
+     * @return false if the tag was already present or cannot be packed
+     */
+    bool insert(std::string_view tag, int ord);
+
+    /// Ordinal of a tag, or npos
+    int find(std::string_view tag) const;
+
+    /// Ordinal of an already packed tag, or npos
+    int find(const PackedTag& key) const;
+
+    /// Ordinal of every tag in tags (npos where absent)
+    void findAll(const std::vector<std::string>& tags, std::vector<int>& ords) const;
+
+    std::size_t size() const { return size_; }
+
+   private:
+    struct Slot {
+        PackedTag key;
+        int ord = npos;
+    };
+
+    std::size_t slotOf(const PackedTag& key) const;
+    void grow();
+
+    std::vector<Slot> slots_;
+    std::size_t mask_;
+    std::size_t size_;
+    std::size_t tagLength_;
+};
+
+#endif  // TAG_INDEX_HH
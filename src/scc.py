@@ -15,30 +15,13 @@ Optimizations:
 
 import sys
 import argparse
-import math
 from pathlib import Path
 from typing import Dict, List
 from collections import defaultdict
 
-
-# Pre-compute logarithm for optimization
-LOG10 = math.log(10.0)
-
-
-def solexa2phred(sq: float) -> float:
-    """
-    Convert Solexa quality score to Phred quality score.
-    Optimized with log10 instead of log(x)/log(10).
-    """
-    return 10.0 * math.log10(1.0 + 10.0 ** (sq / 10.0))
-
-
-def phred2errprob(pq: float) -> float:
-    """
-    Convert Phred quality score to error probability.
-    Optimized with direct calculation.
-    """
-    return 10.0 ** (-pq / 10.0)
+from quality_model import SOLEXA, err_prob
+from quality_model import phred_to_err_prob as phred2errprob  # noqa: F401
+from quality_model import solexa_to_phred as solexa2phred  # noqa: F401
 
 
 def multiply_quals(quals_str: str) -> float:
@@ -48,15 +31,13 @@ def multiply_quals(quals_str: str) -> float:
     Optimized:
     - Single pass through quality scores
     - Avoids intermediate list creation
-    - Pre-computed constants
+    - Error probabilities of integer scores looked up in quality_model's tables
     """
     quals = map(float, quals_str.split())
 
     prod = 1.0
     for sq in quals:
-        phred = solexa2phred(sq)
-        err_prob = phred2errprob(phred)
-        pci = 1.0 - err_prob  # probability of no mismatch
+        pci = 1.0 - err_prob(sq, SOLEXA)  # probability of no mismatch
         prod *= pci
 
     return 1.0 - prod
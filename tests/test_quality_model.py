@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the quality score lookup tables.
+"""
+import math
+import sys
+from pathlib import Path
+
+# Add src to path for imports
+sys.path.insert(0, str(Path(__file__).parent.parent / "src"))
+
+import pytest
+from quality_model import (
+    MAX_SCORE,
+    MIN_SCORE,
+    PHRED,
+    PHRED33_OFFSET,
+    SOLEXA,
+    ascii_to_score,
+    base_err_prob,
+    err_prob,
+    phred_to_err_prob,
+    solexa_to_phred,
+)
+
+
+class TestErrProb:
+    """Tests for the error probabilities of quality scores."""
+
+    def test_table_matches_formula(self) -> None:
+        """Test that integer scores give exactly the computed probabilities."""
+        for q in range(MIN_SCORE, MAX_SCORE + 1):
+            assert err_prob(q) == phred_to_err_prob(solexa_to_phred(q))
+            assert err_prob(q, PHRED) == phred_to_err_prob(q)
+
+    def test_float_integer_scores(self) -> None:
+        """Test that scores parsed as floats use the same table entries."""
+        assert err_prob(20.0) == err_prob(20)
+
+    def test_non_integer_score(self) -> None:
+        """Test that non-integer scores fall back on the formula."""
+        assert err_prob(20.5) == phred_to_err_prob(solexa_to_phred(20.5))
+        assert err_prob(21) < err_prob(20.5) < err_prob(20)
+
+    def test_out_of_range_score(self) -> None:
+        """Test scores beyond the tables."""
+        assert err_prob(200, PHRED) == phred_to_err_prob(200)
+        assert err_prob(-100) == pytest.approx(1.0)
+
+    def test_phred_scale(self) -> None:
+        """Test Phred score error probabilities."""
+        assert err_prob(10, PHRED) == pytest.approx(0.1)
+        assert err_prob(30, PHRED) == pytest.approx(0.001)
+
+    def test_base_err_prob(self) -> None:
+        """Test that an error is shared by the three other bases."""
+        assert base_err_prob(20, PHRED) == pytest.approx(0.01 / 3.0)
+
+
+class TestAsciiToScore:
+    """Tests for decoding ASCII quality characters."""
+
+    def test_phred33(self) -> None:
+        """Test Sanger encoded qualities."""
+        assert ascii_to_score("I", PHRED33_OFFSET) == 40
+        assert ascii_to_score("!", PHRED33_OFFSET) == 0
+
+
+def test_solexa_matches_phred_at_high_scores() -> None:
+    """Test that Solexa and Phred scores agree for good bases."""
+    assert solexa_to_phred(40) == pytest.approx(40.0, abs=1e-3)
+    assert not math.isclose(solexa_to_phred(0), 0.0)
+    assert err_prob(40) == pytest.approx(err_prob(40, PHRED), rel=1e-3)
+    assert SOLEXA != PHRED
@@ -0,0 +1,70 @@
+// Unit tests for the block-buffered text writer
+// Copyright 2025, NGSFeatures Project
+
+#include "BufferedWriter.hh"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cmath>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::string ReadFile(const std::string& fileName) {
+    std::ifstream in(fileName.c_str());
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+}  // namespace
+
+class BufferedWriterTest : public ::testing::Test {
+   protected:
+    void TearDown() override { std::remove(fileName.c_str()); }
+
+    std::string fileName = "test_buffered_writer.out";
+};
+
+TEST_F(BufferedWriterTest, DoublesMatchOstream) {
+    std::vector<double> values = {0.0,     1.0,     -2.5,        1e-05,  0.000123456789, 3.0 / 7.0,
+                                  1234567, 1e+100,  2.5e-300,    100000, 0.1 + 0.2,      -0.0,
+                                  1e-6,    123.456, 99999949999, HUGE_VAL};
+
+    std::ostringstream expected;
+    BufferedWriter out(64);  // small buffer to exercise flushing
+    ASSERT_TRUE(out.open(fileName));
+    for (double x : values) {
+        expected << x << "\t";
+        out.writeDouble(x);
+        out.put('\t');
+    }
+    ASSERT_TRUE(out.close());
+
+    EXPECT_EQ(ReadFile(fileName), expected.str());
+}
+
+TEST_F(BufferedWriterTest, WritesAcrossBufferBoundaries) {
+    std::string expected;
+    BufferedWriter out(64);
+    ASSERT_TRUE(out.open(fileName));
+    for (int i = 0; i < 100; i++) {
+        std::string token(i % 150, static_cast<char>('a' + i % 26));
+        out.write(token);
+        out.put('\n');
+        expected += token + "\n";
+    }
+    ASSERT_TRUE(out.close());
+
+    EXPECT_EQ(ReadFile(fileName), expected);
+}
+
+TEST(BufferedWriter, FailsOnUnwritablePath) {
+    BufferedWriter out;
+    EXPECT_FALSE(out.open("/nonexistent-dir/x.out"));
+}
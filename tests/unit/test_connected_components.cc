@@ -0,0 +1,64 @@
+// Unit tests for the connected-component split of the read-error matrix
+// Copyright 2025, NGSFeatures Project
+
+#include "ConnectedComponents.hh"
+#include "SparseMatrixBuilder.hh"
+
+#include <vector>
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+class ConnectedComponentsTest : public ::testing::Test {
+   protected:
+    // Rows 0, 2 and 4 are linked (0->2 and 4->0), 1 and 3 are linked only
+    // through 3->1, and 5 stands alone
+    void SetUp() override {
+        SparseMatrixBuilder builder(6);
+        builder.addEntry(0, 0.9);
+        builder.addEntry(2, 0.1);
+        builder.endRow();
+        builder.addEntry(1, 1.0);
+        builder.endRow();
+        builder.addEntry(2, 1.0);
+        builder.endRow();
+        builder.addEntry(3, 0.8);
+        builder.addEntry(1, 0.2);
+        builder.endRow();
+        builder.addEntry(4, 0.7);
+        builder.addEntry(0, 0.3);
+        builder.endRow();
+        builder.addEntry(5, 1.0);
+        builder.endRow();
+        A = builder.finish();
+    }
+
+    CsrMatrix A;
+};
+
+TEST_F(ConnectedComponentsTest, GroupsLinkedRows) {
+    ComponentSplit split = SplitIntoComponents(A);
+
+    ASSERT_EQ(split.numComponents(), 3u);
+    EXPECT_EQ(split.component, (std::vector<std::uint32_t>{0, 1, 0, 1, 0, 2}));
+    EXPECT_EQ(split.members[0], (std::vector<std::uint32_t>{0, 2, 4}));
+    EXPECT_EQ(split.members[1], (std::vector<std::uint32_t>{1, 3}));
+    EXPECT_EQ(split.members[2], (std::vector<std::uint32_t>{5}));
+    EXPECT_EQ(split.localIndex, (std::vector<std::uint32_t>{0, 0, 1, 1, 2, 0}));
+}
+
+TEST_F(ConnectedComponentsTest, ExtractsDiagonalBlock) {
+    ComponentSplit split = SplitIntoComponents(A);
+    CsrMatrix B = ExtractComponent(A, split, 0);
+
+    EXPECT_EQ(B.numRows, 3u);
+    EXPECT_EQ(B.numCols, 3u);
+    EXPECT_EQ(B.rowPtr, (std::vector<std::uint64_t>{0, 2, 3, 5}));
+    EXPECT_EQ(B.colIdx, (std::vector<std::uint32_t>{0, 1, 1, 2, 0}));
+    EXPECT_EQ(B.values, (std::vector<double>{0.9, 0.1, 1.0, 0.7, 0.3}));
+
+    CsrMatrix C = ExtractComponent(A, split, 1);
+    EXPECT_EQ(C.colIdx, (std::vector<std::uint32_t>{0, 1, 0}));
+    EXPECT_EQ(C.values, (std::vector<double>{1.0, 0.8, 0.2}));
+}
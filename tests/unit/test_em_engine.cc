@@ -0,0 +1,114 @@
+// Unit tests for the fused EM step
+// Copyright 2025, NGSFeatures Project
+
+#include "EmEngine.hh"
+#include "SparseMatrixBuilder.hh"
+
+#include <vector>
+
+#include <cmath>
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// The unfused step the estimators used to run
+double referenceStep(const CsrMatrix& A, const std::vector<double>& n, std::vector<double>& m,
+                     const std::vector<double>& p, double lambda) {
+    std::vector<double> q = MultiplyCsr(A, p);
+    std::vector<double> r(q.size());
+    for (std::size_t i = 0; i < q.size(); i++) {
+        r[i] = n[i] / q[i];
+    }
+    std::vector<double> s = MultiplyCsr(TransposeCsr(A), r);
+
+    double logLik = 0.0;
+    for (std::size_t j = 0; j < m.size(); j++) {
+        m[j] = p[j] * s[j];
+        if (p[j] != 0.0) {
+            logLik += m[j] * std::log(p[j] * lambda);
+        }
+    }
+    return -lambda + logLik;
+}
+
+}  // namespace
+
+class EmEngineTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        SparseMatrixBuilder builder(3);
+        builder.addEntry(0, 0.9);
+        builder.addEntry(1, 0.1);
+        builder.endRow();
+        builder.addEntry(1, 0.95);
+        builder.addEntry(2, 0.05);
+        builder.endRow();
+        builder.addEntry(2, 0.8);
+        builder.addEntry(0, 0.15);
+        builder.addEntry(1, 0.05);
+        builder.endRow();
+        A = builder.finish();
+        At = TransposeCsr(A);
+        counts = {50.0, 30.0, 20.0};
+        lambda = 100.0;
+    }
+
+    CsrMatrix A, At;
+    std::vector<double> counts;
+    double lambda;
+};
+
+TEST_F(EmEngineTest, StepMatchesUnfusedStep) {
+    EmEngine em(A, At, counts);
+    std::vector<double> m = counts;
+    std::vector<double> ref = counts;
+
+    for (int it = 0; it < 5; it++) {
+        std::vector<double> p(ref.size());
+        for (std::size_t j = 0; j < p.size(); j++) {
+            p[j] = ref[j] / lambda;
+        }
+        double refLogLik = referenceStep(A, counts, ref, p, lambda);
+        double logLik = em.step(m, lambda);
+
+        EXPECT_NEAR(logLik, refLogLik, 1e-9);
+        for (std::size_t j = 0; j < m.size(); j++) {
+            EXPECT_NEAR(m[j], ref[j], 1e-9);
+        }
+    }
+}
+
+TEST_F(EmEngineTest, ClampedStepZeroesTagAndNormalizes) {
+    EmEngine em(A, At, counts);
+    std::vector<double> m = counts;
+    std::vector<double> ref = counts;
+
+    std::vector<double> p = {0.0, ref[1], ref[2]};
+    double tot = p[1] + p[2];
+    p[1] /= tot;
+    p[2] /= tot;
+    double refLogLik = referenceStep(A, counts, ref, p, lambda);
+    double logLik = em.step(m, lambda, true, 0);
+
+    EXPECT_NEAR(logLik, refLogLik, 1e-9);
+    EXPECT_EQ(m[0], 0.0);
+    EXPECT_NEAR(m[1], ref[1], 1e-9);
+    EXPECT_NEAR(m[2], ref[2], 1e-9);
+}
+
+TEST_F(EmEngineTest, StepWithCallerProportions) {
+    EmEngine em(A, At, counts);
+    std::vector<double> p = {0.6, 0.3, 0.1};
+    std::vector<double> m(3, 0.0);
+    std::vector<double> ref(3, 0.0);
+
+    double refLogLik = referenceStep(A, counts, ref, p, lambda);
+    double logLik = em.stepWithP(p, m, lambda);
+
+    EXPECT_NEAR(logLik, refLogLik, 1e-9);
+    for (std::size_t j = 0; j < m.size(); j++) {
+        EXPECT_NEAR(m[j], ref[j], 1e-9);
+    }
+}
@@ -0,0 +1,145 @@
+// Unit tests for the entropy-regularized M-step objective
+// Copyright 2025, NGSFeatures Project
+
+#include "EntropyObjective.hh"
+
+#include <vector>
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Coordinate-by-coordinate derivatives as EstimateTrueCount_EntropyFast
+// used to compute them, O(n^2)
+double h(double x) {
+    return 1. / (1. + exp(-x));
+}
+
+double der_h(double x) {
+    return exp(-x) / pow((1 + exp(-x)), 2);
+}
+
+double sumH(const std::vector<double>& x) {
+    double res = 0;
+    for (double xi : x) {
+        res += h(xi);
+    }
+    return res;
+}
+
+double der_f_k(const std::vector<double>& x, const std::vector<double>& m, int kk) {
+    double res = 0;
+    double tmp_sum = sumH(x);
+    for (int jj = 0; jj < static_cast<int>(x.size()); jj++) {
+        double hx_j = h(x[jj]);
+        double ckj = der_h(x[kk]) * (tmp_sum * (kk == jj) - hx_j) / pow(tmp_sum, 2);
+        res += m[jj] * tmp_sum * ckj / hx_j;
+    }
+    return res;
+}
+
+double der_ent_k(const std::vector<double>& x, int kk) {
+    double res = 0;
+    double tmp_sum = sumH(x);
+    for (int jj = 0; jj < static_cast<int>(x.size()); jj++) {
+        double hx_j = h(x[jj]);
+        double ckj = der_h(x[kk]) * (tmp_sum * (kk == jj) - hx_j) / pow(tmp_sum, 2);
+        if (hx_j > 0) {
+            res += -ckj * (1 + log(hx_j / tmp_sum));
+        }
+    }
+    return res;
+}
+
+double final_f(const std::vector<double>& x, const std::vector<double>& m, double gamma) {
+    double tmp_sum = sumH(x);
+    double f = 0;
+    double ent = 0;
+    for (unsigned i = 0; i < x.size(); i++) {
+        double pi = h(x[i]) / tmp_sum;
+        if (pi > 0) {
+            f += m[i] * log(pi);
+            ent -= pi * log(pi);
+        }
+    }
+    return -f + gamma * ent;
+}
+
+}  // namespace
+
+class EntropyObjectiveTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        for (int i = 0; i < 25; i++) {
+            x.push_back(5 * sin(1.7 * i + 0.3));
+            m.push_back(i % 4 == 0 ? 300.0 + i : 0.5 * (i % 7));
+        }
+    }
+
+    std::vector<double> x;
+    std::vector<double> m;
+};
+
+TEST_F(EntropyObjectiveTest, ValueMatchesDefinition) {
+    for (double gamma : {0.0, 0.5, 20.0}) {
+        EntropyObjective objective(m, gamma);
+        double expected = final_f(x, m, gamma);
+        EXPECT_NEAR(objective.value(x), expected, 1e-9 * std::fabs(expected));
+    }
+}
+
+TEST_F(EntropyObjectiveTest, GradientMatchesPerCoordinateDerivatives) {
+    for (double gamma : {0.0, 0.5, 20.0}) {
+        EntropyObjective objective(m, gamma);
+        std::vector<double> grad;
+        double fx = objective.gradient(x, grad);
+
+        EXPECT_NEAR(fx, final_f(x, m, gamma), 1e-9 * std::fabs(fx));
+        ASSERT_EQ(grad.size(), x.size());
+        for (unsigned k = 0; k < x.size(); k++) {
+            double expected = -der_f_k(x, m, k) + gamma * der_ent_k(x, k);
+            EXPECT_NEAR(grad[k], expected, 1e-9 * (1 + std::fabs(expected))) << "k = " << k;
+        }
+    }
+}
+
+TEST_F(EntropyObjectiveTest, GradientMatchesFiniteDifferences) {
+    EntropyObjective objective(m, 3.0);
+    std::vector<double> grad;
+    objective.gradient(x, grad);
+
+    const double step = 1e-6;
+    for (unsigned k = 0; k < x.size(); k++) {
+        std::vector<double> xp = x;
+        std::vector<double> xm = x;
+        xp[k] += step;
+        xm[k] -= step;
+        double numeric = (objective.value(xp) - objective.value(xm)) / (2 * step);
+        EXPECT_NEAR(grad[k], numeric, 1e-4 * (1 + std::fabs(numeric))) << "k = " << k;
+    }
+}
+
+TEST_F(EntropyObjectiveTest, SaturatedCoordinatesStayFinite) {
+    // exp(-x) overflows for x << 0, which made der_h NaN
+    x[3] = -800;
+    x[4] = 800;
+    EntropyObjective objective(m, 1.0);
+    std::vector<double> grad;
+    double fx = objective.gradient(x, grad);
+
+    EXPECT_TRUE(std::isfinite(fx));
+    for (double g : grad) {
+        EXPECT_TRUE(std::isfinite(g));
+    }
+    EXPECT_DOUBLE_EQ(grad[3], -m[3]);  // m_k h'_k / h_k -> m_k
+}
+
+TEST(EntropyObjective, ProportionsSumToOne) {
+    std::vector<double> p = EntropyObjective::proportions({-1.0, 0.0, 2.0});
+
+    ASSERT_EQ(p.size(), 3u);
+    EXPECT_NEAR(p[0] + p[1] + p[2], 1.0, 1e-15);
+    EXPECT_NEAR(p[1], 0.5 / (h(-1.0) + 0.5 + h(2.0)), 1e-15);
+}
@@ -0,0 +1,125 @@
+// Unit tests for the entropy M-step optimizers
+// Copyright 2025, NGSFeatures Project
+
+#include "EntropyObjective.hh"
+#include "EntropyOptimizer.hh"
+
+#include <memory>
+#include <vector>
+
+#include <cmath>
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+class EntropyOptimizerTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        for (int i = 0; i < 60; i++) {
+            m.push_back(i % 5 == 0 ? 200.0 + 3 * i : 1.0 + (i % 3));
+        }
+    }
+
+    std::vector<double> m;
+};
+
+TEST_F(EntropyOptimizerTest, LbfgsWithoutEntropyRecoversCounts) {
+    // gamma = 0: the minimizer is p = m / sum m
+    // The default stop (F changes by 1e-10 relative, F ~ 1e4 here) leaves
+    // the smallest proportions about 2e-4 relative off, so tighten it
+    EntropyObjective objective(m, 0.0);
+    std::vector<double> x(m.size(), 0.0);
+    LbfgsOptimizer lbfgs(8, 200, 1e-13);
+    lbfgs.minimize(objective, x);
+
+    double total = 0;
+    for (double mj : m) {
+        total += mj;
+    }
+    std::vector<double> p = EntropyObjective::proportions(x);
+    for (std::size_t j = 0; j < m.size(); j++) {
+        EXPECT_NEAR(p[j], m[j] / total, 1e-4 * m[j] / total) << "j = " << j;
+    }
+}
+
+TEST_F(EntropyOptimizerTest, LbfgsBeatsGradientDescent) {
+    EntropyObjective objective(m, 5.0);
+
+    std::vector<double> xLbfgs = EntropyStartingPoint(m);
+    LbfgsOptimizer lbfgs;
+    int iterLbfgs = lbfgs.minimize(objective, xLbfgs);
+
+    srand(1);
+    std::vector<double> xGd;
+    GradientDescentOptimizer gd;
+    gd.minimize(objective, xGd);
+
+    EXPECT_LE(objective.value(xLbfgs), objective.value(xGd) + 1e-9);
+    EXPECT_LT(iterLbfgs, 200);
+
+    std::vector<double> grad;
+    objective.gradient(xLbfgs, grad);
+    for (double g : grad) {
+        EXPECT_LT(std::fabs(g), 1e-2);
+    }
+}
+
+TEST_F(EntropyOptimizerTest, LbfgsIsDeterministic) {
+    EntropyObjective objective(m, 2.0);
+    LbfgsOptimizer lbfgs;
+
+    std::vector<double> x1 = EntropyStartingPoint(m);
+    std::vector<double> x2 = EntropyStartingPoint(m);
+    lbfgs.minimize(objective, x1);
+    lbfgs.minimize(objective, x2);
+
+    EXPECT_EQ(x1, x2);
+}
+
+TEST_F(EntropyOptimizerTest, WarmStartFinishesQuickly) {
+    EntropyObjective objective(m, 2.0);
+    LbfgsOptimizer lbfgs;
+
+    std::vector<double> x = EntropyStartingPoint(m);
+    int cold = lbfgs.minimize(objective, x);
+    int warm = lbfgs.minimize(objective, x);
+
+    EXPECT_LE(warm, 3);
+    EXPECT_LT(warm, cold);
+}
+
+TEST(LbfgsHistory, RejectedPairKeepsFullHistory) {
+    const std::vector<double> zero = {0.0, 0.0};
+    LbfgsHistory history(2, 2);
+    LbfgsHistory reference(2, 2);
+    for (LbfgsHistory* h : {&history, &reference}) {
+        EXPECT_TRUE(h->push(zero, {1.0, 0.0}, zero, {2.0, 0.5}));
+        EXPECT_TRUE(h->push(zero, {0.0, 1.0}, zero, {0.5, 3.0}));
+    }
+    ASSERT_EQ(history.size(), 2u);
+
+    // s'y < 0: the pair must not replace the oldest one
+    EXPECT_FALSE(history.push(zero, {1.0, 1.0}, zero, {-1.0, -2.0}));
+    EXPECT_EQ(history.size(), 2u);
+
+    std::vector<double> d = {0.3, -0.7};
+    std::vector<double> dReference = d;
+    history.multiply(d);
+    reference.multiply(dReference);
+    EXPECT_EQ(d, dReference);
+}
+
+TEST(EntropyOptimizer, MakesOptimizerByName) {
+    EXPECT_NE(MakeEntropyOptimizer("lbfgs"), nullptr);
+    EXPECT_NE(MakeEntropyOptimizer("gd"), nullptr);
+    EXPECT_EQ(MakeEntropyOptimizer("newton"), nullptr);
+}
+
+TEST(EntropyOptimizer, StartingPointFollowsCounts) {
+    std::vector<double> x = EntropyStartingPoint({4.0, 2.0, 0.0});
+    std::vector<double> p = EntropyObjective::proportions(x);
+
+    EXPECT_DOUBLE_EQ(x[0], 0.0);
+    EXPECT_NEAR(p[0] / p[1], 2.0, 1e-12);
+    EXPECT_LT(p[2], 1e-10);
+}
@@ -0,0 +1,141 @@
+// Unit tests for the connected components of the ematch neighbor graph
+// Copyright 2025, NGSFeatures Project
+
+#include "RecountGraphComponents.hh"
+#include "RecountNeighborProbGraphInMemory.hh"
+#include "TagSet.hh"
+#include "utils/graph/ConnectedComponentOnlineComputer.hh"
+
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+using namespace cbrc;
+
+namespace {
+
+// Tag i spelled in base 4 over "0123", so the tags come out sorted
+std::string tagSeq(std::size_t i, std::size_t length) {
+    std::string seq(length, '0');
+    for (std::size_t pos = length; pos-- > 0; i /= 4) {
+        seq[pos] = "0123"[i % 4];
+    }
+    return seq;
+}
+
+}  // namespace
+
+class GraphComponentsTest : public ::testing::Test {
+   protected:
+    // About as many random edges as tags join most tags into one component
+    // spanning every 1024 node chunk of the parallel union, beside some
+    // thousand small components and single tags.  The last tags have no
+    // record, and some records list the node itself.
+    void SetUp() override {
+        numTags = 20000;
+
+        std::vector<std::string> seqs;
+        for (std::size_t i = 0; i < numTags; i++) {
+            seqs.push_back(tagSeq(i, 8));
+        }
+        tags.reset(new TagSet(seqs));
+
+        std::mt19937 rng(2009);
+        std::uniform_int_distribution<tagIdT> anyTag(0, numTags - 1);
+        std::uniform_int_distribution<int> numNeighbors(0, 2);
+
+        std::vector<tagIdT> nodeIds;
+        std::vector<std::size_t> offsets(1, 0);
+        tagIdVecT neighborIds;
+        probVecT neighborProbs;
+        for (tagIdT i = 0; i < numTags - 100; i++) {
+            nodeIds.push_back(i);
+            if (i % 7 == 0) {
+                neighborIds.push_back(i);
+                neighborProbs.push_back(0.9);
+            }
+            for (int k = numNeighbors(rng); k > 0; k--) {
+                neighborIds.push_back(anyTag(rng));
+                neighborProbs.push_back(0.05);
+            }
+            offsets.push_back(neighborIds.size());
+            edges.insert(edges.end(), neighborIds.begin() + offsets[offsets.size() - 2],
+                         neighborIds.end());
+            edgeSources.resize(edges.size(), i);
+        }
+        graph.reset(new RecountNeighborProbGraphInMemory(*tags, nodeIds, offsets, neighborIds,
+                                                         neighborProbs));
+    }
+
+    // Components of the same edges by the serial union-find
+    std::vector<RecountGraphComponents::componentIdT> referenceComponents() const {
+        ConnectedComponentOnlineComputer computer(numTags);
+        for (std::size_t k = 0; k < edges.size(); k++) {
+            computer.addEdge(edgeSources[k], edges[k]);
+        }
+        FLEArray<nodeIndexT> nodeComponents(numTags);
+        computer.getNodeComponents(nodeComponents);
+        return std::vector<RecountGraphComponents::componentIdT>(nodeComponents.begin(),
+                                                                 nodeComponents.end());
+    }
+
+    std::size_t numTags;
+    std::unique_ptr<TagSet> tags;
+    std::unique_ptr<RecountNeighborProbGraphInMemory> graph;
+
+    // edge k joins edgeSources[k] and edges[k]
+    std::vector<tagIdT> edgeSources;
+    std::vector<tagIdT> edges;
+};
+
+TEST_F(GraphComponentsTest, MatchesConnectedComponentOnlineComputer) {
+    const std::vector<RecountGraphComponents::componentIdT> expected = referenceComponents();
+
+    for (std::size_t numThreads : {0, 1, 4}) {
+        const RecountGraphComponents components(*graph, numTags, numThreads);
+
+        ASSERT_EQ(components.size(), numTags);
+        EXPECT_EQ(components.componentIds(), expected) << numThreads << " threads";
+    }
+}
+
+TEST_F(GraphComponentsTest, CountsComponentSizes) {
+    const std::vector<RecountGraphComponents::componentIdT> expected = referenceComponents();
+    const RecountGraphComponents components(*graph, numTags, 4);
+
+    std::vector<uint64_t> sizes(components.numComponents(), 0);
+    for (std::size_t i = 0; i < numTags; i++) {
+        ASSERT_LT(expected[i], sizes.size());
+        sizes[expected[i]]++;
+    }
+    ASSERT_GT(components.numComponents(), 1u);
+    for (std::size_t c = 0; c < sizes.size(); c++) {
+        EXPECT_EQ(components.componentSize(c), sizes[c]) << "component " << c;
+    }
+
+    uint64_t numComponents = 0;
+    uint64_t numSizedTags = 0;
+    for (const RecountGraphComponents::sizeCountT& sizeCount : components.sizeHistogram()) {
+        numComponents += sizeCount.second;
+        numSizedTags += sizeCount.first * sizeCount.second;
+    }
+    EXPECT_EQ(numComponents, components.numComponents());
+    EXPECT_EQ(numSizedTags, numTags);
+}
+
+TEST_F(GraphComponentsTest, ReadsWhatItWrites) {
+    const RecountGraphComponents components(*graph, numTags, 4);
+
+    std::stringstream stream;
+    components.write(stream);
+    const RecountGraphComponents read(stream);
+
+    EXPECT_EQ(read.componentIds(), components.componentIds());
+    EXPECT_EQ(read.sizeHistogram(), components.sizeHistogram());
+}
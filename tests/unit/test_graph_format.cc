@@ -0,0 +1,186 @@
+// Unit tests for the version 001 binary neighbor graph format of the ematch module
+// Copyright 2025, NGSFeatures Project
+
+#include "RecountNeighborProbGraphFormat.hh"
+#include "RecountNeighborProbGraphInMemory.hh"
+#include "TagSet.hh"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+using namespace cbrc;
+namespace format = RecountNeighborProbGraphFormat;
+
+namespace {
+
+// Tag i spelled in base 4 over "0123", so the tags come out sorted
+std::string tagSeq(std::size_t i, std::size_t length) {
+    std::string seq(length, '0');
+    for (std::size_t pos = length; pos-- > 0; i /= 4) {
+        seq[pos] = "0123"[i % 4];
+    }
+    return seq;
+}
+
+// Probability k of the graph, whichever width it holds
+double probAt(const RecountNeighborProbGraphInMemory& graph, std::size_t k) {
+    return graph.hasFloatProbs() ? graph.neighborProbsFloat()[k] : graph.neighborProbs()[k];
+}
+
+}  // namespace
+
+class GraphFormatTest : public ::testing::Test {
+   protected:
+    // 40 tags, of which 30 have records of 0 to 4 neighbors; the
+    // probabilities do not fit in a float exactly
+    void SetUp() override {
+        std::vector<std::string> seqs;
+        for (std::size_t i = 0; i < 40; i++) {
+            seqs.push_back(tagSeq(i, 5));
+        }
+        tags.reset(new TagSet(seqs));
+
+        offsets.push_back(0);
+        for (tagIdT i = 0; i < 30; i++) {
+            nodeIds.push_back(i + 5);
+            for (tagIdT k = 0; k < i % 5; k++) {
+                neighborIds.push_back((i * 7 + k * 11) % 40);
+                neighborProbs.push_back(1.0 / (3.0 + i + k));
+            }
+            offsets.push_back(neighborIds.size());
+        }
+    }
+
+    std::string writeGraph(const std::string& name, bool floatProbs) const {
+        const std::string fileName = ::testing::TempDir() + name;
+        std::ofstream out(fileName.c_str(), std::ios::binary);
+        format::write001(out, nodeIds, offsets, neighborIds, neighborProbs, floatProbs);
+        return fileName;
+    }
+
+    // Overwrite the header of fileName with header
+    static void writeHeader(const std::string& fileName, const format::Header001& header) {
+        std::fstream file(fileName.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(format::signature001().size());
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    static format::Header001 readHeader(const std::string& fileName) {
+        std::ifstream in(fileName.c_str(), std::ios::binary);
+        EXPECT_EQ(format::readVersion(in), 1);
+        return format::readHeader001(in);
+    }
+
+    void expectSameGraph(const RecountNeighborProbGraphInMemory& graph, bool floatProbs) const {
+        EXPECT_EQ(graph.hasFloatProbs(), floatProbs);
+        ASSERT_EQ(graph.size(), nodeIds.size());
+        ASSERT_EQ(graph.numNeighborEntries(), neighborIds.size());
+
+        for (std::size_t node = 0; node < nodeIds.size(); node++) {
+            EXPECT_EQ(graph.nodeId(node), nodeIds[node]);
+            EXPECT_EQ(graph.offset(node + 1), offsets[node + 1]);
+        }
+        for (std::size_t k = 0; k < neighborIds.size(); k++) {
+            EXPECT_EQ(graph.neighborIds()[k], neighborIds[k]);
+            const double expected = floatProbs ? float(neighborProbs[k]) : neighborProbs[k];
+            EXPECT_EQ(probAt(graph, k), expected) << "entry " << k;
+        }
+    }
+
+    std::unique_ptr<TagSet> tags;
+    std::vector<tagIdT> nodeIds;
+    std::vector<std::size_t> offsets;
+    tagIdVecT neighborIds;
+    probVecT neighborProbs;
+};
+
+TEST_F(GraphFormatTest, HeaderRecordsWidths) {
+    for (bool floatProbs : {false, true}) {
+        const format::Header001 header = readHeader(writeGraph("widths.graph", floatProbs));
+
+        EXPECT_EQ(header.byteOrderMark, format::byteOrderMark());
+        EXPECT_EQ(header.tagIdBytes, sizeof(tagIdT));
+        EXPECT_EQ(header.offsetBytes, sizeof(std::size_t));
+        EXPECT_EQ(header.probBytes, floatProbs ? sizeof(float) : sizeof(probT));
+        EXPECT_EQ(header.numNodes, nodeIds.size());
+        EXPECT_EQ(header.numNeighborEntries, neighborIds.size());
+        EXPECT_EQ(header.nodeIdsPos % format::alignment(), 0u);
+        EXPECT_EQ(header.offsetsPos % format::alignment(), 0u);
+        EXPECT_EQ(header.neighborIdsPos % format::alignment(), 0u);
+        EXPECT_EQ(header.neighborProbsPos % format::alignment(), 0u);
+    }
+}
+
+TEST_F(GraphFormatTest, MapsWhatItWrites) {
+    for (bool floatProbs : {false, true}) {
+        const std::string fileName = writeGraph("mapped.graph", floatProbs);
+        const RecountNeighborProbGraphInMemory graph(*tags, fileName);
+
+        EXPECT_TRUE(graph.isMapped());
+        expectSameGraph(graph, floatProbs);
+    }
+}
+
+TEST_F(GraphFormatTest, ReadsWhatItWrites) {
+    for (bool floatProbs : {false, true}) {
+        const std::string fileName = writeGraph("read.graph", floatProbs);
+        std::ifstream in(fileName.c_str(), std::ios::binary);
+        const RecountNeighborProbGraphInMemory graph(*tags, in);
+
+        EXPECT_FALSE(graph.isMapped());
+        expectSameGraph(graph, floatProbs);
+    }
+}
+
+TEST_F(GraphFormatTest, RejectsOtherByteOrder) {
+    const std::string fileName = writeGraph("byteorder.graph", false);
+    format::Header001 header = readHeader(fileName);
+    header.byteOrderMark = 0x04030201;
+    writeHeader(fileName, header);
+
+    EXPECT_DEATH(readHeader(fileName), "other byte order");
+    EXPECT_DEATH({ RecountNeighborProbGraphInMemory graph(*tags, fileName); },
+                 "other byte order");
+}
+
+TEST_F(GraphFormatTest, RejectsOtherIdAndOffsetWidths) {
+    const std::string fileName = writeGraph("ids.graph", false);
+    const format::Header001 written = readHeader(fileName);
+
+    format::Header001 header = written;
+    header.tagIdBytes = 8;
+    writeHeader(fileName, header);
+    EXPECT_DEATH(readHeader(fileName), "8 byte tag ids");
+
+    header = written;
+    header.offsetBytes = 4;
+    writeHeader(fileName, header);
+    EXPECT_DEATH(readHeader(fileName), "4 byte offsets");
+    EXPECT_DEATH({ RecountNeighborProbGraphInMemory graph(*tags, fileName); },
+                 "4 byte offsets");
+}
+
+TEST_F(GraphFormatTest, RejectsOtherProbabilityWidths) {
+    const std::string fileName = writeGraph("probs.graph", false);
+    const format::Header001 written = readHeader(fileName);
+
+    format::Header001 header = written;
+    header.probBytes = 2;
+    writeHeader(fileName, header);
+    EXPECT_DEATH(readHeader(fileName), "2 byte probabilities");
+
+    // a double file claiming floats no longer matches its array positions
+    header = written;
+    header.probBytes = sizeof(float);
+    writeHeader(fileName, header);
+    EXPECT_DEATH(readHeader(fileName), "positions are inconsistent");
+    EXPECT_DEATH({ RecountNeighborProbGraphInMemory graph(*tags, fileName); },
+                 "positions are inconsistent");
+}
@@ -0,0 +1,119 @@
+// Unit tests for the best first combinations of the knapsack module
+// Copyright 2025, NGSFeatures Project
+
+#include "KnapsackEnumerator.hh"
+#include "KnapsackObjectVector.hh"
+
+#include <map>
+#include <vector>
+
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+using namespace cbrc;
+
+namespace {
+
+typedef KnapsackEnumerator::idVecT idVecT;
+typedef KnapsackEnumerator::weightT weightT;
+
+// Every combination startBestFirst yields, in order
+void drainBestFirst(KnapsackEnumerator& enumerator, const KnapsackObjectVector& objects,
+                    std::size_t maxCombinations, std::vector<idVecT>& combinations,
+                    std::vector<weightT>& weights) {
+    combinations.clear();
+    weights.clear();
+    enumerator.startBestFirst(objects, maxCombinations);
+
+    idVecT combination;
+    weightT weight;
+    while (enumerator.nextCombination(combination, weight)) {
+        combinations.push_back(combination);
+        weights.push_back(weight);
+    }
+}
+
+}  // namespace
+
+class KnapsackEnumeratorTest : public ::testing::Test {
+   protected:
+    // Unsorted, with tied weights, and too heavy to all fit at once
+    KnapsackEnumeratorTest()
+        : objects(std::vector<double>{0.5, 1.25, 0.25, 2.0, 0.75, 1.0, 3.5, 0.75, 4.5}),
+          capacity(4.0) {}
+
+    KnapsackObjectVector objects;
+    weightT capacity;
+};
+
+TEST_F(KnapsackEnumeratorTest, BestFirstYieldsEveryCombinationOnce) {
+    KnapsackEnumerator depthFirst(capacity);
+    depthFirst.computeCombinations(objects);
+
+    std::map<idVecT, weightT> expected;
+    for (std::size_t i = 0; i < depthFirst.combinations().size(); i++) {
+        expected[depthFirst.combinations()[i]] = depthFirst.combinationWeights()[i];
+    }
+    ASSERT_EQ(expected.size(), depthFirst.combinations().size());
+
+    KnapsackEnumerator bestFirst(capacity);
+    std::vector<idVecT> combinations;
+    std::vector<weightT> weights;
+    drainBestFirst(bestFirst, objects, 0, combinations, weights);
+
+    std::map<idVecT, weightT> yielded;
+    for (std::size_t i = 0; i < combinations.size(); i++) {
+        EXPECT_TRUE(yielded.insert(std::make_pair(combinations[i], weights[i])).second)
+            << "combination " << i << " yielded twice";
+    }
+    EXPECT_EQ(yielded, expected);
+}
+
+TEST_F(KnapsackEnumeratorTest, BestFirstWeightsNeverDecrease) {
+    KnapsackEnumerator bestFirst(capacity);
+    std::vector<idVecT> combinations;
+    std::vector<weightT> weights;
+    drainBestFirst(bestFirst, objects, 0, combinations, weights);
+
+    ASSERT_FALSE(weights.empty());
+    for (std::size_t i = 0; i < weights.size(); i++) {
+        EXPECT_LE(weights[i], capacity);
+        if (i > 0) {
+            EXPECT_LE(weights[i - 1], weights[i]) << "combination " << i;
+        }
+    }
+}
+
+TEST_F(KnapsackEnumeratorTest, MaxCombinationsKeepsTheFirst) {
+    KnapsackEnumerator enumerator(capacity);
+    std::vector<idVecT> all;
+    std::vector<weightT> allWeights;
+    drainBestFirst(enumerator, objects, 0, all, allWeights);
+
+    for (std::size_t k : {1, 2, 5, 17}) {
+        ASSERT_LT(k, all.size());
+
+        std::vector<idVecT> first;
+        std::vector<weightT> firstWeights;
+        drainBestFirst(enumerator, objects, k, first, firstWeights);
+
+        EXPECT_EQ(first, std::vector<idVecT>(all.begin(), all.begin() + k)) << k << " combinations";
+        EXPECT_EQ(firstWeights, std::vector<weightT>(allWeights.begin(), allWeights.begin() + k));
+    }
+
+    // a limit above the number of combinations yields them all
+    std::vector<idVecT> unlimited;
+    std::vector<weightT> unlimitedWeights;
+    drainBestFirst(enumerator, objects, all.size() + 10, unlimited, unlimitedWeights);
+    EXPECT_EQ(unlimited, all);
+}
+
+TEST_F(KnapsackEnumeratorTest, NothingFitsYieldsNothing) {
+    KnapsackEnumerator enumerator(0.1);
+    std::vector<idVecT> combinations;
+    std::vector<weightT> weights;
+    drainBestFirst(enumerator, objects, 0, combinations, weights);
+
+    EXPECT_TRUE(combinations.empty());
+}
@@ -0,0 +1,135 @@
+// Unit tests for the per-tag log-likelihood ratios
+// Copyright 2025, NGSFeatures Project
+
+#include "LikelihoodRatio.hh"
+#include "SparseMatrixBuilder.hh"
+
+#include <algorithm>
+#include <vector>
+
+#include <cmath>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+class LikelihoodRatioTest : public ::testing::Test {
+   protected:
+    // Tags on a ring, each one reading as its two nearest neighbors (and a
+    // few as a tag further away) with a small error; counts alternate
+    // between true tags and their error copies
+    void SetUp() override {
+        const std::uint32_t n = 40;
+        SparseMatrixBuilder builder(n);
+        for (std::uint32_t i = 0; i < n; i++) {
+            builder.addEntry(i, 0.9);
+            builder.addEntry((i + 1) % n, 0.03);
+            builder.addEntry((i + n - 1) % n, 0.02);
+            if (i % 7 == 0) {
+                builder.addEntry((i + 13) % n, 0.01);
+            }
+            builder.endRow();
+            counts.push_back(i % 3 == 0 ? 500.0 + 10.0 * i : 5.0 + (i % 5));
+        }
+        A = builder.finish();
+        At = TransposeCsr(A);
+    }
+
+    CsrMatrix A;
+    CsrMatrix At;
+    std::vector<double> counts;
+};
+
+TEST_F(LikelihoodRatioTest, WarmStartMatchesConvergedRestart) {
+    const double lambda = static_cast<double>(counts.size());
+
+    LikelihoodRatioOptions restart;
+    restart.start = ClampedStart::ConvergedRestart;
+    restart.convergedTolerance = 1e-13;
+    restart.convergedMaxSteps = 100000;
+    std::vector<double> expRestart, ratioRestart;
+    std::vector<char> doneRestart;
+    ComputeLikelihoodRatios(A, At, counts, lambda, restart, expRestart, ratioRestart,
+                            doneRestart);
+
+    LikelihoodRatioOptions warm;
+    warm.start = ClampedStart::WarmStart;
+    warm.warmTolerance = 1e-10;
+    std::vector<double> expWarm, ratioWarm;
+    std::vector<char> doneWarm;
+    ComputeLikelihoodRatios(A, At, counts, lambda, warm, expWarm, ratioWarm, doneWarm);
+
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        ASSERT_TRUE(doneRestart[i]);
+        EXPECT_TRUE(doneWarm[i]) << "tag " << i;
+        EXPECT_EQ(expWarm[i], expRestart[i]);
+        EXPECT_NEAR(ratioWarm[i], ratioRestart[i], 1e-5 * std::max(1.0, std::fabs(ratioRestart[i])))
+            << "tag " << i;
+    }
+}
+
+TEST_F(LikelihoodRatioTest, WarmStartDefaultsStayClose) {
+    const double lambda = static_cast<double>(counts.size());
+
+    LikelihoodRatioOptions restart;
+    restart.start = ClampedStart::ConvergedRestart;
+    restart.convergedTolerance = 1e-13;
+    restart.convergedMaxSteps = 100000;
+    std::vector<double> expRestart, ratioRestart;
+    std::vector<char> doneRestart;
+    ComputeLikelihoodRatios(A, At, counts, lambda, restart, expRestart, ratioRestart,
+                            doneRestart);
+
+    LikelihoodRatioOptions warm;
+    warm.start = ClampedStart::WarmStart;
+    std::vector<double> expWarm, ratioWarm;
+    std::vector<char> doneWarm;
+    ComputeLikelihoodRatios(A, At, counts, lambda, warm, expWarm, ratioWarm, doneWarm);
+
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        EXPECT_TRUE(doneWarm[i]);
+        EXPECT_NEAR(ratioWarm[i], ratioRestart[i],
+                    1e-3 * std::max(1.0, std::fabs(ratioRestart[i])));
+    }
+}
+
+TEST_F(LikelihoodRatioTest, FreeCountsDoNotDependOnMode) {
+    const double lambda = static_cast<double>(counts.size());
+
+    LikelihoodRatioOptions restart;
+    std::vector<double> expRestart, ratioRestart;
+    std::vector<char> doneRestart;
+    ComputeLikelihoodRatios(A, At, counts, lambda, restart, expRestart, ratioRestart,
+                            doneRestart);
+
+    for (ClampedStart start : {ClampedStart::ConvergedRestart, ClampedStart::WarmStart}) {
+        LikelihoodRatioOptions options;
+        options.start = start;
+        std::vector<double> expFree, ratio;
+        std::vector<char> done;
+        ComputeLikelihoodRatios(A, At, counts, lambda, options, expFree, ratio, done);
+
+        EXPECT_EQ(expFree, expRestart);
+    }
+}
+
+TEST(LikelihoodRatio, LoneTagIsInfinite) {
+    SparseMatrixBuilder builder(1);
+    builder.addEntry(0, 1.0);
+    builder.endRow();
+    CsrMatrix A = builder.finish();
+    CsrMatrix At = TransposeCsr(A);
+
+    for (ClampedStart start :
+         {ClampedStart::Restart, ClampedStart::ConvergedRestart, ClampedStart::WarmStart}) {
+        LikelihoodRatioOptions options;
+        options.start = start;
+        std::vector<double> expFree, ratio;
+        std::vector<char> done;
+        ComputeLikelihoodRatios(A, At, {12.0}, 1.0, options, expFree, ratio, done);
+
+        ASSERT_EQ(ratio.size(), 1u);
+        EXPECT_TRUE(done[0]);
+        EXPECT_GT(ratio[0], 1e300);  // HUGE_VAL; isinf is unreliable under -ffast-math
+        EXPECT_DOUBLE_EQ(expFree[0], 12.0);
+    }
+}
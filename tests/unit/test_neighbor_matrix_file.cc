@@ -0,0 +1,148 @@
+// Unit tests for the binary neighbor matrix (.nbm) format
+// Copyright 2025, NGSFeatures Project
+
+#include "NeighborMatrixFile.hh"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+class NeighborMatrixFileTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        fileName = ::testing::TempDir() + "test_neighbor_matrix.nbm";
+
+        // 3x3 matrix, diagonal first in every row
+        tags = {"AAC", "AAG", "ACT"};
+        rowOffsets = {0, 2, 3, 5};
+        colIndex = {0, 1, 1, 2, 0};
+        values = {0.99, 0.01, 1.0, 0.97, 0.03};
+        rawCounts = {12.0, 1.0, 3.0};
+
+        A.numRows = 3;
+        A.numCols = 3;
+        A.rowPtr = rowOffsets;
+        A.colIdx = colIndex;
+        A.values = values;
+    }
+
+    void TearDown() override { std::remove(fileName.c_str()); }
+
+    std::string fileName;
+    std::vector<std::string> tags;
+    std::vector<std::uint64_t> rowOffsets;
+    std::vector<std::uint32_t> colIndex;
+    std::vector<double> values;
+    std::vector<double> rawCounts;
+    CsrMatrix A;
+};
+
+TEST_F(NeighborMatrixFileTest, RoundTrip) {
+    ASSERT_TRUE(WriteNeighborMatrixFile(fileName, tags, A, rawCounts));
+
+    NeighborMatrixFile nbm;
+    ASSERT_TRUE(nbm.open(fileName));
+    EXPECT_EQ(nbm.numTags(), 3u);
+    EXPECT_EQ(nbm.nnz(), 5u);
+    EXPECT_EQ(nbm.tagLength(), 3u);
+    EXPECT_EQ(nbm.tag(2), "ACT");
+
+    for (unsigned i = 0; i < rowOffsets.size(); i++) {
+        EXPECT_EQ(nbm.rowOffsets()[i], rowOffsets[i]);
+    }
+    for (unsigned k = 0; k < values.size(); k++) {
+        EXPECT_EQ(nbm.colIndex()[k], colIndex[k]);
+        EXPECT_DOUBLE_EQ(nbm.values()[k], values[k]);
+    }
+    EXPECT_DOUBLE_EQ(nbm.rawCounts()[0], 12.0);
+}
+
+TEST_F(NeighborMatrixFileTest, ToCsr) {
+    ASSERT_TRUE(WriteNeighborMatrixFile(fileName, tags, A, rawCounts));
+
+    NeighborMatrixFile nbm;
+    ASSERT_TRUE(nbm.open(fileName));
+
+    CsrMatrix B;
+    std::vector<double> counts;
+    std::vector<std::string> outTags;
+    nbm.toCsr(B, outTags, counts);
+
+    EXPECT_EQ(B.numRows, 3u);
+    EXPECT_EQ(B.numCols, 3u);
+    EXPECT_EQ(B.rowPtr, rowOffsets);
+    EXPECT_EQ(B.colIdx, colIndex);
+    EXPECT_EQ(B.values, values);
+    EXPECT_EQ(outTags, tags);
+    EXPECT_EQ(counts, rawCounts);
+}
+
+TEST_F(NeighborMatrixFileTest, MissingFileIsNotOpened) {
+    NeighborMatrixFile nbm;
+    EXPECT_FALSE(nbm.open(fileName + ".missing"));
+    EXPECT_FALSE(nbm.isOpen());
+}
+
+TEST_F(NeighborMatrixFileTest, OpenIfCurrentChecksSourceFile) {
+    const std::string sourceFileName = fileName + ".txt";
+    std::ofstream source(sourceFileName.c_str());
+    source << "12\tAAC\n1\tAAG\n3\tACT\n";
+    source.close();
+
+    ASSERT_TRUE(WriteNeighborMatrixFile(fileName, tags, A, rawCounts, sourceFileName));
+
+    NeighborMatrixFile nbm;
+    EXPECT_TRUE(nbm.openIfCurrent(fileName, fileName + ".nb.missing", sourceFileName));
+
+    source.open(sourceFileName.c_str(), std::ios::app);
+    source << "5\tCCC\n";
+    source.close();
+
+    EXPECT_FALSE(nbm.openIfCurrent(fileName, fileName + ".nb.missing", sourceFileName));
+    EXPECT_FALSE(nbm.isOpen());
+
+    // Written without a source, the file is never taken as current
+    ASSERT_TRUE(WriteNeighborMatrixFile(fileName, tags, A, rawCounts));
+    EXPECT_FALSE(nbm.openIfCurrent(fileName, fileName + ".nb.missing", sourceFileName));
+
+    std::remove(sourceFileName.c_str());
+}
+
+TEST_F(NeighborMatrixFileTest, RejectsTruncatedFile) {
+    ASSERT_TRUE(WriteNeighborMatrixFile(fileName, tags, A, rawCounts));
+
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    std::ofstream out(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size() - 8);
+    out.close();
+
+    NeighborMatrixFile nbm;
+    EXPECT_FALSE(nbm.open(fileName));
+}
+
+TEST_F(NeighborMatrixFileTest, RejectsColumnIndexOutOfRange) {
+    A.colIdx[3] = 3;
+    ASSERT_TRUE(WriteNeighborMatrixFile(fileName, tags, A, rawCounts));
+
+    NeighborMatrixFile nbm;
+    EXPECT_FALSE(nbm.open(fileName));
+    EXPECT_FALSE(nbm.isOpen());
+}
+
+TEST_F(NeighborMatrixFileTest, RejectsDecreasingRowOffsets) {
+    A.rowPtr = {0, 3, 2, 5};
+    ASSERT_TRUE(WriteNeighborMatrixFile(fileName, tags, A, rawCounts));
+
+    NeighborMatrixFile nbm;
+    EXPECT_FALSE(nbm.open(fileName));
+    EXPECT_FALSE(nbm.isOpen());
+}
@@ -0,0 +1,87 @@
+// Unit tests for the Hamming distance 1 neighbor topology cache
+// Copyright 2025, NGSFeatures Project
+
+#include "NeighborTopologyCache.hh"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+TEST(BuildNeighborTopologyTest, NeighborsInWriteOrder) {
+    NeighborTopology t;
+    BuildNeighborTopology("02", {}, t);
+
+    // Substitutions 1, 2, 3 at each position, 0 in place of the own base
+    EXPECT_EQ(t.nbText, "12\t22\t32\t01\t00\t03\t");
+    EXPECT_TRUE(t.shares.empty());
+}
+
+TEST(BuildNeighborTopologyTest, SharesOfNeighborsInProportionTable) {
+    // Proportions of the 16 tags of length 2, by value in base 4
+    std::vector<double> tagProp(16, 0.0);
+    tagProp[0x6] = 0.25;  // "12"
+    tagProp[0xe] = 0.75;  // "32"
+    tagProp[0x3] = 0.5;   // "03"
+
+    NeighborTopology t;
+    BuildNeighborTopology("02", tagProp, t);
+
+    ASSERT_EQ(t.shares.size(), 3u);
+    EXPECT_EQ(t.shares[0].position, 0u);
+    EXPECT_EQ(t.shares[0].neighbor, 0x6u);
+    EXPECT_DOUBLE_EQ(t.shares[0].prop, 0.25);
+    EXPECT_DOUBLE_EQ(t.shares[0].propSum, 1.0);
+
+    EXPECT_EQ(t.shares[1].neighbor, 0xeu);
+
+    EXPECT_EQ(t.shares[2].position, 1u);
+    EXPECT_EQ(t.shares[2].neighbor, 0x3u);
+    EXPECT_DOUBLE_EQ(t.shares[2].propSum, 0.5);
+}
+
+TEST(NeighborTopologyCacheTest, FindsInsertedTopology) {
+    NeighborTopologyCache cache;
+    EXPECT_EQ(cache.find("0123"), nullptr);
+
+    NeighborTopology t;
+    BuildNeighborTopology("0123", {}, t);
+    const NeighborTopology* cached = cache.insert("0123", t);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->nbText, t.nbText);
+
+    ASSERT_NE(cache.find("0123"), nullptr);
+    EXPECT_EQ(cache.find("0123")->nbText, t.nbText);
+    EXPECT_EQ(cache.find("0122"), nullptr);
+    EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST(NeighborTopologyCacheTest, RejectsTagsItCannotHold) {
+    NeighborTopologyCache cache;
+    NeighborTopology t;
+
+    EXPECT_NE(cache.insert("0123", t), nullptr);
+    EXPECT_EQ(cache.insert("0123", t), nullptr);   // already cached
+    EXPECT_EQ(cache.insert("01230", t), nullptr);  // another length
+    EXPECT_EQ(cache.insert(std::string(65, '0'), t), nullptr);
+    EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST(NeighborTopologyCacheTest, EmptiesWhenFull) {
+    NeighborTopologyCache cache(2);
+    NeighborTopology t;
+
+    EXPECT_NE(cache.insert("00", t), nullptr);
+    EXPECT_NE(cache.insert("01", t), nullptr);
+    EXPECT_EQ(cache.size(), 2u);
+
+    EXPECT_NE(cache.insert("02", t), nullptr);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.find("00"), nullptr);
+    EXPECT_NE(cache.find("02"), nullptr);
+
+    // a new length is accepted once emptied
+    EXPECT_NE(cache.insert("03", t), nullptr);
+    EXPECT_NE(cache.insert("000", t), nullptr);
+    EXPECT_EQ(cache.size(), 1u);
+}
@@ -0,0 +1,84 @@
+// Unit tests for the quality score lookup tables
+// Copyright 2025, NGSFeatures Project
+
+#include "QualityModel.hh"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+// Release builds may use -ffast-math, so the formulas are only compared to a
+// relative tolerance
+static void ExpectClose(double actual, double expected, int score) {
+    EXPECT_NEAR(actual, expected, 1e-12 * expected) << "score " << score;
+}
+
+TEST(QualityModelTest, SolexaTableMatchesFormula) {
+    const QualityModel solexa(QualityScale::Solexa);
+
+    for (int q = QualityModel::kMinScore; q <= QualityModel::kMaxScore; q++) {
+        double phred = 10.0 * std::log10(1.0 + std::pow(10.0, q / 10.0));
+        double err = std::pow(10.0, -phred / 10.0);
+        ExpectClose(solexa.errProb(q), err, q);
+        ExpectClose(solexa.baseErrProb(q), err / 3.0, q);
+    }
+}
+
+TEST(QualityModelTest, LogRatioTableMatchesFormula) {
+    // The expressions of FindNeighboursWithQualJuxt and the knapsack tool
+    const QualityModel solexa(QualityScale::Solexa, QualityFormula::LogRatio);
+    EXPECT_EQ(solexa.formula(), QualityFormula::LogRatio);
+
+    for (int q = QualityModel::kMinScore; q <= QualityModel::kMaxScore; q++) {
+        double phred = 10.00 * std::log(1.00 + std::pow(10.00, (q / 10.0))) / std::log(10.00);
+        double err = std::pow(10.0, -phred / 10.00) / 3;
+        ExpectClose(solexa.phred(q), phred, q);
+        ExpectClose(solexa.baseErrProb(q), err, q);
+        ExpectClose(solexa.negLogBaseErrProb(q), -std::log(err), q);
+    }
+    ExpectClose(solexa.baseErrProb(20.5), QualityModel(QualityScale::Solexa).baseErrProb(20.5), 20);
+}
+
+TEST(QualityModelTest, NonIntegerScoresAreComputed) {
+    const QualityModel solexa(QualityScale::Solexa);
+
+    double err = QualityModel::PhredToErrProb(QualityModel::SolexaToPhred(20.5));
+    EXPECT_DOUBLE_EQ(solexa.errProb(20.5), err);
+    EXPECT_LT(solexa.errProb(20.5), solexa.errProb(20));
+    EXPECT_GT(solexa.errProb(20.5), solexa.errProb(21));
+
+    // outside the tables
+    ExpectClose(solexa.errProb(200), QualityModel::PhredToErrProb(QualityModel::SolexaToPhred(200)), 200);
+    EXPECT_NEAR(solexa.errProb(-100), 1.0, 1e-9);
+}
+
+TEST(QualityModelTest, PhredScale) {
+    const QualityModel phred(QualityScale::Phred);
+
+    ExpectClose(phred.errProb(10), 0.1, 10);
+    ExpectClose(phred.errProb(30), 0.001, 30);
+    ExpectClose(phred.baseErrProb(20), 0.01 / 3.0, 20);
+    EXPECT_EQ(phred.phred(17.5), 17.5);
+}
+
+TEST(QualityModelTest, SolexaApproachesPhredAtHighScores) {
+    const QualityModel solexa(QualityScale::Solexa);
+
+    EXPECT_NEAR(solexa.phred(40), 40.0, 1e-3);
+    EXPECT_NEAR(solexa.phred(0), 10.0 * std::log10(2.0), 1e-12);
+    EXPECT_NEAR(solexa.errProb(-5), 1.0 / (1.0 + std::pow(10.0, -0.5)), 1e-12);
+}
+
+TEST(QualityModelTest, NegLogBaseErrProb) {
+    const QualityModel solexa(QualityScale::Solexa);
+
+    ExpectClose(solexa.negLogBaseErrProb(20), -std::log(solexa.baseErrProb(20)), 20);
+    ExpectClose(solexa.negLogBaseErrProb(20.5), -std::log(solexa.baseErrProb(20.5)), 20);
+}
+
+TEST(AsciiToScoreTest, DecodesEncodings) {
+    EXPECT_EQ(AsciiToScore('I', kPhred33Offset), 40);
+    EXPECT_EQ(AsciiToScore('!', kPhred33Offset), 0);
+    EXPECT_EQ(AsciiToScore('h', kPhred64Offset), 40);
+    EXPECT_EQ(AsciiToScore(';', kSolexa64Offset), -5);
+}
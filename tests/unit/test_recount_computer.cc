@@ -0,0 +1,130 @@
+// Unit tests for the threaded expectation computer of the ematch module
+// Copyright 2025, NGSFeatures Project
+
+#include "RecountComputerForGraphInMemory.hh"
+#include "RecountNeighborProbGraphInMemory.hh"
+#include "RecountTagCounts.hh"
+#include "TagSet.hh"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+using namespace cbrc;
+
+namespace {
+
+// Tag i spelled in base 4 over "0123", so the tags come out sorted
+std::string tagSeq(std::size_t i, std::size_t length) {
+    std::string seq(length, '0');
+    for (std::size_t pos = length; pos-- > 0; i /= 4) {
+        seq[pos] = "0123"[i % 4];
+    }
+    return seq;
+}
+
+}  // namespace
+
+class RecountComputerTest : public ::testing::Test {
+   protected:
+    // Enough tags for several 1024 tag chunks of the parallel gather.
+    // Every third tag has no record, the others up to six neighbors
+    // anywhere in the tag set, so most tags have sources in several chunks.
+    void SetUp() override {
+        const std::size_t numTags = 5000;
+
+        std::vector<std::string> seqs;
+        for (std::size_t i = 0; i < numTags; i++) {
+            seqs.push_back(tagSeq(i, 7));
+        }
+        tags.reset(new TagSet(seqs));
+
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<tagIdT> anyTag(0, numTags - 1);
+        std::uniform_int_distribution<int> numNeighbors(0, 6);
+        std::uniform_real_distribution<probT> anyProb(0.0, 1.0);
+
+        std::vector<tagIdT> nodeIds;
+        std::vector<std::size_t> offsets(1, 0);
+        tagIdVecT neighborIds;
+        probVecT neighborProbs;
+        for (tagIdT i = 0; i < numTags; i++) {
+            if (i % 3 == 2) continue;
+            nodeIds.push_back(i);
+            for (int k = numNeighbors(rng); k > 0; k--) {
+                neighborIds.push_back(anyTag(rng));
+                neighborProbs.push_back(anyProb(rng));
+            }
+            offsets.push_back(neighborIds.size());
+        }
+        graph.reset(new RecountNeighborProbGraphInMemory(*tags, nodeIds, offsets, neighborIds,
+                                                         neighborProbs));
+
+        trueCounts.setSize(numTags);
+        std::uniform_int_distribution<int> anyCount(0, 1000);
+        for (std::size_t i = 0; i < numTags; i++) {
+            trueCounts[i] = anyCount(rng) / 8.0;
+        }
+    }
+
+    std::unique_ptr<TagSet> tags;
+    std::unique_ptr<RecountNeighborProbGraphInMemory> graph;
+    RecountTagCounts trueCounts;
+};
+
+TEST_F(RecountComputerTest, MeanCountsDoNotDependOnThreads) {
+    RecountComputerForGraphInMemory serial(*graph, 0);
+    RecountTagCounts expected(trueCounts.size());
+    serial.meanCountsFromTrue(expected, trueCounts);
+
+    for (std::size_t numThreads : {1, 4}) {
+        RecountComputerForGraphInMemory computer(*graph, numThreads);
+        RecountTagCounts observed(trueCounts.size());
+        computer.meanCountsFromTrue(observed, trueCounts);
+
+        for (std::size_t j = 0; j < trueCounts.size(); j++) {
+            EXPECT_EQ(observed(j), expected(j)) << "tag " << j << ", " << numThreads
+                                                << " threads";
+        }
+    }
+}
+
+TEST_F(RecountComputerTest, VarianceCountsDoNotDependOnThreads) {
+    RecountComputerForGraphInMemory serial(*graph, 0);
+    RecountTagCounts expected(trueCounts.size());
+    serial.varianceCountsFromTrue(expected, trueCounts);
+
+    for (std::size_t numThreads : {1, 4}) {
+        RecountComputerForGraphInMemory computer(*graph, numThreads);
+        RecountTagCounts variances(trueCounts.size());
+        computer.varianceCountsFromTrue(variances, trueCounts);
+
+        for (std::size_t j = 0; j < trueCounts.size(); j++) {
+            EXPECT_EQ(variances(j), expected(j)) << "tag " << j << ", " << numThreads
+                                                 << " threads";
+        }
+    }
+}
+
+TEST_F(RecountComputerTest, SerialMeanCountsMatchEdgeSums) {
+    RecountComputerForGraphInMemory serial(*graph, 0);
+    RecountTagCounts observed(trueCounts.size());
+    serial.meanCountsFromTrue(observed, trueCounts);
+
+    tagCountT total = 0;
+    tagCountT expectedTotal = 0;
+    for (std::size_t j = 0; j < observed.size(); j++) {
+        total += observed(j);
+    }
+    for (std::size_t node = 0; node < graph->size(); node++) {
+        for (std::size_t k = graph->offset(node); k < graph->offset(node + 1); k++) {
+            expectedTotal += trueCounts(graph->nodeId(node)) * graph->neighborProbs()[k];
+        }
+    }
+    EXPECT_NEAR(total, expectedTotal, 1e-9 * expectedTotal);
+}
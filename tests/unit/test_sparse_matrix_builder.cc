@@ -0,0 +1,134 @@
+// Unit tests for the CSR/CSC sparse matrix builder
+// Copyright 2025, NGSFeatures Project
+
+#include "SparseMatrixBuilder.hh"
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+class SparseMatrixBuilderTest : public ::testing::Test {
+   protected:
+    // | 0.9 0.1 0   |
+    // | 0   1.0 0   |
+    // | 0.2 0.3 0.5 |
+    void SetUp() override {
+        SparseMatrixBuilder builder(3);
+        builder.addEntry(0, 0.9);
+        builder.addEntry(1, 0.1);
+        builder.endRow();
+        builder.addEntry(1, 1.0);
+        builder.endRow();
+        builder.addEntry(2, 0.5);
+        builder.addEntry(0, 0.2);
+        builder.addEntry(1, 0.3);
+        builder.endRow();
+        A = builder.finish();
+    }
+
+    CsrMatrix A;
+};
+
+TEST_F(SparseMatrixBuilderTest, BuildsRowsInOrder) {
+    EXPECT_EQ(A.numRows, 3u);
+    EXPECT_EQ(A.numCols, 3u);
+    EXPECT_EQ(A.nnz(), 6u);
+    EXPECT_EQ(A.rowPtr, (std::vector<std::uint64_t>{0, 2, 3, 6}));
+    EXPECT_EQ(A.colIdx, (std::vector<std::uint32_t>{0, 1, 1, 2, 0, 1}));
+}
+
+TEST_F(SparseMatrixBuilderTest, TransposeKeepsRowOrderWithinColumns) {
+    CsrMatrix At = TransposeCsr(A);
+
+    EXPECT_EQ(At.numRows, 3u);
+    EXPECT_EQ(At.rowPtr, (std::vector<std::uint64_t>{0, 2, 5, 6}));
+    EXPECT_EQ(At.colIdx, (std::vector<std::uint32_t>{0, 2, 0, 1, 2, 2}));
+    EXPECT_EQ(At.values, (std::vector<double>{0.9, 0.2, 0.1, 1.0, 0.3, 0.5}));
+}
+
+TEST_F(SparseMatrixBuilderTest, MultiplyMatchesDenseProduct) {
+    std::vector<double> x = {1.0, 2.0, 4.0};
+
+    std::vector<double> y = MultiplyCsr(A, x);
+    EXPECT_DOUBLE_EQ(y[0], 0.9 + 0.2);
+    EXPECT_DOUBLE_EQ(y[1], 2.0);
+    EXPECT_DOUBLE_EQ(y[2], 0.2 + 0.6 + 2.0);
+
+    std::vector<double> z = MultiplyCsr(TransposeCsr(A), x);
+    EXPECT_DOUBLE_EQ(z[0], 0.9 + 0.8);
+    EXPECT_DOUBLE_EQ(z[1], 0.1 + 2.0 + 1.2);
+    EXPECT_DOUBLE_EQ(z[2], 2.0);
+}
+
+TEST_F(SparseMatrixBuilderTest, BuilderIsReusableAfterFinish) {
+    SparseMatrixBuilder builder(2);
+    builder.addEntry(1, 1.0);
+    builder.endRow();
+    EXPECT_EQ(builder.numRows(), 1u);
+    builder.finish();
+    EXPECT_EQ(builder.numRows(), 0u);
+}
+
+TEST_F(SparseMatrixBuilderTest, RejectsColumnOutOfRange) {
+    SparseMatrixBuilder builder(2);
+    EXPECT_TRUE(builder.addEntry(1, 1.0));
+    EXPECT_FALSE(builder.hasRejectedEntries());
+    EXPECT_FALSE(builder.addEntry(2, 0.5));
+    EXPECT_TRUE(builder.hasRejectedEntries());
+    builder.endRow();
+
+    CsrMatrix B = builder.finish();
+    EXPECT_EQ(B.nnz(), 1u);
+    EXPECT_FALSE(builder.hasRejectedEntries());
+}
+
+TEST_F(SparseMatrixBuilderTest, PartitionSplitsRowsByNnz) {
+    EXPECT_EQ(PartitionRowsByNnz(A, 1), (std::vector<std::size_t>{0, 3}));
+    EXPECT_EQ(PartitionRowsByNnz(A, 2), (std::vector<std::size_t>{0, 2, 3}));
+
+    // More parts than rows leaves the extra blocks empty
+    std::vector<std::size_t> bounds = PartitionRowsByNnz(A, 5);
+    ASSERT_EQ(bounds.size(), 6u);
+    EXPECT_EQ(bounds.front(), 0u);
+    EXPECT_EQ(bounds.back(), 3u);
+    for (std::size_t t = 1; t < bounds.size(); t++) {
+        EXPECT_LE(bounds[t - 1], bounds[t]);
+    }
+}
+
+TEST(SparseMatrixLargeTest, MultiplyMatchesSerialProductOnLargeMatrix) {
+    // Big enough to take the parallel path when OpenMP is enabled
+    const std::size_t n = 40000;
+    SparseMatrixBuilder builder(n);
+    for (std::size_t i = 0; i < n; i++) {
+        builder.addEntry(static_cast<std::uint32_t>(i), 0.9);
+        for (std::size_t k = 1; k <= i % 5; k++) {
+            builder.addEntry(static_cast<std::uint32_t>((i * 7 + k * 13) % n), 0.01 * k);
+        }
+        builder.endRow();
+    }
+    CsrMatrix B = builder.finish();
+
+    std::vector<double> x(n);
+    for (std::size_t i = 0; i < n; i++) {
+        x[i] = 1.0 + static_cast<double>(i % 11);
+    }
+
+    std::vector<double> y = MultiplyCsr(B, x);
+    for (std::size_t i = 0; i < n; i += 997) {
+        double expected = 0.0;
+        for (std::uint64_t k = B.rowPtr[i]; k < B.rowPtr[i + 1]; k++) {
+            expected += B.values[k] * x[B.colIdx[k]];
+        }
+        EXPECT_EQ(y[i], expected);
+    }
+
+    std::vector<std::size_t> bounds = PartitionRowsByNnz(B, 4);
+    for (std::size_t t = 0; t < 4; t++) {
+        std::uint64_t blockNnz = B.rowPtr[bounds[t + 1]] - B.rowPtr[bounds[t]];
+        EXPECT_NEAR(static_cast<double>(blockNnz), B.nnz() / 4.0, 6.0);
+    }
+}
@@ -0,0 +1,71 @@
+// Unit tests for the packed-tag hash index
+// Copyright 2025, NGSFeatures Project
+
+#include "TagIndex.hh"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+TEST(PackTagTest, BothAlphabetsPackIdentically) {
+    PackedTag numeric, acgt;
+    ASSERT_TRUE(PackTag("0123", numeric));
+    ASSERT_TRUE(PackTag("ACGT", acgt));
+    EXPECT_EQ(numeric, acgt);
+    EXPECT_EQ(numeric.lo, 0x1bu);
+    EXPECT_EQ(numeric.hi, 0u);
+}
+
+TEST(PackTagTest, LongTagsSpillIntoHighWord) {
+    PackedTag p;
+    ASSERT_TRUE(PackTag(std::string(31, '0') + "3" + "1", p));
+    EXPECT_EQ(p.hi, 0u);
+    EXPECT_EQ(p.lo, 0xdu);
+
+    ASSERT_TRUE(PackTag("1" + std::string(32, '0'), p));
+    EXPECT_EQ(p.hi, 1u);
+    EXPECT_EQ(p.lo, 0u);
+
+    EXPECT_TRUE(PackTag(std::string(64, '3'), p));
+    EXPECT_FALSE(PackTag(std::string(65, '3'), p));
+    EXPECT_FALSE(PackTag("01N3", p));
+}
+
+TEST(TagIndexTest, FindsInsertedTags) {
+    TagIndex index;
+    EXPECT_TRUE(index.insert("0123", 0));
+    EXPECT_TRUE(index.insert("3210", 1));
+
+    EXPECT_EQ(index.size(), 2u);
+    EXPECT_EQ(index.find("0123"), 0);
+    EXPECT_EQ(index.find("TGCA"), 1);
+    EXPECT_EQ(index.find("0000"), TagIndex::npos);
+    EXPECT_EQ(index.find("012"), TagIndex::npos);
+}
+
+TEST(TagIndexTest, FirstInsertionWins) {
+    TagIndex index;
+    EXPECT_TRUE(index.insert("0123", 4));
+    EXPECT_FALSE(index.insert("0123", 7));
+    EXPECT_EQ(index.find("0123"), 4);
+    EXPECT_FALSE(index.insert("01230", 8));
+}
+
+TEST(TagIndexTest, GrowsPastInitialCapacity) {
+    TagIndex index;
+    const int n = 5000;
+    for (int i = 0; i < n; i++) {
+        std::string tag(8, '0');
+        int v = i;
+        for (int p = 7; p >= 0; p--, v /= 4) {
+            tag[p] = static_cast<char>('0' + v % 4);
+        }
+        ASSERT_TRUE(index.insert(tag, i));
+    }
+
+    std::vector<std::string> probe = {"00000000", "00000013", "01032001", "33333333"};
+    std::vector<int> ords;
+    index.findAll(probe, ords);
+    EXPECT_EQ(ords, (std::vector<int>{0, 7, 4993, TagIndex::npos}));
+}
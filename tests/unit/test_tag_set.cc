@@ -0,0 +1,227 @@
+// Unit tests for the tag sets of the ematch module
+// Copyright 2025, NGSFeatures Project
+
+#include "SortedTagSet.hh"
+#include "TagSet.hh"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+using namespace cbrc;
+
+namespace {
+
+std::string randomTag(std::mt19937& rng, std::size_t length) {
+    std::uniform_int_distribution<int> anyResidue(0, 3);
+    std::string seq(length, '0');
+    for (char& c : seq) {
+        c = "0123"[anyResidue(rng)];
+    }
+    return seq;
+}
+
+// numTags distinct random tags, with lengths drawn from lengths, sorted
+std::vector<std::string> randomTags(std::mt19937& rng, std::size_t numTags,
+                                    const std::vector<std::size_t>& lengths) {
+    std::uniform_int_distribution<std::size_t> anyLength(0, lengths.size() - 1);
+    std::set<std::string> tags;
+    while (tags.size() < numTags) {
+        tags.insert(randomTag(rng, lengths[anyLength(rng)]));
+    }
+    return std::vector<std::string>(tags.begin(), tags.end());
+}
+
+// Check find() and operator() of a tag set of tags against std::lower_bound,
+// for every tag and for random queries of each of the query lengths
+void expectMatchesLowerBound(std::mt19937& rng, const std::vector<std::string>& tags,
+                             const std::vector<std::size_t>& queryLengths) {
+    const TagSet tagSet(tags);
+    ASSERT_EQ(tagSet.size(), tags.size());
+
+    // integer keys when every tag has the same length, of at most 64 residues
+    bool sameLength = true;
+    for (const std::string& tag : tags) {
+        sameLength = sameLength && tag.size() == tags.front().size();
+    }
+    EXPECT_EQ(tagSet.hasPackedKeys(), sameLength && tags.front().size() <= 64);
+
+    std::vector<std::string> queries(tags);
+    for (std::size_t length : queryLengths) {
+        for (int i = 0; i < 500; i++) {
+            queries.push_back(randomTag(rng, length));
+        }
+    }
+    // the lowest and highest tags there could be
+    queries.push_back(std::string(tags.front().size(), '0'));
+    queries.push_back(std::string(tags.back().size(), '3'));
+
+    for (const std::string& query : queries) {
+        const std::size_t lower = std::lower_bound(tags.begin(), tags.end(), query) - tags.begin();
+        const bool present = lower < tags.size() && tags[lower] == query;
+        const std::size_t expected = present ? lower : tags.size();
+
+        EXPECT_EQ(tagSet.find(query), expected) << query;
+        EXPECT_EQ(tagSet.find(tagSet.toUnpackedSeq(query)), expected) << query;
+        EXPECT_EQ(tagSet.has(query), present) << query;
+        EXPECT_EQ(tagSet(query), lower) << query;
+    }
+}
+
+// Binary file of tagSet with the byte at pos replaced by value
+template <typename tagSetT>
+std::string patchedBinary(const tagSetT& tagSet, std::size_t pos, unsigned char value) {
+    std::ostringstream out;
+    tagSet.writeToBinaryStream(out);
+    std::string bytes = out.str();
+    bytes[pos] = value;
+    return bytes;
+}
+
+// Text tag list read by SortedTagSet: the number of tags, then one per line
+std::string sortedTagSetText(const std::vector<std::string>& tags) {
+    std::string text = std::to_string(tags.size()) + "\n";
+    for (const std::string& tag : tags) {
+        text += tag + "\n";
+    }
+    return text;
+}
+
+// Byte positions in the binary headers, after the signature
+const std::size_t kByteOrderMarkPos = 0;
+const std::size_t kFirstWidthPos = 4;
+const std::size_t kSecondWidthPos = 5;
+
+}  // namespace
+
+TEST(TagSetTest, FindsShortKeys) {
+    std::mt19937 rng(1);
+    expectMatchesLowerBound(rng, randomTags(rng, 3000, {10}), {10});
+}
+
+// Short enough that a fifth of the 4^6 tags are present
+TEST(TagSetTest, FindsDenseKeys) {
+    std::mt19937 rng(2);
+    expectMatchesLowerBound(rng, randomTags(rng, 800, {6}), {6});
+}
+
+TEST(TagSetTest, FindsLongest64BitKeys) {
+    std::mt19937 rng(3);
+    expectMatchesLowerBound(rng, randomTags(rng, 2000, {32}), {32});
+}
+
+// Over 32 residues the keys take 128 bits
+TEST(TagSetTest, Finds128BitKeys) {
+    std::mt19937 rng(4);
+    expectMatchesLowerBound(rng, randomTags(rng, 2000, {33}), {33});
+    expectMatchesLowerBound(rng, randomTags(rng, 2000, {40}), {40});
+    expectMatchesLowerBound(rng, randomTags(rng, 2000, {64}), {64});
+}
+
+// Queries of another length than the tags search the packed sequences
+TEST(TagSetTest, FindsQueriesOfOtherLengths) {
+    std::mt19937 rng(5);
+    expectMatchesLowerBound(rng, randomTags(rng, 2000, {10}), {9, 11});
+    expectMatchesLowerBound(rng, randomTags(rng, 2000, {40}), {39, 41});
+}
+
+// Tags of several lengths, or over 64 residues, have no keys
+TEST(TagSetTest, FindsWithoutKeys) {
+    std::mt19937 rng(6);
+    expectMatchesLowerBound(rng, randomTags(rng, 2000, {9, 10, 11}), {9, 10, 11});
+    expectMatchesLowerBound(rng, randomTags(rng, 500, {70}), {70});
+}
+
+TEST(TagSetTest, FindsInTinySets) {
+    std::mt19937 rng(7);
+    for (std::size_t numTags = 1; numTags <= 5; numTags++) {
+        expectMatchesLowerBound(rng, randomTags(rng, numTags, {4}), {4});
+        expectMatchesLowerBound(rng, randomTags(rng, numTags, {36}), {36});
+    }
+}
+
+TEST(TagSetBinaryTest, ReadsWhatItWrites) {
+    std::mt19937 rng(8);
+    for (const std::vector<std::size_t>& lengths :
+         std::vector<std::vector<std::size_t> >{{10}, {40}, {9, 10, 11}, {70}}) {
+        const std::vector<std::string> tags = randomTags(rng, 300, lengths);
+        const TagSet written(tags);
+
+        std::stringstream stream;
+        written.writeToBinaryStream(stream);
+        const TagSet read(stream);
+
+        ASSERT_EQ(read.size(), tags.size());
+        EXPECT_EQ(read.totalSize(), written.totalSize());
+        EXPECT_EQ(read.hasPackedKeys(), written.hasPackedKeys());
+        EXPECT_EQ(read.keyLength(), written.keyLength());
+        for (std::size_t i = 0; i < tags.size(); i++) {
+            EXPECT_EQ(read.toString(i), tags[i]);
+            EXPECT_EQ(read.find(tags[i]), i);
+        }
+    }
+}
+
+TEST(TagSetBinaryTest, RejectsOtherByteOrder) {
+    const TagSet tagSet(std::vector<std::string>{"0123", "1230", "2301"});
+    std::istringstream in(
+        patchedBinary(tagSet, TagSet::binarySignature().size() + kByteOrderMarkPos, 0));
+
+    EXPECT_DEATH(TagSet(in, TagSet::binary), "other byte order");
+}
+
+TEST(TagSetBinaryTest, RejectsOtherWidths) {
+    const TagSet tagSet(std::vector<std::string>{"0123", "1230", "2301"});
+
+    std::istringstream offsets(
+        patchedBinary(tagSet, TagSet::binarySignature().size() + kFirstWidthPos, 4));
+    EXPECT_DEATH(TagSet(offsets, TagSet::binary), "4 byte offsets");
+
+    std::istringstream packing(
+        patchedBinary(tagSet, TagSet::binarySignature().size() + kSecondWidthPos, 2));
+    EXPECT_DEATH(TagSet(packing, TagSet::binary), "2 residues per byte");
+}
+
+TEST(SortedTagSetBinaryTest, ReadsWhatItWrites) {
+    std::mt19937 rng(9);
+    const std::vector<std::string> tags = randomTags(rng, 300, {9, 10, 11});
+
+    std::istringstream text(sortedTagSetText(tags));
+    const SortedTagSet written(text);
+    ASSERT_EQ(written.size(), tags.size());
+
+    std::stringstream stream;
+    written.writeToBinaryStream(stream);
+    const SortedTagSet read(stream);
+
+    ASSERT_EQ(read.size(), tags.size());
+    for (std::size_t i = 0; i < tags.size(); i++) {
+        EXPECT_EQ(read.toString(read(i)), tags[i]);
+        EXPECT_EQ(read(read(i)), i);
+    }
+}
+
+TEST(SortedTagSetBinaryTest, RejectsOtherByteOrder) {
+    std::istringstream text(sortedTagSetText({"0123", "1230", "2301"}));
+    const SortedTagSet tagSet(text);
+    std::istringstream in(
+        patchedBinary(tagSet, SortedTagSet::binarySignature().size() + kByteOrderMarkPos, 0));
+
+    EXPECT_DEATH(SortedTagSet(in, SortedTagSet::binary), "other byte order");
+}
+
+TEST(SortedTagSetBinaryTest, RejectsOtherTagLengthWidth) {
+    std::istringstream text(sortedTagSetText({"0123", "1230", "2301"}));
+    const SortedTagSet tagSet(text);
+    std::istringstream in(
+        patchedBinary(tagSet, SortedTagSet::binarySignature().size() + kFirstWidthPos, 4));
+
+    EXPECT_DEATH(SortedTagSet(in, SortedTagSet::binary), "4 byte tag lengths");
+}